@@ -0,0 +1,128 @@
+/*
+ * This file is part of the ftl (Fast Template Library) distribution (https://github.com/zjgoggle/ftl).
+ * Copyright (c) 2020 Jack Zhang.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <string_view>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace zj
+{
+
+/// \brief Bump allocator over large chunks. Allocations are never freed individually; clear() frees all the chunks at once.
+/// \note Objects allocated in Arena are not destructed by Arena.
+class Arena
+{
+public:
+    static constexpr size_t DefaultChunkSize = 1 << 20;
+
+protected:
+    std::vector<std::unique_ptr<char[]>> m_chunks;
+    char *m_pos = nullptr, *m_end = nullptr; // free space in the last chunk.
+    size_t m_chunkSize = DefaultChunkSize;
+    size_t m_bytesAllocated = 0;
+
+public:
+    explicit Arena( size_t chunkSize = DefaultChunkSize ) : m_chunkSize( chunkSize )
+    {
+    }
+    Arena( const Arena & ) = delete;
+    Arena &operator=( const Arena & ) = delete;
+    // the moved-from arena is left empty, so that it doesn't allocate in the chunks it gave away.
+    Arena( Arena &&a ) noexcept
+            : m_chunks( std::move( a.m_chunks ) ), m_pos( std::exchange( a.m_pos, nullptr ) ), m_end( std::exchange( a.m_end, nullptr ) ),
+              m_chunkSize( a.m_chunkSize ), m_bytesAllocated( std::exchange( a.m_bytesAllocated, 0 ) )
+    {
+        a.m_chunks.clear();
+    }
+    Arena &operator=( Arena &&a ) noexcept
+    {
+        if ( this != &a )
+        {
+            m_chunks = std::move( a.m_chunks );
+            a.m_chunks.clear();
+            m_pos = std::exchange( a.m_pos, nullptr );
+            m_end = std::exchange( a.m_end, nullptr );
+            m_chunkSize = a.m_chunkSize;
+            m_bytesAllocated = std::exchange( a.m_bytesAllocated, 0 );
+        }
+        return *this;
+    }
+
+    /// \pre align is a power of 2.
+    void *allocate( size_t n, size_t align = alignof( std::max_align_t ) )
+    {
+        auto p = reinterpret_cast<char *>( ( reinterpret_cast<uintptr_t>( m_pos ) + align - 1 ) & ~uintptr_t( align - 1 ) );
+        if ( !m_pos || p + n > m_end )
+        {
+            newChunk( n + align );
+            p = reinterpret_cast<char *>( ( reinterpret_cast<uintptr_t>( m_pos ) + align - 1 ) & ~uintptr_t( align - 1 ) );
+        }
+        m_pos = p + n;
+        m_bytesAllocated += n;
+        return p;
+    }
+    /// \brief Allocate n uninitialized objects of T.
+    template<class T>
+    T *allocate_n( size_t n )
+    {
+        return static_cast<T *>( allocate( sizeof( T ) * n, alignof( T ) ) );
+    }
+    /// \return a copy of s in arena.
+    std::string_view copyStr( std::string_view s )
+    {
+        if ( s.empty() )
+            return {};
+        auto p = static_cast<char *>( allocate( s.size(), 1 ) );
+        std::memcpy( p, s.data(), s.size() );
+        return std::string_view( p, s.size() );
+    }
+
+    /// \brief Free all the chunks.
+    void clear()
+    {
+        m_chunks.clear();
+        m_pos = m_end = nullptr;
+        m_bytesAllocated = 0;
+    }
+    size_t countChunks() const
+    {
+        return m_chunks.size();
+    }
+    size_t bytesAllocated() const
+    {
+        return m_bytesAllocated;
+    }
+
+protected:
+    // An allocation larger than chunk size gets its own chunk.
+    void newChunk( size_t minSize )
+    {
+        size_t n = std::max( m_chunkSize, minSize );
+        m_chunks.emplace_back( new char[n] );
+        m_pos = m_chunks.back().get();
+        m_end = m_pos + n;
+    }
+};
+
+} // namespace zj
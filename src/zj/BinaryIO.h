@@ -0,0 +1,790 @@
+/*
+ * This file is part of the ftl (Fast Template Library) distribution (https://github.com/zjgoggle/ftl).
+ * Copyright (c) 2020 Jack Zhang.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <zj/IDataFrame.h>
+#include <zj/MappedFile.h>
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+
+namespace zj
+{
+
+///////////////////////////////////////////////////////////////
+/// DFBC binary DataFrame (see "DataFrame Storage Layout" in IDataFrame.h).
+///////////////////////////////////////////////////////////////
+
+static constexpr char DFBC_TypeCode[4] = {'D', 'F', 'B', 'C'};
+static constexpr char DFBI_TypeCode[4] = {'D', 'F', 'B', 'I'}; // index file, see DataFrameWithIndex::saveIndexes.
+static constexpr size_t MaxBinaryColNameLength = 127;
+
+/// \brief Buffered writer of raw values in host byte order. Bytes are flushed to the stream in large blocks.
+class BinaryWriter
+{
+public:
+    static constexpr size_t BlockSize = 1 << 20;
+
+protected:
+    std::ostream &m_os;
+    std::string m_buf;
+    size_t m_flushed = 0;
+
+public:
+    explicit BinaryWriter( std::ostream &os ) : m_os( os )
+    {
+        m_buf.reserve( BlockSize + BlockSize / 4 );
+    }
+    ~BinaryWriter()
+    {
+        flush();
+    }
+
+    template<class T>
+    void put( const T &val )
+    {
+        static_assert( std::is_trivially_copyable_v<T>, "T must be trivially copyable!" );
+        putBytes( &val, sizeof( T ) );
+    }
+    void putBytes( const void *p, size_t n )
+    {
+        m_buf.append( static_cast<const char *>( p ), n );
+        if ( m_buf.size() >= BlockSize )
+            flush();
+    }
+    bool flush()
+    {
+        if ( !m_buf.empty() )
+        {
+            m_os.write( m_buf.data(), m_buf.size() );
+            m_flushed += m_buf.size();
+            m_buf.clear();
+        }
+        return m_os.good();
+    }
+    /// \return number of bytes put, including the buffered bytes.
+    size_t bytesWritten() const
+    {
+        return m_flushed + m_buf.size();
+    }
+};
+
+/// \brief Bounds-checked reader of raw values in host byte order from a memory block.
+class BinaryReader
+{
+protected:
+    const char *m_pos = nullptr, *m_end = nullptr;
+
+public:
+    BinaryReader( const char *p, size_t n ) : m_pos( p ), m_end( p + n )
+    {
+    }
+
+    template<class T>
+    bool get( T &val )
+    {
+        static_assert( std::is_trivially_copyable_v<T>, "T must be trivially copyable!" );
+        if ( remaining() < sizeof( T ) )
+            return false;
+        std::memcpy( &val, m_pos, sizeof( T ) );
+        m_pos += sizeof( T );
+        return true;
+    }
+    /// \brief Get n bytes without copy. p points into the memory block.
+    bool getBytes( size_t n, const char *&p )
+    {
+        if ( remaining() < n )
+            return false;
+        p = m_pos;
+        m_pos += n;
+        return true;
+    }
+    size_t remaining() const
+    {
+        return size_t( m_end - m_pos );
+    }
+};
+
+/// \brief Write a block: 4-byte typeCode, 8-byte length of body, and body written by writeBody(BinaryWriter &), which returns false on error.
+/// \pre os is seekable, as the length is written after body. Open file streams in binary mode.
+template<class WriteBody>
+bool write_binary_block( std::ostream &os, const char ( &typeCode )[4], WriteBody &&writeBody, std::ostream *err = nullptr )
+{
+    os.write( typeCode, sizeof( typeCode ) );
+    const auto lengthPos = os.tellp();
+    if ( lengthPos < 0 )
+    {
+        if ( err )
+            *err << "write_binary_block: output stream is not seekable.\n";
+        return false;
+    }
+    {
+        BinaryWriter w( os );
+        w.put( uint64_t( 0 ) ); // length, written after body.
+        if ( !writeBody( w ) )
+            return false;
+        if ( !w.flush() )
+        {
+            if ( err )
+                *err << "write_binary_block: failed to write " << std::string( typeCode, sizeof( typeCode ) ) << ".\n";
+            return false;
+        }
+    }
+    const auto endPos = os.tellp();
+    const uint64_t length = uint64_t( endPos - lengthPos ) - sizeof( uint64_t );
+    os.seekp( lengthPos );
+    os.write( reinterpret_cast<const char *>( &length ), sizeof( length ) );
+    os.seekp( endPos );
+    if ( !os.good() )
+    {
+        if ( err )
+            *err << "write_binary_block: failed to write length.\n";
+        return false;
+    }
+    return true;
+}
+/// \brief Read the body of a block written by write_binary_block into data in one read.
+inline bool read_binary_block( std::istream &is, const char ( &typeCode )[4], std::string &data, std::ostream *err = nullptr )
+{
+    char code[sizeof( typeCode )];
+    uint64_t length = 0;
+    if ( !is.read( code, sizeof( code ) ) || std::memcmp( code, typeCode, sizeof( code ) ) != 0 )
+    {
+        if ( err )
+            *err << "read_binary_block: not a " << std::string( typeCode, sizeof( typeCode ) ) << " stream.\n";
+        return false;
+    }
+    if ( !is.read( reinterpret_cast<char *>( &length ), sizeof( length ) ) )
+    {
+        if ( err )
+            *err << "read_binary_block: failed to read length.\n";
+        return false;
+    }
+    // a corrupt length fails before allocation if the stream is seekable, or by EOF as data grows by blocks.
+    if ( const auto pos = is.tellg(); pos != std::istream::pos_type( -1 ) && is.seekg( 0, std::ios::end ) )
+    {
+        const uint64_t available = uint64_t( is.tellg() - pos );
+        is.seekg( pos );
+        if ( length > available )
+        {
+            if ( err )
+                *err << "read_binary_block: length " << length << " exceeds stream size " << available << ".\n";
+            return false;
+        }
+    }
+    is.clear();
+    static constexpr uint64_t BlockSize = 1 << 24;
+    data.clear();
+    while ( data.size() < length )
+    {
+        const size_t n = data.size(), len = size_t( std::min( length - n, BlockSize ) );
+        data.resize( n + len );
+        if ( !is.read( data.data() + n, std::streamsize( len ) ) )
+        {
+            if ( err )
+                *err << "read_binary_block: expected " << length << " bytes but got " << n + size_t( is.gcount() ) << ".\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Value encoding: Bool as 1 byte; Str as 4-byte length and bytes; Timestamp as 8-byte nanos and 4-byte Timestamp::formatBits();
+// vector as 4-byte count and elements; other scalars as raw bytes.
+template<class T>
+void write_binary_value( BinaryWriter &w, const T &val )
+{
+    if constexpr ( std::is_same_v<T, Str> || std::is_same_v<T, std::string_view> )
+    {
+        w.put( uint32_t( val.size() ) );
+        w.putBytes( val.data(), val.size() );
+    }
+    else if constexpr ( std::is_same_v<T, Timestamp> )
+    {
+        w.put( val.nanos );
+        w.put( val.formatBits() );
+    }
+    else if constexpr ( std::is_same_v<T, bool> )
+        w.put( uint8_t( val ) );
+    else if constexpr ( FieldValue<T>::is_vec )
+    {
+        w.put( uint32_t( val.size() ) );
+        for ( const auto &e : val )
+            write_binary_value<typename T::value_type>( w, e );
+    }
+    else
+        w.put( val );
+}
+/// \return number of bytes written by write_binary_value.
+template<class T>
+size_t binary_value_size( const T &val )
+{
+    if constexpr ( std::is_same_v<T, Str> || std::is_same_v<T, std::string_view> )
+        return sizeof( uint32_t ) + val.size();
+    else if constexpr ( std::is_same_v<T, Timestamp> )
+        return sizeof( int64_t ) + sizeof( uint32_t );
+    else if constexpr ( std::is_same_v<T, bool> )
+        return sizeof( uint8_t );
+    else if constexpr ( FieldValue<T>::is_vec )
+    {
+        size_t n = sizeof( uint32_t );
+        for ( const auto &e : val )
+            n += binary_value_size<typename T::value_type>( e );
+        return n;
+    }
+    else
+        return sizeof( T );
+}
+template<class T>
+bool read_binary_value( BinaryReader &r, T &val )
+{
+    if constexpr ( std::is_same_v<T, Str> )
+    {
+        uint32_t len;
+        const char *p;
+        if ( !r.get( len ) || !r.getBytes( len, p ) )
+            return false;
+        val.assign( p, len );
+        return true;
+    }
+    else if constexpr ( std::is_same_v<T, Timestamp> )
+    {
+        int64_t nanos;
+        uint32_t bits;
+        if ( !r.get( nanos ) || !r.get( bits ) )
+            return false;
+        val = Timestamp::fromFormatBits( nanos, bits );
+        return true;
+    }
+    else if constexpr ( std::is_same_v<T, bool> )
+    {
+        uint8_t b;
+        if ( !r.get( b ) )
+            return false;
+        val = b != 0;
+        return true;
+    }
+    else if constexpr ( FieldValue<T>::is_vec )
+    {
+        uint32_t n;
+        if ( !r.get( n ) )
+            return false;
+        val.clear();
+        val.reserve( std::min<size_t>( n, r.remaining() ) );
+        for ( uint32_t i = 0; i < n; ++i )
+        {
+            typename T::value_type e{};
+            if ( !read_binary_value( r, e ) )
+                return false;
+            val.push_back( std::move( e ) );
+        }
+        return true;
+    }
+    else
+        return r.get( val );
+}
+
+// invoked by static_invoke_for_type with field type. Writes the value of a CompactField without materializing VarField.
+struct WriteBinaryCompactField
+{
+    template<class T>
+    void invoke( BinaryWriter &w, const CompactField &field ) const
+    {
+        if constexpr ( !std::is_same_v<T, Null> )
+            write_binary_value( w, field.value<T>() );
+    }
+};
+struct ReadBinaryField
+{
+    template<class T>
+    bool invoke( BinaryReader &r, VarField &var ) const
+    {
+        if constexpr ( std::is_same_v<T, Null> )
+        {
+            var = NullField{};
+            return true;
+        }
+        else
+        {
+            FieldValue<T> fieldval{};
+            if ( !read_binary_value( r, fieldval.value ) )
+                return false;
+            var = std::move( fieldval );
+            return true;
+        }
+    }
+};
+
+/// \brief Write 1-byte FieldTypeTag and the value, or no value if it's Null.
+inline void write_binary_field( BinaryWriter &w, const VarField &var )
+{
+    w.put( u_char( var.index() ) );
+    std::visit(
+            [&w]( const auto &fieldval ) {
+                if constexpr ( !std::is_same_v<std::decay_t<decltype( fieldval.value )>, Null> )
+                    write_binary_value( w, fieldval.value );
+            },
+            var );
+}
+/// \brief Read a field written by write_binary_field.
+inline bool read_binary_field( BinaryReader &r, VarField &var )
+{
+    u_char type;
+    if ( !r.get( type ) || type >= u_char( FieldTypeTag::End ) )
+        return false;
+    return static_invoke_for_type( FieldTypeTag( type ), ReadBinaryField(), r, var );
+}
+
+/// \brief Write 4-byte NumCols and column definitions of df.
+inline bool write_binary_column_defs( BinaryWriter &w, const IDataFrame &df, std::ostream *err = nullptr )
+{
+    const size_t ncols = df.countCols();
+    w.put( uint32_t( ncols ) );
+    for ( size_t icol = 0; icol < ncols; ++icol )
+    {
+        const ColumnDef &colDef = df.columnDef( icol );
+        if ( colDef.colName.size() > MaxBinaryColNameLength )
+        {
+            if ( err )
+                *err << "save_binary: column name is longer than " << MaxBinaryColNameLength << ": " << colDef.colName << ".\n";
+            return false;
+        }
+        w.put( u_char( colDef.colTypeTag ) );
+        w.put( u_char( colDef.encoding ) );
+        w.put( u_char( colDef.colName.size() ) );
+        w.putBytes( colDef.colName.data(), colDef.colName.size() );
+    }
+    return true;
+}
+/// \brief Read column definitions written by write_binary_column_defs.
+inline bool read_binary_column_defs( BinaryReader &r, ColumnDefs &columnDefs, std::ostream *err = nullptr )
+{
+    auto fail = [err]( const std::string &msg ) {
+        if ( err )
+            *err << "load_binary: " << msg << ".\n";
+        return false;
+    };
+    uint32_t ncols = 0;
+    if ( !r.get( ncols ) )
+        return fail( "failed to read number of columns" );
+    columnDefs.clear();
+    for ( uint32_t i = 0; i < ncols; ++i )
+    {
+        u_char type, encoding, len;
+        const char *name;
+        if ( !r.get( type ) || !r.get( encoding ) || !r.get( len ) || !r.getBytes( len, name ) )
+            return fail( "failed to read column definition" );
+        if ( type == 0 || type >= u_char( FieldTypeTag::End ) )
+            return fail( "invalid column type: " + std::to_string( type ) );
+        if ( encoding > u_char( ColumnEncoding::DeltaOfDelta ) )
+            return fail( "invalid column encoding: " + std::to_string( encoding ) );
+        columnDefs.push_back( ColumnDef{FieldTypeTag( type ), std::string( name, len ), ColumnEncoding( encoding )} );
+    }
+    return true;
+}
+
+/// \brief Column block of DFBC in memory, of which values are read with memcpy as they may be unaligned.
+struct DFBCColumnBlock
+{
+    size_t nullCount = 0;
+    const char *validity = nullptr; // bitmap words, in which bit 1 is a valid value. nullptr if there is no null.
+    const char *values = nullptr;
+    const char *aux = nullptr; // Timestamp format bits; bytes of Str and vector cells, indexed by NumRows+1 offsets in values.
+
+    template<class U>
+    static U load( const char *p, size_t i )
+    {
+        U val;
+        std::memcpy( &val, p + i * sizeof( U ), sizeof( U ) );
+        return val;
+    }
+    bool isNull( size_t irow ) const
+    {
+        return validity && !( ( load<uint64_t>( validity, irow / Bitmap::WordBits ) >> ( irow % Bitmap::WordBits ) ) & 1u );
+    }
+    /// \return bytes of the Str or vector cell at irow.
+    std::string_view cellBytes( size_t irow ) const
+    {
+        const auto begin = load<uint64_t>( values, irow ), end = load<uint64_t>( values, irow + 1 );
+        return std::string_view( aux + begin, size_t( end - begin ) );
+    }
+    /// \brief Get the value at irow, which is not null.
+    template<class T>
+    bool get( size_t irow, T &val ) const
+    {
+        if constexpr ( std::is_same_v<T, bool> )
+            val = ( load<uint64_t>( values, irow / Bitmap::WordBits ) >> ( irow % Bitmap::WordBits ) ) & 1u;
+        else if constexpr ( std::is_same_v<T, Timestamp> )
+            val = Timestamp::fromFormatBits( load<int64_t>( values, irow ), load<uint32_t>( aux, irow ) );
+        else if constexpr ( std::is_same_v<T, Str> )
+            val.assign( cellBytes( irow ) );
+        else if constexpr ( FieldValue<T>::is_vec )
+        {
+            auto bytes = cellBytes( irow );
+            BinaryReader r( bytes.data(), bytes.size() );
+            return read_binary_value( r, val ) && !r.remaining();
+        }
+        else
+            val = load<T>( values, irow );
+        return true;
+    }
+};
+
+// invoked by static_invoke_for_type with column type. Writes the column block of column icol (see "DataFrame Storage Layout").
+struct WriteBinaryColumn
+{
+    template<class T>
+    void invoke( BinaryWriter &w, const IDataFrame &df, size_t icol ) const
+    {
+        const size_t nrows = df.countRows();
+        if constexpr ( std::is_same_v<T, Null> )
+            w.put( uint64_t( nrows ) );
+        else
+        {
+            using FieldT = FieldValue<T>;
+            // plain column values are written in bulk; the other columns and DataFrames are traversed by column.
+            if constexpr ( std::is_trivially_copyable_v<T> && !std::is_same_v<T, bool> )
+            {
+                const IColumn *pCol = df.getColumn( icol );
+                if ( auto values = pCol ? static_cast<const T *>( pCol->plainValues() ) : nullptr )
+                {
+                    writeValidity( w, nrows, pCol->countNulls(), pCol->validity() );
+                    if constexpr ( std::is_same_v<T, Timestamp> )
+                    {
+                        for ( size_t i = 0; i < nrows; ++i )
+                            w.put( values[i].nanos );
+                        for ( size_t i = 0; i < nrows; ++i )
+                            w.put( values[i].formatBits() );
+                    }
+                    else
+                        w.putBytes( values, nrows * sizeof( T ) );
+                    return;
+                }
+            }
+            // return nullptr for null. The field is short-lived (see nextFieldSlot), and so is the converted value.
+            T converted{};
+            auto fieldAt = [&]( size_t irow ) -> const T * { return field_value_as( df.at( irow, icol ), converted ); };
+            Bitmap validity( nrows, true );
+            size_t nullCount = 0;
+            std::vector<uint64_t> offsets; // of Str and vector cells.
+            if constexpr ( std::is_same_v<T, Str> || FieldT::is_vec )
+                offsets.assign( 1, 0 );
+            for ( size_t irow = 0; irow < nrows; ++irow )
+            {
+                auto p = fieldAt( irow );
+                if ( !p )
+                    validity.set( irow, false ), ++nullCount;
+                if constexpr ( std::is_same_v<T, Str> )
+                    offsets.push_back( offsets.back() + ( p ? p->size() : 0 ) );
+                else if constexpr ( FieldT::is_vec )
+                    offsets.push_back( offsets.back() + ( p ? binary_value_size( *p ) : 0 ) );
+            }
+            writeValidity( w, nrows, nullCount, &validity );
+            if constexpr ( std::is_same_v<T, bool> )
+            {
+                Bitmap bits( nrows );
+                for ( size_t irow = 0; irow < nrows; ++irow )
+                    if ( auto p = fieldAt( irow ) )
+                        bits.set( irow, *p );
+                w.putBytes( bits.words().data(), bits.words().size() * sizeof( uint64_t ) );
+            }
+            else if constexpr ( std::is_same_v<T, Timestamp> )
+            {
+                std::vector<uint32_t> formatBits( nrows );
+                for ( size_t irow = 0; irow < nrows; ++irow )
+                {
+                    auto p = fieldAt( irow );
+                    w.put( p ? p->nanos : int64_t( 0 ) );
+                    formatBits[irow] = p ? p->formatBits() : 0;
+                }
+                w.putBytes( formatBits.data(), nrows * sizeof( uint32_t ) );
+            }
+            else if constexpr ( std::is_same_v<T, Str> || FieldT::is_vec )
+            {
+                w.putBytes( offsets.data(), offsets.size() * sizeof( uint64_t ) );
+                for ( size_t irow = 0; irow < nrows; ++irow )
+                {
+                    if ( auto p = fieldAt( irow ) )
+                    {
+                        if constexpr ( std::is_same_v<T, Str> )
+                            w.putBytes( p->data(), p->size() );
+                        else
+                            write_binary_value( w, *p );
+                    }
+                }
+            }
+            else
+            {
+                for ( size_t irow = 0; irow < nrows; ++irow )
+                {
+                    auto p = fieldAt( irow );
+                    w.put( p ? *p : T{} );
+                }
+            }
+        }
+    }
+
+protected:
+    static void writeValidity( BinaryWriter &w, size_t nrows, size_t nullCount, const Bitmap *validity )
+    {
+        w.put( uint64_t( nullCount ) );
+        if ( nullCount )
+        {
+            for ( size_t i = 0, nwords = Bitmap::countWords( nrows ); i < nwords; ++i )
+                w.put( validity && i < validity->words().size() ? validity->words()[i] : ~uint64_t( 0 ) );
+        }
+    }
+};
+
+// invoked by static_invoke_for_type with column type. Locates the column block of nrows rows, and advances r past it.
+struct ParseBinaryColumn
+{
+    template<class T>
+    bool invoke( BinaryReader &r, size_t nrows, DFBCColumnBlock &block ) const
+    {
+        uint64_t nullCount = 0;
+        if ( !r.get( nullCount ) || nullCount > nrows )
+            return false;
+        block.nullCount = nullCount;
+        const size_t nwords = Bitmap::countWords( nrows );
+        if ( nullCount && !std::is_same_v<T, Null> && !r.getBytes( nwords * sizeof( uint64_t ), block.validity ) )
+            return false;
+        if constexpr ( std::is_same_v<T, Null> )
+            return nullCount == nrows;
+        else if constexpr ( std::is_same_v<T, bool> )
+            return r.getBytes( nwords * sizeof( uint64_t ), block.values );
+        else if constexpr ( std::is_same_v<T, Timestamp> )
+            return r.remaining() / ( sizeof( int64_t ) + sizeof( uint32_t ) ) >= nrows && r.getBytes( nrows * sizeof( int64_t ), block.values ) &&
+                   r.getBytes( nrows * sizeof( uint32_t ), block.aux );
+        else if constexpr ( std::is_same_v<T, Str> || FieldValue<T>::is_vec )
+        {
+            if ( r.remaining() / sizeof( uint64_t ) <= nrows || !r.getBytes( ( nrows + 1 ) * sizeof( uint64_t ), block.values ) )
+                return false;
+            uint64_t prev = 0;
+            for ( size_t i = 0; i <= nrows; ++i ) // offsets start from 0 and don't decrease.
+            {
+                const auto offset = DFBCColumnBlock::load<uint64_t>( block.values, i );
+                if ( offset < prev || ( i == 0 && offset != 0 ) )
+                    return false;
+                prev = offset;
+            }
+            return r.getBytes( prev, block.aux );
+        }
+        else
+            return r.remaining() / sizeof( T ) >= nrows && r.getBytes( nrows * sizeof( T ), block.values );
+    }
+};
+
+// invoked by static_invoke_for_type with column type. Appends values of a column block to the column storage in one typed loop.
+struct ReadBinaryColumn
+{
+    template<class T>
+    bool invoke( const DFBCColumnBlock &block, size_t nrows, IColumn &col ) const
+    {
+        if constexpr ( std::is_same_v<T, Null> )
+        {
+            for ( size_t irow = 0; irow < nrows; ++irow )
+                col.appendNull();
+            return true;
+        }
+        else if constexpr ( std::is_same_v<T, bool> )
+        {
+            if ( auto p = dynamic_cast<BoolColumn *>( &col ) )
+                return load<T>( block, nrows, col, [p]( bool val ) { p->push_back( val ); return true; } );
+        }
+        else if constexpr ( std::is_same_v<T, Str> )
+        {
+            if ( auto p = dynamic_cast<DictStrColumn *>( &col ) )
+            {
+                for ( size_t irow = 0; irow < nrows; ++irow )
+                    block.isNull( irow ) ? p->appendNull() : p->push_back( block.cellBytes( irow ) );
+                return true;
+            }
+        }
+        else if constexpr ( FieldValue<T>::is_vec )
+        {
+            if ( auto p = dynamic_cast<ListColumn<typename T::value_type> *>( &col ) )
+                return load<T>( block, nrows, col, [p]( const T &val ) { p->push_back( val.begin(), val.end() ); return true; } );
+        }
+        if constexpr ( !std::is_same_v<T, bool> && !FieldValue<T>::is_vec )
+        {
+            if ( auto p = dynamic_cast<TypedColumn<T> *>( &col ) )
+            {
+                p->reserve( p->size() + nrows );
+                return load<T>( block, nrows, col, [p]( T &val ) { p->push_back( std::move( val ) ); return true; } );
+            }
+        }
+        // other storages, e.g. run-length and integer codecs, append fields.
+        return load<T>( block, nrows, col, [&col]( T &val ) { return col.append( FieldValue<T>{std::move( val )} ); } );
+    }
+
+protected:
+    template<class T, class Push>
+    static bool load( const DFBCColumnBlock &block, size_t nrows, IColumn &col, Push &&push )
+    {
+        T val{};
+        for ( size_t irow = 0; irow < nrows; ++irow )
+        {
+            if ( block.isNull( irow ) )
+                col.appendNull();
+            else if ( !block.get( irow, val ) || !push( val ) )
+                return false;
+        }
+        return true;
+    }
+};
+
+// invoked by static_invoke_for_type with column type. Gets the field at irow of a column block.
+struct ReadBinaryCell
+{
+    template<class T>
+    bool invoke( const DFBCColumnBlock &block, size_t irow, VarField &var ) const
+    {
+        if constexpr ( !std::is_same_v<T, Null> )
+        {
+            if ( !block.isNull( irow ) )
+            {
+                FieldValue<T> fieldval{};
+                if ( !block.get( irow, fieldval.value ) )
+                    return false;
+                var = std::move( fieldval );
+                return true;
+            }
+        }
+        var = NullField{};
+        return true;
+    }
+};
+
+/// \brief Write df as DFBC: header, column definitions and a block of typed values per column.
+/// \pre os is seekable, as the length in header is written after columns. Open file streams in binary mode.
+inline bool save_binary( const IDataFrame &df, std::ostream &os, std::ostream *err = nullptr )
+{
+    return write_binary_block(
+            os,
+            DFBC_TypeCode,
+            [&]( BinaryWriter &w ) {
+                if ( !write_binary_column_defs( w, df, err ) )
+                    return false;
+                w.put( uint64_t( df.countRows() ) );
+                for ( size_t icol = 0, ncols = df.countCols(); icol < ncols; ++icol )
+                    static_invoke_for_type( df.columnDef( icol ).colTypeTag, WriteBinaryColumn(), w, df, icol );
+                return true;
+            },
+            err );
+}
+inline bool save_binary( const IDataFrame &df, const std::string &filename, std::ostream *err = nullptr )
+{
+    std::ofstream ofs( filename, std::ios::binary | std::ios::trunc );
+    if ( !ofs )
+    {
+        if ( err )
+            *err << "save_binary: failed to open file: " << filename << ".\n";
+        return false;
+    }
+    return save_binary( df, ofs, err );
+}
+
+/// \brief Reader of DFBC. A file is memory-mapped, and a stream is read in one block. Column blocks are located on open, and then
+/// read by column into column storages (readColumn), or by row (next).
+class DFBCReader
+{
+protected:
+    std::string m_data;
+    MappedFile m_file;
+    ColumnDefs m_columnDefs;
+    std::vector<DFBCColumnBlock> m_blocks;
+    size_t m_numRows = 0;
+    size_t m_nextRow = 0;
+
+public:
+    bool open( std::istream &is, std::ostream *err = nullptr )
+    {
+        return read_binary_block( is, DFBC_TypeCode, m_data, err ) && parse( m_data.data(), m_data.size(), err );
+    }
+    bool open( const std::string &filename, std::ostream *err = nullptr )
+    {
+        if ( MappedFile::isEmptyFile( filename ) )
+            return fail( err, "empty file: " + filename );
+        if ( !m_file.open( filename, err ) )
+            return false;
+        m_file.adviseSequential();
+        BinaryReader r( m_file.data(), m_file.size() );
+        const char *code;
+        uint64_t length = 0;
+        if ( !r.getBytes( sizeof( DFBC_TypeCode ), code ) || std::memcmp( code, DFBC_TypeCode, sizeof( DFBC_TypeCode ) ) != 0 )
+            return fail( err, "not a DFBC file: " + filename );
+        if ( !r.get( length ) || length > r.remaining() )
+            return fail( err, "length " + std::to_string( length ) + " exceeds file size " + std::to_string( m_file.size() ) );
+        return parse( m_file.data() + sizeof( DFBC_TypeCode ) + sizeof( length ), length, err );
+    }
+
+    const ColumnDefs &columnDefs() const
+    {
+        return m_columnDefs;
+    }
+    size_t numRows() const
+    {
+        return m_numRows;
+    }
+    /// \brief Append numRows() values of column icol to col, which stores the column type.
+    bool readColumn( size_t icol, IColumn &col, std::ostream *err = nullptr ) const
+    {
+        if ( !static_invoke_for_type( m_columnDefs.at( icol ).colTypeTag, ReadBinaryColumn(), m_blocks[icol], m_numRows, col ) )
+            return fail( err, "failed to read column " + m_columnDefs[icol].colName );
+        return true;
+    }
+    /// \brief Decode next row into rec. Each field is either null or of the column type.
+    bool next( Record &rec, std::ostream *err = nullptr )
+    {
+        if ( m_nextRow >= m_numRows )
+            return fail( err, "no more rows" );
+        rec.resize( m_columnDefs.size() );
+        for ( size_t icol = 0; icol < m_columnDefs.size(); ++icol )
+            if ( !static_invoke_for_type( m_columnDefs[icol].colTypeTag, ReadBinaryCell(), m_blocks[icol], m_nextRow, rec[icol] ) )
+                return fail( err, "failed to read field of column " + m_columnDefs[icol].colName + " at row " + std::to_string( m_nextRow ) );
+        ++m_nextRow;
+        return true;
+    }
+
+protected:
+    bool parse( const char *data, size_t size, std::ostream *err )
+    {
+        BinaryReader r( data, size );
+        uint64_t nrows = 0;
+        if ( !read_binary_column_defs( r, m_columnDefs, err ) )
+            return false;
+        if ( !r.get( nrows ) )
+            return fail( err, "failed to read number of rows" );
+        m_numRows = nrows;
+        m_nextRow = 0;
+        m_blocks.assign( m_columnDefs.size(), {} );
+        for ( size_t icol = 0; icol < m_columnDefs.size(); ++icol )
+            if ( !static_invoke_for_type( m_columnDefs[icol].colTypeTag, ParseBinaryColumn(), r, m_numRows, m_blocks[icol] ) )
+                return fail( err, "invalid block of column " + m_columnDefs[icol].colName );
+        return true;
+    }
+    static bool fail( std::ostream *err, const std::string &msg )
+    {
+        if ( err )
+            *err << "load_binary: " << msg << ".\n";
+        return false;
+    }
+};
+
+} // namespace zj
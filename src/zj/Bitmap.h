@@ -0,0 +1,196 @@
+/*
+ * This file is part of the ftl (Fast Template Library) distribution (https://github.com/zjgoggle/ftl).
+ * Copyright (c) 2020 Jack Zhang.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+
+namespace zj
+{
+
+/// \brief Packed bits in 64-bit words.
+/// \note Bits beyond size() in the last word are always 0, so words can be combined and counted without masking.
+class Bitmap
+{
+public:
+    static constexpr size_t WordBits = 64;
+
+protected:
+    std::vector<uint64_t> m_words;
+    size_t m_size = 0;
+
+public:
+    Bitmap() = default;
+    explicit Bitmap( size_t n, bool val = false )
+    {
+        resize( n, val );
+    }
+
+    static size_t countWords( size_t nbits )
+    {
+        return ( nbits + WordBits - 1 ) / WordBits;
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+    const std::vector<uint64_t> &words() const
+    {
+        return m_words;
+    }
+    std::vector<uint64_t> &words()
+    {
+        return m_words;
+    }
+
+    bool test( size_t i ) const
+    {
+        assert( i < m_size );
+        return ( m_words[i / WordBits] >> ( i % WordBits ) ) & 1u;
+    }
+    bool operator[]( size_t i ) const
+    {
+        return test( i );
+    }
+    void set( size_t i, bool val = true )
+    {
+        assert( i < m_size );
+        uint64_t mask = uint64_t( 1 ) << ( i % WordBits );
+        if ( val )
+            m_words[i / WordBits] |= mask;
+        else
+            m_words[i / WordBits] &= ~mask;
+    }
+    void push_back( bool val )
+    {
+        if ( m_size % WordBits == 0 )
+            m_words.push_back( 0 );
+        ++m_size;
+        if ( val )
+            m_words.back() |= uint64_t( 1 ) << ( ( m_size - 1 ) % WordBits );
+    }
+    /// New bits are set to val.
+    void resize( size_t n, bool val = false )
+    {
+        if ( n > m_size && val )
+        {
+            if ( m_size % WordBits ) // fill the tail of last word
+                m_words.back() |= ~uint64_t( 0 ) << ( m_size % WordBits );
+            m_words.resize( countWords( n ), ~uint64_t( 0 ) );
+        }
+        else
+            m_words.resize( countWords( n ), 0 );
+        m_size = n;
+        clearTail();
+    }
+    void reserve( size_t n )
+    {
+        m_words.reserve( countWords( n ) );
+    }
+    void clear()
+    {
+        m_words.clear();
+        m_size = 0;
+    }
+
+    /// \return number of set bits.
+    size_t count() const
+    {
+        size_t n = 0;
+        for ( auto w : m_words )
+            n += __builtin_popcountll( w );
+        return n;
+    }
+    bool all() const
+    {
+        return count() == m_size;
+    }
+    bool none() const
+    {
+        for ( auto w : m_words )
+            if ( w )
+                return false;
+        return true;
+    }
+
+    void flip()
+    {
+        for ( auto &w : m_words )
+            w = ~w;
+        clearTail();
+    }
+    /// \pre a.size() == size()
+    Bitmap &operator&=( const Bitmap &a )
+    {
+        assert( a.size() == m_size );
+        for ( size_t i = 0, N = m_words.size(); i < N; ++i )
+            m_words[i] &= a.m_words[i];
+        return *this;
+    }
+    /// \pre a.size() == size()
+    Bitmap &operator|=( const Bitmap &a )
+    {
+        assert( a.size() == m_size );
+        for ( size_t i = 0, N = m_words.size(); i < N; ++i )
+            m_words[i] |= a.m_words[i];
+        return *this;
+    }
+
+    /// Call func(size_t index) for each set bit in ascending order, skipping zero words.
+    template<class Func>
+    void foreachSet( Func &&func ) const
+    {
+        for ( size_t iw = 0, N = m_words.size(); iw < N; ++iw )
+            for ( uint64_t w = m_words[iw]; w; w &= w - 1 )
+                func( iw * WordBits + __builtin_ctzll( w ) );
+    }
+    /// Call func(size_t index) for each unset bit in ascending order, skipping full words.
+    template<class Func>
+    void foreachUnset( Func &&func ) const
+    {
+        for ( size_t iw = 0, N = m_words.size(); iw < N; ++iw )
+        {
+            uint64_t w = ~m_words[iw];
+            if ( iw + 1 == N && m_size % WordBits )
+                w &= ( uint64_t( 1 ) << ( m_size % WordBits ) ) - 1;
+            for ( ; w; w &= w - 1 )
+                func( iw * WordBits + __builtin_ctzll( w ) );
+        }
+    }
+
+    bool operator==( const Bitmap &a ) const
+    {
+        return m_size == a.m_size && m_words == a.m_words;
+    }
+
+protected:
+    void clearTail()
+    {
+        if ( m_size % WordBits )
+            m_words.back() &= ( uint64_t( 1 ) << ( m_size % WordBits ) ) - 1;
+    }
+};
+
+} // namespace zj
@@ -0,0 +1,1450 @@
+/*
+ * This file is part of the ftl (Fast Template Library) distribution (https://github.com/zjgoggle/ftl).
+ * Copyright (c) 2020 Jack Zhang.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <zj/VarField.h>
+#include <zj/Bitmap.h>
+#include <zj/SparseVector.h>
+#include <zj/IntCodec.h>
+#include <zj/FieldParser.h>
+#include <algorithm>
+#include <deque>
+#include <numeric>
+#include <memory>
+
+namespace zj
+{
+
+///////////////////////////////////////////////////////////////
+/// IColumn: storage of a single column in ColumnDataFrame.
+///////////////////////////////////////////////////////////////
+
+class IColumn
+{
+public:
+    virtual ~IColumn() = default;
+
+    virtual FieldTypeTag typeTag() const = 0;
+    virtual size_t size() const = 0;
+    virtual bool isNull( size_t irow ) const = 0;
+    virtual size_t countNulls() const = 0;
+    /// \brief Validity bitmap, in which bit 1 is a valid value and bit 0 is null.
+    /// \return nullptr if there is no null in column.
+    virtual const Bitmap *validity() const = 0;
+    /// \brief Values as a contiguous array of size() elements of the column type, e.g. int32_t for Int32, with default values at nulls.
+    /// Scans cast it by typeTag() instead of the concrete column type.
+    /// \return nullptr if values are not stored as a plain array.
+    virtual const void *plainValues() const
+    {
+        return nullptr;
+    }
+
+    /// \brief Copy the value at irow into var. var is set to NullField if the value is null.
+    /// \note var is reused if it already holds the column type, which saves allocations for Str and Vec fields.
+    virtual void get( size_t irow, VarField &var ) const = 0;
+
+    /// \brief Append a field. NullField is appended as null. Numeric fields are converted to the column type.
+    /// \return false if the field is not compatible with the column type.
+    virtual bool append( const VarField &var ) = 0;
+    /// \brief Parse a string and append it. "N/A" is appended as null if global().bParseNull.
+    /// \return false if the string can't be parsed as column type.
+    virtual bool appendStr( std::string_view s ) = 0;
+    virtual void appendNull() = 0;
+    /// \brief Parse and append n strings, as appendStr does for each. Typed columns convert them in one typed loop (see FieldParser).
+    /// \return number of appended strings; less than n if fields[return] can't be parsed.
+    virtual size_t appendStrs( const std::string_view *fields, size_t n )
+    {
+        for ( size_t i = 0; i < n; ++i )
+            if ( !appendStr( fields[i] ) )
+                return i;
+        return n;
+    }
+
+    /// \brief Same as hash_code<VarField> of the value at irow, without materializing VarField.
+    virtual size_t hashAt( size_t irow ) const = 0;
+    /// \brief Compare values at irow and jrow as VarField operators do: null equals null and is less than any value.
+    virtual bool equalAt( size_t irow, size_t jrow ) const = 0;
+    virtual bool lessAt( size_t irow, size_t jrow ) const = 0;
+
+    /// Remove the trailing elements so that size() == n. Used to roll back a partially appended row.
+    virtual void truncate( size_t n ) = 0;
+    virtual void reserve( size_t n ) = 0;
+
+    virtual IColumn *clone() const = 0;
+};
+
+using IColumnPtr = std::unique_ptr<IColumn>;
+
+///////////////////////////////////////////////////////////////
+/// TypedColumn: contiguous values of the primitive type of FieldValue<T>.
+///////////////////////////////////////////////////////////////
+
+template<class T>
+class TypedColumn : public IColumn
+{
+public:
+    using value_type = T;
+    using field_type = FieldValue<T>;
+    using const_reference = typename std::vector<T>::const_reference;
+
+protected:
+    std::vector<T> m_values; // null elements hold default value.
+    Bitmap m_validity; // empty until the first null is appended.
+    size_t m_nullCount = 0;
+
+public:
+    FieldTypeTag typeTag() const override
+    {
+        return field_type::type;
+    }
+    size_t size() const override
+    {
+        return m_values.size();
+    }
+    bool isNull( size_t irow ) const override
+    {
+        return m_nullCount && !m_validity.test( irow );
+    }
+    size_t countNulls() const override
+    {
+        return m_nullCount;
+    }
+    const Bitmap *validity() const override
+    {
+        return m_nullCount ? &m_validity : nullptr;
+    }
+    const std::vector<T> &values() const
+    {
+        return m_values;
+    }
+    const void *plainValues() const override
+    {
+        if constexpr ( std::is_trivially_copyable_v<T> && !std::is_same_v<T, bool> )
+            return m_values.data();
+        else
+            return nullptr;
+    }
+    const_reference valueAt( size_t irow ) const
+    {
+        return m_values[irow];
+    }
+
+    void get( size_t irow, VarField &var ) const override
+    {
+        if ( isNull( irow ) )
+            var = NullField{};
+        else if ( auto p = std::get_if<field_type>( &var ) )
+            p->value = m_values[irow];
+        else
+            var.template emplace<field_type>( field_type{m_values[irow]} );
+    }
+
+    bool append( const VarField &var ) override
+    {
+        if ( var.index() == 0 )
+        {
+            appendNull();
+            return true;
+        }
+        if ( auto p = std::get_if<field_type>( &var ) )
+        {
+            push_back( p->value );
+            return true;
+        }
+        if constexpr ( isNumericFieldType( field_type::type ) )
+        {
+            if ( isNumericFieldType( FieldTypeTag( var.index() ) ) )
+            {
+                if ( auto intVal = getAsInt( var ) )
+                    push_back( T( *intVal ) );
+                else
+                    push_back( T( *getAsDouble( var ) ) );
+                return true;
+            }
+        }
+        return false;
+    }
+    bool appendStr( std::string_view s ) override
+    {
+        if ( global().bParseNull && is_null( s ) )
+        {
+            appendNull();
+            return true;
+        }
+        field_type fieldval{};
+        if ( !from_string( fieldval, s ) )
+            return false;
+        push_back( std::move( fieldval.value ) );
+        return true;
+    }
+    size_t appendStrs( const std::string_view *fields, size_t n ) override
+    {
+        FieldParser<T> parser;
+        const bool parseNull = global().bParseNull;
+        for ( size_t i = 0; i < n; ++i )
+        {
+            T val{};
+            if ( parseNull && is_null( fields[i] ) )
+                appendNull();
+            else if ( parser( fields[i], val ) )
+                push_back( std::move( val ) );
+            else
+                return i;
+        }
+        return n;
+    }
+    void appendNull() override
+    {
+        if ( m_validity.empty() )
+            m_validity.resize( m_values.size(), true );
+        m_values.emplace_back();
+        m_validity.push_back( false );
+        ++m_nullCount;
+    }
+    void push_back( T val )
+    {
+        m_values.push_back( std::move( val ) );
+        if ( !m_validity.empty() )
+            m_validity.push_back( true );
+    }
+
+    size_t hashAt( size_t irow ) const override
+    {
+        return isNull( irow ) ? hashcode( Null{} ) : hashcode( m_values[irow] );
+    }
+    bool equalAt( size_t irow, size_t jrow ) const override
+    {
+        bool nullI = isNull( irow ), nullJ = isNull( jrow );
+        if ( nullI || nullJ )
+            return nullI && nullJ;
+        return m_values[irow] == m_values[jrow];
+    }
+    bool lessAt( size_t irow, size_t jrow ) const override
+    {
+        bool nullI = isNull( irow ), nullJ = isNull( jrow );
+        if ( nullI || nullJ )
+            return nullI && !nullJ;
+        return m_values[irow] < m_values[jrow];
+    }
+
+    void truncate( size_t n ) override
+    {
+        if ( n >= m_values.size() )
+            return;
+        if ( !m_validity.empty() )
+        {
+            m_validity.resize( n );
+            m_nullCount = n - m_validity.count();
+        }
+        m_values.resize( n );
+    }
+    void reserve( size_t n ) override
+    {
+        m_values.reserve( n );
+    }
+    IColumn *clone() const override
+    {
+        return new TypedColumn( *this );
+    }
+};
+
+///////////////////////////////////////////////////////////////
+/// BoolColumn: Bool column packed in bitmap.
+///////////////////////////////////////////////////////////////
+
+class BoolColumn : public IColumn
+{
+public:
+    using value_type = bool;
+    using field_type = BoolField;
+
+protected:
+    Bitmap m_bits; // null elements hold 0.
+    Bitmap m_validity; // empty until the first null is appended.
+    size_t m_nullCount = 0;
+
+public:
+    FieldTypeTag typeTag() const override
+    {
+        return FieldTypeTag::Bool;
+    }
+    size_t size() const override
+    {
+        return m_bits.size();
+    }
+    bool isNull( size_t irow ) const override
+    {
+        return m_nullCount && !m_validity.test( irow );
+    }
+    size_t countNulls() const override
+    {
+        return m_nullCount;
+    }
+    const Bitmap *validity() const override
+    {
+        return m_nullCount ? &m_validity : nullptr;
+    }
+    const Bitmap &bits() const
+    {
+        return m_bits;
+    }
+    bool valueAt( size_t irow ) const
+    {
+        return m_bits.test( irow );
+    }
+
+    /// \brief Select rows word by word: a row is selected if its value is true and trueMatches, or false and falseMatches,
+    /// or null and nullMatches. E.g. select(true, false, false) is the bitmap itself, and select(false, true, true) is its complement.
+    Bitmap select( bool trueMatches, bool falseMatches, bool nullMatches ) const
+    {
+        Bitmap res( size() );
+        auto &words = res.words();
+        const auto &bits = m_bits.words();
+        const uint64_t *valid = m_nullCount ? m_validity.words().data() : nullptr;
+        for ( size_t i = 0, N = words.size(); i < N; ++i )
+        {
+            uint64_t validWord = valid ? valid[i] : ~uint64_t( 0 );
+            uint64_t w = ( trueMatches ? bits[i] : 0 ) | ( falseMatches ? ~bits[i] & validWord : 0 );
+            words[i] = nullMatches ? w | ~validWord : w;
+        }
+        if ( size() % Bitmap::WordBits ) // clear the tail of last word.
+            words.back() &= ( uint64_t( 1 ) << ( size() % Bitmap::WordBits ) ) - 1;
+        return res;
+    }
+
+    void get( size_t irow, VarField &var ) const override
+    {
+        if ( isNull( irow ) )
+            var = NullField{};
+        else
+            var.template emplace<field_type>( field_type{m_bits.test( irow )} );
+    }
+    bool append( const VarField &var ) override
+    {
+        if ( var.index() == 0 )
+        {
+            appendNull();
+            return true;
+        }
+        if ( auto p = std::get_if<field_type>( &var ) )
+        {
+            push_back( p->value );
+            return true;
+        }
+        return false;
+    }
+    bool appendStr( std::string_view s ) override
+    {
+        if ( global().bParseNull && is_null( s ) )
+        {
+            appendNull();
+            return true;
+        }
+        field_type fieldval{};
+        if ( !from_string( fieldval, s ) )
+            return false;
+        push_back( fieldval.value );
+        return true;
+    }
+    void appendNull() override
+    {
+        if ( m_validity.empty() )
+            m_validity.resize( m_bits.size(), true );
+        m_bits.push_back( false );
+        m_validity.push_back( false );
+        ++m_nullCount;
+    }
+    void push_back( bool val )
+    {
+        m_bits.push_back( val );
+        if ( !m_validity.empty() )
+            m_validity.push_back( true );
+    }
+
+    size_t hashAt( size_t irow ) const override
+    {
+        return isNull( irow ) ? hashcode( Null{} ) : hashcode( m_bits.test( irow ) );
+    }
+    bool equalAt( size_t irow, size_t jrow ) const override
+    {
+        bool nullI = isNull( irow ), nullJ = isNull( jrow );
+        if ( nullI || nullJ )
+            return nullI && nullJ;
+        return m_bits.test( irow ) == m_bits.test( jrow );
+    }
+    bool lessAt( size_t irow, size_t jrow ) const override
+    {
+        bool nullI = isNull( irow ), nullJ = isNull( jrow );
+        if ( nullI || nullJ )
+            return nullI && !nullJ;
+        return m_bits.test( irow ) < m_bits.test( jrow );
+    }
+
+    void truncate( size_t n ) override
+    {
+        if ( n >= m_bits.size() )
+            return;
+        if ( !m_validity.empty() )
+        {
+            m_validity.resize( n );
+            m_nullCount = n - m_validity.count();
+        }
+        m_bits.resize( n );
+    }
+    void reserve( size_t n ) override
+    {
+        m_bits.reserve( n );
+    }
+    IColumn *clone() const override
+    {
+        return new BoolColumn( *this );
+    }
+};
+
+///////////////////////////////////////////////////////////////
+/// ListColumn: vector-typed column in flat values and row offsets.
+///////////////////////////////////////////////////////////////
+
+// std::vector<bool> is not contiguous, so bool elements are stored as uint8_t.
+template<class T>
+using list_storage_t = std::conditional_t<std::is_same_v<T, bool>, uint8_t, T>;
+
+/// \brief Read-only span-like view of a cell of ListColumn.
+/// Compare and hash are the same as std::vector<T> of the same elements, so a view can be compared with and looked up by vector fields.
+template<class T>
+class VecView
+{
+public:
+    using value_type = T;
+    using stored_type = list_storage_t<T>;
+    using const_iterator = const stored_type *;
+
+protected:
+    const stored_type *m_data = nullptr;
+    size_t m_size = 0;
+
+public:
+    VecView() = default;
+    VecView( const stored_type *data, size_t n ) : m_data( data ), m_size( n )
+    {
+    }
+    size_t size() const
+    {
+        return m_size;
+    }
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+    const_iterator begin() const
+    {
+        return m_data;
+    }
+    const_iterator end() const
+    {
+        return m_data + m_size;
+    }
+    decltype( auto ) operator[]( size_t i ) const
+    {
+        if constexpr ( std::is_same_v<T, bool> )
+            return bool( m_data[i] );
+        else
+            return static_cast<const T &>( m_data[i] );
+    }
+    std::vector<T> toVector() const
+    {
+        return std::vector<T>( begin(), end() );
+    }
+};
+
+template<class T>
+bool operator==( const VecView<T> &a, const VecView<T> &b )
+{
+    return VecEqual()( a, b );
+}
+template<class T>
+bool operator==( const VecView<T> &a, const std::vector<T> &b )
+{
+    return VecEqual()( a, b );
+}
+template<class T>
+bool operator==( const std::vector<T> &a, const VecView<T> &b )
+{
+    return VecEqual()( a, b );
+}
+template<class T>
+bool operator<( const VecView<T> &a, const VecView<T> &b )
+{
+    return VecLess()( a, b );
+}
+template<class T>
+bool operator<( const VecView<T> &a, const std::vector<T> &b )
+{
+    return VecLess()( a, b );
+}
+template<class T>
+bool operator<( const std::vector<T> &a, const VecView<T> &b )
+{
+    return VecLess()( a, b );
+}
+template<class T>
+struct hash_code<VecView<T>>
+{
+    size_t operator()( const VecView<T> &v ) const
+    {
+        return VecHash()( v );
+    }
+};
+template<class T>
+std::string to_string( const VecView<T> &v )
+{
+    return to_string_vec( v );
+}
+
+/// \brief Column of FieldValue<std::vector<T>>. Elements of all rows are stored in one flat buffer, and row irow is
+/// values()[offsets()[irow], offsets()[irow + 1]). Null is an empty range marked in validity bitmap.
+template<class T>
+class ListColumn : public IColumn
+{
+public:
+    using value_type = T;
+    using vector_type = std::vector<T>;
+    using field_type = FieldValue<vector_type>;
+    using stored_type = list_storage_t<T>;
+
+protected:
+    std::vector<stored_type> m_values;
+    std::vector<size_t> m_offsets{0};
+    Bitmap m_validity; // empty until the first null is appended.
+    size_t m_nullCount = 0;
+
+public:
+    FieldTypeTag typeTag() const override
+    {
+        return field_type::type;
+    }
+    size_t size() const override
+    {
+        return m_offsets.size() - 1;
+    }
+    bool isNull( size_t irow ) const override
+    {
+        return m_nullCount && !m_validity.test( irow );
+    }
+    size_t countNulls() const override
+    {
+        return m_nullCount;
+    }
+    const Bitmap *validity() const override
+    {
+        return m_nullCount ? &m_validity : nullptr;
+    }
+    const std::vector<stored_type> &values() const
+    {
+        return m_values;
+    }
+    const std::vector<size_t> &offsets() const
+    {
+        return m_offsets;
+    }
+    VecView<T> cell( size_t irow ) const
+    {
+        return VecView<T>( m_values.data() + m_offsets[irow], m_offsets[irow + 1] - m_offsets[irow] );
+    }
+
+    void get( size_t irow, VarField &var ) const override
+    {
+        if ( isNull( irow ) )
+            var = NullField{};
+        else
+        {
+            auto view = cell( irow );
+            if ( auto p = std::get_if<field_type>( &var ) )
+                p->value.assign( view.begin(), view.end() );
+            else
+                var.template emplace<field_type>( field_type{view.toVector()} );
+        }
+    }
+    bool append( const VarField &var ) override
+    {
+        if ( var.index() == 0 )
+        {
+            appendNull();
+            return true;
+        }
+        if ( auto p = std::get_if<field_type>( &var ) )
+        {
+            push_back( p->value.begin(), p->value.end() );
+            return true;
+        }
+        return false;
+    }
+    bool appendStr( std::string_view s ) override
+    {
+        if ( global().bParseNull && is_null( s ) )
+        {
+            appendNull();
+            return true;
+        }
+        field_type fieldval{};
+        if ( !from_string( fieldval, s ) )
+            return false;
+        push_back( fieldval.value.begin(), fieldval.value.end() );
+        return true;
+    }
+    void appendNull() override
+    {
+        if ( m_validity.empty() )
+            m_validity.resize( size(), true );
+        m_offsets.push_back( m_values.size() );
+        m_validity.push_back( false );
+        ++m_nullCount;
+    }
+    template<class It>
+    void push_back( It first, It last )
+    {
+        m_values.insert( m_values.end(), first, last );
+        m_offsets.push_back( m_values.size() );
+        if ( !m_validity.empty() )
+            m_validity.push_back( true );
+    }
+
+    size_t hashAt( size_t irow ) const override
+    {
+        return isNull( irow ) ? hashcode( Null{} ) : hashcode( cell( irow ) );
+    }
+    bool equalAt( size_t irow, size_t jrow ) const override
+    {
+        bool nullI = isNull( irow ), nullJ = isNull( jrow );
+        if ( nullI || nullJ )
+            return nullI && nullJ;
+        auto a = cell( irow ), b = cell( jrow );
+        return a.size() == b.size() && std::equal( a.begin(), a.end(), b.begin() );
+    }
+    bool lessAt( size_t irow, size_t jrow ) const override
+    {
+        bool nullI = isNull( irow ), nullJ = isNull( jrow );
+        if ( nullI || nullJ )
+            return nullI && !nullJ;
+        auto a = cell( irow ), b = cell( jrow );
+        return std::lexicographical_compare( a.begin(), a.end(), b.begin(), b.end() );
+    }
+
+    void truncate( size_t n ) override
+    {
+        if ( n >= size() )
+            return;
+        if ( !m_validity.empty() )
+        {
+            m_validity.resize( n );
+            m_nullCount = n - m_validity.count();
+        }
+        m_offsets.resize( n + 1 );
+        m_values.resize( m_offsets.back() );
+    }
+    void reserve( size_t n ) override
+    {
+        m_offsets.reserve( n + 1 );
+    }
+    IColumn *clone() const override
+    {
+        return new ListColumn( *this );
+    }
+};
+
+///////////////////////////////////////////////////////////////
+/// DictStrColumn: dictionary-encoded Str column.
+///////////////////////////////////////////////////////////////
+
+/// \brief Distinct strings of dictionary-encoded columns. The code of a value is its position in dictionary.
+/// \note Dictionary is append-only, so codes stay valid when it's shared by multiple columns.
+class StrDictionary
+{
+public:
+    using code_type = uint32_t;
+
+protected:
+    std::deque<std::string> m_values; // <code: value>. deque keeps the strings in place for the views in m_codes.
+    std::unordered_map<std::string_view, code_type> m_codes; // <value: code>
+    bool m_sorted = true; // values are ascending, so that codes are ordered as values.
+
+public:
+    StrDictionary() = default;
+    StrDictionary( const StrDictionary &a )
+    {
+        for ( const auto &e : a.m_values )
+            insert( e );
+    }
+    StrDictionary( StrDictionary &&a ) = default;
+    StrDictionary &operator=( const StrDictionary &a ) = delete;
+    StrDictionary &operator=( StrDictionary &&a ) = default;
+
+    size_t size() const
+    {
+        return m_values.size();
+    }
+    bool isSorted() const
+    {
+        return m_sorted;
+    }
+    const std::string &value( code_type code ) const
+    {
+        return m_values[code];
+    }
+    std::optional<code_type> find( std::string_view s ) const
+    {
+        if ( auto it = m_codes.find( s ); it != m_codes.end() )
+            return it->second;
+        return {};
+    }
+    /// \return code of s. s is added if it's not in dictionary.
+    code_type insert( std::string_view s )
+    {
+        if ( auto it = m_codes.find( s ); it != m_codes.end() )
+            return it->second;
+        if ( m_values.size() >= std::numeric_limits<code_type>::max() )
+            throw std::length_error( "StrDictionary is full" );
+        if ( !m_values.empty() && !( m_values.back() < s ) )
+            m_sorted = false;
+        auto code = code_type( m_values.size() );
+        m_codes.emplace( std::string_view( m_values.emplace_back( s ) ), code );
+        return code;
+    }
+
+    /// \pre isSorted().
+    /// \return the first code whose value is not less than s.
+    code_type lowerBound( std::string_view s ) const
+    {
+        assert( m_sorted );
+        return code_type( std::lower_bound( m_values.begin(), m_values.end(), s ) - m_values.begin() );
+    }
+    /// \pre isSorted().
+    /// \return the first code whose value is greater than s.
+    code_type upperBound( std::string_view s ) const
+    {
+        assert( m_sorted );
+        return code_type( std::upper_bound( m_values.begin(), m_values.end(), s ) - m_values.begin() );
+    }
+    /// \return codes in ascending order of values.
+    std::vector<code_type> sortedCodes() const
+    {
+        std::vector<code_type> codes( m_values.size() );
+        std::iota( codes.begin(), codes.end(), 0 );
+        std::sort( codes.begin(), codes.end(), [this]( code_type a, code_type b ) { return m_values[a] < m_values[b]; } );
+        return codes;
+    }
+};
+
+/// \brief Str column that stores a code per row. Low-cardinality strings are stored once in dictionary,
+/// and predicates can be evaluated on codes, see DictCodeFilter.
+class DictStrColumn : public IColumn
+{
+public:
+    using code_type = StrDictionary::code_type;
+    using DictionaryPtr = std::shared_ptr<StrDictionary>;
+
+protected:
+    DictionaryPtr m_dict = std::make_shared<StrDictionary>(); // shared only through shareDictionary().
+    std::vector<code_type> m_codes; // null elements hold code 0.
+    Bitmap m_validity; // empty until the first null is appended.
+    size_t m_nullCount = 0;
+
+public:
+    FieldTypeTag typeTag() const override
+    {
+        return FieldTypeTag::Str;
+    }
+    size_t size() const override
+    {
+        return m_codes.size();
+    }
+    bool isNull( size_t irow ) const override
+    {
+        return m_nullCount && !m_validity.test( irow );
+    }
+    size_t countNulls() const override
+    {
+        return m_nullCount;
+    }
+    const Bitmap *validity() const override
+    {
+        return m_nullCount ? &m_validity : nullptr;
+    }
+    const StrDictionary &dictionary() const
+    {
+        return *m_dict;
+    }
+    const DictionaryPtr &dictionaryPtr() const
+    {
+        return m_dict;
+    }
+    /// \brief Use the dictionary of another column so that codes of both columns can be compared directly.
+    /// \return false if this column is not empty.
+    bool shareDictionary( const DictStrColumn &a )
+    {
+        if ( !m_codes.empty() )
+            return false;
+        m_dict = a.m_dict;
+        return true;
+    }
+    bool sharesDictionary( const DictStrColumn &a ) const
+    {
+        return m_dict == a.m_dict;
+    }
+    const std::vector<code_type> &codes() const
+    {
+        return m_codes;
+    }
+    code_type codeAt( size_t irow ) const
+    {
+        return m_codes[irow];
+    }
+    /// \pre !isNull(irow)
+    const std::string &valueAt( size_t irow ) const
+    {
+        return m_dict->value( m_codes[irow] );
+    }
+
+    void get( size_t irow, VarField &var ) const override
+    {
+        if ( isNull( irow ) )
+            var = NullField{};
+        else if ( auto p = std::get_if<StrField>( &var ) )
+            p->value = valueAt( irow );
+        else
+            var.emplace<StrField>( StrField{valueAt( irow )} );
+    }
+
+    bool append( const VarField &var ) override
+    {
+        if ( var.index() == 0 )
+        {
+            appendNull();
+            return true;
+        }
+        if ( auto p = std::get_if<StrField>( &var ) )
+        {
+            push_back( p->value );
+            return true;
+        }
+        return false;
+    }
+    bool appendStr( std::string_view s ) override
+    {
+        if ( global().bParseNull && is_null( s ) )
+            appendNull();
+        else
+            push_back( s );
+        return true;
+    }
+    void appendNull() override
+    {
+        if ( m_validity.empty() )
+            m_validity.resize( m_codes.size(), true );
+        m_codes.push_back( 0 );
+        m_validity.push_back( false );
+        ++m_nullCount;
+    }
+    void push_back( std::string_view s )
+    {
+        m_codes.push_back( m_dict->insert( s ) );
+        if ( !m_validity.empty() )
+            m_validity.push_back( true );
+    }
+
+    /// \brief Re-encode the column with a sorted dictionary, so that ordered comparisons work on codes.
+    /// \note The new dictionary is not shared with other columns any more.
+    void sortDictionary()
+    {
+        if ( m_dict->isSorted() )
+            return;
+        std::vector<code_type> sorted = m_dict->sortedCodes(), remap( sorted.size() );
+        auto dict = std::make_shared<StrDictionary>();
+        for ( size_t i = 0, N = sorted.size(); i < N; ++i )
+        {
+            remap[sorted[i]] = dict->insert( m_dict->value( sorted[i] ) );
+        }
+        for ( auto &code : m_codes )
+            code = remap[code];
+        m_dict = std::move( dict );
+    }
+
+    size_t hashAt( size_t irow ) const override
+    {
+        return isNull( irow ) ? hashcode( Null{} ) : std::hash<std::string_view>()( valueAt( irow ) );
+    }
+    bool equalAt( size_t irow, size_t jrow ) const override
+    {
+        bool nullI = isNull( irow ), nullJ = isNull( jrow );
+        if ( nullI || nullJ )
+            return nullI && nullJ;
+        return m_codes[irow] == m_codes[jrow];
+    }
+    bool lessAt( size_t irow, size_t jrow ) const override
+    {
+        bool nullI = isNull( irow ), nullJ = isNull( jrow );
+        if ( nullI || nullJ )
+            return nullI && !nullJ;
+        if ( m_dict->isSorted() )
+            return m_codes[irow] < m_codes[jrow];
+        return valueAt( irow ) < valueAt( jrow );
+    }
+
+    void truncate( size_t n ) override
+    {
+        if ( n >= m_codes.size() )
+            return;
+        if ( !m_validity.empty() )
+        {
+            m_validity.resize( n );
+            m_nullCount = n - m_validity.count();
+        }
+        m_codes.resize( n );
+    }
+    void reserve( size_t n ) override
+    {
+        m_codes.reserve( n );
+    }
+    /// \brief The clone gets its own copy of dictionary, so values appended to either column don't show up in the other.
+    IColumn *clone() const override
+    {
+        auto pCol = new DictStrColumn( *this );
+        pCol->m_dict = std::make_shared<StrDictionary>( *m_dict );
+        return pCol;
+    }
+};
+
+///////////////////////////////////////////////////////////////
+/// RunColumn: scalar column stored as runs (SparseVector segments).
+///////////////////////////////////////////////////////////////
+
+/// \brief Column of runs: a Duplicate segment per run of same values, or an Incremental segment per run of consecutive
+/// integers. at() is O(log segments); predicates are evaluated per segment (see scan_compare_runs).
+/// \note Null elements hold default value, so runs are not broken by nulls of the same default value.
+template<class T>
+class RunColumn : public IColumn
+{
+public:
+    using value_type = T;
+    using field_type = FieldValue<T>;
+
+protected:
+    SparseVector<T> m_runs;
+    Bitmap m_validity; // empty until the first null is appended.
+    size_t m_nullCount = 0;
+
+public:
+    FieldTypeTag typeTag() const override
+    {
+        return field_type::type;
+    }
+    size_t size() const override
+    {
+        return m_runs.size();
+    }
+    bool isNull( size_t irow ) const override
+    {
+        return m_nullCount && !m_validity.test( irow );
+    }
+    size_t countNulls() const override
+    {
+        return m_nullCount;
+    }
+    const Bitmap *validity() const override
+    {
+        return m_nullCount ? &m_validity : nullptr;
+    }
+    const SparseVector<T> &runs() const
+    {
+        return m_runs;
+    }
+    size_t countSegments() const
+    {
+        return m_runs.countSegments();
+    }
+    T valueAt( size_t irow ) const
+    {
+        return m_runs[irow];
+    }
+
+    void get( size_t irow, VarField &var ) const override
+    {
+        if ( isNull( irow ) )
+            var = NullField{};
+        else if ( auto p = std::get_if<field_type>( &var ) )
+            p->value = m_runs[irow];
+        else
+            var.template emplace<field_type>( field_type{m_runs[irow]} );
+    }
+
+    bool append( const VarField &var ) override
+    {
+        if ( var.index() == 0 )
+        {
+            appendNull();
+            return true;
+        }
+        if ( auto p = std::get_if<field_type>( &var ) )
+        {
+            push_back( p->value );
+            return true;
+        }
+        if constexpr ( isNumericFieldType( field_type::type ) )
+        {
+            if ( isNumericFieldType( FieldTypeTag( var.index() ) ) )
+            {
+                if ( auto intVal = getAsInt( var ) )
+                    push_back( T( *intVal ) );
+                else
+                    push_back( T( *getAsDouble( var ) ) );
+                return true;
+            }
+        }
+        return false;
+    }
+    bool appendStr( std::string_view s ) override
+    {
+        if ( global().bParseNull && is_null( s ) )
+        {
+            appendNull();
+            return true;
+        }
+        if constexpr ( std::is_same_v<T, Str> ) // compare before copy, as a repeated value doesn't need a string.
+        {
+            const auto &segs = m_runs.segments();
+            if ( !segs.empty() && segs.back().m_value == s )
+            {
+                push_back( segs.back().m_value );
+                return true;
+            }
+        }
+        field_type fieldval{};
+        if ( !from_string( fieldval, s ) )
+            return false;
+        push_back( std::move( fieldval.value ) );
+        return true;
+    }
+    void appendNull() override
+    {
+        if ( m_validity.empty() )
+            m_validity.resize( m_runs.size(), true );
+        m_runs.push_back( T{} );
+        m_validity.push_back( false );
+        ++m_nullCount;
+    }
+    void push_back( const T &val )
+    {
+        m_runs.push_back( val );
+        if ( !m_validity.empty() )
+            m_validity.push_back( true );
+    }
+
+    size_t hashAt( size_t irow ) const override
+    {
+        return isNull( irow ) ? hashcode( Null{} ) : hashcode( m_runs[irow] );
+    }
+    bool equalAt( size_t irow, size_t jrow ) const override
+    {
+        bool nullI = isNull( irow ), nullJ = isNull( jrow );
+        if ( nullI || nullJ )
+            return nullI && nullJ;
+        return m_runs[irow] == m_runs[jrow];
+    }
+    bool lessAt( size_t irow, size_t jrow ) const override
+    {
+        bool nullI = isNull( irow ), nullJ = isNull( jrow );
+        if ( nullI || nullJ )
+            return nullI && !nullJ;
+        return m_runs[irow] < m_runs[jrow];
+    }
+
+    void truncate( size_t n ) override
+    {
+        if ( n >= m_runs.size() )
+            return;
+        if ( !m_validity.empty() )
+        {
+            m_validity.resize( n );
+            m_nullCount = n - m_validity.count();
+        }
+        m_runs.truncate( n );
+    }
+    void reserve( size_t ) override
+    {
+    }
+    IColumn *clone() const override
+    {
+        return new RunColumn( *this );
+    }
+};
+
+///////////////////////////////////////////////////////////////
+/// EncodedIntColumn: Int32, Int64 or Timestamp column stored as IntBlockVector.
+///////////////////////////////////////////////////////////////
+
+/// \return the IntCodec of encoding, or nullopt if encoding is not an integer codec.
+inline std::optional<IntCodec> int_codec_of( ColumnEncoding encoding )
+{
+    switch ( encoding )
+    {
+    case ColumnEncoding::FrameOfReference:
+        return IntCodec::FrameOfReference;
+    case ColumnEncoding::Delta:
+        return IntCodec::Delta;
+    case ColumnEncoding::DeltaOfDelta:
+        return IntCodec::DeltaOfDelta;
+    default:
+        return std::nullopt;
+    }
+}
+
+/// \return true if columns of typeTag can be stored by integer codecs, i.e. Int32, Int64 and Timestamp columns.
+inline bool is_int_codec_type( FieldTypeTag typeTag )
+{
+    return typeTag == FieldTypeTag::Int32 || typeTag == FieldTypeTag::Int64 || typeTag == FieldTypeTag::Timestamp;
+}
+
+/// \brief Column of integers encoded in blocks (see IntBlockVector). Timestamp nanos are encoded by the column codec, and
+/// Timestamp::formatBits() by FrameOfReference, which takes no residual bits if the format doesn't change.
+/// Predicates are evaluated on blocks decoded one by one into a small buffer (see foreachBlock).
+/// A column borrowed from a file mapping is read-only.
+/// \note Null elements hold the previous value, which keeps deltas small.
+template<class T>
+class EncodedIntColumn : public IColumn
+{
+public:
+    using value_type = T;
+    using field_type = FieldValue<T>;
+    static constexpr size_t BlockSize = IntBlockVector::BlockSize;
+    static_assert( std::is_same_v<T, int32_t> || std::is_same_v<T, int64_t> || std::is_same_v<T, Timestamp>,
+                   "EncodedIntColumn expects Int32, Int64 or Timestamp!" );
+
+protected:
+    IntBlockVector m_values;
+    IntBlockVector m_formatBits; // Timestamp only.
+    Bitmap m_validity; // empty until the first null is appended.
+    size_t m_nullCount = 0;
+    T m_last{}; // last appended value, held by nulls.
+
+public:
+    explicit EncodedIntColumn( IntCodec codec ) : m_values( codec )
+    {
+    }
+    /// \brief Column of encoded vectors, e.g. borrowed from a file mapping. formatBits is empty unless T is Timestamp.
+    /// validity is empty if there is no null.
+    EncodedIntColumn( IntBlockVector values, IntBlockVector formatBits, Bitmap validity )
+            : m_values( std::move( values ) ), m_formatBits( std::move( formatBits ) ), m_validity( std::move( validity ) )
+    {
+        if ( !m_validity.empty() )
+            m_nullCount = m_values.size() - m_validity.count();
+        if ( !m_values.empty() )
+            m_last = valueAt( m_values.size() - 1 );
+    }
+
+    FieldTypeTag typeTag() const override
+    {
+        return field_type::type;
+    }
+    size_t size() const override
+    {
+        return m_values.size();
+    }
+    bool isNull( size_t irow ) const override
+    {
+        return m_nullCount && !m_validity.test( irow );
+    }
+    size_t countNulls() const override
+    {
+        return m_nullCount;
+    }
+    const Bitmap *validity() const override
+    {
+        return m_nullCount ? &m_validity : nullptr;
+    }
+    IntCodec codec() const
+    {
+        return m_values.codec();
+    }
+    const IntBlockVector &encodedValues() const
+    {
+        return m_values;
+    }
+    const IntBlockVector &encodedFormatBits() const
+    {
+        return m_formatBits;
+    }
+    bool isReadOnly() const
+    {
+        return m_values.isBorrowed();
+    }
+    /// \return bytes of encoded values and format bits, excluding validity.
+    size_t encodedBytes() const
+    {
+        return m_values.encodedBytes() + m_formatBits.encodedBytes();
+    }
+    T valueAt( size_t irow ) const
+    {
+        if constexpr ( std::is_same_v<T, Timestamp> )
+            return Timestamp::fromFormatBits( m_values[irow], uint32_t( m_formatBits[irow] ) );
+        else
+            return T( m_values[irow] );
+    }
+    /// \brief Decode blocks one by one and call func( const T *values, size_t n, size_t ibegin ) for each block.
+    template<class Func>
+    void foreachBlock( Func &&func ) const
+    {
+        if constexpr ( std::is_same_v<T, int64_t> )
+            m_values.foreachBlock( func );
+        else
+        {
+            int64_t buf[BlockSize];
+            T out[BlockSize];
+            for ( size_t iblock = 0, nblocks = m_values.countBlocks(); iblock < nblocks; ++iblock )
+            {
+                const size_t n = m_values.decodeBlock( iblock, buf );
+                if constexpr ( std::is_same_v<T, Timestamp> )
+                {
+                    int64_t bits[BlockSize];
+                    m_formatBits.decodeBlock( iblock, bits );
+                    for ( size_t i = 0; i < n; ++i )
+                        out[i] = Timestamp::fromFormatBits( buf[i], uint32_t( bits[i] ) );
+                }
+                else
+                    std::copy( buf, buf + n, out );
+                func( static_cast<const T *>( out ), n, iblock * BlockSize );
+            }
+        }
+    }
+
+    void get( size_t irow, VarField &var ) const override
+    {
+        if ( isNull( irow ) )
+            var = NullField{};
+        else if ( auto p = std::get_if<field_type>( &var ) )
+            p->value = valueAt( irow );
+        else
+            var.template emplace<field_type>( field_type{valueAt( irow )} );
+    }
+
+    /// \return false if the field is not compatible with the column type, or the column is read-only.
+    bool append( const VarField &var ) override
+    {
+        if ( isReadOnly() )
+            return false;
+        if ( var.index() == 0 )
+        {
+            appendNull();
+            return true;
+        }
+        if ( auto p = std::get_if<field_type>( &var ) )
+        {
+            push_back( p->value );
+            return true;
+        }
+        if constexpr ( std::is_integral_v<T> )
+        {
+            if ( isNumericFieldType( FieldTypeTag( var.index() ) ) )
+            {
+                if ( auto intVal = getAsInt( var ) )
+                    push_back( T( *intVal ) );
+                else
+                    push_back( T( *getAsDouble( var ) ) );
+                return true;
+            }
+        }
+        return false;
+    }
+    bool appendStr( std::string_view s ) override
+    {
+        if ( isReadOnly() )
+            return false;
+        if ( global().bParseNull && is_null( s ) )
+        {
+            appendNull();
+            return true;
+        }
+        field_type fieldval{};
+        if ( !from_string( fieldval, s ) )
+            return false;
+        push_back( fieldval.value );
+        return true;
+    }
+    size_t appendStrs( const std::string_view *fields, size_t n ) override
+    {
+        if ( isReadOnly() )
+            return 0;
+        FieldParser<T> parser;
+        const bool parseNull = global().bParseNull;
+        for ( size_t i = 0; i < n; ++i )
+        {
+            T val{};
+            if ( parseNull && is_null( fields[i] ) )
+                appendNull();
+            else if ( parser( fields[i], val ) )
+                push_back( val );
+            else
+                return i;
+        }
+        return n;
+    }
+    /// \throw std::logic_error if the column is read-only.
+    void appendNull() override
+    {
+        if ( m_validity.empty() )
+            m_validity.resize( m_values.size(), true );
+        pushValue( m_last );
+        m_validity.push_back( false );
+        ++m_nullCount;
+    }
+    void push_back( const T &val )
+    {
+        pushValue( val );
+        m_last = val;
+        if ( !m_validity.empty() )
+            m_validity.push_back( true );
+    }
+
+    size_t hashAt( size_t irow ) const override
+    {
+        return isNull( irow ) ? hashcode( Null{} ) : hashcode( valueAt( irow ) );
+    }
+    bool equalAt( size_t irow, size_t jrow ) const override
+    {
+        bool nullI = isNull( irow ), nullJ = isNull( jrow );
+        if ( nullI || nullJ )
+            return nullI && nullJ;
+        return valueAt( irow ) == valueAt( jrow );
+    }
+    bool lessAt( size_t irow, size_t jrow ) const override
+    {
+        bool nullI = isNull( irow ), nullJ = isNull( jrow );
+        if ( nullI || nullJ )
+            return nullI && !nullJ;
+        return valueAt( irow ) < valueAt( jrow );
+    }
+
+    /// \throw std::logic_error if the column is read-only.
+    void truncate( size_t n ) override
+    {
+        if ( n >= m_values.size() )
+            return;
+        m_values.truncate( n );
+        if constexpr ( std::is_same_v<T, Timestamp> )
+            m_formatBits.truncate( n );
+        if ( !m_validity.empty() )
+        {
+            m_validity.resize( n );
+            m_nullCount = n - m_validity.count();
+        }
+        m_last = n ? valueAt( n - 1 ) : T{};
+    }
+    void reserve( size_t ) override
+    {
+    }
+    IColumn *clone() const override
+    {
+        return new EncodedIntColumn( *this );
+    }
+
+protected:
+    void pushValue( const T &val )
+    {
+        if constexpr ( std::is_same_v<T, Timestamp> )
+        {
+            m_values.push_back( val.nanos );
+            m_formatBits.push_back( val.formatBits() );
+        }
+        else
+            m_values.push_back( val );
+    }
+};
+
+// wrap RunColumn creation. Vector and Null columns are not supported.
+struct CreateRunColumn
+{
+    template<class T>
+    IColumn *invoke() const
+    {
+        if constexpr ( FieldValue<T>::is_vec || std::is_same_v<T, Null> )
+            return nullptr;
+        else
+            return new RunColumn<T>();
+    }
+};
+
+// wrap EncodedIntColumn creation. Only Int32, Int64 and Timestamp columns are supported.
+struct CreateEncodedIntColumn
+{
+    template<class T>
+    IColumn *invoke( IntCodec codec ) const
+    {
+        if constexpr ( std::is_same_v<T, int32_t> || std::is_same_v<T, int64_t> || std::is_same_v<T, Timestamp> )
+            return new EncodedIntColumn<T>( codec );
+        else
+            return nullptr;
+    }
+};
+
+// wrap TypedColumn, BoolColumn and ListColumn creation.
+struct CreateColumn
+{
+    template<class T>
+    IColumn *invoke() const
+    {
+        if constexpr ( FieldValue<T>::is_vec )
+            return new ListColumn<typename T::value_type>();
+        else if constexpr ( std::is_same_v<T, bool> )
+            return new BoolColumn();
+        else
+            return new TypedColumn<T>();
+    }
+};
+
+inline IColumnPtr create_column( FieldTypeTag typeTag )
+{
+    return IColumnPtr( static_invoke_for_type( typeTag, CreateColumn() ) );
+}
+
+/// \brief Create the column storage by type and encoding of colDef.
+/// \throw std::invalid_argument if the encoding is not supported by column type.
+inline IColumnPtr create_column( const ColumnDef &colDef )
+{
+    switch ( colDef.encoding )
+    {
+    case ColumnEncoding::Plain:
+        return create_column( colDef.colTypeTag );
+    case ColumnEncoding::Dictionary:
+        if ( colDef.colTypeTag != FieldTypeTag::Str )
+            throw std::invalid_argument( "Dictionary encoding expects Str column: " + colDef.colName );
+        return IColumnPtr( new DictStrColumn() );
+    case ColumnEncoding::RunLength:
+        if ( auto pCol = static_invoke_for_type( colDef.colTypeTag, CreateRunColumn() ) )
+            return IColumnPtr( pCol );
+        throw std::invalid_argument( "RunLength encoding expects scalar column: " + colDef.colName );
+    case ColumnEncoding::FrameOfReference:
+    case ColumnEncoding::Delta:
+    case ColumnEncoding::DeltaOfDelta:
+        if ( auto pCol = static_invoke_for_type( colDef.colTypeTag, CreateEncodedIntColumn(), *int_codec_of( colDef.encoding ) ) )
+            return IColumnPtr( pCol );
+        throw std::invalid_argument( "Integer codec expects Int32, Int64 or Timestamp column: " + colDef.colName );
+    default:
+        throw std::invalid_argument( "Invalid column encoding: " + std::to_string( int( colDef.encoding ) ) );
+    }
+}
+
+} // namespace zj
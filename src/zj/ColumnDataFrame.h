@@ -0,0 +1,547 @@
+/*
+ * This file is part of the ftl (Fast Template Library) distribution (https://github.com/zjgoggle/ftl).
+ * Copyright (c) 2020 Jack Zhang.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <zj/IDataFrame.h>
+#include <zj/Column.h>
+#include <zj/BinaryIO.h>
+#include <zj/ReadCSV.h>
+#include <algorithm>
+#include <sstream>
+
+namespace zj
+{
+
+/**
+ * @brief The columnar DataFrame. Each column is stored as a typed contiguous array chosen by ColumnDef::colTypeTag,
+ * or as dictionary codes if ColumnDef::encoding is ColumnEncoding::Dictionary. Vector columns are stored as flat values and row offsets.
+ * Bool columns are packed in bitmap. Scalar columns of ColumnEncoding::RunLength are stored as runs (see RunColumn). Int32, Int64 and
+ * Timestamp columns of integer codecs, e.g. ColumnEncoding::DeltaOfDelta, are stored as bit-packed blocks (see EncodedIntColumn).
+ * at() materializes the cell into a thread-local field slot (see nextFieldSlot), so the returned reference is short-lived.
+ * Use column() or typedColumn() to scan values without VarField.
+ */
+class ColumnDataFrame : public IDataFrame
+{
+protected:
+    std::vector<ColumnDef> m_columnDefs;
+    std::vector<IColumnPtr> m_columns;
+    size_t m_nrows = 0;
+
+    std::unordered_map<std::string, size_t> m_columnNames; // <name: index>
+
+    bool m_allowNullField = true;
+
+public:
+    ColumnDataFrame() = default;
+
+    ColumnDataFrame( const std::vector<std::vector<std::string>> &rows, const ColumnDefs &columnDefs )
+    {
+        std::stringstream err;
+        if ( !from_rows( rows, columnDefs, &err ) )
+            throw std::runtime_error( "Failed to create ColumnDataFrame from strings vector: " + err.str() );
+    }
+    template<class... T>
+    ColumnDataFrame( const std::vector<std::tuple<T...>> &tups, const std::vector<std::string> &colNames = {} )
+    {
+        std::stringstream err;
+        if ( !from_tuples( tups, colNames, &err ) )
+            throw std::runtime_error( "Failed to create ColumnDataFrame from tuple vector: " + err.str() );
+    }
+    ColumnDataFrame( const ColumnDataFrame &a )
+            : m_columnDefs( a.m_columnDefs ), m_nrows( a.m_nrows ), m_columnNames( a.m_columnNames ), m_allowNullField( a.m_allowNullField )
+    {
+        for ( const auto &col : a.m_columns )
+            m_columns.emplace_back( col->clone() );
+    }
+    ColumnDataFrame( ColumnDataFrame &&a ) = default;
+    ColumnDataFrame &operator=( const ColumnDataFrame &a )
+    {
+        if ( this != &a )
+        {
+            ColumnDataFrame tmp( a );
+            *this = std::move( tmp );
+        }
+        return *this;
+    }
+    ColumnDataFrame &operator=( ColumnDataFrame &&a ) = default;
+    ~ColumnDataFrame() override = default;
+
+    /// \brief Create columns without any row. Rows can be appended by appendRowStr or appendTupple.
+    void create( const ColumnDefs &columnDefs )
+    {
+        clear();
+        m_columnDefs = columnDefs;
+        for ( const auto &colDef : m_columnDefs )
+            m_columns.push_back( create_column( colDef ) );
+        createColumnIndex();
+    }
+
+    /// \brief Load DFBC written by save_binary.
+    bool load_binary( std::istream &is, std::ostream *err = nullptr )
+    {
+        DFBCReader reader;
+        return reader.open( is, err ) && load_binary( reader, err );
+    }
+    bool load_binary( const std::string &filename, std::ostream *err = nullptr )
+    {
+        DFBCReader reader;
+        return reader.open( filename, err ) && load_binary( reader, err );
+    }
+    /// \brief Read each column block of reader into the column storage.
+    bool load_binary( DFBCReader &reader, std::ostream *err = nullptr )
+    {
+        create( reader.columnDefs() );
+        for ( size_t icol = 0; icol < m_columns.size(); ++icol )
+        {
+            m_columns[icol]->reserve( reader.numRows() );
+            if ( !reader.readColumn( icol, *m_columns[icol], err ) )
+            {
+                clearRecords();
+                return false;
+            }
+        }
+        m_nrows = reader.numRows();
+        return true;
+    }
+
+    bool from_rows( const std::vector<std::vector<std::string>> &rows, const ColumnDefs &columnDefs = {}, std::ostream *err = nullptr )
+    {
+        create( columnDefs );
+        for ( auto &col : m_columns )
+            col->reserve( rows.size() );
+        for ( const auto &row : rows )
+        {
+            if ( !appendRowStr( row, err ) )
+                return false;
+        }
+        return true;
+    }
+
+    /// \brief Read csv records of text into columns of columnDefs. Records are copied into a CsvRecordBatch of up to 4096 rows,
+    /// whose fields are then parsed column by column into the typed columns (see appendBatch). Columns are reserved by the count
+    /// of lines in text.
+    /// \return false if a record doesn't match columns. ColumnDataFrame keeps the records before it.
+    /// \throw runtime_error if a quoted string is malformed.
+    bool read_csv( std::string_view text, const ColumnDefs &columnDefs, const CsvOptions &opts = {}, std::ostream *err = nullptr )
+    {
+        create( columnDefs );
+        const auto nlines = size_t( std::count( text.begin(), text.end(), '\n' ) ) + 1;
+        for ( auto &col : m_columns )
+            col->reserve( nlines > opts.skipLines ? nlines - opts.skipLines : 0 );
+        return appendCsv( [&]( auto &&onRecord ) { scan_csv( text, opts, onRecord ); }, err );
+    }
+    /// \brief Read csv records of is, which is read in blocks (see scan_csv).
+    bool read_csv( std::istream &is, const ColumnDefs &columnDefs, const CsvOptions &opts = {}, std::ostream *err = nullptr )
+    {
+        create( columnDefs );
+        return appendCsv( [&]( auto &&onRecord ) { scan_csv( is, opts, onRecord ); }, err );
+    }
+    /// \brief Read csv records of the memory mapping of filename.
+    bool read_csv_file( const std::string &filename, const ColumnDefs &columnDefs, const CsvOptions &opts = {}, std::ostream *err = nullptr )
+    {
+        if ( MappedFile::isEmptyFile( filename ) )
+        {
+            create( columnDefs );
+            return true;
+        }
+        MappedFile file;
+        if ( !file.open( filename, err ) )
+            return false;
+        file.adviseSequential();
+        return read_csv( std::string_view( file.data(), file.size() ), columnDefs, opts, err );
+    }
+
+    /// \brief Parse fields of row into columns. Row is a vector of std::string or std::string_view.
+    template<class Row = std::vector<std::string>>
+    bool appendRowStr( const Row &row, std::ostream *err = nullptr )
+    {
+        if ( m_columnDefs.empty() )
+        {
+            if ( err )
+                *err << "Failed appendRowStr: ColumnDataFrame is not created yet!\n";
+            return false;
+        }
+        if ( row.size() != m_columnDefs.size() )
+        {
+            if ( err )
+                *err << "appendRowStr: Failed construct row=" << to_string( row ) << ". NumFields=" << row.size()
+                     << " is not equal to columns=" << m_columnDefs.size() << ".\n";
+            return false;
+        }
+        for ( size_t i = 0; i < m_columnDefs.size(); ++i )
+        {
+            IColumn &col = *m_columns[i];
+            if ( !col.appendStr( row[i] ) )
+            {
+                if ( err )
+                    *err << "appendRowStr: Failed to parse (row element=" << to_string( row[i] ) << ", col=" << i << ").\n";
+                return rollbackRow();
+            }
+            if ( !m_allowNullField && col.isNull( m_nrows ) )
+            {
+                if ( err )
+                    *err << "appendRowStr: Null field is not allowed at col=" << i << ".\n";
+                return rollbackRow();
+            }
+        }
+        ++m_nrows;
+        return true;
+    }
+
+    /// \brief Append a record whose fields are compatible with columns.
+    bool appendRecord( const Record &rec, std::ostream *err = nullptr )
+    {
+        if ( !is_record_compatible( rec, m_columnDefs, err, m_allowNullField ) )
+            return false;
+        for ( size_t i = 0; i < m_columnDefs.size(); ++i )
+        {
+            if ( !m_columns[i]->append( rec[i] ) )
+            {
+                if ( err )
+                    *err << "appendRecord: Incompatible field:" << to_string( rec[i] ) << " at col=" << i << ".\n";
+                return rollbackRow();
+            }
+        }
+        ++m_nrows;
+        return true;
+    }
+
+    template<class... T>
+    bool from_tuples( const std::vector<std::tuple<T...>> &tups, const std::vector<std::string> &colNames = {}, std::ostream *err = nullptr )
+    {
+        static_assert( CompatibleFieldTypes<T...>(), "" );
+        clear();
+
+        const std::vector<std::string> *pNames = &colNames;
+        std::vector<std::string> generatedNames;
+        size_t nCol = std::tuple_size_v<std::tuple<T...>>;
+        if ( colNames.empty() )
+        {
+            for ( auto i = 0u; i < nCol; ++i )
+            {
+                generatedNames.push_back( "Col" + std::to_string( i ) );
+            }
+            pNames = &generatedNames;
+        }
+        else if ( colNames.size() != nCol )
+        {
+            if ( err )
+                *err << "Expecting " << nCol << " names, privided " << colNames.size() << ".\n";
+            return false;
+        }
+        ColumnDefs columnDefs;
+        create_columns<0, CompatibleFieldType_t<T>...>( columnDefs, *pNames );
+        create( columnDefs );
+
+        for ( const auto &tup : tups )
+        {
+            if ( !appendTupple( tup, err ) )
+                return false;
+        }
+        return true;
+    }
+
+    template<class... T>
+    bool appendTupple( const std::tuple<T...> &tup, std::ostream *err = nullptr )
+    {
+        static_assert( CompatibleFieldTypes<T...>(), "" );
+        if ( m_columnDefs.empty() )
+        {
+            if ( err )
+                *err << "Failed appendTupple: ColumnDataFrame is not created yet!\n";
+            return false;
+        }
+        auto tupSize = std::tuple_size_v<std::tuple<T...>>;
+        if ( tupSize != m_columnDefs.size() )
+        {
+            if ( err )
+                *err << "appendTupple: Failed construct row=" << to_string( tup ) << ". NumFields=" << tupSize
+                     << " is not equal to columns=" << m_columnDefs.size() << ".\n";
+            return false;
+        }
+        Record rec;
+        if ( !create_record( rec, tup, err, m_allowNullField ) )
+            return false;
+        return appendRecord( rec, err );
+    }
+
+    bool canAppend( const IDataFrame &rhs, std::ostream *err = nullptr ) const
+    {
+        // check if another has all consistent columns that <columnName, columnType> is the same.
+        for ( const auto &col : m_columnDefs )
+        {
+            auto &colDef = rhs.columnDef( rhs.colIndex( col.colName ) );
+            if ( col.colTypeTag != colDef.colTypeTag ) // check colType
+            {
+                if ( err )
+                    *err << "Failed to append: column " << col.colName << " type doesn't match " << typeName( col.colTypeTag )
+                         << " != " << typeName( colDef.colTypeTag ) << ".\n";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // if this is empty, copy columns from rhs.
+    bool append( const IDataFrame &rhs, std::ostream *err = nullptr )
+    {
+        if ( !canAppend( rhs, err ) )
+            return false;
+        if ( m_columnDefs.empty() )
+        {
+            ColumnDefs columnDefs;
+            for ( size_t i = 0, ncols = rhs.countCols(); i < ncols; ++i )
+                columnDefs.push_back( rhs.columnDef( i ) );
+            create( columnDefs );
+        }
+        std::vector<size_t> rhsCols;
+        for ( const auto &col : m_columnDefs )
+            rhsCols.push_back( rhs.colIndex( col.colName ) );
+        for ( auto &col : m_columns )
+            col->reserve( m_nrows + rhs.countRows() );
+        const size_t nrowsBefore = m_nrows;
+        for ( size_t i = 0, nrows = rhs.countRows(); i < nrows; ++i )
+        {
+            for ( size_t j = 0, ncols = m_columns.size(); j < ncols; ++j )
+            {
+                const VarField &field = rhs.at( i, rhsCols[j] );
+                if ( !m_columns[j]->append( field ) )
+                {
+                    if ( err )
+                        *err << "append: Incompatible field:" << to_string( field ) << " at row=" << i << ", col=" << j << ".\n";
+                    m_nrows = nrowsBefore; // all or none of rhs rows are appended.
+                    return rollbackRow();
+                }
+            }
+            ++m_nrows;
+        }
+        return true;
+    }
+    IDataFrame *deepCopy() const override
+    {
+        return new ColumnDataFrame( *this );
+    }
+
+    size_t countRows() const override
+    {
+        return m_nrows;
+    }
+    size_t countCols() const override
+    {
+        return m_columnDefs.size();
+    }
+    const VarField &at( size_t irow, size_t icol ) const override
+    {
+        if ( icol >= countCols() )
+            throw std::out_of_range( "icol our of range: " + to_string( icol ) + " >= " + to_string( m_columnDefs.size() ) );
+        if ( irow >= countRows() )
+            throw std::out_of_range( "irow our of range: " + to_string( irow ) + " >= " + to_string( countRows() ) );
+        VarField &slot = nextFieldSlot();
+        m_columns[icol]->get( irow, slot );
+        return slot;
+    }
+    const VarField &at( size_t irow, const std::string &col ) const override
+    {
+        return at( irow, colIndex( col ) );
+    }
+    const VarField &operator()( size_t irow, size_t icol ) const
+    {
+        return at( irow, icol );
+    }
+    const VarField &operator()( size_t irow, const std::string &col ) const
+    {
+        return at( irow, col );
+    }
+
+    const IColumn *getColumn( size_t icol ) const override
+    {
+        return m_columns.at( icol ).get();
+    }
+    const IColumn &column( size_t icol ) const
+    {
+        return *m_columns.at( icol );
+    }
+    const IColumn &column( const std::string &colName ) const
+    {
+        return *m_columns[colIndex( colName )];
+    }
+    /// \return nullptr if the column is not stored as TypedColumn<T>. Bool columns are stored as BoolColumn.
+    template<class T>
+    const TypedColumn<T> *typedColumn( size_t icol ) const
+    {
+        return dynamic_cast<const TypedColumn<T> *>( m_columns.at( icol ).get() );
+    }
+    /// \return nullptr if the column is not a Bool column, which is packed in bitmap.
+    const BoolColumn *boolColumn( size_t icol ) const
+    {
+        return dynamic_cast<const BoolColumn *>( m_columns.at( icol ).get() );
+    }
+    /// \return nullptr if the column is not stored as ListColumn<T>, i.e. FieldValue<std::vector<T>>.
+    template<class T>
+    const ListColumn<T> *listColumn( size_t icol ) const
+    {
+        return dynamic_cast<const ListColumn<T> *>( m_columns.at( icol ).get() );
+    }
+    /// \return nullptr if the column is not stored as RunColumn<T>, i.e. ColumnEncoding::RunLength.
+    template<class T>
+    const RunColumn<T> *runColumn( size_t icol ) const
+    {
+        return dynamic_cast<const RunColumn<T> *>( m_columns.at( icol ).get() );
+    }
+    /// \return nullptr if the column is not stored as EncodedIntColumn<T>, i.e. an integer codec.
+    template<class T>
+    const EncodedIntColumn<T> *encodedColumn( size_t icol ) const
+    {
+        return dynamic_cast<const EncodedIntColumn<T> *>( m_columns.at( icol ).get() );
+    }
+    /// \return nullptr if the column is not dictionary-encoded.
+    const DictStrColumn *dictColumn( size_t icol ) const
+    {
+        return dynamic_cast<const DictStrColumn *>( m_columns.at( icol ).get() );
+    }
+    /// \brief Re-encode all the dictionary-encoded columns with sorted dictionaries. Call it after loading so that
+    /// ordered comparisons work on codes.
+    void sortDictionaries()
+    {
+        for ( auto &col : m_columns )
+            if ( auto pCol = dynamic_cast<DictStrColumn *>( col.get() ) )
+                pCol->sortDictionary();
+    }
+    /// \brief Let column icol use the dictionary of column icolA in a, so that codes of both can be compared directly.
+    /// \pre Both are dictionary-encoded and column icol is empty.
+    bool shareDictionary( size_t icol, const ColumnDataFrame &a, size_t icolA, std::ostream *err = nullptr )
+    {
+        auto pCol = dynamic_cast<DictStrColumn *>( m_columns.at( icol ).get() );
+        auto pColA = a.dictColumn( icolA );
+        if ( !pCol || !pColA )
+        {
+            if ( err )
+                *err << "shareDictionary: column " << icol << " or " << icolA << " is not dictionary-encoded.\n";
+            return false;
+        }
+        if ( !pCol->shareDictionary( *pColA ) )
+        {
+            if ( err )
+                *err << "shareDictionary: column " << icol << " is not empty.\n";
+            return false;
+        }
+        return true;
+    }
+
+    const ColumnDef &columnDef( size_t icol ) const override
+    {
+        if ( icol >= m_columnDefs.size() )
+        {
+            throw std::out_of_range( "icol our of range: " + to_string( icol ) + " >= " + to_string( m_columnDefs.size() ) );
+        }
+        return m_columnDefs[icol];
+    }
+    const ColumnDef &columnDef( const std::string &colName ) const override
+    {
+        return m_columnDefs.at( colIndex( colName ) );
+    }
+
+    const std::string &colName( size_t icol ) const override
+    {
+        return m_columnDefs[icol].colName;
+    }
+
+    size_t colIndex( const std::string &colName ) const override
+    {
+        if ( auto it = m_columnNames.find( colName ); it != m_columnNames.end() )
+            return it->second;
+        throw std::out_of_range( "Failed to find DataFrame column name:" + colName );
+    }
+
+    void clearRecords()
+    {
+        for ( auto &col : m_columns )
+            col->truncate( 0 );
+        m_nrows = 0;
+    }
+    /// \brief clear records and columns.
+    void clear()
+    {
+        m_columnDefs.clear();
+        m_columns.clear();
+        m_columnNames.clear();
+        m_nrows = 0;
+    }
+
+protected:
+    void createColumnIndex()
+    {
+        m_columnNames.clear();
+        for ( size_t i = 0, N = m_columnDefs.size(); i < N; ++i )
+            m_columnNames[m_columnDefs[i].colName] = i;
+    }
+    // drop fields appended for the current row.
+    bool rollbackRow()
+    {
+        for ( auto &col : m_columns )
+            col->truncate( m_nrows );
+        return false;
+    }
+    // scan( onRecord ) calls onRecord( const std::vector<std::string_view> &fields ) for each csv record.
+    // Records are collected in batches, which are appended column by column (see appendBatch).
+    template<class Scan>
+    bool appendCsv( Scan &&scan, std::ostream *err )
+    {
+        static constexpr size_t BatchRows = 4096;
+        CsvRecordBatch batch;
+        bool ok = true;
+        scan( [&]( const std::vector<std::string_view> &fields ) {
+            batch.push_back( fields );
+            if ( batch.size() < BatchRows )
+                return true;
+            ok = appendBatch( batch, err );
+            batch.clear();
+            return ok;
+        } );
+        return ok && appendBatch( batch, err );
+    }
+    // append fields of each column by IColumn::appendStrs. If a record doesn't match, the batch is appended row by row to stop there.
+    bool appendBatch( const CsvRecordBatch &batch, std::ostream *err )
+    {
+        const size_t nrows = batch.size(), ncols = m_columnDefs.size();
+        bool bulk = ncols != 0;
+        for ( size_t irow = 0; bulk && irow < nrows; ++irow )
+            bulk = batch.countFields( irow ) == ncols;
+        std::vector<std::string_view> fields( bulk ? nrows : 0 );
+        for ( size_t icol = 0; bulk && icol < ncols; ++icol )
+        {
+            IColumn &col = *m_columns[icol];
+            const size_t nullCount = col.countNulls();
+            for ( size_t irow = 0; irow < nrows; ++irow )
+                fields[irow] = batch.field( irow, icol );
+            bulk = col.appendStrs( fields.data(), nrows ) == nrows && ( m_allowNullField || col.countNulls() == nullCount );
+        }
+        if ( bulk )
+        {
+            m_nrows += nrows;
+            return true;
+        }
+        rollbackRow();
+        for ( size_t irow = 0; irow < nrows; ++irow )
+            if ( !appendRowStr( batch.record( irow ), err ) )
+                return false;
+        return true;
+    }
+};
+
+} // namespace zj
@@ -0,0 +1,537 @@
+/*
+ * This file is part of the ftl (Fast Template Library) distribution (https://github.com/zjgoggle/ftl).
+ * Copyright (c) 2020 Jack Zhang.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <zj/VarField.h>
+#include <limits>
+
+namespace zj
+{
+
+///////////////////////////////////////////////////////////////
+/// CompactField: 16-byte tagged field.
+///////////////////////////////////////////////////////////////
+
+/**
+ * @brief A tagged field of the same value types as VarField in 16 bytes.
+ * Scalars and Timestamp are stored inline. Str bytes and vectors are stored out of line, either owned (allocated and freed by the field)
+ * or borrowed (pointing to storage that outlives the field, e.g. an arena or a VarField).
+ * Compare and hash are consistent with VarField: CompactField(var) == var, and hash_code of both are the same.
+ */
+class CompactField
+{
+protected:
+    union Payload
+    {
+        bool b;
+        char c;
+        int32_t i32;
+        int64_t i64;
+        float f32;
+        double f64;
+        const char *str; // Str: m_len bytes, not null terminated.
+        const void *ptr; // vector: pointer to the underlying type of FieldValue.
+    } m_val;
+    uint32_t m_len = 0; // length of Str, or Timestamp::formatBits() of Timestamp.
+    FieldTypeTag m_tag = FieldTypeTag::Null;
+    bool m_owned = false; // str/ptr is allocated by this field.
+
+public:
+    // vectors are stored out of line.
+    template<class T>
+    static constexpr bool is_out_of_line = FieldValue<T>::is_vec;
+
+    CompactField()
+    {
+        m_val.i64 = 0;
+    }
+    template<class T>
+    explicit CompactField( FieldValue<T> v ) : CompactField()
+    {
+        set<T>( std::move( v.value ) );
+    }
+    explicit CompactField( const VarField &var ) : CompactField()
+    {
+        std::visit( [this]( const auto &fieldval ) { set( fieldval.value ); }, var );
+    }
+    /// \brief A field that refers to the out-of-line value of var without copying it. var must outlive the field.
+    static CompactField borrow( const VarField &var )
+    {
+        CompactField res;
+        std::visit( [&res]( const auto &fieldval ) { res.setBorrowed( fieldval.value ); }, var );
+        return res;
+    }
+    /// \brief A Str field that refers to s without copying it. The bytes of s must outlive the field.
+    static CompactField borrowStr( std::string_view s )
+    {
+        CompactField res;
+        res.setTag( FieldTypeTag::Str );
+        res.m_val.str = s.data();
+        res.m_len = uint32_t( s.size() );
+        return res;
+    }
+
+    CompactField( const CompactField &a ) : m_val( a.m_val ), m_len( a.m_len ), m_tag( a.m_tag ), m_owned( false )
+    {
+        if ( a.m_owned )
+            copyPayload();
+    }
+    CompactField( CompactField &&a ) noexcept : m_val( a.m_val ), m_len( a.m_len ), m_tag( a.m_tag ), m_owned( a.m_owned )
+    {
+        a.m_owned = false;
+        a.m_tag = FieldTypeTag::Null;
+    }
+    CompactField &operator=( const CompactField &a )
+    {
+        if ( this != &a )
+        {
+            CompactField tmp( a );
+            *this = std::move( tmp );
+        }
+        return *this;
+    }
+    CompactField &operator=( CompactField &&a ) noexcept
+    {
+        if ( this != &a )
+        {
+            freePayload();
+            m_val = a.m_val;
+            m_len = a.m_len;
+            m_tag = a.m_tag;
+            m_owned = a.m_owned;
+            a.m_owned = false;
+            a.m_tag = FieldTypeTag::Null;
+        }
+        return *this;
+    }
+    ~CompactField()
+    {
+        freePayload();
+    }
+
+    FieldTypeTag typeTag() const
+    {
+        return m_tag;
+    }
+    /// Same as VarField::index().
+    size_t index() const
+    {
+        return size_t( m_tag );
+    }
+    bool isNull() const
+    {
+        return m_tag == FieldTypeTag::Null;
+    }
+    bool isOwned() const
+    {
+        return m_owned;
+    }
+    /// \return true if the value of type is stored out of line, except Str.
+    static constexpr bool isOutOfLineType( FieldTypeTag type )
+    {
+        return is_vec_field( type );
+    }
+    /// \brief Deep copy. Unlike copy constructor, the out-of-line value is copied even if it's borrowed.
+    CompactField clone() const
+    {
+        CompactField res( *this );
+        if ( !res.m_owned && ( m_tag == FieldTypeTag::Str || isOutOfLineType( m_tag ) ) )
+            res.copyPayload();
+        return res;
+    }
+
+    void setNull()
+    {
+        setTag( FieldTypeTag::Null );
+        m_val.i64 = 0;
+    }
+    /// \brief Set an owned copy of string s.
+    void setStr( std::string_view s )
+    {
+        if ( s.size() > std::numeric_limits<uint32_t>::max() )
+            throw std::length_error( "CompactField string is too long: " + std::to_string( s.size() ) );
+        char *p = s.empty() ? nullptr : new char[s.size()];
+        if ( p )
+            std::memcpy( p, s.data(), s.size() );
+        setTag( FieldTypeTag::Str );
+        m_val.str = p;
+        m_len = uint32_t( s.size() );
+        m_owned = p != nullptr;
+    }
+    template<class T>
+    void set( T val )
+    {
+        using FieldT = FieldValue<T>;
+        static_assert( FieldT::type != FieldTypeTag::End, "Not a field value type" );
+        if constexpr ( std::is_same_v<T, Null> )
+            setNull();
+        else if constexpr ( std::is_same_v<T, Str> )
+            setStr( val );
+        else if constexpr ( is_out_of_line<T> )
+        {
+            auto p = new T( std::move( val ) );
+            setTag( FieldT::type );
+            m_val.ptr = p;
+            m_owned = true;
+        }
+        else if constexpr ( std::is_same_v<T, Timestamp> )
+        {
+            setTag( FieldT::type );
+            m_val.i64 = val.nanos;
+            m_len = val.formatBits();
+        }
+        else
+        {
+            setTag( FieldT::type );
+            m_val.i64 = 0;
+            std::memcpy( &m_val, &val, sizeof( T ) );
+        }
+    }
+    template<class T>
+    void setBorrowed( const T &val )
+    {
+        if constexpr ( std::is_same_v<T, Str> )
+            *this = borrowStr( val );
+        else if constexpr ( is_out_of_line<T> )
+        {
+            setTag( FieldValue<T>::type );
+            m_val.ptr = &val;
+        }
+        else
+            set( val );
+    }
+
+    /// \pre typeTag() == FieldValue<T>::type
+    /// \return std::string_view for Str, const reference for out-of-line types, or the scalar value.
+    template<class T>
+    decltype( auto ) value() const
+    {
+        assert( m_tag == FieldValue<T>::type );
+        if constexpr ( std::is_same_v<T, Str> )
+            return strView();
+        else if constexpr ( is_out_of_line<T> )
+            return *static_cast<const T *>( m_val.ptr );
+        else if constexpr ( std::is_same_v<T, Null> )
+            return Null{};
+        else if constexpr ( std::is_same_v<T, Timestamp> )
+            return Timestamp::fromFormatBits( m_val.i64, m_len );
+        else
+        {
+            T res;
+            std::memcpy( &res, &m_val, sizeof( T ) );
+            return res;
+        }
+    }
+    /// \pre typeTag() == FieldTypeTag::Str
+    std::string_view strView() const
+    {
+        assert( m_tag == FieldTypeTag::Str );
+        return std::string_view( m_val.str, m_len );
+    }
+
+    /// \return value of Bool, Char, Int32 and Int64 fields as VarField getAsInt does.
+    std::optional<int64_t> asInt() const
+    {
+        switch ( m_tag )
+        {
+        case FieldTypeTag::Bool:
+            return m_val.b;
+        case FieldTypeTag::Char:
+            return m_val.c;
+        case FieldTypeTag::Int32:
+            return m_val.i32;
+        case FieldTypeTag::Int64:
+            return m_val.i64;
+        default:
+            return {};
+        }
+    }
+    /// \return value of Float32 and Float64 fields as VarField getAsDouble does.
+    std::optional<double> asDouble() const
+    {
+        if ( m_tag == FieldTypeTag::Float32 )
+            return m_val.f32;
+        if ( m_tag == FieldTypeTag::Float64 )
+            return m_val.f64;
+        return {};
+    }
+
+    /// \brief Copy the value into var. var is reused if it already holds the field type.
+    void get( VarField &var ) const
+    {
+        static_invoke_for_type( m_tag, GetVarField(), *this, var );
+    }
+    VarField toVarField() const
+    {
+        VarField var;
+        get( var );
+        return var;
+    }
+
+protected:
+    struct GetVarField
+    {
+        template<class T>
+        void invoke( const CompactField &a, VarField &var ) const
+        {
+            using FieldT = FieldValue<T>;
+            if constexpr ( std::is_same_v<T, Null> )
+                var = NullField{};
+            else if ( auto p = std::get_if<FieldT>( &var ) )
+                p->value = T( a.value<T>() );
+            else
+                var.template emplace<FieldT>( FieldT{T( a.value<T>() )} );
+        }
+    };
+    struct CopyPayload
+    {
+        template<class T>
+        const void *invoke( const void *p ) const
+        {
+            if constexpr ( is_out_of_line<T> )
+                return new T( *static_cast<const T *>( p ) );
+            else
+                return nullptr;
+        }
+    };
+    struct FreePayload
+    {
+        template<class T>
+        void invoke( const void *p ) const
+        {
+            if constexpr ( is_out_of_line<T> )
+                delete static_cast<const T *>( p );
+        }
+    };
+
+    void setTag( FieldTypeTag tag )
+    {
+        freePayload();
+        m_tag = tag;
+        m_len = 0;
+    }
+    void copyPayload()
+    {
+        if ( m_tag == FieldTypeTag::Str )
+        {
+            auto p = new char[m_len];
+            std::memcpy( p, m_val.str, m_len );
+            m_val.str = p;
+        }
+        else
+            m_val.ptr = static_invoke_for_type( m_tag, CopyPayload(), m_val.ptr );
+        m_owned = true;
+    }
+    void freePayload()
+    {
+        if ( !m_owned )
+            return;
+        if ( m_tag == FieldTypeTag::Str )
+            delete[] m_val.str;
+        else
+            static_invoke_for_type( m_tag, FreePayload(), m_val.ptr );
+        m_owned = false;
+    }
+};
+
+static_assert( sizeof( CompactField ) == 16, "CompactField is expected to be 16 bytes." );
+
+using CompactRecord = std::vector<CompactField>;
+
+inline CompactRecord to_compact( const Record &rec )
+{
+    CompactRecord res;
+    res.reserve( rec.size() );
+    for ( const auto &e : rec )
+        res.emplace_back( e );
+    return res;
+}
+inline Record to_record( const CompactField *fields, size_t nfields )
+{
+    Record res;
+    res.reserve( nfields );
+    for ( size_t i = 0; i < nfields; ++i )
+        res.push_back( fields[i].toVarField() );
+    return res;
+}
+inline Record to_record( const CompactRecord &rec )
+{
+    return to_record( rec.data(), rec.size() );
+}
+
+struct ParseCompactField
+{
+    template<class T>
+    bool invoke( CompactField &field, std::string_view s ) const
+    {
+        if constexpr ( std::is_same_v<T, Str> )
+        {
+            field.setStr( s );
+            return true;
+        }
+        else
+        {
+            FieldValue<T> fieldval{};
+            if ( !from_string( fieldval, s ) )
+                return false;
+            field.set( std::move( fieldval.value ) );
+            return true;
+        }
+    }
+};
+
+/// \brief Parse string s as typeTag into field without a temporary VarField. "N/A" is parsed as null if global().bParseNull.
+inline bool from_string( CompactField &field, FieldTypeTag typeTag, std::string_view s )
+{
+    if ( global().bParseNull && is_null( s ) )
+    {
+        field.setNull();
+        return true;
+    }
+    return static_invoke_for_type( typeTag, ParseCompactField(), field, s );
+}
+
+///////////////////////////////////////////////////////////////
+/// compare and hash. Same semantic as VarField: null is less than any value; numeric fields are compared by value.
+///////////////////////////////////////////////////////////////
+
+struct CompactEqual
+{
+    template<class T>
+    bool invoke( const CompactField &a, const CompactField &b ) const
+    {
+        if constexpr ( std::is_same_v<T, Null> )
+            return true;
+        else
+            return a.value<T>() == b.value<T>();
+    }
+};
+struct CompactLess
+{
+    template<class T>
+    bool invoke( const CompactField &a, const CompactField &b ) const
+    {
+        if constexpr ( std::is_same_v<T, Null> )
+            return false;
+        else
+            return a.value<T>() < b.value<T>();
+    }
+};
+
+inline bool operator==( const CompactField &a, const CompactField &b )
+{
+    int anynull = ( a.isNull() ? 1 : 0 ) | ( b.isNull() ? 2 : 0 );
+    if ( anynull )
+        return anynull == 3;
+    if ( auto intA = a.asInt() )
+    {
+        if ( auto intB = b.asInt() )
+            return *intA == *intB;
+        else if ( auto doubleB = b.asDouble() )
+            return *intA == *doubleB;
+    }
+    else if ( auto doubleA = a.asDouble() )
+    {
+        if ( auto intB = b.asInt() )
+            return *doubleA == *intB;
+        else if ( auto doubleB = b.asDouble() )
+            return *doubleA == *doubleB;
+    }
+    if ( a.typeTag() != b.typeTag() )
+        return false;
+    return static_invoke_for_type( a.typeTag(), CompactEqual(), a, b );
+}
+inline bool operator<( const CompactField &a, const CompactField &b )
+{
+    int anynull = ( a.isNull() ? 1 : 0 ) | ( b.isNull() ? 2 : 0 );
+    if ( anynull )
+        return ( anynull == 1 ); // null is always less than non-null.
+    if ( auto intA = a.asInt() )
+    {
+        if ( auto intB = b.asInt() )
+            return *intA < *intB;
+        else if ( auto doubleB = b.asDouble() )
+            return *intA < *doubleB;
+    }
+    else if ( auto doubleA = a.asDouble() )
+    {
+        if ( auto intB = b.asInt() )
+            return *doubleA < *intB;
+        else if ( auto doubleB = b.asDouble() )
+            return *doubleA < *doubleB;
+    }
+    if ( a.typeTag() != b.typeTag() )
+        return a.typeTag() < b.typeTag();
+    return static_invoke_for_type( a.typeTag(), CompactLess(), a, b );
+}
+inline bool operator!=( const CompactField &a, const CompactField &b )
+{
+    return !( a == b );
+}
+
+inline bool operator==( const CompactField &a, const VarField &b )
+{
+    return a == CompactField::borrow( b );
+}
+inline bool operator==( const VarField &a, const CompactField &b )
+{
+    return CompactField::borrow( a ) == b;
+}
+inline bool operator<( const CompactField &a, const VarField &b )
+{
+    return a < CompactField::borrow( b );
+}
+inline bool operator<( const VarField &a, const CompactField &b )
+{
+    return CompactField::borrow( a ) < b;
+}
+
+struct HashCompactField
+{
+    template<class T>
+    size_t invoke( const CompactField &a ) const
+    {
+        if constexpr ( std::is_same_v<T, Null> )
+            return hashcode( Null{} );
+        else if constexpr ( std::is_same_v<T, Str> )
+            return std::hash<std::string_view>()( a.strView() ); // same as std::hash<std::string>.
+        else
+            return hashcode( a.value<T>() );
+    }
+};
+
+/// \note It's the same as hash_code<VarField> of the same value.
+template<>
+struct hash_code<CompactField>
+{
+    size_t operator()( const CompactField &a ) const
+    {
+        return static_invoke_for_type( a.typeTag(), HashCompactField(), a );
+    }
+};
+
+inline std::string to_string( const CompactField &a )
+{
+    return to_string( a.toVarField() );
+}
+inline std::ostream &operator<<( std::ostream &os, const CompactField &a )
+{
+    return os << to_string( a );
+}
+
+} // namespace zj
@@ -17,7 +17,11 @@
 
 #pragma once
 
+#include <numeric>
 #include <zj/IDataFrame.h>
+#include <zj/Column.h>
+#include <zj/RowMapping.h>
+#include <zj/RowGroupStats.h>
 
 namespace zj
 {
@@ -33,6 +37,8 @@ enum class OperatorTag
 
     ISIN,
     NOTIN,
+    ISNULL,
+    NOTNULL,
     AND, // &&
     OR, // ||
 };
@@ -57,6 +63,10 @@ inline const char *to_cstr( OperatorTag v )
         return "isin";
     case OperatorTag::NOTIN:
         return "notin";
+    case OperatorTag::ISNULL:
+        return "isnull";
+    case OperatorTag::NOTNULL:
+        return "notnull";
     case OperatorTag::AND:
         return "&&";
     case OperatorTag::OR:
@@ -87,6 +97,10 @@ inline OperatorTag logicOpposite( OperatorTag v )
         return OperatorTag::NOTIN;
     case OperatorTag::NOTIN:
         return OperatorTag::ISIN;
+    case OperatorTag::ISNULL:
+        return OperatorTag::NOTNULL;
+    case OperatorTag::NOTNULL:
+        return OperatorTag::ISNULL;
     case OperatorTag::AND:
         return OperatorTag::OR;
     case OperatorTag::OR:
@@ -124,6 +138,12 @@ struct ICondition
     virtual bool evalAtRow( Rowindex irow ) const = 0;
     virtual const std::vector<size_t> &getColIndices() const = 0;
     virtual OperatorTag getOperator() const = 0;
+    /// \brief Test a row group by statistics of the single condition column.
+    /// \return false if no row of the row group can match; true if any may match.
+    virtual bool mayMatchChunk( const ColumnChunkStats &/*stats*/ ) const
+    {
+        return true;
+    }
     virtual ~ICondition() = default;
 };
 using IConditionPtr = std::unique_ptr<ICondition>;
@@ -158,6 +178,322 @@ inline bool checkFieldCompatible( const IDataFrame *df, const std::vector<std::s
     return true;
 }
 
+///////////////////////////////////////////////////////////////
+/// Typed scan kernels on columnar storage (see IDataFrame::getColumn).
+///////////////////////////////////////////////////////////////
+
+/// \brief Scan dense values and push the matched row indices. Nulls are tested only if there is a validity bitmap.
+/// \param ibegin row index of values[0], e.g. the first row of a decoded block.
+template<class Values, class Pred>
+void scan_dense_values( const Values &values,
+                        const Bitmap *validity,
+                        bool nullMatches,
+                        Pred &&pred,
+                        RowMapping &irows,
+                        size_t ibegin = 0 )
+{
+    const size_t N = values.size();
+    if ( !validity )
+    {
+        for ( size_t i = 0; i < N; ++i )
+            if ( pred( values[i] ) )
+                irows.push_back( ibegin + i );
+    }
+    else
+    {
+        for ( size_t i = 0; i < N; ++i )
+            if ( validity->test( ibegin + i ) ? pred( values[i] ) : nullMatches )
+                irows.push_back( ibegin + i );
+    }
+}
+
+/// \brief Compare column values with val as VarField operators do: null is less than any value.
+template<class Values, class U>
+void scan_compare_values( const Values &values,
+                          const Bitmap *validity,
+                          OperatorTag op,
+                          const U &val,
+                          RowMapping &irows,
+                          size_t ibegin = 0 )
+{
+    using T = typename Values::value_type;
+    switch ( op )
+    {
+    case OperatorTag::EQ:
+        return scan_dense_values( values, validity, false, [&]( const T &x ) { return x == val; }, irows, ibegin );
+    case OperatorTag::NE:
+        return scan_dense_values( values, validity, true, [&]( const T &x ) { return !( x == val ); }, irows, ibegin );
+    case OperatorTag::LT:
+        return scan_dense_values( values, validity, true, [&]( const T &x ) { return x < val; }, irows, ibegin );
+    case OperatorTag::LE:
+        return scan_dense_values( values, validity, true, [&]( const T &x ) { return !( val < x ); }, irows, ibegin );
+    case OperatorTag::GT:
+        return scan_dense_values( values, validity, false, [&]( const T &x ) { return val < x; }, irows, ibegin );
+    case OperatorTag::GE:
+        return scan_dense_values( values, validity, false, [&]( const T &x ) { return !( x < val ); }, irows, ibegin );
+    default:
+        throw std::runtime_error( "Invalid CompareTag:" + std::to_string( int( op ) ) );
+    }
+}
+
+/// \brief Compare column runs with val as scan_compare_values does, but evaluate once per Duplicate segment, and find the
+/// matched range of an Incremental segment, whose values ascend, by binary search. Nulls are tested only if there is a validity bitmap.
+template<class T, class U>
+void scan_compare_runs( const SparseVector<T> &runs, const Bitmap *validity, OperatorTag op, const U &val, RowMapping &irows )
+{
+    const bool nullMatches = op == OperatorTag::NE || op == OperatorTag::LT || op == OperatorTag::LE;
+    auto addRange = [&]( size_t ibegin, size_t iend, bool matched ) {
+        if ( !validity )
+        {
+            if ( matched )
+                irows.push_back_range( ibegin, iend );
+        }
+        else if ( matched || nullMatches )
+        {
+            for ( size_t i = ibegin; i < iend; ++i )
+                if ( validity->test( i ) ? matched : nullMatches )
+                    irows.push_back( i );
+        }
+    };
+    for ( const auto &seg : runs.segments() )
+    {
+        const size_t ibegin = seg.beginIdx();
+        if ( seg.m_segType == SegType::Duplicate )
+        {
+            addRange( ibegin, seg.m_endIdx, invoke_compare( op, seg.m_value, val ) );
+            continue;
+        }
+        // first local index in [0, size) where pred is false. pred is true for a prefix because values ascend.
+        auto partitionPoint = [&]( auto &&pred ) {
+            size_t lo = 0, hi = seg.size();
+            while ( lo < hi )
+            {
+                size_t mid = lo + ( hi - lo ) / 2;
+                if ( pred( seg.atLocal( mid ) ) )
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            return ibegin + lo;
+        };
+        size_t iLower = partitionPoint( [&]( const T &x ) { return x < val; } ); // first x >= val
+        size_t iUpper = partitionPoint( [&]( const T &x ) { return !( val < x ); } ); // first x > val
+        switch ( op )
+        {
+        case OperatorTag::EQ:
+        case OperatorTag::NE:
+            addRange( ibegin, iLower, op == OperatorTag::NE );
+            addRange( iLower, iUpper, op == OperatorTag::EQ );
+            addRange( iUpper, seg.m_endIdx, op == OperatorTag::NE );
+            break;
+        case OperatorTag::LT:
+        case OperatorTag::GE:
+            addRange( ibegin, iLower, op == OperatorTag::LT );
+            addRange( iLower, seg.m_endIdx, op == OperatorTag::GE );
+            break;
+        case OperatorTag::LE:
+        case OperatorTag::GT:
+            addRange( ibegin, iUpper, op == OperatorTag::LE );
+            addRange( iUpper, seg.m_endIdx, op == OperatorTag::GT );
+            break;
+        default:
+            throw std::runtime_error( "Invalid CompareTag:" + std::to_string( int( op ) ) );
+        }
+    }
+}
+
+/// \brief Push the rows selected by BoolColumn::select, i.e. the bitmap or its complement, without evaluating rows.
+inline void scan_bool_column( const BoolColumn &col, bool trueMatches, bool falseMatches, bool nullMatches, RowMapping &irows )
+{
+    col.select( trueMatches, falseMatches, nullMatches ).foreachSet( [&]( size_t i ) { irows.push_back( i ); } );
+}
+
+// invoked by static_invoke_for_type with column type.
+struct ScanCompareColumn
+{
+    /// \return false if the column storage or the value type is not supported.
+    template<class T>
+    bool invoke( const IColumn &col, OperatorTag op, const VarField &val, RowMapping &irows ) const
+    {
+        using FieldT = FieldValue<T>;
+        if constexpr ( FieldT::is_vec || std::is_same_v<T, Null> )
+            return false;
+        else
+        {
+            if ( val.index() == 0 )
+                return false;
+            if constexpr ( std::is_same_v<T, bool> )
+            {
+                if ( auto pCol = dynamic_cast<const BoolColumn *>( &col ) )
+                {
+                    scan_bool_column( *pCol,
+                                      invoke_compare( op, VarField( BoolField{true} ), val ),
+                                      invoke_compare( op, VarField( BoolField{false} ), val ),
+                                      invoke_compare( op, VarField( NullField{} ), val ),
+                                      irows );
+                    return true;
+                }
+            }
+            if constexpr ( !std::is_same_v<T, bool> )
+                if ( auto p = static_cast<const T *>( col.plainValues() ) )
+                    return scanTyped<T>( VecView<T>( p, col.size() ), col.validity(), op, val, irows, ScanValues() );
+            if ( auto pCol = dynamic_cast<const RunColumn<T> *>( &col ) )
+                return scanTyped<T>( pCol->runs(), pCol->validity(), op, val, irows, ScanRuns() );
+            if constexpr ( std::is_same_v<T, int32_t> || std::is_same_v<T, int64_t> || std::is_same_v<T, Timestamp> )
+                if ( auto pCol = dynamic_cast<const EncodedIntColumn<T> *>( &col ) )
+                    return scanTyped<T>( *pCol, pCol->validity(), op, val, irows, ScanBlocks() );
+            return false;
+        }
+    }
+
+protected:
+    struct ScanValues
+    {
+        template<class Values, class U>
+        void operator()( const Values &values, const Bitmap *validity, OperatorTag op, const U &val, RowMapping &irows ) const
+        {
+            scan_compare_values( values, validity, op, val, irows );
+        }
+    };
+    struct ScanRuns
+    {
+        template<class Values, class U>
+        void operator()( const Values &values, const Bitmap *validity, OperatorTag op, const U &val, RowMapping &irows ) const
+        {
+            scan_compare_runs( values, validity, op, val, irows );
+        }
+    };
+    struct ScanBlocks
+    {
+        template<class T, class U>
+        void operator()( const EncodedIntColumn<T> &col,
+                         const Bitmap *validity,
+                         OperatorTag op,
+                         const U &val,
+                         RowMapping &irows ) const
+        {
+            col.foreachBlock( [&]( const T *values, size_t n, size_t ibegin ) {
+                scan_compare_values( VecView<T>( values, n ), validity, op, val, irows, ibegin );
+            } );
+        }
+    };
+    // convert val to the compared type of column T and scan.
+    template<class T, class Values, class Scan>
+    static bool scanTyped( const Values &values, const Bitmap *validity, OperatorTag op, const VarField &val, RowMapping &irows, Scan scan )
+    {
+        using FieldT = FieldValue<T>;
+        if constexpr ( isNumericFieldType( FieldT::type ) ) // numeric types are compared by value.
+        {
+            if ( !isNumericFieldType( FieldTypeTag( val.index() ) ) )
+                return false;
+            if ( auto intVal = getAsInt( val ); intVal && std::is_integral_v<T> )
+                scan( values, validity, op, *intVal, irows );
+            else if ( intVal )
+                scan( values, validity, op, double( *intVal ), irows );
+            else
+                scan( values, validity, op, *getAsDouble( val ), irows );
+        }
+        else
+        {
+            auto p = std::get_if<FieldT>( &val );
+            if ( !p )
+                return false;
+            scan( values, validity, op, p->value, irows );
+        }
+        return true;
+    }
+};
+
+/// \brief Predicate on the codes of a dictionary-encoded column. A string predicate is translated into a code range,
+/// or into a match table that's evaluated once per dictionary value, so that rows are evaluated without strings.
+struct DictCodeFilter
+{
+    using code_type = StrDictionary::code_type;
+
+    code_type lo = 0, hi = 0; // match codes in [lo, hi) if table is empty.
+    std::vector<uint8_t> table; // <code: matched>
+    bool negate = false;
+    bool nullMatches = false;
+
+    bool match( code_type code ) const
+    {
+        bool matched = table.empty() ? ( code >= lo && code < hi ) : ( code < table.size() && table[code] );
+        return matched != negate;
+    }
+    bool matchRow( const DictStrColumn &col, size_t irow ) const
+    {
+        return col.isNull( irow ) ? nullMatches : match( col.codeAt( irow ) );
+    }
+    void scan( const DictStrColumn &col, RowMapping &irows ) const
+    {
+        scan_dense_values( col.codes(), col.validity(), nullMatches, [this]( code_type code ) { return match( code ); }, irows );
+    }
+
+    /// \brief Compare values with val as VarField operators do: null is less than any value.
+    /// Ordered comparisons are code ranges if dictionary is sorted.
+    static DictCodeFilter compare( const StrDictionary &dict, OperatorTag op, const std::string &val )
+    {
+        DictCodeFilter res;
+        constexpr code_type maxCode = std::numeric_limits<code_type>::max();
+        switch ( op )
+        {
+        case OperatorTag::EQ:
+        case OperatorTag::NE:
+            if ( auto code = dict.find( val ) )
+                res.lo = *code, res.hi = *code + 1;
+            res.negate = res.nullMatches = op == OperatorTag::NE;
+            return res;
+        case OperatorTag::LT:
+        case OperatorTag::LE:
+            res.nullMatches = true;
+            break;
+        case OperatorTag::GT:
+        case OperatorTag::GE:
+            break;
+        default:
+            throw std::runtime_error( "Invalid CompareTag:" + std::to_string( int( op ) ) );
+        }
+        if ( dict.isSorted() )
+        {
+            if ( op == OperatorTag::LT )
+                res.hi = dict.lowerBound( val );
+            else if ( op == OperatorTag::LE )
+                res.hi = dict.upperBound( val );
+            else
+                res.lo = op == OperatorTag::GT ? dict.upperBound( val ) : dict.lowerBound( val ), res.hi = maxCode;
+        }
+        else
+        {
+            res.table.resize( dict.size() );
+            for ( size_t code = 0, N = dict.size(); code < N; ++code )
+                res.table[code] = invoke_compare( op, dict.value( code_type( code ) ), val );
+        }
+        return res;
+    }
+    /// \param vals Single-field records of isin/notin.
+    static DictCodeFilter isin( const StrDictionary &dict, const std::vector<Record> &vals, bool isInOrNot )
+    {
+        DictCodeFilter res;
+        res.table.resize( dict.size() );
+        for ( const auto &rec : vals )
+        {
+            if ( rec.at( 0 ).index() == 0 )
+                res.nullMatches = true;
+            else if ( auto p = std::get_if<StrField>( &rec[0] ) )
+            {
+                if ( auto code = dict.find( p->value ) )
+                    res.table[*code] = true;
+            }
+        }
+        if ( !isInOrNot )
+        {
+            res.negate = true;
+            res.nullMatches = !res.nullMatches;
+        }
+        return res;
+    }
+};
+
 struct ConditionCompare : public ICondition
 {
     static constexpr bool bSingleCol = false;
@@ -170,6 +506,8 @@ struct ConditionCompare : public ICondition
     ColIndex m_col; // column indices
     OperatorTag m_compareTag;
     RecordType m_val;
+    const DictStrColumn *m_dictCol = nullptr; // set if it's a single-column condition on a dictionary-encoded column.
+    DictCodeFilter m_dictFilter;
 
     bool init( const IDataFrame *df, ColNames colnames, OperatorTag compareTag, RecordType val, std::ostream *err = nullptr )
     {
@@ -190,11 +528,22 @@ struct ConditionCompare : public ICondition
         if ( !checkFieldCompatible( df, m_col, val, err ) )
             return false;
         m_val = std::move( val );
+        initDictFilter();
         return true;
     }
     void setLogicNot()
     {
         m_compareTag = logicOpposite( m_compareTag );
+        initDictFilter();
+    }
+    void initDictFilter()
+    {
+        m_dictCol = m_col.size() == 1 ? dynamic_cast<const DictStrColumn *>( m_df->getColumn( m_col[0] ) ) : nullptr;
+        auto pVal = m_dictCol ? std::get_if<StrField>( &m_val[0] ) : nullptr;
+        if ( !pVal ) // null is compared by VarField.
+            m_dictCol = nullptr;
+        else
+            m_dictFilter = DictCodeFilter::compare( m_dictCol->dictionary(), m_compareTag, pVal->value );
     }
     OperatorTag getOperator() const override
     {
@@ -206,8 +555,56 @@ struct ConditionCompare : public ICondition
     }
     bool evalAtRow( Rowindex irow ) const override
     {
+        if ( m_dictCol )
+            return m_dictFilter.matchRow( *m_dictCol, irow );
         return invoke_compare( m_compareTag, RecordRef{m_df, irow, &m_col}, m_val );
     }
+    bool mayMatchChunk( const ColumnChunkStats &stats ) const override
+    {
+        if ( m_col.size() != 1 )
+            return true;
+        const VarField &val = m_val[0];
+        if ( stats.nullCount && invoke_compare( m_compareTag, VarField( NullField{} ), val ) )
+            return true;
+        if ( stats.allNull() )
+            return false;
+        if ( !stats.hasMinMax() )
+            return true;
+        const VarField &lo = stats.minValue, &hi = stats.maxValue;
+        switch ( m_compareTag )
+        {
+        case OperatorTag::EQ:
+            return !( val < lo ) && !( hi < val );
+        case OperatorTag::NE:
+            return !( lo == val && hi == val );
+        case OperatorTag::LT:
+            return lo < val;
+        case OperatorTag::LE:
+            return !( val < lo );
+        case OperatorTag::GT:
+            return val < hi;
+        case OperatorTag::GE:
+            return !( hi < val );
+        default:
+            return true;
+        }
+    }
+    /// \brief Evaluate all rows by a typed scan over the dense column values of a columnar DataFrame.
+    /// \return false if it's not a single-column condition on a columnar DataFrame, and irows is untouched.
+    bool scanColumn( RowMapping &irows ) const
+    {
+        if ( m_dictCol )
+        {
+            m_dictFilter.scan( *m_dictCol, irows );
+            return true;
+        }
+        if ( m_col.size() != 1 )
+            return false;
+        const IColumn *pCol = m_df->getColumn( m_col[0] );
+        if ( !pCol )
+            return false;
+        return static_invoke_for_type( pCol->typeTag(), ScanCompareColumn(), *pCol, m_compareTag, m_val[0], irows );
+    }
 };
 
 struct ConditionIsIn : public ICondition
@@ -224,6 +621,10 @@ struct ConditionIsIn : public ICondition
     ColIndex m_col; // column indices
     std::unordered_set<ValueType, HashCode> m_val; // hash delegate, which is RecordType (Record)
     bool m_isinOrNot; // or not in
+    const DictStrColumn *m_dictCol = nullptr; // set if it's a single-column condition on a dictionary-encoded column.
+    DictCodeFilter m_dictFilter;
+    const BoolColumn *m_boolCol = nullptr; // set if it's a single-column condition on a Bool column.
+    bool m_boolMatches[3] = {}; // isin result of <true, false, null>.
 
     bool init( const IDataFrame *df, ColNames colnames, std::vector<Record> records, bool isInOrNot = true, std::ostream *err = nullptr )
     {
@@ -245,6 +646,21 @@ struct ConditionIsIn : public ICondition
         for ( const auto &e : records )
             if ( !checkFieldCompatible( df, m_col, e, err ) )
                 return false;
+        if ( m_col.size() == 1 )
+            m_dictCol = dynamic_cast<const DictStrColumn *>( m_df->getColumn( m_col[0] ) );
+        if ( m_dictCol )
+            m_dictFilter = DictCodeFilter::isin( m_dictCol->dictionary(), records, m_isinOrNot );
+        if ( m_col.size() == 1 )
+            m_boolCol = dynamic_cast<const BoolColumn *>( m_df->getColumn( m_col[0] ) );
+        if ( m_boolCol )
+        {
+            const VarField keys[3] = {BoolField{true}, BoolField{false}, NullField{}};
+            for ( int i = 0; i < 3; ++i )
+                m_boolMatches[i] = std::any_of( records.begin(), records.end(), [&]( const Record &rec ) { return rec.at( 0 ) == keys[i]; } );
+            if ( !m_isinOrNot )
+                for ( auto &matched : m_boolMatches )
+                    matched = !matched;
+        }
         for ( auto &&e : records )
             m_val.emplace( ValueType{std::move( e )} );
         return true;
@@ -252,6 +668,10 @@ struct ConditionIsIn : public ICondition
     void setLogicNot()
     {
         m_isinOrNot = !m_isinOrNot;
+        m_dictFilter.negate = !m_dictFilter.negate;
+        m_dictFilter.nullMatches = !m_dictFilter.nullMatches;
+        for ( auto &matched : m_boolMatches )
+            matched = !matched;
     }
     OperatorTag getOperator() const override
     {
@@ -264,11 +684,98 @@ struct ConditionIsIn : public ICondition
 
     bool evalAtRow( Rowindex irow ) const override
     {
+        if ( m_dictCol )
+            return m_dictFilter.matchRow( *m_dictCol, irow );
         if ( m_isinOrNot )
             return m_val.count( ValueType{typename ValueType::position_type{m_df, irow, &m_col}} );
         else
             return !m_val.count( ValueType{typename ValueType::position_type{m_df, irow, &m_col}} );
     }
+    bool mayMatchChunk( const ColumnChunkStats &stats ) const override
+    {
+        if ( m_col.size() != 1 || !m_isinOrNot )
+            return true;
+        for ( const ValueType &delg : m_val )
+        {
+            const VarField &val = std::get<1>( delg.m_data ).at( 0 );
+            if ( val.index() == 0 ? stats.nullCount != 0
+                                  : !stats.allNull() && ( !stats.hasMinMax() || ( !( val < stats.minValue ) && !( stats.maxValue < val ) ) ) )
+                return true;
+        }
+        return false;
+    }
+    /// \brief Evaluate all rows on the codes of a dictionary-encoded column, or on the bitmap of a Bool column.
+    /// \return false if it's not a single-column condition on such a column, and irows is untouched.
+    bool scanColumn( RowMapping &irows ) const
+    {
+        if ( m_dictCol )
+            m_dictFilter.scan( *m_dictCol, irows );
+        else if ( m_boolCol )
+            scan_bool_column( *m_boolCol, m_boolMatches[0], m_boolMatches[1], m_boolMatches[2], irows );
+        else
+            return false;
+        return true;
+    }
+};
+
+struct ConditionIsNull : public ICondition
+{
+    const IDataFrame *m_df;
+    std::vector<std::size_t> m_col; // single column
+    bool m_isnullOrNot; // or not null
+
+    bool init( const IDataFrame *df, const std::vector<std::string> &colnames, bool isNullOrNot = true, std::ostream *err = nullptr )
+    {
+        m_df = df;
+        m_isnullOrNot = isNullOrNot;
+        if ( colnames.size() != 1 )
+        {
+            if ( err )
+                *err << "isnull/notnull expects single column. ColumnCount:" << colnames.size() << " .\n";
+            return false;
+        }
+        m_col = m_df->colIndex( colnames );
+        return true;
+    }
+    void setLogicNot()
+    {
+        m_isnullOrNot = !m_isnullOrNot;
+    }
+    OperatorTag getOperator() const override
+    {
+        return m_isnullOrNot ? OperatorTag::ISNULL : OperatorTag::NOTNULL;
+    }
+    const std::vector<size_t> &getColIndices() const override
+    {
+        return m_col;
+    }
+    bool evalAtRow( Rowindex irow ) const override
+    {
+        return ( m_df->at( irow, m_col[0] ).index() == 0 ) == m_isnullOrNot;
+    }
+    bool mayMatchChunk( const ColumnChunkStats &stats ) const override
+    {
+        return m_isnullOrNot ? stats.nullCount != 0 : !stats.allNull();
+    }
+    /// \brief Evaluate all rows word by word on the validity bitmap of a columnar DataFrame.
+    /// \return false if the DataFrame is not columnar, and irows is untouched.
+    bool scanColumn( RowMapping &irows ) const
+    {
+        const IColumn *pCol = m_df->getColumn( m_col[0] );
+        if ( !pCol )
+            return false;
+        if ( const Bitmap *validity = pCol->validity() )
+        {
+            auto addRow = [&]( size_t i ) { irows.push_back( i ); };
+            if ( m_isnullOrNot )
+                validity->foreachUnset( addRow );
+            else
+                validity->foreachSet( addRow );
+        }
+        else if ( !m_isnullOrNot ) // no null
+            irows.push_back_range( 0, pCol->size() );
+        return true;
+    }
 };
 
 // expression
@@ -286,6 +793,8 @@ struct ColName
     // cols are inited already
     Expr isin( Record vals ) const;
     Expr notin( Record vals ) const;
+    Expr isnull() const;
+    Expr notnull() const;
 };
 struct ColNames
 {
@@ -307,7 +816,7 @@ struct Expr
 {
     std::vector<std::string> cols; // column names
     OperatorTag compareOrIn; // compare, isin, notin
-    std::variant<Record, std::vector<Record>> val; // it's Record for Compare, vector<Record> for isin/notin
+    std::variant<Record, std::vector<Record>> val; // it's Record for Compare, vector<Record> for isin/notin, empty Record for isnull/notnull
 
     bool has_value() const
     {
@@ -325,6 +834,13 @@ struct Expr
             if ( condIsin->init( &df, cols, v, compareOrIn == OperatorTag::ISIN, err ) )
                 return IConditionPtr{condIsin};
         }
+        else if ( compareOrIn == OperatorTag::ISNULL || compareOrIn == OperatorTag::NOTNULL )
+        {
+            auto condIsNull = new ConditionIsNull();
+            if ( condIsNull->init( &df, cols, compareOrIn == OperatorTag::ISNULL, err ) )
+                return IConditionPtr{condIsNull};
+            delete condIsNull;
+        }
         else
         {
             assert( val.index() == 0 );
@@ -584,6 +1100,17 @@ inline Expr ColName::notin( Record vals ) const
     return r;
 }
 
+inline Expr ColName::isnull() const
+{
+    assert( cols.size() == 1 );
+    return {cols, OperatorTag::ISNULL, Record{}};
+}
+inline Expr ColName::notnull() const
+{
+    assert( cols.size() == 1 );
+    return {cols, OperatorTag::NOTNULL, Record{}};
+}
+
 inline Expr ColNames::isin( std::vector<Record> vals ) const
 {
     assert( cols.size() && cols.size() == vals.at( 0 ).size() && "Multi-value element" );
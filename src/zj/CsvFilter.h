@@ -0,0 +1,158 @@
+/*
+ * This file is part of the ftl (Fast Template Library) distribution (https://github.com/zjgoggle/ftl).
+ * Copyright (c) 2020 Jack Zhang.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <zj/ColumnDataFrame.h>
+#include <zj/Condition.h>
+
+namespace zj
+{
+
+///////////////////////////////////////////////////////////////
+/// Predicate pushdown of CSV: records are filtered by the predicate columns before the other columns are parsed.
+///////////////////////////////////////////////////////////////
+
+/**
+ * @brief Evaluate AndExpr on csv records. Only the fields of the predicate columns are parsed, into a one-row ColumnDataFrame on which
+ * the conditions are built once, as DataFrameWithIndex::select builds them on a DataFrame.
+ * Fields of a record are in the order of columnDefs, i.e. the projected columns if CsvOptions::columns is set.
+ */
+class CsvPredicate
+{
+protected:
+    ColumnDataFrame m_row; // predicate columns of the current record.
+    std::vector<size_t> m_fieldIndices; // field index of each predicate column.
+    std::vector<IConditionPtr> m_conds;
+    std::vector<std::string_view> m_fields;
+
+public:
+    /// \return false if a column of where is not in columnDefs, or a value of where is not compatible with the column type.
+    bool init( const ColumnDefs &columnDefs, const AndExpr &where, std::ostream *err = nullptr )
+    {
+        ColumnDefs predDefs;
+        m_fieldIndices.clear();
+        for ( const auto &expr : where.ops )
+        {
+            for ( const auto &name : expr.cols )
+            {
+                if ( std::any_of( predDefs.begin(), predDefs.end(), [&]( const ColumnDef &def ) { return def.colName == name; } ) )
+                    continue;
+                auto it = std::find_if( columnDefs.begin(), columnDefs.end(), [&]( const ColumnDef &def ) { return def.colName == name; } );
+                if ( it == columnDefs.end() )
+                {
+                    if ( err )
+                        *err << "CsvPredicate: Failed to find column:" << name << ".\n";
+                    return false;
+                }
+                predDefs.push_back( ColumnDef{it->colTypeTag, name} ); // plain encoding for a single row.
+                m_fieldIndices.push_back( size_t( it - columnDefs.begin() ) );
+            }
+        }
+        m_row.create( predDefs );
+        m_conds = where.toCondition( m_row, err );
+        return m_conds.size() == where.ops.size();
+    }
+
+    /// \brief Parse the predicate fields of a record, and evaluate the conditions on them.
+    /// \param matched true if all conditions are true.
+    /// \return false if a predicate field is missing, or can't be parsed as its column type.
+    bool match( const std::vector<std::string_view> &fields, bool &matched, std::ostream *err = nullptr )
+    {
+        matched = false;
+        m_fields.clear();
+        for ( size_t ifield : m_fieldIndices )
+        {
+            if ( ifield >= fields.size() )
+            {
+                if ( err )
+                    *err << "CsvPredicate: Missing field:" << ifield << " of record with " << fields.size() << " fields.\n";
+                return false;
+            }
+            m_fields.push_back( fields[ifield] );
+        }
+        m_row.clearRecords();
+        if ( !m_row.appendRowStr( m_fields, err ) )
+            return false;
+        matched = std::all_of( m_conds.begin(), m_conds.end(), []( const IConditionPtr &cond ) { return cond->evalAtRow( 0 ); } );
+        return true;
+    }
+};
+
+/// \brief Read csv records that match where into df.
+/// scan( onRecord ) calls onRecord( const std::vector<std::string_view> &fields ) for each csv record.
+template<class DataFrame, class Scan>
+bool read_csv_where( DataFrame &df, const ColumnDefs &columnDefs, const AndExpr &where, std::ostream *err, Scan &&scan )
+{
+    df.create( columnDefs );
+    CsvPredicate pred;
+    if ( !pred.init( columnDefs, where, err ) )
+        return false;
+    bool ok = true;
+    scan( [&]( const std::vector<std::string_view> &fields ) {
+        bool matched = false;
+        ok = pred.match( fields, matched, err ) && ( !matched || df.appendRowStr( fields, err ) );
+        return ok;
+    } );
+    return ok;
+}
+
+/// \brief Read csv records of text that match where into df, a RowDataFrame or ColumnDataFrame, of columnDefs. The fields of other
+/// columns are parsed only for matched records.
+/// \return false if where is invalid for columnDefs, or a record fails to parse. df keeps the records before it.
+/// \throw runtime_error if a quoted string is malformed.
+template<class DataFrame>
+bool read_csv_where( DataFrame &df,
+                     std::string_view text,
+                     const ColumnDefs &columnDefs,
+                     const AndExpr &where,
+                     const CsvOptions &opts = {},
+                     std::ostream *err = nullptr )
+{
+    return read_csv_where( df, columnDefs, where, err, [&]( auto &&onRecord ) { scan_csv( text, opts, onRecord ); } );
+}
+/// \brief Read csv records of is, which is read in blocks (see scan_csv), that match where into df.
+template<class DataFrame>
+bool read_csv_where( DataFrame &df,
+                     std::istream &is,
+                     const ColumnDefs &columnDefs,
+                     const AndExpr &where,
+                     const CsvOptions &opts = {},
+                     std::ostream *err = nullptr )
+{
+    return read_csv_where( df, columnDefs, where, err, [&]( auto &&onRecord ) { scan_csv( is, opts, onRecord ); } );
+}
+/// \brief Read csv records of the memory mapping of filename that match where into df.
+template<class DataFrame>
+bool read_csv_file_where( DataFrame &df,
+                          const std::string &filename,
+                          const ColumnDefs &columnDefs,
+                          const AndExpr &where,
+                          const CsvOptions &opts = {},
+                          std::ostream *err = nullptr )
+{
+    if ( MappedFile::isEmptyFile( filename ) )
+        return read_csv_where( df, std::string_view(), columnDefs, where, opts, err );
+    MappedFile file;
+    if ( !file.open( filename, err ) )
+        return false;
+    file.adviseSequential();
+    return read_csv_where( df, std::string_view( file.data(), file.size() ), columnDefs, where, opts, err );
+}
+
+} // namespace zj
@@ -0,0 +1,293 @@
+/*
+ * This file is part of the ftl (Fast Template Library) distribution (https://github.com/zjgoggle/ftl).
+ * Copyright (c) 2020 Jack Zhang.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <zj/ReadCSV.h>
+#include <zj/VarField.h>
+#include <algorithm>
+#include <cctype>
+
+namespace zj
+{
+
+///////////////////////////////////////////////////////////////
+/// Schema inference of CSV: types and names of columns are inferred from sampled records, before the full load by
+/// ColumnDataFrame::read_csv.
+///////////////////////////////////////////////////////////////
+
+enum class CsvHeader
+{
+    Auto, // the first record is a header if its fields don't parse as the types of the records below it.
+    Present,
+    Absent,
+};
+
+struct CsvSchemaOptions
+{
+    size_t sampleRows = 1000; // leading records to sample, including the header.
+    size_t sampleChunks = 0; // chunks spread out in text to sample after the leading records. Ignored if CsvOptions::newlineInQuotes.
+    size_t chunkRows = 100; // records to sample in each chunk.
+    CsvHeader header = CsvHeader::Auto;
+};
+
+struct CsvSchema
+{
+    ColumnDefs columnDefs; // columns are named Col0, Col1, ... if there is no header.
+    bool hasHeader = false; // the first record after CsvOptions::skipLines is the header.
+    size_t sampledRows = 0; // records sampled, excluding the header.
+
+    /// \return opts that skip the header for loading.
+    CsvOptions dataOptions( CsvOptions opts ) const
+    {
+        opts.skipLines += hasHeader;
+        return opts;
+    }
+};
+
+/**
+ * @brief Infer the type of a column from its values. The candidate types are Bool, Int32, Int64, Float64 and Timestamp, and the column
+ * type is the first of them that from_string parses every value as, or Str if there is none. Null strings (see is_null) are skipped if
+ * global().bParseNull. Bool values are 0/1, true/false, yes/no, t/f, y/n in any case.
+ * Empty values are Str, because the numeric columns don't parse them.
+ */
+class CsvColumnInference
+{
+public:
+    static constexpr FieldTypeTag CandidateTypes[] = {
+            FieldTypeTag::Bool, FieldTypeTag::Int32, FieldTypeTag::Int64, FieldTypeTag::Float64, FieldTypeTag::Timestamp};
+    static constexpr size_t NumCandidates = std::size( CandidateTypes );
+
+protected:
+    uint32_t m_candidates = ( 1u << NumCandidates ) - 1; // bit i: all values parse as CandidateTypes[i].
+    bool m_hasValue = false;
+
+public:
+    void add( std::string_view s )
+    {
+        if ( global().bParseNull && is_null( s ) )
+            return;
+        m_hasValue = true;
+        for ( uint32_t bits = m_candidates; bits; bits &= bits - 1 )
+        {
+            const unsigned i = unsigned( __builtin_ctz( bits ) );
+            if ( !parses( CandidateTypes[i], s ) )
+                m_candidates &= ~( 1u << i );
+        }
+    }
+    /// \return Str if there is no value.
+    FieldTypeTag type() const
+    {
+        return m_hasValue && m_candidates ? CandidateTypes[__builtin_ctz( m_candidates )] : FieldTypeTag::Str;
+    }
+
+    /// \return true if s parses as type, as the columns of type parse it.
+    static bool parses( FieldTypeTag type, std::string_view s )
+    {
+        if ( global().bParseNull && is_null( s ) )
+            return true;
+        if ( type == FieldTypeTag::Str )
+            return true;
+        if ( s.empty() )
+            return false;
+        switch ( type )
+        {
+        case FieldTypeTag::Bool:
+            return is_bool_str( s );
+        case FieldTypeTag::Int32:
+        {
+            Int32Field val;
+            return from_string( val, s );
+        }
+        case FieldTypeTag::Int64:
+        {
+            Int64Field val;
+            return from_string( val, s );
+        }
+        case FieldTypeTag::Float64:
+        {
+            Float64Field val;
+            return from_string( val, s );
+        }
+        case FieldTypeTag::Timestamp:
+        {
+            TimestampField val;
+            return from_string( val, s );
+        }
+        default:
+            return false;
+        }
+    }
+    static bool is_bool_str( std::string_view s )
+    {
+        static constexpr std::string_view words[] = {"0", "1", "t", "f", "y", "n", "true", "false", "yes", "no"};
+        auto equalLower = []( char a, char b ) { return a == std::tolower( static_cast<unsigned char>( b ) ); };
+        return std::any_of( std::begin( words ), std::end( words ), [&]( std::string_view w ) {
+            return w.size() == s.size() && std::equal( w.begin(), w.end(), s.begin(), equalLower );
+        } );
+    }
+};
+
+/// \brief Infer CsvSchema from records added in order. The first record is kept as the header candidate.
+class CsvSchemaInference
+{
+protected:
+    std::vector<std::string> m_first;
+    std::vector<CsvColumnInference> m_columns; // of records after the first.
+    size_t m_nrecords = 0;
+
+public:
+    /// \brief Add a record. Records of a different number of fields than the first are skipped.
+    void add( const std::vector<std::string_view> &fields )
+    {
+        if ( m_nrecords++ == 0 )
+        {
+            m_first.assign( fields.begin(), fields.end() );
+            m_columns.resize( fields.size() );
+            return;
+        }
+        if ( fields.size() != m_columns.size() )
+            return;
+        for ( size_t i = 0; i < fields.size(); ++i )
+            m_columns[i].add( fields[i] );
+    }
+    size_t countRecords() const
+    {
+        return m_nrecords;
+    }
+
+    CsvSchema schema( CsvHeader header = CsvHeader::Auto ) const
+    {
+        CsvSchema res;
+        res.hasHeader = header == CsvHeader::Present || ( header == CsvHeader::Auto && looksLikeHeader() );
+        res.sampledRows = m_nrecords - ( m_nrecords && res.hasHeader );
+        for ( size_t i = 0; i < m_columns.size(); ++i )
+        {
+            auto column = m_columns[i];
+            if ( !res.hasHeader )
+                column.add( m_first[i] );
+            std::string name = res.hasHeader && !m_first[i].empty() ? m_first[i] : "Col" + std::to_string( i );
+            res.columnDefs.push_back( ColumnDef{column.type(), std::move( name )} );
+        }
+        return res;
+    }
+
+protected:
+    // The first record is a header if a field doesn't parse as the type of its column, or if all columns are Str, its fields are
+    // distinct non-empty names.
+    bool looksLikeHeader() const
+    {
+        if ( m_nrecords < 2 )
+            return false;
+        bool allStr = true;
+        for ( size_t i = 0; i < m_columns.size(); ++i )
+        {
+            const FieldTypeTag type = m_columns[i].type();
+            if ( type == FieldTypeTag::Str )
+                continue;
+            allStr = false;
+            if ( !CsvColumnInference::parses( type, m_first[i] ) )
+                return true;
+        }
+        if ( !allStr )
+            return false;
+        auto names = m_first;
+        std::sort( names.begin(), names.end() );
+        return std::adjacent_find( names.begin(), names.end() ) == names.end() &&
+               std::none_of( names.begin(), names.end(), []( const std::string &s ) { return s.empty(); } );
+    }
+};
+
+/// \brief Infer schema of csv text from its leading records, and records of chunks spread out in text.
+/// A chunk begins at the first line after its offset, which is a record boundary unless opts.newlineInQuotes.
+/// \throw runtime_error if a sampled quoted string is malformed.
+inline CsvSchema infer_csv_schema( std::string_view text, const CsvOptions &opts = {}, const CsvSchemaOptions &schemaOpts = {} )
+{
+    CsvSchemaInference inference;
+    const char *p = text.data(), *end = text.data() + text.size();
+    {
+        CsvTokenizer tokenizer( opts );
+        while ( inference.countRecords() < schemaOpts.sampleRows && tokenizer.next( p, end, true ) == CsvTokenizer::Status::Record )
+            inference.add( tokenizer.fields() );
+    }
+    if ( !opts.newlineInQuotes && schemaOpts.sampleChunks && inference.countRecords() )
+    {
+        CsvOptions chunkOpts = opts;
+        chunkOpts.skipLines = 0;
+        size_t sampledEnd = size_t( p - text.data() ); // chunks don't overlap sampled records.
+        for ( size_t ichunk = 1; ichunk <= schemaOpts.sampleChunks; ++ichunk )
+        {
+            const size_t offset = std::max( sampledEnd, text.size() * ichunk / ( schemaOpts.sampleChunks + 1 ) );
+            const char *q = text.data() + offset;
+            if ( offset != sampledEnd ) // skip the partial line.
+            {
+                const char *nl = static_cast<const char *>( std::memchr( q - 1, '\n', size_t( end - q + 1 ) ) );
+                q = nl ? nl + 1 : end;
+            }
+            CsvTokenizer tokenizer( chunkOpts );
+            for ( size_t n = 0; n < schemaOpts.chunkRows && tokenizer.next( q, end, true ) == CsvTokenizer::Status::Record; ++n )
+                inference.add( tokenizer.fields() );
+            sampledEnd = size_t( q - text.data() );
+        }
+    }
+    return inference.schema( schemaOpts.header );
+}
+
+/// \brief Infer schema of the leading records of is. The stream is positioned back where it was if it's seekable.
+inline CsvSchema infer_csv_schema( std::istream &is, const CsvOptions &opts = {}, const CsvSchemaOptions &schemaOpts = {} )
+{
+    CsvSchemaInference inference;
+    const auto startPos = is.tellg();
+    if ( schemaOpts.sampleRows )
+        scan_csv(
+                is,
+                opts,
+                [&]( const std::vector<std::string_view> &fields ) {
+                    inference.add( fields );
+                    return inference.countRecords() < schemaOpts.sampleRows;
+                },
+                1 << 16 );
+    if ( startPos != std::istream::pos_type( -1 ) )
+    {
+        is.clear();
+        is.seekg( startPos );
+    }
+    return inference.schema( schemaOpts.header );
+}
+
+/// \brief Infer schema of the memory mapping of filename.
+/// \return false if the file can't be opened.
+inline bool infer_csv_file_schema( const std::string &filename,
+                                   CsvSchema &schema,
+                                   const CsvOptions &opts = {},
+                                   const CsvSchemaOptions &schemaOpts = {},
+                                   std::ostream *err = nullptr )
+{
+    if ( MappedFile::isEmptyFile( filename ) )
+    {
+        schema = CsvSchema{};
+        return true;
+    }
+    MappedFile file;
+    if ( !file.open( filename, err ) )
+        return false;
+    schema = infer_csv_schema( std::string_view( file.data(), file.size() ), opts, schemaOpts );
+    return true;
+}
+
+} // namespace zj
@@ -1,5 +1,6 @@
 #include "DataFrameIndex.h"
 #include <sstream>
+#include <fstream>
 
 namespace zj
 {
@@ -48,20 +49,225 @@ std::optional<DataFrameWithIndex::iterator> DataFrameWithIndex::addIndex( IndexT
             *err << "AddIndex failed: Invalid Index type: " << char( indexType ) << ".\n";
         return {};
     }
-    if ( auto res = m_indexMap.emplace( std::move( key ), std::move( val ) ); res.second )
+    return insertIndex( std::move( key ), std::move( val ), err );
+}
+std::optional<DataFrameWithIndex::iterator> DataFrameWithIndex::insertIndex( IndexKey key, IndexValue val, std::ostream *err )
+{
+    const std::string indexName = val.name;
+    if ( auto res = m_indexMap.emplace( key, std::move( val ) ); res.second )
     {
         if ( !indexName.empty() )
             m_nameMap[indexName] = res.first;
         return res.first;
     }
-    else
+    if ( err )
+        *err << "AddIndex failed: duplicate key: " << key << ".\n";
+    return {};
+}
+
+bool DataFrameWithIndex::saveIndexes( std::ostream &os, std::ostream *err ) const
+{
+    if ( !m_pDataFrame )
     {
         if ( err )
-            *err << "AddIndex failed: duplicate key: " << key << ".\n";
-        return {};
+            *err << "saveIndexes failed. DataFrame is not set.\n";
+        return false;
+    }
+    const size_t nrows = m_pDataFrame->countRows();
+    if ( nrows > std::numeric_limits<uint32_t>::max() )
+    {
+        if ( err )
+            *err << "saveIndexes failed: row indices don't fit in 4 bytes. rows: " << nrows << ".\n";
+        return false;
+    }
+    auto putCols = [&]( BinaryWriter &w, const std::vector<size_t> &icols ) {
+        w.put( uint32_t( icols.size() ) );
+        for ( auto icol : icols )
+            w.put( uint32_t( icol ) );
+    };
+    auto putRows = [&]( BinaryWriter &w, const std::vector<size_t> &irows ) {
+        for ( auto irow : irows )
+            w.put( uint32_t( irow ) );
+    };
+    return write_binary_block(
+            os,
+            DFBI_TypeCode,
+            [&]( BinaryWriter &w ) {
+                w.put( uint64_t( nrows ) );
+                if ( !write_binary_column_defs( w, *m_pDataFrame, err ) )
+                    return false;
+                w.put( uint32_t( m_indexMap.size() ) );
+                for ( const auto &[key, val] : m_indexMap )
+                {
+                    if ( val.name.size() > MaxBinaryColNameLength )
+                    {
+                        if ( err )
+                            *err << "saveIndexes failed: index name is longer than " << MaxBinaryColNameLength << ": " << val.name << ".\n";
+                        return false;
+                    }
+                    w.put( u_char( val.name.size() ) );
+                    w.putBytes( val.name.data(), val.name.size() );
+                    if ( auto pOrdered = std::get_if<MultiColOrderedIndex>( &val.value ) )
+                    {
+                        w.put( char( pOrdered->isReverseOrder() ? IndexType::ReverseOrderedIndex : IndexType::OrderedIndex ) );
+                        putCols( w, pOrdered->getCols() );
+                        putRows( w, pOrdered->getRowIndices() );
+                    }
+                    else
+                    {
+                        const auto &hashIndex = std::get<MultiColHashMultiIndex>( val.value );
+                        w.put( char( hashIndex.isMultiValue() ? IndexType::HashMultiIndex : IndexType::HashIndex ) );
+                        putCols( w, hashIndex.m_cols );
+                        w.put( uint32_t( hashIndex.size() ) );
+                        hashIndex.foreachGroup( [&]( const std::vector<size_t> &irows ) {
+                            w.put( uint32_t( irows.size() ) );
+                            putRows( w, irows );
+                        } );
+                    }
+                }
+                return true;
+            },
+            err );
+}
+bool DataFrameWithIndex::saveIndexes( const std::string &filename, std::ostream *err ) const
+{
+    std::ofstream ofs( filename, std::ios::binary | std::ios::trunc );
+    if ( !ofs )
+    {
+        if ( err )
+            *err << "saveIndexes failed to open file: " << filename << ".\n";
+        return false;
+    }
+    return saveIndexes( ofs, err );
+}
+
+bool DataFrameWithIndex::loadIndexes( std::istream &is, std::ostream *err )
+{
+    auto fail = [&]( const std::string &msg ) {
+        clearIndex();
+        if ( err )
+            *err << "loadIndexes failed: " << msg << ".\n";
+        return false;
+    };
+    if ( !m_pDataFrame )
+        return fail( "DataFrame is not set" );
+    std::string data;
+    if ( !read_binary_block( is, DFBI_TypeCode, data, err ) )
+        return fail( "invalid index file" );
+    BinaryReader r( data.data(), data.size() );
+
+    const size_t nrows = m_pDataFrame->countRows(), ncols = m_pDataFrame->countCols();
+    uint64_t savedRows = 0;
+    ColumnDefs savedColumnDefs;
+    if ( !r.get( savedRows ) || !read_binary_column_defs( r, savedColumnDefs, err ) )
+        return fail( "invalid header" );
+    if ( savedRows != nrows )
+        return fail( "number of rows " + std::to_string( savedRows ) + " doesn't match DataFrame rows " + std::to_string( nrows ) );
+    if ( savedColumnDefs.size() != ncols )
+        return fail( "number of columns " + std::to_string( savedColumnDefs.size() ) + " doesn't match DataFrame columns " +
+                     std::to_string( ncols ) );
+    for ( size_t icol = 0; icol < ncols; ++icol )
+    {
+        const ColumnDef &colDef = m_pDataFrame->columnDef( icol );
+        if ( savedColumnDefs[icol].colTypeTag != colDef.colTypeTag || savedColumnDefs[icol].colName != colDef.colName )
+            return fail( "column " + savedColumnDefs[icol].colName + " doesn't match DataFrame column " + colDef.colName );
+    }
+
+    auto getCols = [&]( std::vector<size_t> &icols ) {
+        uint32_t n = 0, icol = 0;
+        if ( !r.get( n ) || n == 0 || n > ncols )
+            return false;
+        icols.resize( n );
+        for ( auto &e : icols )
+        {
+            if ( !r.get( icol ) || icol >= ncols )
+                return false;
+            e = icol;
+        }
+        return true;
+    };
+    auto getRows = [&]( std::vector<size_t> &irows, size_t n ) {
+        if ( r.remaining() < n * sizeof( uint32_t ) )
+            return false;
+        irows.resize( n );
+        for ( auto &e : irows )
+        {
+            uint32_t irow = 0;
+            r.get( irow );
+            e = irow;
+        }
+        return true;
+    };
+
+    clearIndex();
+    uint32_t nindexes = 0;
+    if ( !r.get( nindexes ) )
+        return fail( "failed to read number of indexes" );
+    for ( uint32_t k = 0; k < nindexes; ++k )
+    {
+        u_char nameLen = 0;
+        const char *name = nullptr;
+        char indexType = 0;
+        IndexValue val;
+        std::vector<size_t> icols;
+        if ( !r.get( nameLen ) || !r.getBytes( nameLen, name ) || !r.get( indexType ) )
+            return fail( "failed to read index" );
+        val.name.assign( name, nameLen );
+        if ( !val.name.empty() && m_nameMap.count( val.name ) )
+            return fail( "duplicate index name: " + val.name );
+        if ( !getCols( icols ) )
+            return fail( "invalid columns of index " + val.name );
+        IndexKey key{IndexCategory::HashCat, icols};
+
+        if ( indexType == char( IndexType::OrderedIndex ) || indexType == char( IndexType::ReverseOrderedIndex ) )
+        {
+            std::vector<Rowindex> irows;
+            if ( !getRows( irows, nrows ) )
+                return fail( "failed to read rows of index " + val.name );
+            MultiColOrderedIndex index;
+            if ( !index.createFromSorted(
+                         *m_pDataFrame, std::move( icols ), indexType == char( IndexType::ReverseOrderedIndex ), std::move( irows ), err ) )
+                return fail( "invalid index " + val.name );
+            val.value = std::move( index );
+            key.indexCategory = IndexCategory::OrderedCat;
+        }
+        else if ( indexType == char( IndexType::HashIndex ) || indexType == char( IndexType::HashMultiIndex ) )
+        {
+            uint32_t nkeys = 0, nkeyRows = 0;
+            if ( !r.get( nkeys ) || nkeys > nrows )
+                return fail( "invalid number of keys of index " + val.name );
+            std::vector<std::vector<size_t>> groups( nkeys );
+            for ( auto &irows : groups )
+                if ( !r.get( nkeyRows ) || !getRows( irows, nkeyRows ) )
+                    return fail( "failed to read rows of index " + val.name );
+            MultiColHashMultiIndex index;
+            if ( !index.createFromGroups( *m_pDataFrame, std::move( icols ), std::move( groups ), err ) )
+                return fail( "invalid index " + val.name );
+            if ( indexType == char( IndexType::HashIndex ) && index.isMultiValue() )
+                return fail( "HashIndex has multiple rows of a key" );
+            val.value = std::move( index );
+        }
+        else
+            return fail( "invalid index type: " + std::to_string( int( indexType ) ) );
+        if ( !insertIndex( std::move( key ), std::move( val ), err ) )
+            return fail( "duplicate index" );
     }
+    if ( r.remaining() )
+        return fail( "unexpected bytes at end" );
+    return true;
 }
-DataFrameView DataFrameWithIndex::select_rows( std::vector<Rowindex> irows )
+bool DataFrameWithIndex::loadIndexes( const std::string &filename, std::ostream *err )
+{
+    std::ifstream ifs( filename, std::ios::binary );
+    if ( !ifs )
+    {
+        if ( err )
+            *err << "loadIndexes failed to open file: " << filename << ".\n";
+        return false;
+    }
+    return loadIndexes( ifs, err );
+}
+DataFrameView DataFrameWithIndex::select_rows( RowMapping irows )
 {
     std::stringstream err;
     DataFrameView view;
@@ -79,7 +285,7 @@ DataFrameView DataFrameWithIndex::select_cols( std::vector<Rowindex> icols )
     return view;
 }
 
-DataFrameView DataFrameWithIndex::select( std::vector<Rowindex> irows, std::vector<size_t> icols )
+DataFrameView DataFrameWithIndex::select( RowMapping irows, std::vector<size_t> icols )
 {
     std::stringstream err;
     DataFrameView view;
@@ -152,21 +358,19 @@ auto findRows_Ordered_EQ( const ConditionCompare *pCondCompare, const MultiColOr
     return irows;
 }
 
-std::vector<Rowindex> getRowsNotInSorted( const IDataFrame *df, const std::vector<Rowindex> &excludeSortedRows )
+// the rows between excluded rows are pushed as ranges.
+RowMapping getRowsNotInSorted( const IDataFrame *df, const std::vector<Rowindex> &excludeSortedRows )
 {
     size_t N = df->size();
     assert( excludeSortedRows.empty() || excludeSortedRows.back() < N );
-    std::vector<Rowindex> res;
-    res.resize( df->size() - excludeSortedRows.size() );
-    size_t pos = 0, startval = 0;
+    RowMapping res;
+    size_t startval = 0;
     for ( auto e : excludeSortedRows )
     {
-        auto n = e - startval; // number of values to populate.
-        std::iota( &res[pos], &res[pos + n], startval );
-        pos += n;
+        res.push_back_range( startval, e );
         startval = e + 1;
     }
-    std::iota( &res[pos], &res[pos + ( N - startval )], startval );
+    res.push_back_range( startval, N );
     return res;
 }
 
@@ -205,6 +409,41 @@ std::pair<const MultiColOrderedIndex *, const MultiColHashMultiIndex *> findInde
     return {pOrderIndex, pHashIndex};
 }
 
+std::optional<std::vector<std::pair<Rowindex, Rowindex>>> findRowGroups( const IDataFrame *df, const std::vector<const ICondition *> &conds )
+{
+    const RowGroupStats *pGroups = nullptr; // the layout of row groups.
+    std::vector<bool> mayMatch;
+    for ( const ICondition *pCond : conds )
+    {
+        const auto &icols = pCond->getColIndices();
+        const RowGroupStats *pStats = icols.size() == 1 ? df->rowGroupStats( icols[0] ) : nullptr;
+        if ( !pStats || pStats->countGroups() == 0 || ( pGroups && pStats->rowGroupSize != pGroups->rowGroupSize ) )
+            continue;
+        if ( !pGroups )
+        {
+            pGroups = pStats;
+            mayMatch.assign( pStats->countGroups(), true );
+        }
+        for ( size_t g = 0, N = mayMatch.size(); g < N; ++g )
+            if ( mayMatch[g] && !pCond->mayMatchChunk( pStats->chunks[g] ) )
+                mayMatch[g] = false;
+    }
+    if ( !pGroups || std::all_of( mayMatch.begin(), mayMatch.end(), []( bool b ) { return b; } ) )
+        return {};
+    std::vector<std::pair<Rowindex, Rowindex>> ranges;
+    for ( size_t g = 0, N = mayMatch.size(); g < N; ++g )
+    {
+        if ( !mayMatch[g] )
+            continue;
+        auto range = pGroups->groupRange( g );
+        if ( !ranges.empty() && ranges.back().second == range.first ) // merge adjacent row groups.
+            ranges.back().second = range.second;
+        else
+            ranges.push_back( range );
+    }
+    return ranges;
+}
+
 /// Try fast path first. if bEvaluateSlowPath, evalulate slow path.
 /// \param bByFast [out] True if evaluated by fast path, False by slow path or not being evaluated.
 template<bool ReturnVecOrSet>
@@ -216,22 +455,34 @@ auto findRowsByCondition( const DataFrameWithIndex *dfidx, ICondition *pCond, bo
     auto [pOrderedIndex, pHashIndex] = findIndex( dfidx, icols );
     ConditionIsIn *pCondIsin = dynamic_cast<ConditionIsIn *>( pCond );
     ConditionCompare *pCondCompare = dynamic_cast<ConditionCompare *>( pCond );
+    ConditionIsNull *pCondIsNull = dynamic_cast<ConditionIsNull *>( pCond );
 
     if ( bByFast )
         *bByFast = true; // bye default;
-    std::conditional_t<ReturnVecOrSet, std::vector<Rowindex>, std::unordered_set<Rowindex>> irows;
+    std::conditional_t<ReturnVecOrSet, RowMapping, std::unordered_set<Rowindex>> irows;
     auto addOneResult = [&]( Rowindex idx ) {
         if constexpr ( ReturnVecOrSet )
             irows.push_back( idx );
         else
             irows.insert( idx );
     };
+    auto addScannedResult = [&]( RowMapping &&scanned ) {
+        if constexpr ( ReturnVecOrSet )
+            irows = std::move( scanned );
+        else
+            scanned.foreach( [&]( Rowindex idx ) { irows.insert( idx ); } );
+    };
+    // rows found by index lookups, in a vector if ReturnVecOrSet.
+    auto lookupResult = [&]( auto &&rows ) {
+        if constexpr ( ReturnVecOrSet )
+            irows.assign( std::move( rows ) );
+        else
+            irows = std::move( rows );
+        return std::move( irows );
+    };
     auto addAllResult = [&]() {
         if constexpr ( ReturnVecOrSet )
-        {
-            irows.resize( df->size() );
-            std::iota( irows.begin(), irows.end(), 0 );
-        }
+            irows.assignAll( df->size() );
         else
         {
             for ( size_t i = 0, N = df->size(); i < N; ++i )
@@ -239,17 +490,25 @@ auto findRowsByCondition( const DataFrameWithIndex *dfidx, ICondition *pCond, bo
         }
     };
 
+    if ( pCondIsNull ) // validity bitmap is evaluated as fast path.
+    {
+        if ( RowMapping scanned; pCondIsNull->scanColumn( scanned ) )
+        {
+            addScannedResult( std::move( scanned ) );
+            return irows;
+        }
+    }
     if ( pHashIndex )
     {
         if ( op == OperatorTag::ISIN )
         {
             assert( pCondIsin );
-            return findRows_Hash_ISIN<ReturnVecOrSet>( pCondIsin, pHashIndex );
+            return lookupResult( findRows_Hash_ISIN<ReturnVecOrSet>( pCondIsin, pHashIndex ) );
         }
         else if ( op == OperatorTag::EQ )
         {
             assert( pCondCompare );
-            return findRows_Hash_EQ<ReturnVecOrSet>( pCondCompare, pHashIndex );
+            return lookupResult( findRows_Hash_EQ<ReturnVecOrSet>( pCondCompare, pHashIndex ) );
         }
         else if ( op == OperatorTag::NOTIN )
         {
@@ -285,11 +544,11 @@ auto findRowsByCondition( const DataFrameWithIndex *dfidx, ICondition *pCond, bo
     {
         if ( op == OperatorTag::ISIN )
         {
-            return findRows_Ordered_ISIN<ReturnVecOrSet>( pCondIsin, pOrderedIndex );
+            return lookupResult( findRows_Ordered_ISIN<ReturnVecOrSet>( pCondIsin, pOrderedIndex ) );
         }
         else if ( op == OperatorTag::EQ )
         {
-            return findRows_Ordered_EQ<ReturnVecOrSet>( pCondCompare, pOrderedIndex );
+            return lookupResult( findRows_Ordered_EQ<ReturnVecOrSet>( pCondCompare, pOrderedIndex ) );
         }
         else if ( op == OperatorTag::NOTIN )
         {
@@ -354,11 +613,35 @@ auto findRowsByCondition( const DataFrameWithIndex *dfidx, ICondition *pCond, bo
         *bByFast = false;
     if ( bEvaluateSlowPath )
     {
+        if ( auto ranges = findRowGroups( df, {pCond} ) ) // skip row groups by statistics.
+        {
+            for ( auto [ibegin, iend] : *ranges )
+                for ( size_t i = ibegin; i < iend; ++i )
+                    if ( pCond->evalAtRow( i ) )
+                        addOneResult( i );
+            return irows;
+        }
+        if ( pCondCompare ) // typed scan on columnar DataFrame.
+        {
+            if ( RowMapping scanned; pCondCompare->scanColumn( scanned ) )
+            {
+                addScannedResult( std::move( scanned ) );
+                return irows;
+            }
+        }
+        if ( pCondIsin ) // code scan on dictionary-encoded column.
+        {
+            if ( RowMapping scanned; pCondIsin->scanColumn( scanned ) )
+            {
+                addScannedResult( std::move( scanned ) );
+                return irows;
+            }
+        }
         return dfidx->findRowsSlowPath<ReturnVecOrSet>( pCond );
     }
     return irows;
 }
-std::vector<Rowindex> DataFrameWithIndex::findRows( Expr expr, bool bEvaluateSlowPath ) const
+RowMapping DataFrameWithIndex::findRows( Expr expr, bool bEvaluateSlowPath ) const
 {
     std::stringstream err;
     IConditionPtr pCond = expr.toCondition( *m_pDataFrame, &err );
@@ -367,14 +650,14 @@ std::vector<Rowindex> DataFrameWithIndex::findRows( Expr expr, bool bEvaluateSlo
     return findRowsByCondition<true>( this, pCond.get(), bEvaluateSlowPath );
 }
 
-std::vector<Rowindex> DataFrameWithIndex::findRows( AndExpr expr ) const
+RowMapping DataFrameWithIndex::findRows( AndExpr expr ) const
 {
     std::stringstream err;
     std::vector<IConditionPtr> andConds = expr.toCondition( *m_pDataFrame, &err );
     if ( andConds.empty() )
         throw std::runtime_error( "AddExp Error: " + err.str() );
 
-    std::vector<Rowindex> irows;
+    RowMapping irows;
     std::unordered_set<Rowindex> rowCandidates;
     std::vector<bool> evaluated( andConds.size(), false );
 
@@ -436,34 +719,42 @@ std::vector<Rowindex> DataFrameWithIndex::findRows( AndExpr expr ) const
             if ( rowCandidates.empty() )
                 return {};
         }
-        irows.insert( irows.end(), rowCandidates.begin(), rowCandidates.end() );
-        std::sort( irows.begin(), irows.end() );
+        std::vector<Rowindex> sorted( rowCandidates.begin(), rowCandidates.end() );
+        std::sort( sorted.begin(), sorted.end() );
+        irows.assign( std::move( sorted ) );
         return irows;
     }
 
-    // otherwise slow path: evaluate row by row.
-    for ( size_t i = 0, N = size(); i < N; ++i )
+    // otherwise slow path: evaluate row by row in the row groups that may match.
+    std::vector<const ICondition *> conds;
+    for ( const auto &pCond : andConds )
+        conds.push_back( pCond.get() );
+    auto ranges = findRowGroups( m_pDataFrame.get(), conds ).value_or( std::vector<std::pair<Rowindex, Rowindex>>{{0, size()}} );
+    for ( auto [ibegin, iend] : ranges )
     {
-        bool good = true;
-        for ( size_t k = 0, M = andConds.size(); k < M && good; ++k )
+        for ( size_t i = ibegin; i < iend; ++i )
         {
-            assert( !evaluated[k] );
-            if ( !andConds[k]->evalAtRow( i ) )
-                good = false;
+            bool good = true;
+            for ( size_t k = 0, M = andConds.size(); k < M && good; ++k )
+            {
+                assert( !evaluated[k] );
+                if ( !andConds[k]->evalAtRow( i ) )
+                    good = false;
+            }
+            if ( good )
+                irows.push_back( i );
         }
-        if ( good )
-            irows.push_back( i );
     }
     return irows;
 }
-std::vector<Rowindex> DataFrameWithIndex::findRows( OrExpr expr ) const
+RowMapping DataFrameWithIndex::findRows( OrExpr expr ) const
 {
     std::stringstream err;
     std::vector<std::vector<IConditionPtr>> orConds = expr.toCondition( *m_pDataFrame, &err );
     if ( orConds.empty() )
         throw std::runtime_error( "OrExp Error: " + err.str() );
 
-    std::vector<Rowindex> irows;
+    RowMapping irows;
 
     // todo: add fast path evaluation for OrExpr.
 
@@ -69,6 +69,10 @@ struct hash_code<IndexKey>
     }
 };
 
+/// \brief Find the row groups that may match all the conditions by statistics of row groups (see IDataFrame::rowGroupStats).
+/// \return [beginRow, endRow) ranges of the row groups that may match, or nullopt if no row group is skipped.
+std::optional<std::vector<std::pair<Rowindex, Rowindex>>> findRowGroups( const IDataFrame *df, const std::vector<const ICondition *> &conds );
+
 // df.where( Col("Age") > 10 && isin("Level", Set('A', 'B'))  )
 // df.where( Col("A
 class DataFrameWithIndex
@@ -168,6 +172,19 @@ public:
         m_indexMap.clear();
     }
 
+    //------------- Index File -----------------------
+
+    /// \brief Save all the indexes as DFBI (see "Index File Layout" in IDataFrame.h). The DataFrame itself is saved by save_binary.
+    /// \pre os is seekable. Open file streams in binary mode.
+    bool saveIndexes( std::ostream &os, std::ostream *err = nullptr ) const;
+    bool saveIndexes( const std::string &filename, std::ostream *err = nullptr ) const;
+
+    /// \brief Replace all the indexes by those saved by saveIndexes, without sorting or grouping rows again.
+    /// Fails if the indexes were not saved with the same number of rows and column definitions as the DataFrame, or if the saved
+    /// row order or groups don't match its rows, which is verified in O(rows).
+    bool loadIndexes( std::istream &is, std::ostream *err = nullptr );
+    bool loadIndexes( const std::string &filename, std::ostream *err = nullptr );
+
     //------------- Evaluate Expressions -----------------------
 
     DataFrameView select( Expr expr )
@@ -208,7 +225,7 @@ public:
     template<bool ReturnVecOrSet>
     auto findRowsSlowPath( ICondition *pCond ) const
     {
-        std::conditional_t<ReturnVecOrSet, std::vector<Rowindex>, std::unordered_set<Rowindex>> irows;
+        std::conditional_t<ReturnVecOrSet, RowMapping, std::unordered_set<Rowindex>> irows;
         for ( size_t i = 0, N = size(); i < N; ++i )
         {
             if ( pCond->evalAtRow( i ) )
@@ -223,13 +240,15 @@ public:
     }
 
 protected:
-    std::vector<Rowindex> findRows( ICondition *pCond, bool bEvaluateSlowPath = true ) const;
-    std::vector<Rowindex> findRows( Expr expr, bool bEvaluateSlowPath = true ) const;
-    std::vector<Rowindex> findRows( AndExpr expr ) const;
-    std::vector<Rowindex> findRows( OrExpr expr ) const;
+    std::optional<iterator> insertIndex( IndexKey key, IndexValue val, std::ostream *err );
+
+    RowMapping findRows( ICondition *pCond, bool bEvaluateSlowPath = true ) const;
+    RowMapping findRows( Expr expr, bool bEvaluateSlowPath = true ) const;
+    RowMapping findRows( AndExpr expr ) const;
+    RowMapping findRows( OrExpr expr ) const;
 
-    DataFrameView select( std::vector<Rowindex> irows, std::vector<size_t> icols );
-    DataFrameView select_rows( std::vector<Rowindex> irows );
+    DataFrameView select( RowMapping irows, std::vector<size_t> icols );
+    DataFrameView select_rows( RowMapping irows );
     DataFrameView select_cols( std::vector<Rowindex> icols );
 
     /// \param colindices column indices to select. Select all columns if it's empty.
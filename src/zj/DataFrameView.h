@@ -20,6 +20,7 @@
 
 #include <zj/IDataFrame.h>
 #include <zj/Indexing.h>
+#include <zj/RowMapping.h>
 
 namespace zj
 {
@@ -58,6 +59,10 @@ public:
     {
         return m_pDataFrame->at( underlyingRow( irow ), col );
     }
+    const CompactField *compactAt( size_t irow, size_t icol ) const override
+    {
+        return m_pDataFrame->compactAt( underlyingRow( irow ), underlyingCol( icol ) );
+    }
     const std::string &colName( size_t icol ) const override
     {
         return m_pDataFrame->colName( underlyingCol( icol ) );
@@ -111,9 +116,9 @@ public:
 /// \brief DataFrameView is a view of selected [rows, columns] of ]underlying DataFrame.
 class DataFrameView : public IDataFrameView
 {
-    std::vector<std::size_t> m_colIndices; // row index of underlying DataFrame.
+    std::vector<std::size_t> m_colIndices; // col index of underlying DataFrame.
     std::unordered_map<std::string, size_t> m_columnNames; // <name: currentIndex>
-    std::vector<std::size_t> m_rowIndices; // row index of underlying DataFrame.
+    RowMapping m_rowIndices; // row index of underlying DataFrame.
 
 public:
     bool create( const IDataFrame &df, std::vector<std::size_t> irows, std::vector<std::size_t> icols, std::ostream *err = nullptr )
@@ -122,22 +127,64 @@ public:
             return false;
         return create_row_view_impl( df, std::move( irows ), err );
     }
+    /// \brief View of rows found by a condition. Rows are kept as segments if they are range-shaped.
+    bool create( const IDataFrame &df, RowMapping irows, std::vector<std::size_t> icols, std::ostream *err = nullptr )
+    {
+        if ( !create_column_view_impl( df, std::move( icols ), err ) )
+            return false;
+        return create_row_view_impl( df, std::move( irows ), err );
+    }
     bool create( const IDataFrame &df, std::vector<std::size_t> irows, std::vector<std::string> colNames, std::ostream *err = nullptr )
     {
         return create( df, std::move( irows ), df.colIndex( colNames ), err );
     }
+    /// \brief View of all rows, of which the row mapping is a single range.
     bool create_column_view( const IDataFrame &df, std::vector<std::size_t> icols, std::ostream *err = nullptr )
     {
         if ( !create_column_view_impl( df, std::move( icols ), err ) )
             return false;
-        std::vector<size_t> irows( df.countRows(), 0 );
-        std::iota( irows.begin(), irows.end(), 0 );
-        return create_row_view_impl( df, std::move( irows ), err );
+        if ( auto pView = dynamic_cast<const DataFrameView *>( &df ) ) // same rows as df.
+        {
+            if ( pView != this )
+                m_rowIndices = pView->m_rowIndices;
+        }
+        else if ( df.isView() )
+        {
+            std::vector<size_t> irows( df.countRows(), 0 );
+            std::iota( irows.begin(), irows.end(), 0 );
+            return create_row_view_impl( df, std::move( irows ), err );
+        }
+        else
+            m_rowIndices.assignAll( df.countRows() );
+        return true;
     }
     bool create_column_view( const IDataFrame &df, std::vector<std::string> colNames, std::ostream *err = nullptr )
     {
         return create_column_view( df, df.colIndex( colNames ), err );
     }
+    /// \brief View of rows [ibegin, iend) and all columns.
+    bool create_range_view( const IDataFrame &df, size_t ibegin, size_t iend, std::ostream *err = nullptr )
+    {
+        if ( ibegin > iend || iend > df.countRows() )
+        {
+            if ( err )
+                *err << "Row range:[" << ibegin << ", " << iend << ") is not in range:" << df.countRows() << ".\n";
+            return false;
+        }
+        std::vector<size_t> icols( df.countCols(), 0 );
+        std::iota( icols.begin(), icols.end(), 0 );
+        if ( df.isView() )
+        {
+            std::vector<size_t> irows( iend - ibegin, 0 );
+            std::iota( irows.begin(), irows.end(), ibegin );
+            return create_row_view_impl( df, std::move( irows ), err ) && create_column_view_impl( df, std::move( icols ), err );
+        }
+        SparseVector<size_t> runs;
+        if ( iend > ibegin )
+            runs.push_back_incremental( ibegin, iend - ibegin );
+        m_rowIndices.assign( std::move( runs ) );
+        return create_column_view_impl( df, std::move( icols ), err );
+    }
     bool create_row_view( const IDataFrame &df, std::vector<std::size_t> irows, std::ostream *err = nullptr )
     {
         if ( !create_row_view_impl( df, std::move( irows ), err ) )
@@ -146,6 +193,14 @@ public:
         std::iota( icols.begin(), icols.end(), 0 );
         return create_column_view_impl( df, std::move( icols ), err );
     }
+    bool create_row_view( const IDataFrame &df, RowMapping irows, std::ostream *err = nullptr )
+    {
+        if ( !create_row_view_impl( df, std::move( irows ), err ) )
+            return false;
+        std::vector<size_t> icols( df.countCols(), 0 );
+        std::iota( icols.begin(), icols.end(), 0 );
+        return create_column_view_impl( df, std::move( icols ), err );
+    }
 
     void sort_by( const std::vector<std::string> &colNames, bool bReverseOrder = false )
     {
@@ -156,7 +211,12 @@ public:
         newIndices.reserve( size() );
         for ( auto i : orderedRows )
             newIndices.push_back( m_rowIndices[i] );
-        m_rowIndices = std::move( newIndices );
+        m_rowIndices.assign( std::move( newIndices ) );
+    }
+    /// \return the row mapping, which is range-compressed if rows are range-shaped.
+    const RowMapping &rowMapping() const
+    {
+        return m_rowIndices;
     }
 
     //////////////////////////////////////////////////////////
@@ -220,20 +280,37 @@ protected:
         m_pDataFrame = &df;
         if ( df.isView() )
         {
-            m_rowIndices.resize( irows.size() );
             const IDataFrameView *pView = dynamic_cast<const IDataFrameView *>( &df );
             m_pDataFrame = pView->underlying();
-            for ( size_t i = 0, N = irows.size(); i < N; ++i )
-                m_rowIndices[i] = pView->underlyingRow( irows[i] );
+            for ( auto &r : irows )
+                r = pView->underlyingRow( r );
         }
-        else
-            m_rowIndices = std::move( irows );
+        m_rowIndices.assign( std::move( irows ) );
+        return true;
+    }
+    bool create_row_view_impl( const IDataFrame &df, RowMapping &&irows, std::ostream *err = nullptr )
+    {
+        if ( !irows.empty() && irows.maxRow() >= df.countRows() )
+        {
+            if ( err )
+                *err << "Rowindex:" << irows.maxRow() << " is not in range:" << df.countRows() << ".\n";
+            return false;
+        }
+        m_pDataFrame = &df;
+        if ( df.isView() )
+        {
+            const IDataFrameView *pView = dynamic_cast<const IDataFrameView *>( &df );
+            m_pDataFrame = pView->underlying();
+            RowMapping mapped;
+            irows.foreach( [&]( size_t r ) { mapped.push_back( pView->underlyingRow( r ) ); } );
+            irows = std::move( mapped );
+        }
+        irows.compact();
+        m_rowIndices = std::move( irows );
         return true;
     }
 };
 
 using DataFrameViewPtr = std::shared_ptr<DataFrameView>;
 
-// todo: SparseDataFrameView
-
 } // namespace zj
@@ -64,6 +64,8 @@ std::optional<DateTime> ParseDateTime( std::string_view s, std::ostream *err )
 
     const char *ps = s.data(), *pEnd = s.data() + s.length();
 
+    auto at = [&]( const char *p ) -> char { return p < pEnd ? *p : '\0'; }; // s is not null terminated.
+    auto rest = [&]( const char *p ) { return std::string_view( p, size_t( pEnd - std::min( p, pEnd ) ) ); };
     auto skipSpace = [&]( const char *p ) -> const char * {
         while ( p < pEnd && isspace( *p ) )
             ++p;
@@ -76,18 +78,24 @@ std::optional<DateTime> ParseDateTime( std::string_view s, std::ostream *err )
     auto continueParse2Ints = [&]( auto &res ) -> bool {
         for ( int i = 0; i < 2; ++i )
         {
+            if ( res.ptr == pEnd )
+            {
+                if ( err )
+                    *err << "Expected " << i + 2 << "-th part of Year-Mon-Date at end.\n";
+                return false;
+            }
             ps = res.ptr + 1;
             res = std::from_chars( ps, pEnd, val[i] );
             if ( res.ptr == ps )
             {
                 if ( err )
-                    *err << "Expected " << i + 2 << "-th part of Year-Mon-Date at: " << ps << ".\n";
+                    *err << "Expected " << i + 2 << "-th part of Year-Mon-Date at: " << rest( ps ) << ".\n";
                 return false;
             }
-            if ( i == 0 && expectedSep != *res.ptr )
+            if ( i == 0 && expectedSep != at( res.ptr ) )
             {
                 if ( err )
-                    *err << "Expected sep:" << expectedSep << " at:" << ps << ".\n";
+                    *err << "Expected sep:" << expectedSep << " at:" << rest( ps ) << ".\n";
                 return false;
             }
             nDigits[i] = res.ptr - ps;
@@ -100,16 +108,16 @@ std::optional<DateTime> ParseDateTime( std::string_view s, std::ostream *err )
     if ( res.ptr == ps )
     {
         if ( err )
-            *err << "Failed to first integer at:" << ps << ".\n";
+            *err << "Failed to first integer at:" << rest( ps ) << ".\n";
         return {};
     }
-    else if ( *res.ptr != ':' )
+    else if ( at( res.ptr ) != ':' )
     {
-        expectedSep = *res.ptr;
+        expectedSep = at( res.ptr );
         if ( res.ptr - ps > 8 )
         {
             if ( err )
-                *err << "Too large year at:" << ps << ".\n";
+                *err << "Too large year at:" << rest( ps ) << ".\n";
             return {};
         }
         if ( res.ptr - ps != 8 ) // year
@@ -133,7 +141,7 @@ std::optional<DateTime> ParseDateTime( std::string_view s, std::ostream *err )
             else
             {
                 if ( err )
-                    *err << "Malformed date format at:" << p << ".\n";
+                    *err << "Malformed date format at:" << rest( p ) << ".\n";
                 return {};
             }
         }
@@ -158,13 +166,13 @@ std::optional<DateTime> ParseDateTime( std::string_view s, std::ostream *err )
             return {};
         }
 
-        if ( *res.ptr == ':' )
+        if ( at( res.ptr ) == ':' )
         {
             if ( err )
                 *err << "\":\" is not allow at end of date.\n";
             return {};
         }
-        if ( res.ptr != pEnd && !isspace( *res.ptr ) ) // skip the Date:Time seperator.
+        if ( res.ptr != pEnd && !isspace( at( res.ptr ) ) ) // skip the Date:Time seperator.
             ++res.ptr;
         ps = skipSpace( res.ptr );
         res = std::from_chars( ps, pEnd, x ); // parse first part of time.
@@ -173,7 +181,7 @@ std::optional<DateTime> ParseDateTime( std::string_view s, std::ostream *err )
             if ( ps != pEnd )
             {
                 if ( err )
-                    *err << "Invalid string after date:" << ps << std::endl;
+                    *err << "Invalid string after date:" << rest( ps ) << std::endl;
                 return {};
             }
             t.setDateOnly();
@@ -184,7 +192,7 @@ std::optional<DateTime> ParseDateTime( std::string_view s, std::ostream *err )
         t.setTimeOnly();
 
     //------------------------ parse time HH:MM:SS
-    if ( *res.ptr == ':' ) // it's possibly time format.
+    if ( at( res.ptr ) == ':' ) // it's possibly time format.
     {
         t.hour = x;
         expectedSep = ':';
@@ -206,14 +214,14 @@ std::optional<DateTime> ParseDateTime( std::string_view s, std::ostream *err )
         t.min = val[0];
         t.sec = val[1];
 
-        if ( *res.ptr == '.' ) //---- parse subsecond;
+        if ( at( res.ptr ) == '.' ) //---- parse subsecond;
         {
             ps = res.ptr + 1;
             res = std::from_chars( ps, pEnd, t.nanosec );
             if ( ps == res.ptr )
             {
                 if ( err )
-                    *err << "Expected subsecond digits at:" << ps;
+                    *err << "Expected subsecond digits at:" << rest( ps );
                 return {};
             }
             for ( size_t i = 0, ndigits = res.ptr - ps; i < 9 - ndigits; ++i )
@@ -238,14 +246,14 @@ std::optional<DateTime> ParseDateTime( std::string_view s, std::ostream *err )
         else if ( res.ptr - ps == 2 || res.ptr - ps == 1 ) // H or HH or HH:MM
         {
             h = x;
-            if ( *res.ptr == ':' ) // HH:MM
+            if ( at( res.ptr ) == ':' ) // HH:MM
             {
                 ps = res.ptr + 1;
                 res = std::from_chars( ps, pEnd, x );
                 if ( res.ptr - ps != 2 && res.ptr - ps != 1 )
                 {
                     if ( err )
-                        *err << "Invalid timezone minute format:" << ps << ".\n";
+                        *err << "Invalid timezone minute format:" << rest( ps ) << ".\n";
                     return {};
                 }
                 m = x;
@@ -254,7 +262,7 @@ std::optional<DateTime> ParseDateTime( std::string_view s, std::ostream *err )
         else
         {
             if ( err )
-                *err << "Too large to empty timezone format:" << ps << ". Valid formats: +HHMM or -HH:MM.\n";
+                *err << "Too large to empty timezone format:" << rest( ps ) << ". Valid formats: +HHMM or -HH:MM.\n";
             return {};
         }
         // check range
@@ -20,9 +20,11 @@
 #include <stdint.h>
 #include <time.h>
 #include <string.h>
+#include <stdio.h>
 
 #include <chrono>
 #include <optional>
+#include <string>
 #include <charconv>
 #include <iostream>
 
@@ -244,4 +246,172 @@ inline std::ostream &operator<<( std::ostream &os, const DateTime &dt )
 
 std::optional<DateTime> ParseDateTime( std::string_view s, std::ostream *err = nullptr );
 
+/// \return days since 1970-01-01 of proleptic Gregorian date y-m-d. m: 1-12, d: 1-31.
+constexpr int64_t days_from_civil( int64_t y, unsigned m, unsigned d )
+{
+    y -= m <= 2;
+    const int64_t era = ( y >= 0 ? y : y - 399 ) / 400;
+    const unsigned yoe = unsigned( y - era * 400 ); // [0, 399]
+    const unsigned doy = ( 153 * ( m > 2 ? m - 3 : m + 9 ) + 2 ) / 5 + d - 1; // [0, 365]
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy; // [0, 146096]
+    return era * 146097 + int64_t( doe ) - 719468;
+}
+/// \brief Inverse of days_from_civil.
+constexpr void civil_from_days( int64_t days, int64_t &y, unsigned &m, unsigned &d )
+{
+    days += 719468;
+    const int64_t era = ( days >= 0 ? days : days - 146096 ) / 146097;
+    const unsigned doe = unsigned( days - era * 146097 );
+    const unsigned yoe = ( doe - doe / 1460 + doe / 36524 - doe / 146096 ) / 365;
+    const unsigned doy = doe - ( 365 * yoe + yoe / 4 - yoe / 100 );
+    const unsigned mp = ( 5 * doy + 2 ) / 153;
+    d = doy - ( 153 * mp + 2 ) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = int64_t( yoe ) + era * 400 + ( m <= 2 );
+}
+
+/**
+ * @brief Timestamp field value: normalized nanoseconds since epoch. Compare and hash are integer operations on nanos.
+ * - A value with time zone is normalized to UTC.
+ * - A value without time zone is normalized as if it's UTC, so that it doesn't depend on the local time zone.
+ * - A time-only value holds nanoseconds since midnight, in [0, NanosPerDay).
+ * Time zone and date/time-only flags are kept only for printing; broken-down fields are computed by to_datetime() when needed.
+ */
+struct Timestamp
+{
+    static constexpr int64_t NanosPerSec = 1000000000;
+    static constexpr int64_t NanosPerDay = 86400 * NanosPerSec;
+
+    int64_t nanos = 0;
+    int16_t tzOffsetMinutes = 0; // valid if hasTimeZone.
+    uint8_t dateOrTimeOnly = DateTime::USE_DATETIME;
+    bool hasTimeZone = false;
+
+    Timestamp() = default;
+    explicit constexpr Timestamp( int64_t nanosSinceEpoch ) : nanos( nanosSinceEpoch )
+    {
+    }
+    Timestamp( const DateTime &dt ) : dateOrTimeOnly( uint8_t( dt.dateOrTimeOnly ) ), hasTimeZone( dt.tzOffsetMinutes.has_value() )
+    {
+        if ( hasTimeZone )
+            tzOffsetMinutes = int16_t( *dt.tzOffsetMinutes );
+        int64_t secs = 0;
+        if ( dt.hasDate() )
+            secs = days_from_civil( dt.year, dt.month, dt.mday ) * 86400;
+        if ( dt.hasTime() )
+            secs += int64_t( dt.hour ) * 3600 + dt.min * 60 + dt.sec - int64_t( tzOffsetMinutes ) * 60;
+        nanos = secs * NanosPerSec + int64_t( dt.nanosec );
+        if ( !dt.hasDate() )
+            nanos = ( nanos % NanosPerDay + NanosPerDay ) % NanosPerDay;
+    }
+
+    /// \return nanoseconds since epoch.
+    int64_t count() const
+    {
+        return nanos;
+    }
+    std::chrono::nanoseconds time_since_epoch() const
+    {
+        return std::chrono::nanoseconds( nanos );
+    }
+    std::optional<int> timeZoneOffsetMinutes() const
+    {
+        return hasTimeZone ? std::optional<int>( tzOffsetMinutes ) : std::nullopt;
+    }
+    bool hasTime() const
+    {
+        return dateOrTimeOnly != DateTime::DATEONLY;
+    }
+    bool hasDate() const
+    {
+        return dateOrTimeOnly != DateTime::TIMEONLY;
+    }
+
+    /// \brief Broken-down date time in its own time zone.
+    DateTime to_datetime() const
+    {
+        DateTime dt;
+        int64_t local = nanos + int64_t( tzOffsetMinutes ) * 60 * NanosPerSec;
+        int64_t days = local / NanosPerDay, nanosOfDay = local % NanosPerDay;
+        if ( nanosOfDay < 0 )
+        {
+            --days;
+            nanosOfDay += NanosPerDay;
+        }
+        int64_t year = 0;
+        civil_from_days( days, year, dt.month, dt.mday );
+        dt.year = unsigned( year );
+        int64_t secs = nanosOfDay / NanosPerSec;
+        dt.hour = unsigned( secs / 3600 );
+        dt.min = unsigned( secs % 3600 / 60 );
+        dt.sec = unsigned( secs % 60 );
+        dt.nanosec = size_t( nanosOfDay % NanosPerSec );
+        dt.tzOffsetMinutes = timeZoneOffsetMinutes();
+        dt.dateOrTimeOnly = dateOrTimeOnly;
+        if ( !hasDate() )
+            dt.year = dt.month = dt.mday = 0;
+        return dt;
+    }
+
+    /// Same as DateTime::to_string.
+    std::string to_string( const char *adateFmt = "%Y-%m-%d", int nSubsecondDigits = -1, int bPrintTimeZone = -1 ) const
+    {
+        char buf[64];
+        char fmtBuf[32] = "%Y-%m-%dT%T";
+        const char *datefmt = adateFmt ? adateFmt : "%Y-%m-%d";
+        if ( !hasDate() )
+            strcpy( fmtBuf, "%T" );
+        else if ( !hasTime() )
+            snprintf( fmtBuf, sizeof( fmtBuf ), "%s", datefmt );
+        else
+            snprintf( fmtBuf, sizeof( fmtBuf ), "%sT%s", datefmt, "%T" );
+        return PrintTimestamp( buf, sizeof( buf ), time_since_epoch(), fmtBuf, nSubsecondDigits, bPrintTimeZone, timeZoneOffsetMinutes(), true );
+    }
+
+    /// \brief tzOffsetMinutes, dateOrTimeOnly and hasTimeZone packed in 32 bits.
+    uint32_t formatBits() const
+    {
+        return uint32_t( uint16_t( tzOffsetMinutes ) ) | uint32_t( dateOrTimeOnly ) << 16 | uint32_t( hasTimeZone ) << 24;
+    }
+    static Timestamp fromFormatBits( int64_t nanos, uint32_t bits )
+    {
+        Timestamp res( nanos );
+        res.tzOffsetMinutes = int16_t( uint16_t( bits & 0xffff ) );
+        res.dateOrTimeOnly = uint8_t( ( bits >> 16 ) & 0xff );
+        res.hasTimeZone = ( bits >> 24 ) & 1;
+        return res;
+    }
+
+    bool operator==( const Timestamp &a ) const
+    {
+        return nanos == a.nanos;
+    }
+    bool operator!=( const Timestamp &a ) const
+    {
+        return nanos != a.nanos;
+    }
+    bool operator<( const Timestamp &a ) const
+    {
+        return nanos < a.nanos;
+    }
+    bool operator>( const Timestamp &a ) const
+    {
+        return nanos > a.nanos;
+    }
+    bool operator<=( const Timestamp &a ) const
+    {
+        return nanos <= a.nanos;
+    }
+    bool operator>=( const Timestamp &a ) const
+    {
+        return nanos >= a.nanos;
+    }
+};
+
+inline std::ostream &operator<<( std::ostream &os, const Timestamp &ts )
+{
+    os << ts.to_string();
+    return os;
+}
+
 } // namespace zj
@@ -0,0 +1,201 @@
+/*
+ * This file is part of the ftl (Fast Template Library) distribution (https://github.com/zjgoggle/ftl).
+ * Copyright (c) 2020 Jack Zhang.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <zj/VarField.h>
+#include <charconv>
+#include <optional>
+
+namespace zj
+{
+
+///////////////////////////////////////////////////////////////
+/// Typed conversion of string fields, i.e. a column of csv fields converted in one typed loop (see IColumn::appendStrs).
+///////////////////////////////////////////////////////////////
+
+/**
+ * @brief Parse Timestamp. The layout of the first value that ParseDateTime parses is locked if it's one of
+ * YYYY-MM-DD, YYYY/MM/DD or YYYYMMDD, optionally followed by 'T' or ' ' and HH:MM:SS[.fraction]. Then values of the same layout are
+ * parsed by fixed offsets, and the other values by ParseDateTime, so that results are always the same as from_string.
+ */
+class TimestampParser
+{
+protected:
+    struct Layout
+    {
+        size_t len = 0;
+        char dateSep = 0; // 0 for YYYYMMDD.
+        char timeSep = 0; // 0 for date only.
+        size_t fracDigits = 0;
+    };
+    std::optional<Layout> m_layout;
+    bool m_detected = false; // the first successful value is examined.
+
+public:
+    bool locked() const
+    {
+        return m_layout.has_value();
+    }
+
+    bool operator()( std::string_view s, Timestamp &val )
+    {
+        if ( m_layout && parse( *m_layout, s, val ) )
+            return true;
+        auto dt = ParseDateTime( s );
+        if ( !dt )
+            return false;
+        val = *dt;
+        if ( !m_detected )
+        {
+            m_detected = true;
+            Timestamp locked;
+            if ( auto layout = detect( s ); layout && parse( *layout, s, locked ) && locked.nanos == val.nanos &&
+                                            locked.dateOrTimeOnly == val.dateOrTimeOnly && !val.hasTimeZone )
+                m_layout = layout;
+        }
+        return true;
+    }
+
+protected:
+    static bool is_digit( char c )
+    {
+        return unsigned( c - '0' ) < 10;
+    }
+    // parse n digits at s, which are known to be digits.
+    static unsigned digits( const char *s, size_t n )
+    {
+        unsigned x = 0;
+        for ( size_t i = 0; i < n; ++i )
+            x = x * 10 + unsigned( s[i] - '0' );
+        return x;
+    }
+    static std::optional<Layout> detect( std::string_view s )
+    {
+        Layout layout;
+        size_t pos = 0;
+        if ( s.size() >= 10 && ( s[4] == '-' || s[4] == '/' ) && s[7] == s[4] )
+        {
+            layout.dateSep = s[4];
+            pos = 10;
+        }
+        else if ( s.size() >= 8 )
+            pos = 8;
+        else
+            return {};
+        if ( pos < s.size() )
+        {
+            layout.timeSep = s[pos];
+            if ( ( layout.timeSep != 'T' && layout.timeSep != ' ' ) || s.size() < pos + 9 )
+                return {};
+            pos += 9;
+            if ( pos < s.size() )
+            {
+                if ( s[pos] != '.' || s.size() - pos - 1 > 9 )
+                    return {};
+                layout.fracDigits = s.size() - pos - 1;
+            }
+        }
+        layout.len = s.size();
+        return layout;
+    }
+    // \return false if s is not of layout, or a value is out of range, in which case ParseDateTime decides.
+    static bool parse( const Layout &layout, std::string_view s, Timestamp &val )
+    {
+        if ( s.size() != layout.len )
+            return false;
+        const char *p = s.data();
+        DateTime dt;
+        size_t pos;
+        if ( layout.dateSep )
+        {
+            if ( p[4] != layout.dateSep || p[7] != layout.dateSep || !all_digits( p, {0, 1, 2, 3, 5, 6, 8, 9} ) )
+                return false;
+            dt.year = digits( p, 4 );
+            dt.month = digits( p + 5, 2 );
+            dt.mday = digits( p + 8, 2 );
+            pos = 10;
+        }
+        else
+        {
+            if ( !all_digits( p, {0, 1, 2, 3, 4, 5, 6, 7} ) )
+                return false;
+            dt.year = digits( p, 4 );
+            dt.month = digits( p + 4, 2 );
+            dt.mday = digits( p + 6, 2 );
+            pos = 8;
+        }
+        if ( dt.month == 0 || dt.month > 12 || dt.mday == 0 || dt.mday > 31 )
+            return false;
+        if ( !layout.timeSep )
+        {
+            dt.setDateOnly();
+            val = dt;
+            return true;
+        }
+        p += pos;
+        if ( p[0] != layout.timeSep || p[3] != ':' || p[6] != ':' || !all_digits( p, {1, 2, 4, 5, 7, 8} ) )
+            return false;
+        dt.hour = digits( p + 1, 2 );
+        dt.min = digits( p + 4, 2 );
+        dt.sec = digits( p + 7, 2 );
+        if ( dt.hour >= 24 || dt.min >= 60 || dt.sec >= 60 )
+            return false;
+        if ( layout.fracDigits )
+        {
+            p += 9;
+            if ( p[0] != '.' )
+                return false;
+            for ( size_t i = 1; i <= layout.fracDigits; ++i )
+                if ( !is_digit( p[i] ) )
+                    return false;
+            dt.nanosec = digits( p + 1, layout.fracDigits );
+            for ( size_t i = layout.fracDigits; i < 9; ++i )
+                dt.nanosec *= 10;
+        }
+        val = dt;
+        return true;
+    }
+    static bool all_digits( const char *p, std::initializer_list<int> offsets )
+    {
+        for ( int i : offsets )
+            if ( !is_digit( p[i] ) )
+                return false;
+        return true;
+    }
+};
+
+/// \brief Parse a value of type T as from_string of FieldValue<T> does.
+template<class T>
+struct FieldParser
+{
+    bool operator()( std::string_view s, T &val )
+    {
+        FieldValue<T> fieldval{};
+        if ( !from_string( fieldval, s ) )
+            return false;
+        val = std::move( fieldval.value );
+        return true;
+    }
+};
+template<>
+struct FieldParser<Timestamp> : TimestampParser
+{
+};
+
+} // namespace zj
@@ -18,17 +18,53 @@
 #pragma once
 
 #include <zj/VarField.h>
+#include <zj/CompactField.h>
+#include <zj/Column.h>
 
 namespace zj
 {
 
 /**
 
-DataFrame Storage Layout:
+DataFrame Storage Layout (see save_binary and DFBCReader in BinaryIO.h):
 
-4-bytes TypeCode | 4-bytes length of Fields data | 4 bytes    | 127-bytes-length  | 4-bytes number of Fields | Field0 Type | Field 0 |....|
-------------------------------------------------------------------------------------------------------------
-DFBC             |  length (in bytes)            | NumCols    |  Column Names     |  Number of Fields        |  Type       |  Value  |....|
+4-bytes TypeCode | 8-bytes length of the rest    | 4 bytes    | Column Definitions | 8 bytes  | Column Block 0 | Column Block 1 |....|
+-----------------------------------------------------------------------------------------------------------------------------------
+DFBC             |  length (in bytes)            | NumCols    |  see below         | NumRows  |  see below     |                |....|
+
+Column Definition: 1-byte Type | 1-byte Encoding | 1-byte name length (<= 127) | Column Name.
+Column Block: 8-byte NullCount | Validity, (NumRows+63)/64 8-byte bitmap words present only if NullCount > 0 | Values.
+Values in host byte order: scalars as arrays of the type, nulls as 0; Bool as bitmap words; Timestamp as 8-byte nanos, then 4-byte format
+bits; Str and vector as NumRows+1 8-byte offsets, then bytes of cells, which are Str bytes or vector values encoded as below.
+Value: Bool as 1 byte; Str as 4-byte length and bytes; Timestamp as 8-byte nanos and 4-byte format bits; vector as 4-byte count and
+elements; other scalars as raw bytes.
+Field: 1-byte FieldTypeTag, and the value, or no value if it's Null.
+
+
+Mapped DataFrame Layout (see save_mapped and MappedDataFrame in MappedDataFrame.h):
+
+4-bytes TypeCode | 4 bytes  | 8 bytes          | Column Sections ...                   | 8 bytes | Column Definitions | Column Entries |
+-------------------------------------------------------------------------------------------------------------------------------------
+DFBM             | Version  | Directory Offset | each section is aligned to 4096 bytes | NumRows | NumCols, see above | one per column |
+
+Version 2 appends row group statistics to directory: 8-byte RowGroupSize (0 for none), then for each column, for each row group:
+8-byte NullCount | Min Field | Max Field. Fields are encoded as in DFBC, and Null if there is no value or the column is vector.
+
+Column Entry: 8-byte NullCount | 8-byte Validity Offset | 8-byte Values Offset | 8-byte Values Length | 8-byte Aux Offset.
+Offsets are from the beginning of file, and 0 means absent. Validity is bitmap words, present only if there are nulls.
+Values: scalars as arrays of the type, nulls as 0; Bool as bitmap words; Timestamp as 8-byte nanos, and aux as 4-byte format bits;
+Str as bytes and vector as cells encoded as in DFBC, and aux as NumRows+1 8-byte offsets into values.
+Int32, Int64 and Timestamp columns of integer codecs (ColumnEncoding::FrameOfReference, Delta and DeltaOfDelta) store values as
+serialized IntBlockVector (see IntCodec.h), nulls as the previous value, and Timestamp format bits as a second FrameOfReference vector.
+
+
+Index File Layout (see DataFrameWithIndex::saveIndexes and loadIndexes):
+
+4-bytes TypeCode | 8-bytes length of the rest | 8 bytes | Column Definitions | 4 bytes    | 1-byte name length | Index Name | Index |....|
+-------------------------------------------------------------------------------------------------------------------------------------------
+DFBI             |  length (in bytes)         | NumRows | NumCols, see above | NumIndexes |  (<= 127)          |            | below |....|
+
+NumRows and Column Definitions are of the indexed DataFrame, and are verified when indexes are loaded.
 
 
 Ordered Index Layout:
@@ -37,12 +73,16 @@ Ordered Index Layout:
 --------------------------------------------------------------------------------
 IndexType | NumColumns  | Col0, Col1... | Index of First sorted fields | Index of second | .....
 
+All the NumRows row indices are saved in sorted order, so that loading doesn't sort again.
+
 
 Hash Index Layout:
 
-1 Byte        | 4-byte cols | Column indices
---------------------------------------------
-HashIndex/'H' | NumColumns  | Col0, Col1...
+1 Byte        | 4-byte cols | Column indices | 4 bytes  | 4 bytes             | 4 bytes      | .... |
+----------------------------------------------------------------------------------------------------
+HashIndex/'H' | NumColumns  | Col0, Col1...  | NumKeys  | NumRows of 1st key  | Row indices  | .... |
+
+Rows are saved by key, so that loading doesn't group rows again.
 
 **/
 
@@ -56,6 +96,7 @@ enum class IndexType : char
 };
 
 class IDataFrame;
+struct RowGroupStats;
 
 template<bool isSingleT>
 struct RecordOrFieldRef
@@ -73,6 +114,16 @@ struct RecordOrFieldRef
     const VarField &operator[]( size_t nthField ) const;
     const VarField &at( const std::string &colname ) const;
     const VarField &operator[]( const std::string &colname ) const;
+    /// \return the field if df stores cells as CompactField; nullptr otherwise.
+    const CompactField *compactAt( size_t nthField ) const;
+
+    /// \return column index of nthField in df.
+    size_t colAt( size_t nthField ) const;
+    /// \brief Same as hash_code<VarField> of nthField. Compact and columnar cells are hashed in place.
+    size_t hashAt( size_t nthField ) const;
+    /// \brief Compare nthField with the nthField of b. Rows of the same columnar df are compared in column storage.
+    bool equalAt( size_t nthField, const RecordOrFieldRef &b ) const;
+    bool lessAt( size_t nthField, const RecordOrFieldRef &b ) const;
 };
 using RowRef = RecordOrFieldRef<false>;
 
@@ -92,6 +143,18 @@ struct VectorRef
 
 using ColumnRef = VectorRef<VarField>;
 
+/// \brief Thread-local ring of VarField slots for IDataFrame implementations that don't store cells as VarField, e.g. ColumnDataFrame.
+/// Their at() fills the next slot and returns a reference to it, which stays valid until another FieldSlotCount slots are taken on the same
+/// thread. That covers the pairwise compare/hash in Indexing and Condition. Copy the field if it has to live longer.
+static constexpr size_t FieldSlotCount = 64;
+
+inline VarField &nextFieldSlot()
+{
+    thread_local std::array<VarField, FieldSlotCount> slots;
+    thread_local size_t pos = 0;
+    return slots[pos++ % FieldSlotCount];
+}
+
 ///////////////////////////////////////////////////////////////
 /// IDataFrame
 ///////////////////////////////////////////////////////////////
@@ -120,6 +183,26 @@ public:
         return false;
     }
 
+    /// \return the stored cell if the DataFrame stores cells as CompactField; nullptr otherwise.
+    /// Hash delegates use it to hash and compare cells without materializing VarField.
+    virtual const CompactField *compactAt( size_t /*irow*/, size_t /*icol*/ ) const
+    {
+        return nullptr;
+    }
+
+    /// \return the typed column storage if the DataFrame is columnar; nullptr otherwise.
+    virtual const IColumn *getColumn( size_t /*icol*/ ) const
+    {
+        return nullptr;
+    }
+
+    /// \return statistics of row groups of column icol if the DataFrame has; nullptr otherwise.
+    /// Conditions skip the row groups that can't match by statistics.
+    virtual const RowGroupStats *rowGroupStats( size_t /*icol*/ ) const
+    {
+        return nullptr;
+    }
+
     /// \return rows/records
     virtual size_t size() const
     {
@@ -352,6 +435,54 @@ const VarField &RecordOrFieldRef<isSingleT>::operator[]( const std::string &coln
     return df->at( irow, colname );
 }
 
+template<bool isSingleT>
+const CompactField *RecordOrFieldRef<isSingleT>::compactAt( size_t nthField ) const
+{
+    return df->compactAt( irow, colAt( nthField ) );
+}
+template<bool isSingleT>
+size_t RecordOrFieldRef<isSingleT>::colAt( size_t nthField ) const
+{
+    if constexpr ( isSingle )
+        return *icols;
+    else
+        return icols ? icols->at( nthField ) : nthField;
+}
+template<bool isSingleT>
+size_t RecordOrFieldRef<isSingleT>::hashAt( size_t nthField ) const
+{
+    size_t icol = colAt( nthField );
+    if ( const CompactField *p = df->compactAt( irow, icol ) )
+        return hashcode( *p );
+    if ( const IColumn *pCol = df->getColumn( icol ) )
+        return pCol->hashAt( irow );
+    return hashcode( at( nthField ) );
+}
+template<bool isSingleT>
+bool RecordOrFieldRef<isSingleT>::equalAt( size_t nthField, const RecordOrFieldRef &b ) const
+{
+    size_t icol = colAt( nthField ), jcol = b.colAt( nthField );
+    if ( df == b.df && icol == jcol )
+        if ( const IColumn *pCol = df->getColumn( icol ) )
+            return pCol->equalAt( irow, b.irow );
+    const CompactField *pa = df->compactAt( irow, icol ), *pb = pa ? b.df->compactAt( b.irow, jcol ) : nullptr;
+    if ( pa && pb )
+        return *pa == *pb;
+    return at( nthField ) == b.at( nthField );
+}
+template<bool isSingleT>
+bool RecordOrFieldRef<isSingleT>::lessAt( size_t nthField, const RecordOrFieldRef &b ) const
+{
+    size_t icol = colAt( nthField ), jcol = b.colAt( nthField );
+    if ( df == b.df && icol == jcol )
+        if ( const IColumn *pCol = df->getColumn( icol ) )
+            return pCol->lessAt( irow, b.irow );
+    const CompactField *pa = df->compactAt( irow, icol ), *pb = pa ? b.df->compactAt( b.irow, jcol ) : nullptr;
+    if ( pa && pb )
+        return *pa < *pb;
+    return at( nthField ) < b.at( nthField );
+}
+
 template<bool isSingleT>
 std::string to_string( const RecordOrFieldRef<isSingleT> &rec )
 {
@@ -363,12 +494,16 @@ std::ostream &operator<<( std::ostream &os, const RecordOrFieldRef<isSingleT> &r
     return os << to_string( rec );
 }
 
+/// \note Same as VecHash of the fields. Compact and columnar cells are hashed in place.
 template<bool isSingle>
 struct hash_code<RecordOrFieldRef<isSingle>>
 {
     size_t operator()( const RecordOrFieldRef<isSingle> &v ) const
     {
-        return VecHash()( v );
+        size_t r = hashcode( 0 );
+        for ( size_t i = 0, N = v.size(); i < N; ++i )
+            r = i == 0 ? v.hashAt( i ) : hash_combine( r, v.hashAt( i ) );
+        return r;
     }
 };
 
@@ -377,10 +512,12 @@ bool operator==( const RecordOrFieldRef<isSingle> &a, const RecordOrFieldRef<isS
 {
     if ( a.df == b.df && a.icols == b.icols && a.irow == b.irow )
         return true;
-    if constexpr ( isSingle )
-        return a.at( 0 ) == b.at( 0 );
-    else
-        return VecEqual()( a, b );
+    if ( a.size() != b.size() )
+        return false;
+    for ( size_t i = 0, N = a.size(); i < N; ++i )
+        if ( !a.equalAt( i, b ) )
+            return false;
+    return true;
 }
 template<bool isSingle>
 bool operator==( const typename RecordOrFieldRef<isSingle>::RecordType &a, const RecordOrFieldRef<isSingle> &b )
@@ -399,10 +536,15 @@ bool operator==( const RecordOrFieldRef<isSingle> &a, const typename RecordOrFie
 template<bool isSingle>
 bool operator<( const RecordOrFieldRef<isSingle> &a, const RecordOrFieldRef<isSingle> &val )
 {
-    if constexpr ( isSingle )
-        return a.at( 0 ) < val.at( 0 );
-    else
-        return VecLess()( a, val );
+    const size_t N = a.size(), M = val.size();
+    for ( size_t i = 0, L = std::min( N, M ); i < L; ++i )
+    {
+        if ( a.lessAt( i, val ) )
+            return true;
+        if ( val.lessAt( i, a ) )
+            return false;
+    }
+    return N < M;
 }
 template<bool isSingle>
 bool operator<( const RecordOrFieldRef<isSingle> &a, const typename RecordOrFieldRef<isSingle>::RecordType &val )
@@ -18,6 +18,7 @@
 #pragma once
 #include <numeric>
 #include <zj/IDataFrame.h>
+#include <zj/Column.h>
 
 namespace zj
 {
@@ -293,14 +294,19 @@ struct HashMultiIndex : public HashMultiIndexBase<FieldHashDelegate>
 
 // Positions are saved in Index.
 /// key:[rowindices]
+/// If all the columns are dictionary-encoded, rows are keyed by the combined codes, so that strings are not hashed.
 struct MultiColHashMultiIndex : public HashMultiIndexBase<MultiColFieldsHashDelegate>
 {
     ICols m_cols;
-
+    std::vector<const DictStrColumn *> m_dictCols; // not empty if indexed by codes.
+    std::vector<uint64_t> m_codeRadix; // dictionary size + 1 of each column when index is created. The last code is for null.
+    std::unordered_map<uint64_t, std::vector<size_t>> m_codeIndices; // <combined codes: [rowindices]>
 
     MultiColHashMultiIndex() = default;
-    MultiColHashMultiIndex( const MultiColHashMultiIndex &a ) : m_cols( a.m_cols )
+    MultiColHashMultiIndex( const MultiColHashMultiIndex &a )
+            : m_cols( a.m_cols ), m_dictCols( a.m_dictCols ), m_codeRadix( a.m_codeRadix ), m_codeIndices( a.m_codeIndices )
     {
+        m_isMultiValue = a.m_isMultiValue;
         m_indices = a.m_indices;
         for ( const auto &e : m_indices )
         {
@@ -308,8 +314,13 @@ struct MultiColHashMultiIndex : public HashMultiIndexBase<MultiColFieldsHashDele
             std::get<0>( const_cast<MultiColFieldsHashDelegate &>( e.first ).m_data ).icols = &m_cols;
         }
     }
-    MultiColHashMultiIndex( MultiColHashMultiIndex &&a ) : m_cols( a.m_cols )
+    MultiColHashMultiIndex( MultiColHashMultiIndex &&a )
+            : m_cols( a.m_cols )
+            , m_dictCols( std::move( a.m_dictCols ) )
+            , m_codeRadix( std::move( a.m_codeRadix ) )
+            , m_codeIndices( std::move( a.m_codeIndices ) )
     {
+        m_isMultiValue = a.m_isMultiValue;
         m_indices = std::move( a.m_indices );
         for ( const auto &e : m_indices )
         {
@@ -334,7 +345,11 @@ struct MultiColHashMultiIndex : public HashMultiIndexBase<MultiColFieldsHashDele
     void create( const IDataFrame &df, std::vector<size_t> icols )
     {
         m_indices.clear();
+        m_codeIndices.clear();
+        m_isMultiValue = false;
         m_cols = std::move( icols );
+        if ( createCodeIndex( df ) )
+            return;
         for ( auto i = 0u; i < df.size(); ++i )
         {
             MultiColFieldsHashDelegate val{MultiColFieldsHashDelegate::position_type{&df, i, &m_cols}};
@@ -348,11 +363,191 @@ struct MultiColHashMultiIndex : public HashMultiIndexBase<MultiColFieldsHashDele
     {
         create( df, df.colIndex( colNames ) );
     }
+    /// \brief Create from groups of rows with equal keys, e.g. visited by foreachGroup() and loaded from index file.
+    /// Rows are not grouped again, only the first row of each group is hashed.
+    /// Row ranges, total rows, equal keys within each group and distinct keys of groups are verified.
+    bool createFromGroups( const IDataFrame &df,
+                           std::vector<size_t> icols,
+                           std::vector<std::vector<size_t>> &&groups,
+                           std::ostream *err = nullptr )
+    {
+        m_indices.clear();
+        m_codeIndices.clear();
+        m_isMultiValue = false;
+        m_cols = std::move( icols );
+        size_t nrows = 0;
+        for ( const auto &rows : groups )
+        {
+            nrows += rows.size();
+            if ( rows.empty() )
+            {
+                if ( err )
+                    *err << "MultiColHashMultiIndex: empty group of rows.\n";
+                return false;
+            }
+            for ( auto irow : rows )
+                if ( irow >= df.size() )
+                {
+                    if ( err )
+                        *err << "MultiColHashMultiIndex: row index " << irow << " is out of range " << df.size() << ".\n";
+                    return false;
+                }
+            if ( rows.size() > 1 )
+                m_isMultiValue = true;
+        }
+        if ( nrows != df.size() )
+        {
+            if ( err )
+                *err << "MultiColHashMultiIndex: groups have " << nrows << " rows, but DataFrame has " << df.size() << ".\n";
+            return false;
+        }
+        const bool bCodes = initCodeColumns( df );
+        if ( bCodes )
+            m_codeIndices.reserve( groups.size() );
+        else
+            m_indices.reserve( groups.size() );
+        auto keyAt = [&]( size_t irow ) { return MultiColFieldsHashDelegate{MultiColFieldsHashDelegate::position_type{&df, irow, &m_cols}}; };
+        for ( auto &rows : groups )
+        {
+            const size_t first = rows.front();
+            const uint64_t codeKey = bCodes ? rowCodeKey( first ) : 0;
+            MultiColFieldsHashDelegate key = keyAt( first );
+            for ( size_t k = 1, N = rows.size(); k < N; ++k )
+            {
+                if ( bCodes ? rowCodeKey( rows[k] ) != codeKey : !( keyAt( rows[k] ) == key ) )
+                {
+                    if ( err )
+                        *err << "MultiColHashMultiIndex: key of row " << rows[k] << " differs from row " << first << " in the group.\n";
+                    m_indices.clear();
+                    m_codeIndices.clear();
+                    return false;
+                }
+            }
+            bool inserted;
+            if ( bCodes )
+                inserted = m_codeIndices.emplace( codeKey, std::move( rows ) ).second;
+            else
+                inserted = m_indices.emplace( std::move( key ), std::move( rows ) ).second;
+            if ( !inserted )
+            {
+                if ( err )
+                    *err << "MultiColHashMultiIndex: key of row " << first << " is in more than one group.\n";
+                m_indices.clear();
+                m_codeIndices.clear();
+                return false;
+            }
+        }
+        return true;
+    }
+    /// \brief Call func( const std::vector<size_t> &rows ) for rows of each key.
+    template<class Func>
+    void foreachGroup( Func &&func ) const
+    {
+        if ( isCodeIndex() )
+            for ( const auto &e : m_codeIndices )
+                func( e.second );
+        else
+            for ( const auto &e : m_indices )
+                func( e.second );
+    }
+
+    bool isCodeIndex() const
+    {
+        return !m_dictCols.empty();
+    }
+    const std::vector<size_t> *at( const Record &key ) const
+    {
+        if ( !isCodeIndex() )
+            return HashMultiIndexBase::at( key );
+        if ( auto code = codeKey( key ) )
+            if ( auto it = m_codeIndices.find( *code ); it != m_codeIndices.end() )
+                return &it->second;
+        return nullptr;
+    }
+    const std::vector<size_t> &operator[]( const Record &key ) const
+    {
+        if ( auto v = at( key ) )
+            return *v;
+        throw std::out_of_range( "MultiColHashIndex:key:" + to_string( key ) );
+    }
+    size_t size() const
+    {
+        return isCodeIndex() ? m_codeIndices.size() : m_indices.size();
+    }
+
+    /// \return the combined codes of key, or nullopt if any value is not in dictionaries when index is created.
+    std::optional<uint64_t> codeKey( const Record &key ) const
+    {
+        if ( key.size() != m_dictCols.size() )
+            return {};
+        uint64_t res = 0;
+        for ( size_t j = 0, N = m_dictCols.size(); j < N; ++j )
+        {
+            uint64_t code = m_codeRadix[j] - 1; // null
+            if ( key[j].index() != 0 )
+            {
+                auto p = std::get_if<StrField>( &key[j] );
+                if ( !p )
+                    return {};
+                auto found = m_dictCols[j]->dictionary().find( p->value );
+                if ( !found || *found >= code )
+                    return {};
+                code = *found;
+            }
+            res = res * m_codeRadix[j] + code;
+        }
+        return res;
+    }
+
+protected:
+    // index by codes if all the columns are dictionary-encoded and the combined codes fit in uint64_t.
+    bool createCodeIndex( const IDataFrame &df )
+    {
+        if ( !initCodeColumns( df ) )
+            return false;
+        for ( size_t i = 0, N = df.size(); i < N; ++i )
+        {
+            auto &mapped = m_codeIndices[rowCodeKey( i )];
+            mapped.push_back( i );
+            if ( mapped.size() > 1 )
+                m_isMultiValue = true;
+        }
+        return true;
+    }
+    // set m_dictCols and m_codeRadix if all the columns are dictionary-encoded and the combined codes fit in uint64_t.
+    bool initCodeColumns( const IDataFrame &df )
+    {
+        m_dictCols.clear();
+        m_codeRadix.clear();
+        uint64_t keySpace = 1;
+        for ( auto icol : m_cols )
+        {
+            auto pCol = dynamic_cast<const DictStrColumn *>( df.getColumn( icol ) );
+            uint64_t radix = pCol ? pCol->dictionary().size() + 1 : 0;
+            if ( !pCol || keySpace > std::numeric_limits<uint64_t>::max() / radix )
+            {
+                m_dictCols.clear();
+                m_codeRadix.clear();
+                return false;
+            }
+            keySpace *= radix;
+            m_dictCols.push_back( pCol );
+            m_codeRadix.push_back( radix );
+        }
+        return isCodeIndex();
+    }
+    uint64_t rowCodeKey( size_t irow ) const
+    {
+        uint64_t key = 0;
+        for ( size_t j = 0, ncols = m_dictCols.size(); j < ncols; ++j )
+            key = key * m_codeRadix[j] + ( m_dictCols[j]->isNull( irow ) ? m_codeRadix[j] - 1 : m_dictCols[j]->codeAt( irow ) );
+        return key;
+    }
 };
 
 inline std::string to_string( const MultiColHashMultiIndex &val )
 {
-    return to_string( val.m_indices );
+    return val.isCodeIndex() ? to_string( val.m_codeIndices ) : to_string( val.m_indices );
 }
 
 
@@ -423,6 +618,57 @@ public:
         m_bReverseOrder = bReverseOrder;
         sortRows(); // if it's already sorted. may not need to sort again.
     }
+    /// \brief Create from rows already in index order, e.g. getRowIndices() loaded from index file, without sorting again.
+    /// sortedRows are verified to be a permutation of rows of df in the order of icols.
+    bool createFromSorted( const IDataFrame &df,
+                           std::conditional_t<isSingleCol, size_t, std::vector<size_t>> icols,
+                           bool bReverseOrder,
+                           std::vector<Rowindex> &&sortedRows,
+                           std::ostream *err = nullptr )
+    {
+        const size_t nrows = df.countRows();
+        if ( sortedRows.size() != nrows )
+        {
+            if ( err )
+                *err << "OrderedIndex: number of rows " << sortedRows.size() << " doesn't match DataFrame rows " << nrows << ".\n";
+            return false;
+        }
+        Bitmap seen( nrows );
+        for ( auto irow : sortedRows )
+        {
+            if ( irow >= nrows || seen.test( irow ) )
+            {
+                if ( err )
+                    *err << "OrderedIndex: row index " << irow << " is out of range or duplicate.\n";
+                return false;
+            }
+            seen.set( irow );
+        }
+        const LessThan less{&df, &icols, bReverseOrder};
+        for ( size_t i = 1; i < nrows; ++i )
+        {
+            if ( less( sortedRows[i], sortedRows[i - 1] ) )
+            {
+                if ( err )
+                    *err << "OrderedIndex: row " << sortedRows[i] << " is out of order after row " << sortedRows[i - 1] << ".\n";
+                return false;
+            }
+        }
+        m_pDataFrame = &df;
+        m_cols = std::move( icols );
+        m_indices = std::move( sortedRows );
+        m_bReverseOrder = bReverseOrder;
+        return true;
+    }
+
+    const ColsType &getCols() const
+    {
+        return m_cols;
+    }
+    bool isReverseOrder() const
+    {
+        return m_bReverseOrder;
+    }
 
     const std::vector<Rowindex> &getRowIndices() const
     {
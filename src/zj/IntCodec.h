@@ -0,0 +1,377 @@
+/*
+ * This file is part of the ftl (Fast Template Library) distribution (https://github.com/zjgoggle/ftl).
+ * Copyright (c) 2020 Jack Zhang.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace zj
+{
+
+///////////////////////////////////////////////////////////////
+/// Block codecs of 64-bit integers: frame-of-reference, delta and delta-of-delta, each bit-packed per block.
+///////////////////////////////////////////////////////////////
+
+enum class IntCodec : uint8_t
+{
+    FrameOfReference = 0, // value - min of block. For bounded ints, e.g. quantities and enums.
+    Delta, // difference from the previous value. For ascending or slowly changing ints, e.g. sequence numbers.
+    DeltaOfDelta, // difference of consecutive deltas. For values of regular intervals, e.g. timestamps.
+};
+
+/// \return number of bits to represent v.
+inline unsigned bit_width_u64( uint64_t v )
+{
+    return v ? 64 - unsigned( __builtin_clzll( v ) ) : 0;
+}
+
+/// \brief Append n values of width bits each to words, in little-endian bit order. Values must be less than 2^width.
+inline void bitpack_append( const uint64_t *vals, size_t n, unsigned width, std::vector<uint64_t> &words )
+{
+    if ( !width )
+        return;
+    const size_t start = words.size();
+    words.resize( start + ( n * width + 63 ) / 64, 0 );
+    uint64_t *out = words.data() + start;
+    for ( size_t i = 0, bitpos = 0; i < n; ++i, bitpos += width )
+    {
+        const size_t iw = bitpos / 64, ib = bitpos % 64;
+        out[iw] |= vals[i] << ib;
+        if ( ib + width > 64 )
+            out[iw + 1] |= vals[i] >> ( 64 - ib );
+    }
+}
+/// \return value i packed by bitpack_append.
+inline uint64_t bitunpack_at( const uint64_t *in, size_t i, unsigned width )
+{
+    if ( !width )
+        return 0;
+    const size_t bitpos = i * width, iw = bitpos / 64, ib = bitpos % 64;
+    uint64_t v = in[iw] >> ib;
+    if ( ib + width > 64 )
+        v |= in[iw + 1] << ( 64 - ib );
+    return width == 64 ? v : v & ( ( uint64_t( 1 ) << width ) - 1 );
+}
+/// \brief Unpack n values packed by bitpack_append.
+inline void bitunpack( const uint64_t *in, size_t n, unsigned width, uint64_t *out )
+{
+    if ( !width )
+    {
+        std::fill( out, out + n, uint64_t( 0 ) );
+        return;
+    }
+    const uint64_t mask = width == 64 ? ~uint64_t( 0 ) : ( uint64_t( 1 ) << width ) - 1;
+    for ( size_t i = 0, bitpos = 0; i < n; ++i, bitpos += width )
+    {
+        const size_t iw = bitpos / 64, ib = bitpos % 64;
+        uint64_t v = in[iw] >> ib;
+        if ( ib + width > 64 )
+            v |= in[iw + 1] << ( 64 - ib );
+        out[i] = v & mask;
+    }
+}
+
+/**
+ * @brief Vector of int64_t encoded in blocks of BlockSize values. Appended values are kept raw until a block is full.
+ * Block Layout (64-bit words): Count (low 32 bits) and Width (high 32 bits) | Reference | First Value (Delta and DeltaOfDelta)
+ *   | First Delta (DeltaOfDelta) | Residuals bit-packed in Width bits.
+ * Residuals are the values, deltas or deltas of deltas, minus Reference, their minimum. Arithmetic wraps around, so any int64 is
+ * encoded losslessly. Random access decodes a single residual for FrameOfReference, or a prefix of the block for the others.
+ * Serialized Layout (64-bit words): Codec | Size | NumBlocks | NumBlocks+1 block offsets in words | Blocks. The last block may be
+ * partial. A serialized vector can be borrowed without copying, e.g. from a file mapping, and is read-only.
+ */
+class IntBlockVector
+{
+public:
+    using value_type = int64_t;
+    static constexpr size_t BlockSize = 128;
+
+protected:
+    IntCodec m_codec = IntCodec::FrameOfReference;
+    size_t m_size = 0;
+    std::vector<uint64_t> m_words; // encoded full blocks.
+    std::vector<uint64_t> m_offsets = {0}; // begin of each encoded block, and end of the last one.
+    std::vector<int64_t> m_tail; // values of the last partial block, not encoded yet.
+
+    // borrowed serialized blocks.
+    const uint64_t *m_borrowedWords = nullptr, *m_borrowedOffsets = nullptr;
+    size_t m_borrowedBlocks = 0;
+    std::shared_ptr<const void> m_keepAlive;
+    bool m_borrowed = false;
+
+public:
+    explicit IntBlockVector( IntCodec codec = IntCodec::FrameOfReference ) : m_codec( codec )
+    {
+    }
+
+    IntCodec codec() const
+    {
+        return m_codec;
+    }
+    size_t size() const
+    {
+        return m_size;
+    }
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+    bool isBorrowed() const
+    {
+        return m_borrowed;
+    }
+    size_t countBlocks() const
+    {
+        return ( m_size + BlockSize - 1 ) / BlockSize;
+    }
+    /// \return bytes of encoded blocks and raw values.
+    size_t encodedBytes() const
+    {
+        if ( m_borrowed )
+            return m_borrowedOffsets[m_borrowedBlocks] * sizeof( uint64_t );
+        return m_words.size() * sizeof( uint64_t ) + m_tail.size() * sizeof( int64_t );
+    }
+
+    /// \brief Decode block iblock into out, which has room for BlockSize values.
+    /// \return number of values in block.
+    size_t decodeBlock( size_t iblock, int64_t *out ) const
+    {
+        if ( iblock < countEncodedBlocks() )
+            return decode_block( m_codec, blockWords( iblock ), out );
+        std::copy( m_tail.begin(), m_tail.end(), out );
+        return m_tail.size();
+    }
+    /// \brief Decode blocks one by one into a buffer of BlockSize values and call func( const int64_t *values, size_t n, size_t ibegin ).
+    template<class Func>
+    void foreachBlock( Func &&func ) const
+    {
+        int64_t buf[BlockSize];
+        for ( size_t iblock = 0, nblocks = countBlocks(); iblock < nblocks; ++iblock )
+            func( static_cast<const int64_t *>( buf ), decodeBlock( iblock, buf ), iblock * BlockSize );
+    }
+    int64_t operator[]( size_t i ) const
+    {
+        const size_t iblock = i / BlockSize, j = i % BlockSize;
+        if ( iblock >= countEncodedBlocks() )
+            return m_tail[j];
+        const uint64_t *blk = blockWords( iblock );
+        if ( m_codec == IntCodec::FrameOfReference )
+            return int64_t( blk[1] + bitunpack_at( blk + headerWords( m_codec ), j, unsigned( blk[0] >> 32 ) ) );
+        int64_t buf[BlockSize];
+        decode_block( m_codec, blk, buf );
+        return buf[j];
+    }
+
+    void push_back( int64_t val )
+    {
+        checkWritable();
+        m_tail.push_back( val );
+        ++m_size;
+        if ( m_tail.size() == BlockSize )
+        {
+            encode_block( m_codec, m_tail.data(), m_tail.size(), m_words );
+            m_offsets.push_back( m_words.size() );
+            m_tail.clear();
+        }
+    }
+    /// \brief Remove the trailing values so that size() == n. The block containing n is decoded into raw values.
+    void truncate( size_t n )
+    {
+        checkWritable();
+        if ( n >= m_size )
+            return;
+        const size_t iblock = n / BlockSize;
+        if ( iblock < countEncodedBlocks() )
+        {
+            int64_t buf[BlockSize];
+            decodeBlock( iblock, buf );
+            m_tail.assign( buf, buf + n % BlockSize );
+            m_words.resize( m_offsets[iblock] );
+            m_offsets.resize( iblock + 1 );
+        }
+        else
+            m_tail.resize( n % BlockSize );
+        m_size = n;
+    }
+    void clear()
+    {
+        *this = IntBlockVector( m_codec );
+    }
+
+    /// \brief Append serialized layout to out. The raw values are encoded as the last partial block.
+    void serialize( std::vector<uint64_t> &out ) const
+    {
+        const size_t nEncoded = countEncodedBlocks(), nblocks = countBlocks();
+        const uint64_t *offsets = m_borrowed ? m_borrowedOffsets : m_offsets.data();
+        const uint64_t *words = m_borrowed ? m_borrowedWords : m_words.data();
+        out.push_back( uint64_t( m_codec ) );
+        out.push_back( m_size );
+        out.push_back( nblocks );
+        out.insert( out.end(), offsets, offsets + nEncoded + 1 );
+        std::vector<uint64_t> tailWords;
+        if ( nblocks > nEncoded )
+        {
+            encode_block( m_codec, m_tail.data(), m_tail.size(), tailWords );
+            out.push_back( offsets[nEncoded] + tailWords.size() );
+        }
+        out.insert( out.end(), words, words + offsets[nEncoded] );
+        out.insert( out.end(), tailWords.begin(), tailWords.end() );
+    }
+    /// \brief Borrow the serialized layout at data of nwords words without copying. keepAlive holds the memory of data.
+    /// \param nread number of words of the layout.
+    /// \return false if the layout is invalid.
+    bool borrow( const uint64_t *data, size_t nwords, std::shared_ptr<const void> keepAlive, size_t &nread )
+    {
+        if ( nwords < 3 || data[0] > uint64_t( IntCodec::DeltaOfDelta ) || data[1] > std::numeric_limits<uint64_t>::max() - BlockSize )
+            return false;
+        const IntCodec codec = IntCodec( data[0] );
+        const size_t size = data[1], nblocks = data[2];
+        if ( nblocks != ( size + BlockSize - 1 ) / BlockSize || nblocks >= nwords - 3 )
+            return false;
+        const uint64_t *offsets = data + 3, *words = offsets + nblocks + 1;
+        const size_t maxWords = nwords - 3 - ( nblocks + 1 );
+        if ( offsets[0] != 0 || offsets[nblocks] > maxWords )
+            return false;
+        for ( size_t iblock = 0; iblock < nblocks; ++iblock )
+        {
+            const uint64_t begin = offsets[iblock], end = offsets[iblock + 1];
+            if ( end < begin || end > offsets[nblocks] || end - begin < headerWords( codec ) )
+                return false;
+            const uint64_t count = words[begin] & 0xffffffff, width = words[begin] >> 32;
+            const size_t nresiduals = count - std::min( count, leadingValues( codec ) );
+            if ( count != std::min( BlockSize, size - iblock * BlockSize ) || width > 64 ||
+                 end - begin < headerWords( codec ) + ( nresiduals * width + 63 ) / 64 )
+                return false;
+        }
+        *this = IntBlockVector( codec );
+        m_size = size;
+        m_borrowedWords = words;
+        m_borrowedOffsets = offsets;
+        m_borrowedBlocks = nblocks;
+        m_keepAlive = std::move( keepAlive );
+        m_borrowed = true;
+        nread = 3 + nblocks + 1 + offsets[nblocks];
+        return true;
+    }
+
+    /// \return number of values stored in the block header rather than as residuals.
+    static constexpr size_t leadingValues( IntCodec codec )
+    {
+        return codec == IntCodec::FrameOfReference ? 0 : codec == IntCodec::Delta ? 1 : 2;
+    }
+    static constexpr size_t headerWords( IntCodec codec )
+    {
+        return 2 + leadingValues( codec );
+    }
+
+    /// \brief Append the encoded block of n (<= BlockSize) values to words.
+    static void encode_block( IntCodec codec, const int64_t *vals, size_t n, std::vector<uint64_t> &words )
+    {
+        const auto *u = reinterpret_cast<const uint64_t *>( vals );
+        const size_t nlead = std::min( n, leadingValues( codec ) );
+        uint64_t residuals[BlockSize];
+        size_t m = 0;
+        for ( size_t i = nlead; i < n; ++i )
+        {
+            if ( codec == IntCodec::FrameOfReference )
+                residuals[m++] = u[i];
+            else if ( codec == IntCodec::Delta )
+                residuals[m++] = u[i] - u[i - 1];
+            else
+                residuals[m++] = ( u[i] - u[i - 1] ) - ( u[i - 1] - u[i - 2] );
+        }
+        int64_t ref = m ? std::numeric_limits<int64_t>::max() : 0;
+        for ( size_t i = 0; i < m; ++i )
+            ref = std::min( ref, int64_t( residuals[i] ) );
+        uint64_t bits = 0;
+        for ( size_t i = 0; i < m; ++i )
+        {
+            residuals[i] -= uint64_t( ref );
+            bits |= residuals[i];
+        }
+        const unsigned width = bit_width_u64( bits );
+
+        words.push_back( uint64_t( n ) | uint64_t( width ) << 32 );
+        words.push_back( uint64_t( ref ) );
+        if ( codec != IntCodec::FrameOfReference )
+            words.push_back( n ? u[0] : 0 );
+        if ( codec == IntCodec::DeltaOfDelta )
+            words.push_back( n > 1 ? u[1] - u[0] : 0 );
+        bitpack_append( residuals, m, width, words );
+    }
+    /// \brief Decode the block encoded by encode_block into out.
+    /// \return number of values in block.
+    static size_t decode_block( IntCodec codec, const uint64_t *blk, int64_t *out )
+    {
+        const size_t n = blk[0] & 0xffffffff;
+        const unsigned width = unsigned( blk[0] >> 32 );
+        const uint64_t ref = blk[1];
+        const size_t nlead = std::min( n, leadingValues( codec ) );
+        uint64_t residuals[BlockSize];
+        bitunpack( blk + headerWords( codec ), n - nlead, width, residuals );
+        if ( codec == IntCodec::FrameOfReference )
+        {
+            for ( size_t i = 0; i < n; ++i )
+                out[i] = int64_t( ref + residuals[i] );
+        }
+        else if ( codec == IntCodec::Delta )
+        {
+            uint64_t v = blk[2];
+            for ( size_t i = 0; i < n; ++i )
+            {
+                if ( i )
+                    v += ref + residuals[i - 1];
+                out[i] = int64_t( v );
+            }
+        }
+        else
+        {
+            uint64_t v = blk[2], delta = blk[3];
+            for ( size_t i = 0; i < n; ++i )
+            {
+                if ( i >= 2 )
+                    delta += ref + residuals[i - 2];
+                if ( i )
+                    v += delta;
+                out[i] = int64_t( v );
+            }
+        }
+        return n;
+    }
+
+protected:
+    size_t countEncodedBlocks() const
+    {
+        return m_borrowed ? m_borrowedBlocks : m_offsets.size() - 1;
+    }
+    const uint64_t *blockWords( size_t iblock ) const
+    {
+        return m_borrowed ? m_borrowedWords + m_borrowedOffsets[iblock] : m_words.data() + m_offsets[iblock];
+    }
+    void checkWritable() const
+    {
+        if ( m_borrowed )
+            throw std::logic_error( "IntBlockVector is borrowed and read-only!" );
+    }
+};
+
+} // namespace zj
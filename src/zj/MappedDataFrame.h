@@ -0,0 +1,723 @@
+/*
+ * This file is part of the ftl (Fast Template Library) distribution (https://github.com/zjgoggle/ftl).
+ * Copyright (c) 2020 Jack Zhang.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <zj/IDataFrame.h>
+#include <zj/Column.h>
+#include <zj/BinaryIO.h>
+#include <zj/RowGroupStats.h>
+#include <zj/MappedFile.h>
+#include <mutex>
+#include <sstream>
+
+namespace zj
+{
+
+///////////////////////////////////////////////////////////////
+/// DFBM memory-mapped columnar DataFrame (see "Mapped DataFrame Layout" in IDataFrame.h).
+///////////////////////////////////////////////////////////////
+
+static constexpr char DFBM_TypeCode[4] = {'D', 'F', 'B', 'M'};
+static constexpr uint32_t DFBM_Version = 2; // version 2 adds row group statistics.
+
+/// \brief Column sections in DFBM. Offsets are from the beginning of file, and 0 means the section is absent.
+struct MappedColumnEntry
+{
+    uint64_t nullCount = 0;
+    uint64_t validityOffset = 0; // validity bitmap words; absent if there is no null.
+    uint64_t valuesOffset = 0;
+    uint64_t valuesBytes = 0;
+    uint64_t auxOffset = 0; // NumRows+1 byte offsets of Str and vector cells, or NumRows format bits of Timestamp.
+};
+
+/// \brief Read-only column whose values are read straight from the mapping of DFBM. Scalars are arrays of T, Bool is packed in
+/// bitmap, Timestamp is nanos and format bits, Str and vector cells are bytes indexed by offsets. Vector cells are encoded as in DFBC.
+template<class T>
+class MappedColumn : public IColumn
+{
+public:
+    using value_type = T;
+    using field_type = FieldValue<T>;
+    /// Stored as a contiguous array of T, so that values() is available.
+    static constexpr bool is_plain = !field_type::is_vec && !std::is_same_v<T, Str> && !std::is_same_v<T, bool> &&
+                                     !std::is_same_v<T, Timestamp> && !std::is_same_v<T, Null>;
+
+protected:
+    struct LazyValidity
+    {
+        std::once_flag once;
+        Bitmap bits;
+    };
+    std::shared_ptr<const MappedFile> m_file; // keeps mapping alive.
+    size_t m_size = 0;
+    size_t m_nullCount = 0;
+    const uint64_t *m_validityWords = nullptr;
+    const char *m_values = nullptr;
+    size_t m_valuesBytes = 0;
+    const char *m_aux = nullptr;
+    std::shared_ptr<LazyValidity> m_validity = std::make_shared<LazyValidity>(); // copied from mapping when validity() is called.
+
+public:
+    MappedColumn( std::shared_ptr<const MappedFile> file, size_t nrows, const MappedColumnEntry &entry )
+            : m_file( std::move( file ) ), m_size( nrows ), m_nullCount( entry.nullCount ), m_valuesBytes( entry.valuesBytes )
+    {
+        const char *base = m_file->data();
+        if ( entry.validityOffset )
+            m_validityWords = reinterpret_cast<const uint64_t *>( base + entry.validityOffset );
+        m_values = base + entry.valuesOffset;
+        if ( entry.auxOffset )
+            m_aux = base + entry.auxOffset;
+    }
+
+    /// \return false if the sections of entry are not in file.
+    static bool validate( const MappedFile &file, size_t nrows, const MappedColumnEntry &entry )
+    {
+        const uint64_t nwords = ( nrows + Bitmap::WordBits - 1 ) / Bitmap::WordBits;
+        if ( entry.nullCount > nrows || ( entry.nullCount && !file.contains( entry.validityOffset, nwords * sizeof( uint64_t ), 8 ) ) )
+            return false;
+        if ( !file.contains( entry.valuesOffset, entry.valuesBytes, 8 ) )
+            return false;
+        if constexpr ( std::is_same_v<T, bool> )
+            return entry.valuesBytes == nwords * sizeof( uint64_t );
+        else if constexpr ( std::is_same_v<T, Timestamp> )
+            return entry.valuesBytes == nrows * sizeof( int64_t ) && file.contains( entry.auxOffset, nrows * sizeof( uint32_t ), 8 );
+        else if constexpr ( is_plain )
+            return entry.valuesBytes == nrows * sizeof( T );
+        else
+            return file.contains( entry.auxOffset, ( nrows + 1 ) * sizeof( uint64_t ), 8 );
+    }
+
+    FieldTypeTag typeTag() const override
+    {
+        return field_type::type;
+    }
+    size_t size() const override
+    {
+        return m_size;
+    }
+    bool isNull( size_t irow ) const override
+    {
+        return m_validityWords && !( m_validityWords[irow / Bitmap::WordBits] >> ( irow % Bitmap::WordBits ) & 1 );
+    }
+    size_t countNulls() const override
+    {
+        return m_nullCount;
+    }
+    const Bitmap *validity() const override
+    {
+        if ( !m_validityWords )
+            return nullptr;
+        std::call_once( m_validity->once, [this] {
+            m_validity->bits.resize( m_size );
+            auto &words = m_validity->bits.words();
+            std::memcpy( words.data(), m_validityWords, words.size() * sizeof( uint64_t ) );
+        } );
+        return &m_validity->bits;
+    }
+    const void *plainValues() const override
+    {
+        return is_plain ? m_values : nullptr;
+    }
+    /// \brief Values in mapping. Null elements hold default value.
+    VecView<T> values() const
+    {
+        static_assert( is_plain, "values() is only for scalars stored as array!" );
+        return VecView<T>( reinterpret_cast<const T *>( m_values ), m_size );
+    }
+    /// \return T for scalars and Timestamp, std::string_view into mapping for Str, and decoded std::vector for vector types.
+    auto valueAt( size_t irow ) const
+    {
+        if constexpr ( is_plain )
+            return reinterpret_cast<const T *>( m_values )[irow];
+        else if constexpr ( std::is_same_v<T, bool> )
+            return bool( reinterpret_cast<const uint64_t *>( m_values )[irow / Bitmap::WordBits] >> ( irow % Bitmap::WordBits ) & 1 );
+        else if constexpr ( std::is_same_v<T, Timestamp> )
+            return Timestamp::fromFormatBits( reinterpret_cast<const int64_t *>( m_values )[irow],
+                                              reinterpret_cast<const uint32_t *>( m_aux )[irow] );
+        else if constexpr ( std::is_same_v<T, Str> )
+        {
+            auto [p, n] = cellBytes( irow );
+            return std::string_view( p, n );
+        }
+        else
+        {
+            auto [p, n] = cellBytes( irow );
+            T vec;
+            BinaryReader r( p, n );
+            if constexpr ( !std::is_same_v<T, Null> )
+                if ( !read_binary_value( r, vec ) )
+                    throw std::runtime_error( "MappedColumn: corrupt vector cell at row " + std::to_string( irow ) );
+            return vec;
+        }
+    }
+
+    void get( size_t irow, VarField &var ) const override
+    {
+        if constexpr ( std::is_same_v<T, Null> )
+            var = NullField{};
+        else if ( isNull( irow ) )
+            var = NullField{};
+        else if ( auto p = std::get_if<field_type>( &var ) )
+            p->value = valueAt( irow );
+        else
+            var.template emplace<field_type>( field_type{T( valueAt( irow ) )} );
+    }
+    bool append( const VarField & ) override
+    {
+        return false;
+    }
+    bool appendStr( std::string_view ) override
+    {
+        return false;
+    }
+    void appendNull() override
+    {
+        throw std::logic_error( "MappedColumn is read-only!" );
+    }
+
+    size_t hashAt( size_t irow ) const override
+    {
+        if constexpr ( std::is_same_v<T, Null> )
+            return hashcode( Null{} );
+        else if constexpr ( std::is_same_v<T, Str> )
+            return isNull( irow ) ? hashcode( Null{} ) : std::hash<std::string_view>()( valueAt( irow ) );
+        else
+            return isNull( irow ) ? hashcode( Null{} ) : hashcode( valueAt( irow ) );
+    }
+    bool equalAt( size_t irow, size_t jrow ) const override
+    {
+        bool nullI = isNull( irow ), nullJ = isNull( jrow );
+        if ( nullI || nullJ )
+            return nullI && nullJ;
+        if constexpr ( std::is_same_v<T, Null> )
+            return true;
+        else
+            return valueAt( irow ) == valueAt( jrow );
+    }
+    bool lessAt( size_t irow, size_t jrow ) const override
+    {
+        bool nullI = isNull( irow ), nullJ = isNull( jrow );
+        if ( nullI || nullJ )
+            return nullI && !nullJ;
+        if constexpr ( std::is_same_v<T, Null> )
+            return false;
+        else
+            return valueAt( irow ) < valueAt( jrow );
+    }
+
+    void truncate( size_t n ) override
+    {
+        if ( n < m_size )
+            throw std::logic_error( "MappedColumn is read-only!" );
+    }
+    void reserve( size_t ) override
+    {
+    }
+    IColumn *clone() const override
+    {
+        return new MappedColumn( *this );
+    }
+
+protected:
+    std::pair<const char *, size_t> cellBytes( size_t irow ) const
+    {
+        const auto *offsets = reinterpret_cast<const uint64_t *>( m_aux );
+        uint64_t begin = offsets[irow], end = offsets[irow + 1];
+        if ( begin > end || end > m_valuesBytes )
+            throw std::runtime_error( "MappedColumn: corrupt offsets at row " + std::to_string( irow ) );
+        return {m_values + begin, size_t( end - begin )};
+    }
+};
+
+// invoked by static_invoke_for_type with column type. Writes the sections of column icol and fills entry.
+struct WriteMappedColumn
+{
+    static void alignPage( BinaryWriter &w )
+    {
+        static const char zeros[MappedPageSize] = {};
+        if ( auto n = w.bytesWritten() % MappedPageSize )
+            w.putBytes( zeros, MappedPageSize - n );
+    }
+    // write the serialized IntBlockVector of values, and of format bits for Timestamp.
+    // return false if column type T doesn't support integer codecs.
+    template<class T, class FieldAt>
+    static bool writeEncoded( BinaryWriter &w, size_t nrows, IntCodec codec, FieldAt &&fieldAt )
+    {
+        if constexpr ( std::is_same_v<T, int32_t> || std::is_same_v<T, int64_t> || std::is_same_v<T, Timestamp> )
+        {
+            EncodedIntColumn<T> col( codec );
+            for ( size_t i = 0; i < nrows; ++i )
+            {
+                if ( auto p = fieldAt( i ) )
+                    col.push_back( *p );
+                else
+                    col.appendNull();
+            }
+            std::vector<uint64_t> words;
+            col.encodedValues().serialize( words );
+            if constexpr ( std::is_same_v<T, Timestamp> )
+                col.encodedFormatBits().serialize( words );
+            w.putBytes( words.data(), words.size() * sizeof( uint64_t ) );
+            return true;
+        }
+        else
+            return false;
+    }
+
+    template<class T>
+    void invoke( BinaryWriter &w, const IDataFrame &df, size_t icol, MappedColumnEntry &entry ) const
+    {
+        const size_t nrows = df.countRows();
+        Bitmap validity( nrows, true );
+        // return nullptr for null. The field is short-lived (see nextFieldSlot), and so is the converted value.
+        T converted{};
+        auto fieldAt = [&]( size_t irow ) -> const T * {
+            if ( auto p = field_value_as( df.at( irow, icol ), converted ) )
+                return p;
+            validity.set( irow, false );
+            ++entry.nullCount;
+            return nullptr;
+        };
+
+        alignPage( w );
+        entry.valuesOffset = w.bytesWritten();
+        const auto codec = int_codec_of( df.columnDef( icol ).encoding );
+        if ( codec && writeEncoded<T>( w, nrows, *codec, fieldAt ) )
+        {
+        }
+        else if constexpr ( std::is_same_v<T, bool> )
+        {
+            Bitmap bits( nrows );
+            for ( size_t i = 0; i < nrows; ++i )
+                if ( auto p = fieldAt( i ) )
+                    bits.set( i, *p );
+            w.putBytes( bits.words().data(), bits.words().size() * sizeof( uint64_t ) );
+        }
+        else if constexpr ( std::is_same_v<T, Timestamp> )
+        {
+            std::vector<uint32_t> formatBits( nrows );
+            for ( size_t i = 0; i < nrows; ++i )
+            {
+                auto p = fieldAt( i );
+                w.put( p ? p->nanos : int64_t( 0 ) );
+                formatBits[i] = p ? p->formatBits() : 0;
+            }
+            entry.valuesBytes = w.bytesWritten() - entry.valuesOffset;
+            alignPage( w );
+            entry.auxOffset = w.bytesWritten();
+            w.putBytes( formatBits.data(), formatBits.size() * sizeof( uint32_t ) );
+        }
+        else if constexpr ( MappedColumn<T>::is_plain )
+        {
+            for ( size_t i = 0; i < nrows; ++i )
+            {
+                auto p = fieldAt( i );
+                w.put( p ? *p : T{} );
+            }
+        }
+        else // Str and vector cells.
+        {
+            std::vector<uint64_t> offsets( 1, 0 );
+            offsets.reserve( nrows + 1 );
+            for ( size_t i = 0; i < nrows; ++i )
+            {
+                if constexpr ( std::is_same_v<T, Str> )
+                {
+                    if ( auto p = fieldAt( i ) )
+                        w.putBytes( p->data(), p->size() );
+                }
+                else if constexpr ( !std::is_same_v<T, Null> )
+                {
+                    if ( auto p = fieldAt( i ) )
+                        write_binary_value( w, *p );
+                }
+                else
+                    fieldAt( i );
+                offsets.push_back( w.bytesWritten() - entry.valuesOffset );
+            }
+            entry.valuesBytes = offsets.back();
+            alignPage( w );
+            entry.auxOffset = w.bytesWritten();
+            w.putBytes( offsets.data(), offsets.size() * sizeof( uint64_t ) );
+        }
+        if ( !entry.valuesBytes && !entry.auxOffset )
+            entry.valuesBytes = w.bytesWritten() - entry.valuesOffset;
+        if ( entry.nullCount )
+        {
+            alignPage( w );
+            entry.validityOffset = w.bytesWritten();
+            w.putBytes( validity.words().data(), validity.words().size() * sizeof( uint64_t ) );
+        }
+    }
+};
+
+// invoked by static_invoke_for_type with column type.
+struct CreateMappedColumn
+{
+    /// \return nullptr if the sections are invalid.
+    template<class T>
+    IColumn *invoke( const std::shared_ptr<const MappedFile> &file, size_t nrows, const MappedColumnEntry &entry, ColumnEncoding encoding ) const
+    {
+        if ( auto codec = int_codec_of( encoding ) )
+            return createEncoded<T>( file, nrows, entry, *codec );
+        if ( !MappedColumn<T>::validate( *file, nrows, entry ) )
+            return nullptr;
+        return new MappedColumn<T>( file, nrows, entry );
+    }
+
+protected:
+    // borrow the serialized IntBlockVectors from mapping. Validity is copied.
+    template<class T>
+    static IColumn *createEncoded( const std::shared_ptr<const MappedFile> &file, size_t nrows, const MappedColumnEntry &entry, IntCodec codec )
+    {
+        if constexpr ( std::is_same_v<T, int32_t> || std::is_same_v<T, int64_t> || std::is_same_v<T, Timestamp> )
+        {
+            const uint64_t nwords = ( nrows + Bitmap::WordBits - 1 ) / Bitmap::WordBits;
+            if ( entry.nullCount > nrows || ( entry.nullCount && !file->contains( entry.validityOffset, nwords * sizeof( uint64_t ), 8 ) ) )
+                return nullptr;
+            if ( !file->contains( entry.valuesOffset, entry.valuesBytes, 8 ) || entry.valuesBytes % sizeof( uint64_t ) )
+                return nullptr;
+            const auto *words = reinterpret_cast<const uint64_t *>( file->data() + entry.valuesOffset );
+            const size_t nvaluesWords = entry.valuesBytes / sizeof( uint64_t );
+            size_t nread = 0, nreadBits = 0;
+            IntBlockVector values, formatBits;
+            if ( !values.borrow( words, nvaluesWords, file, nread ) || values.size() != nrows || values.codec() != codec )
+                return nullptr;
+            if constexpr ( std::is_same_v<T, Timestamp> )
+                if ( !formatBits.borrow( words + nread, nvaluesWords - nread, file, nreadBits ) || formatBits.size() != nrows )
+                    return nullptr;
+            Bitmap validity;
+            if ( entry.nullCount )
+            {
+                validity.resize( nrows );
+                std::memcpy( validity.words().data(), file->data() + entry.validityOffset, nwords * sizeof( uint64_t ) );
+                validity.resize( nrows ); // clear the bits beyond nrows.
+                if ( nrows - validity.count() != entry.nullCount )
+                    return nullptr;
+            }
+            return new EncodedIntColumn<T>( std::move( values ), std::move( formatBits ), std::move( validity ) );
+        }
+        else
+            return nullptr;
+    }
+};
+
+/// \brief Write df as DFBM, in which each column is stored contiguously and aligned to pages, so that it can be opened by
+/// MappedDataFrame without deserializing.
+/// Statistics of each row group of rowGroupSize rows are saved in directory, by which conditions skip row groups. 0 for no statistics.
+/// \pre os is at the beginning of a file and seekable. Open file streams in binary mode.
+inline bool save_mapped( const IDataFrame &df, std::ostream &os, size_t rowGroupSize, std::ostream *err = nullptr )
+{
+    const size_t nrows = df.countRows(), ncols = df.countCols();
+    const auto startPos = os.tellp();
+    if ( startPos != 0 )
+    {
+        if ( err )
+            *err << "save_mapped: output stream is not at the beginning of a file.\n";
+        return false;
+    }
+    for ( size_t icol = 0; icol < ncols; ++icol )
+    {
+        const auto &colDef = df.columnDef( icol );
+        if ( int_codec_of( colDef.encoding ) && !is_int_codec_type( colDef.colTypeTag ) )
+        {
+            if ( err )
+                *err << "save_mapped: Integer codec expects Int32, Int64 or Timestamp column: " << colDef.colName << ".\n";
+            return false;
+        }
+    }
+    uint64_t dirOffset = 0;
+    {
+        BinaryWriter w( os );
+        w.putBytes( DFBM_TypeCode, sizeof( DFBM_TypeCode ) );
+        w.put( DFBM_Version );
+        w.put( uint64_t( 0 ) ); // directory offset, written at last.
+        std::vector<MappedColumnEntry> entries( ncols );
+        for ( size_t icol = 0; icol < ncols; ++icol )
+            static_invoke_for_type( df.columnDef( icol ).colTypeTag, WriteMappedColumn(), w, df, icol, entries[icol] );
+        dirOffset = w.bytesWritten();
+        w.put( uint64_t( nrows ) );
+        if ( !write_binary_column_defs( w, df, err ) )
+            return false;
+        for ( const auto &entry : entries )
+            w.put( entry );
+        w.put( uint64_t( rowGroupSize ) );
+        for ( size_t icol = 0; icol < ncols && rowGroupSize; ++icol )
+            write_binary_row_group_stats( w, compute_row_group_stats( df, icol, rowGroupSize ) );
+        if ( !w.flush() )
+        {
+            if ( err )
+                *err << "save_mapped: failed to write.\n";
+            return false;
+        }
+    }
+    os.seekp( sizeof( DFBM_TypeCode ) + sizeof( DFBM_Version ) );
+    os.write( reinterpret_cast<const char *>( &dirOffset ), sizeof( dirOffset ) );
+    os.seekp( 0, std::ios::end );
+    if ( !os.good() )
+    {
+        if ( err )
+            *err << "save_mapped: failed to write directory offset.\n";
+        return false;
+    }
+    return true;
+}
+inline bool save_mapped( const IDataFrame &df, std::ostream &os, std::ostream *err = nullptr )
+{
+    return save_mapped( df, os, RowGroupStats::DefaultRowGroupSize, err );
+}
+inline bool save_mapped( const IDataFrame &df, const std::string &filename, size_t rowGroupSize, std::ostream *err = nullptr )
+{
+    std::ofstream ofs( filename, std::ios::binary | std::ios::trunc );
+    if ( !ofs )
+    {
+        if ( err )
+            *err << "save_mapped: failed to open file: " << filename << ".\n";
+        return false;
+    }
+    return save_mapped( df, ofs, rowGroupSize, err );
+}
+inline bool save_mapped( const IDataFrame &df, const std::string &filename, std::ostream *err = nullptr )
+{
+    return save_mapped( df, filename, RowGroupStats::DefaultRowGroupSize, err );
+}
+
+/**
+ * @brief Read-only columnar DataFrame over the memory mapping of a DFBM file written by save_mapped.
+ * Opening reads only the directory at the end of file. Cells are read straight from the mapping, so pages of a column are faulted in
+ * only when the column is accessed, and the pages are shared by all the processes mapping the same file. Conditions skip the row groups
+ * that can't match by rowGroupStats(), so that their pages are not touched.
+ * at() materializes the cell into a thread-local field slot (see nextFieldSlot). Use mappedColumn() to read values without VarField.
+ * Columns of integer codecs are EncodedIntColumn borrowing the encoded blocks from the mapping, and are decoded block by block.
+ * Copies share the same mapping.
+ */
+class MappedDataFrame : public IDataFrame
+{
+protected:
+    std::shared_ptr<const MappedFile> m_file;
+    std::vector<ColumnDef> m_columnDefs;
+    std::vector<MappedColumnEntry> m_entries;
+    std::vector<RowGroupStats> m_stats; // empty if there is no statistics.
+    std::vector<IColumnPtr> m_columns;
+    size_t m_nrows = 0;
+
+    std::unordered_map<std::string, size_t> m_columnNames; // <name: index>
+
+public:
+    MappedDataFrame() = default;
+    explicit MappedDataFrame( const std::string &filename )
+    {
+        std::stringstream err;
+        if ( !open( filename, &err ) )
+            throw std::runtime_error( "Failed to open MappedDataFrame: " + err.str() );
+    }
+    MappedDataFrame( const MappedDataFrame &a )
+            : m_file( a.m_file )
+            , m_columnDefs( a.m_columnDefs )
+            , m_entries( a.m_entries )
+            , m_stats( a.m_stats )
+            , m_nrows( a.m_nrows )
+            , m_columnNames( a.m_columnNames )
+    {
+        for ( const auto &col : a.m_columns )
+            m_columns.emplace_back( col->clone() );
+    }
+    MappedDataFrame( MappedDataFrame &&a ) = default;
+    MappedDataFrame &operator=( const MappedDataFrame &a )
+    {
+        if ( this != &a )
+        {
+            MappedDataFrame tmp( a );
+            *this = std::move( tmp );
+        }
+        return *this;
+    }
+    MappedDataFrame &operator=( MappedDataFrame &&a ) = default;
+    ~MappedDataFrame() override = default;
+
+    /// \brief Map a DFBM file. Only the header and directory are read.
+    bool open( const std::string &filename, std::ostream *err = nullptr )
+    {
+        clear();
+        auto file = std::make_shared<MappedFile>();
+        if ( !file->open( filename, err ) )
+            return false;
+        constexpr size_t headerSize = sizeof( DFBM_TypeCode ) + sizeof( DFBM_Version ) + sizeof( uint64_t );
+        uint32_t version = 0;
+        uint64_t dirOffset = 0;
+        BinaryReader header( file->data(), file->size() );
+        const char *code = nullptr;
+        if ( !header.getBytes( sizeof( DFBM_TypeCode ), code ) || std::memcmp( code, DFBM_TypeCode, sizeof( DFBM_TypeCode ) ) != 0 ||
+             !header.get( version ) || !header.get( dirOffset ) )
+            return fail( err, "not a DFBM file: " + filename );
+        if ( version == 0 || version > DFBM_Version )
+            return fail( err, "unsupported version: " + std::to_string( version ) );
+        if ( dirOffset < headerSize || !file->contains( dirOffset, 0 ) )
+            return fail( err, "invalid directory offset: " + std::to_string( dirOffset ) );
+
+        BinaryReader r( file->data() + dirOffset, file->size() - dirOffset );
+        uint64_t nrows = 0;
+        if ( !r.get( nrows ) || !read_binary_column_defs( r, m_columnDefs, err ) )
+            return fail( err, "invalid directory" );
+        m_entries.resize( m_columnDefs.size() );
+        for ( auto &entry : m_entries )
+            if ( !r.get( entry ) )
+                return fail( err, "failed to read column entries" );
+        if ( version >= 2 )
+        {
+            uint64_t rowGroupSize = 0;
+            if ( !r.get( rowGroupSize ) )
+                return fail( err, "failed to read row group size" );
+            m_stats.resize( rowGroupSize ? m_columnDefs.size() : 0 );
+            for ( auto &stats : m_stats )
+                if ( !read_binary_row_group_stats( r, nrows, rowGroupSize, stats ) )
+                    return fail( err, "failed to read row group statistics" );
+        }
+        m_nrows = nrows;
+        m_file = std::move( file );
+        for ( size_t icol = 0, ncols = m_columnDefs.size(); icol < ncols; ++icol )
+        {
+            IColumn *pCol = static_invoke_for_type( m_columnDefs[icol].colTypeTag,
+                                                    CreateMappedColumn(),
+                                                    m_file,
+                                                    m_nrows,
+                                                    m_entries[icol],
+                                                    m_columnDefs[icol].encoding );
+            if ( !pCol )
+                return fail( err, "invalid sections of column " + m_columnDefs[icol].colName );
+            m_columns.emplace_back( pCol );
+        }
+        createColumnIndex();
+        return true;
+    }
+    /// \brief Unmap the file if it's not shared by copies.
+    void clear()
+    {
+        m_columnDefs.clear();
+        m_entries.clear();
+        m_stats.clear();
+        m_columns.clear();
+        m_columnNames.clear();
+        m_file.reset();
+        m_nrows = 0;
+    }
+
+    /// \brief Hint the kernel to read ahead the pages of column icol, e.g. before a full scan.
+    void willNeed( size_t icol ) const
+    {
+        const MappedColumnEntry &entry = m_entries.at( icol );
+        m_file->willNeed( entry.valuesOffset, entry.valuesBytes );
+        if ( entry.auxOffset )
+            m_file->willNeed( entry.auxOffset, ( m_nrows + 1 ) * sizeof( uint64_t ) );
+    }
+
+    IDataFrame *deepCopy() const override
+    {
+        return new MappedDataFrame( *this );
+    }
+    const RowGroupStats *rowGroupStats( size_t icol ) const override
+    {
+        return m_stats.empty() ? nullptr : &m_stats.at( icol );
+    }
+
+    size_t countRows() const override
+    {
+        return m_nrows;
+    }
+    size_t countCols() const override
+    {
+        return m_columnDefs.size();
+    }
+    const VarField &at( size_t irow, size_t icol ) const override
+    {
+        if ( icol >= countCols() )
+            throw std::out_of_range( "icol our of range: " + to_string( icol ) + " >= " + to_string( m_columnDefs.size() ) );
+        if ( irow >= countRows() )
+            throw std::out_of_range( "irow our of range: " + to_string( irow ) + " >= " + to_string( countRows() ) );
+        VarField &slot = nextFieldSlot();
+        m_columns[icol]->get( irow, slot );
+        return slot;
+    }
+    const VarField &at( size_t irow, const std::string &col ) const override
+    {
+        return at( irow, colIndex( col ) );
+    }
+    const VarField &operator()( size_t irow, size_t icol ) const
+    {
+        return at( irow, icol );
+    }
+    const VarField &operator()( size_t irow, const std::string &col ) const
+    {
+        return at( irow, col );
+    }
+
+    const IColumn *getColumn( size_t icol ) const override
+    {
+        return m_columns.at( icol ).get();
+    }
+    const IColumn &column( size_t icol ) const
+    {
+        return *m_columns.at( icol );
+    }
+    /// \return nullptr if the column type is not T.
+    template<class T>
+    const MappedColumn<T> *mappedColumn( size_t icol ) const
+    {
+        return dynamic_cast<const MappedColumn<T> *>( m_columns.at( icol ).get() );
+    }
+
+    const ColumnDef &columnDef( size_t icol ) const override
+    {
+        if ( icol >= m_columnDefs.size() )
+        {
+            throw std::out_of_range( "icol our of range: " + to_string( icol ) + " >= " + to_string( m_columnDefs.size() ) );
+        }
+        return m_columnDefs[icol];
+    }
+    const ColumnDef &columnDef( const std::string &colName ) const override
+    {
+        return m_columnDefs.at( colIndex( colName ) );
+    }
+    const std::string &colName( size_t icol ) const override
+    {
+        return m_columnDefs[icol].colName;
+    }
+    size_t colIndex( const std::string &colName ) const override
+    {
+        if ( auto it = m_columnNames.find( colName ); it != m_columnNames.end() )
+            return it->second;
+        throw std::out_of_range( "Failed to find DataFrame column name:" + colName );
+    }
+
+protected:
+    void createColumnIndex()
+    {
+        m_columnNames.clear();
+        for ( size_t i = 0, N = m_columnDefs.size(); i < N; ++i )
+            m_columnNames[m_columnDefs[i].colName] = i;
+    }
+    bool fail( std::ostream *err, const std::string &msg )
+    {
+        clear();
+        if ( err )
+            *err << "MappedDataFrame: " << msg << ".\n";
+        return false;
+    }
+};
+
+} // namespace zj
@@ -0,0 +1,123 @@
+/*
+ * This file is part of the ftl (Fast Template Library) distribution (https://github.com/zjgoggle/ftl).
+ * Copyright (c) 2020 Jack Zhang.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace zj
+{
+
+static constexpr size_t MappedPageSize = 4096; // DFBM column sections are aligned to pages so that columns don't share pages.
+
+/// \brief Read-only memory mapping of a whole file. Pages are shared by all the processes mapping the same file.
+class MappedFile
+{
+protected:
+    const char *m_data = nullptr;
+    size_t m_size = 0;
+
+public:
+    MappedFile() = default;
+    MappedFile( const MappedFile & ) = delete;
+    MappedFile &operator=( const MappedFile & ) = delete;
+    ~MappedFile()
+    {
+        close();
+    }
+
+    /// \return true if filename is an empty regular file, which can't be mapped.
+    static bool isEmptyFile( const std::string &filename )
+    {
+        struct stat st;
+        return ::stat( filename.c_str(), &st ) == 0 && S_ISREG( st.st_mode ) && st.st_size == 0;
+    }
+
+    bool open( const std::string &filename, std::ostream *err = nullptr )
+    {
+        close();
+        int fd = ::open( filename.c_str(), O_RDONLY );
+        if ( fd < 0 )
+        {
+            if ( err )
+                *err << "MappedFile: failed to open file: " << filename << ".\n";
+            return false;
+        }
+        struct stat st;
+        if ( ::fstat( fd, &st ) != 0 || st.st_size == 0 )
+        {
+            ::close( fd );
+            if ( err )
+                *err << "MappedFile: empty file or failed to stat: " << filename << ".\n";
+            return false;
+        }
+        void *p = ::mmap( nullptr, size_t( st.st_size ), PROT_READ, MAP_SHARED, fd, 0 );
+        ::close( fd ); // the mapping is kept after closing fd.
+        if ( p == MAP_FAILED )
+        {
+            if ( err )
+                *err << "MappedFile: failed to map file: " << filename << ".\n";
+            return false;
+        }
+        m_data = static_cast<const char *>( p );
+        m_size = size_t( st.st_size );
+        return true;
+    }
+    void close()
+    {
+        if ( m_data )
+            ::munmap( const_cast<char *>( m_data ), m_size );
+        m_data = nullptr;
+        m_size = 0;
+    }
+    const char *data() const
+    {
+        return m_data;
+    }
+    size_t size() const
+    {
+        return m_size;
+    }
+    /// \return true if [offset, offset + n) is in file and offset is aligned to align.
+    bool contains( uint64_t offset, uint64_t n, size_t align = 1 ) const
+    {
+        return offset % align == 0 && offset <= m_size && n <= m_size - offset;
+    }
+    /// \brief Hint the kernel to read ahead [offset, offset + n).
+    void willNeed( uint64_t offset, uint64_t n ) const
+    {
+        if ( !m_data || !n )
+            return;
+        uint64_t begin = offset / MappedPageSize * MappedPageSize;
+        ::madvise( const_cast<char *>( m_data ) + begin, std::min<uint64_t>( offset + n, m_size ) - begin, MADV_WILLNEED );
+    }
+    /// \brief Hint the kernel to read ahead aggressively and drop pages behind, e.g. for a single pass of parsing.
+    void adviseSequential() const
+    {
+        if ( m_data )
+            ::madvise( const_cast<char *>( m_data ), m_size, MADV_SEQUENTIAL );
+    }
+};
+
+} // namespace zj
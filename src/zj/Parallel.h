@@ -0,0 +1,73 @@
+/*
+ * This file is part of the ftl (Fast Template Library) distribution (https://github.com/zjgoggle/ftl).
+ * Copyright (c) 2020 Jack Zhang.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace zj
+{
+
+/// \return nthreads, or the number of hardware threads if nthreads is 0.
+inline size_t resolve_threads( size_t nthreads )
+{
+    return nthreads ? nthreads : std::max<size_t>( 1, std::thread::hardware_concurrency() );
+}
+
+/// \brief Call func( i ) for each i in [0, n) on up to nthreads threads, including the calling thread. 0 for hardware threads.
+/// Indices are taken in ascending order by idle threads, so that uneven tasks are balanced.
+/// \throw the first exception thrown by func, after all threads finish. The indices not taken yet are skipped.
+template<class Func>
+void parallel_for( size_t n, size_t nthreads, Func &&func )
+{
+    nthreads = std::min( resolve_threads( nthreads ), n );
+    std::atomic<size_t> next{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    auto work = [&] {
+        for ( size_t i; !failed.load( std::memory_order_relaxed ) && ( i = next.fetch_add( 1 ) ) < n; )
+        {
+            try
+            {
+                func( i );
+            }
+            catch ( ... )
+            {
+                std::lock_guard<std::mutex> lock( errorMutex );
+                if ( !error )
+                    error = std::current_exception();
+                failed = true;
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for ( size_t i = 1; i < nthreads; ++i )
+        threads.emplace_back( work );
+    work();
+    for ( auto &t : threads )
+        t.join();
+    if ( error )
+        std::rethrow_exception( error );
+}
+
+} // namespace zj
@@ -0,0 +1,307 @@
+/*
+ * This file is part of the ftl (Fast Template Library) distribution (https://github.com/zjgoggle/ftl).
+ * Copyright (c) 2020 Jack Zhang.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <zj/ColumnDataFrame.h>
+#include <zj/Parallel.h>
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <sstream>
+
+namespace zj
+{
+
+/// \brief Match name against pattern, where '*' matches any characters and '?' matches one character.
+inline bool match_wildcard( std::string_view pattern, std::string_view name )
+{
+    size_t p = 0, n = 0, starP = std::string_view::npos, starN = 0;
+    while ( n < name.size() )
+    {
+        if ( p < pattern.size() && ( pattern[p] == '?' || pattern[p] == name[n] ) )
+            ++p, ++n;
+        else if ( p < pattern.size() && pattern[p] == '*' )
+            starP = p++, starN = n;
+        else if ( starP != std::string_view::npos )
+            p = starP + 1, n = ++starN;
+        else
+            return false;
+    }
+    while ( p < pattern.size() && pattern[p] == '*' )
+        ++p;
+    return p == pattern.size();
+}
+
+/// \brief List regular files matching pattern, e.g. "data/trades_*.csv", in sorted order. Wildcards are only allowed in the file name.
+/// \return false if the directory of pattern can't be listed.
+inline bool glob_files( const std::string &pattern, std::vector<std::string> &filenames, std::ostream *err = nullptr )
+{
+    namespace fs = std::filesystem;
+    const fs::path path( pattern );
+    const fs::path dir = path.has_parent_path() ? path.parent_path() : fs::path( "." );
+    const std::string namePattern = path.filename().string();
+    std::error_code ec;
+    filenames.clear();
+    for ( fs::directory_iterator it( dir, ec ), end; !ec && it != end; it.increment( ec ) )
+    {
+        if ( it->is_regular_file( ec ) && match_wildcard( namePattern, it->path().filename().string() ) )
+            filenames.push_back( ( path.has_parent_path() ? it->path() : it->path().filename() ).string() );
+    }
+    if ( ec )
+    {
+        if ( err )
+            *err << "glob_files: Failed to list " << dir << ": " << ec.message() << ".\n";
+        return false;
+    }
+    std::sort( filenames.begin(), filenames.end() );
+    return true;
+}
+
+/// \brief Error of a file that failed to load.
+struct CsvFileError
+{
+    std::string filename;
+    std::string message;
+};
+
+/**
+ * @brief DataFrame of partitions which have the same columns, e.g. one partition per daily file. Partitions are shared, not copied.
+ * Rows are numbered through partitions in order; at() finds the partition of a row by binary search over partition ends.
+ */
+class PartitionedDataFrame : public IDataFrame
+{
+protected:
+    std::vector<ColumnDef> m_columnDefs;
+    std::unordered_map<std::string, size_t> m_columnNames; // <name: index>
+
+    std::vector<IDataFramePtr> m_partitions;
+    std::vector<std::string> m_partitionNames;
+    std::vector<size_t> m_rowEnds; // m_rowEnds[i] is the end row of partition i.
+
+public:
+    PartitionedDataFrame() = default;
+
+    /// \brief Clear partitions and set columns, which partitions must have.
+    void create( const ColumnDefs &columnDefs )
+    {
+        clear();
+        m_columnDefs = columnDefs;
+        for ( size_t i = 0, N = m_columnDefs.size(); i < N; ++i )
+            m_columnNames[m_columnDefs[i].colName] = i;
+    }
+
+    /// \brief Append a partition. Columns are taken from the first partition if create() is not called.
+    /// \return false if the column names or types of df are different.
+    bool addPartition( IDataFramePtr df, const std::string &name = {}, std::ostream *err = nullptr )
+    {
+        if ( m_columnDefs.empty() && m_partitions.empty() )
+        {
+            ColumnDefs columnDefs;
+            for ( size_t i = 0, ncols = df->countCols(); i < ncols; ++i )
+                columnDefs.push_back( df->columnDef( i ) );
+            create( columnDefs );
+        }
+        if ( df->countCols() != countCols() )
+        {
+            if ( err )
+                *err << "addPartition: " << name << " has " << df->countCols() << " columns, expected " << countCols() << ".\n";
+            return false;
+        }
+        for ( size_t i = 0, ncols = countCols(); i < ncols; ++i )
+        {
+            const auto &colDef = df->columnDef( i );
+            if ( colDef.colName != m_columnDefs[i].colName || colDef.colTypeTag != m_columnDefs[i].colTypeTag )
+            {
+                if ( err )
+                    *err << "addPartition: " << name << " column " << i << " " << colDef.colName << ":" << typeName( colDef.colTypeTag )
+                         << " doesn't match " << m_columnDefs[i].colName << ":" << typeName( m_columnDefs[i].colTypeTag ) << ".\n";
+                return false;
+            }
+        }
+        m_rowEnds.push_back( countRows() + df->countRows() );
+        m_partitions.push_back( std::move( df ) );
+        m_partitionNames.push_back( name );
+        return true;
+    }
+
+    /// \brief Read csv files into partitions, one ColumnDataFrame per file in the order of filenames. Files are read concurrently
+    /// on nthreads threads (0 for hardware threads), each by ColumnDataFrame::read_csv_file.
+    /// \return false if any file fails. A failed file has no partition, and its error is added to errors; the other files are loaded.
+    bool read_csv_files( const std::vector<std::string> &filenames,
+                         const ColumnDefs &columnDefs,
+                         const CsvOptions &opts = {},
+                         size_t nthreads = 0,
+                         std::vector<CsvFileError> *errors = nullptr )
+    {
+        create( columnDefs );
+        std::vector<std::shared_ptr<ColumnDataFrame>> dfs( filenames.size() );
+        std::vector<std::string> messages( filenames.size() );
+        parallel_for( filenames.size(), nthreads, [&]( size_t i ) {
+            auto df = std::make_shared<ColumnDataFrame>();
+            std::stringstream err;
+            try
+            {
+                if ( df->read_csv_file( filenames[i], columnDefs, opts, &err ) )
+                    dfs[i] = std::move( df );
+            }
+            catch ( const std::exception &e )
+            {
+                err << e.what();
+            }
+            if ( !dfs[i] )
+                messages[i] = err.str().empty() ? "Failed to read csv." : err.str();
+        } );
+        bool ok = true;
+        for ( size_t i = 0; i < filenames.size(); ++i )
+        {
+            if ( dfs[i] )
+                addPartition( std::move( dfs[i] ), filenames[i] );
+            else
+            {
+                ok = false;
+                if ( errors )
+                    errors->push_back( CsvFileError{filenames[i], std::move( messages[i] )} );
+            }
+        }
+        return ok;
+    }
+    /// \brief Read csv files matching pattern (see glob_files). It fails if no file matches.
+    bool read_csv_glob( const std::string &pattern,
+                        const ColumnDefs &columnDefs,
+                        const CsvOptions &opts = {},
+                        size_t nthreads = 0,
+                        std::vector<CsvFileError> *errors = nullptr )
+    {
+        std::vector<std::string> filenames;
+        std::stringstream err;
+        if ( !glob_files( pattern, filenames, &err ) || filenames.empty() )
+        {
+            create( columnDefs );
+            if ( errors )
+                errors->push_back( CsvFileError{pattern, filenames.empty() && err.str().empty() ? "No file matches." : err.str()} );
+            return false;
+        }
+        return read_csv_files( filenames, columnDefs, opts, nthreads, errors );
+    }
+
+    size_t countPartitions() const
+    {
+        return m_partitions.size();
+    }
+    const IDataFrame &partition( size_t ipart ) const
+    {
+        return *m_partitions.at( ipart );
+    }
+    const std::string &partitionName( size_t ipart ) const
+    {
+        return m_partitionNames.at( ipart );
+    }
+    /// \return first row of partition ipart.
+    size_t partitionBegin( size_t ipart ) const
+    {
+        return ipart ? m_rowEnds.at( ipart - 1 ) : 0;
+    }
+    /// \return <partition, row in partition> of irow.
+    std::array<size_t, 2> partitionPos( size_t irow ) const
+    {
+        if ( irow >= countRows() )
+            throw std::out_of_range( "irow our of range: " + to_string( irow ) + " >= " + to_string( countRows() ) );
+        const size_t ipart = size_t( std::upper_bound( m_rowEnds.begin(), m_rowEnds.end(), irow ) - m_rowEnds.begin() );
+        return {ipart, irow - partitionBegin( ipart )};
+    }
+
+    /// \brief Copy all partitions into a ColumnDataFrame.
+    IDataFrame *deepCopy() const override
+    {
+        auto res = new ColumnDataFrame();
+        res->create( m_columnDefs );
+        for ( const auto &part : m_partitions )
+            res->append( *part );
+        return res;
+    }
+
+    size_t countRows() const override
+    {
+        return m_rowEnds.empty() ? 0 : m_rowEnds.back();
+    }
+    size_t countCols() const override
+    {
+        return m_columnDefs.size();
+    }
+    const VarField &at( size_t irow, size_t icol ) const override
+    {
+        auto [ipart, row] = partitionPos( irow );
+        return m_partitions[ipart]->at( row, icol );
+    }
+    const VarField &at( size_t irow, const std::string &col ) const override
+    {
+        return at( irow, colIndex( col ) );
+    }
+    const VarField &operator()( size_t irow, size_t icol ) const
+    {
+        return at( irow, icol );
+    }
+    const VarField &operator()( size_t irow, const std::string &col ) const
+    {
+        return at( irow, col );
+    }
+    const CompactField *compactAt( size_t irow, size_t icol ) const override
+    {
+        auto [ipart, row] = partitionPos( irow );
+        return m_partitions[ipart]->compactAt( row, icol );
+    }
+    /// \return the column of the only partition; nullptr if there are multiple partitions, whose columns are separate.
+    const IColumn *getColumn( size_t icol ) const override
+    {
+        return m_partitions.size() == 1 ? m_partitions[0]->getColumn( icol ) : nullptr;
+    }
+
+    const ColumnDef &columnDef( size_t icol ) const override
+    {
+        if ( icol >= m_columnDefs.size() )
+            throw std::out_of_range( "icol our of range: " + to_string( icol ) + " >= " + to_string( m_columnDefs.size() ) );
+        return m_columnDefs[icol];
+    }
+    const ColumnDef &columnDef( const std::string &colName ) const override
+    {
+        return m_columnDefs.at( colIndex( colName ) );
+    }
+    const std::string &colName( size_t icol ) const override
+    {
+        return m_columnDefs[icol].colName;
+    }
+    size_t colIndex( const std::string &colName ) const override
+    {
+        if ( auto it = m_columnNames.find( colName ); it != m_columnNames.end() )
+            return it->second;
+        throw std::out_of_range( "Failed to find DataFrame column name:" + colName );
+    }
+
+    /// \brief clear partitions and columns.
+    void clear()
+    {
+        m_columnDefs.clear();
+        m_columnNames.clear();
+        m_partitions.clear();
+        m_partitionNames.clear();
+        m_rowEnds.clear();
+    }
+};
+
+} // namespace zj
@@ -17,185 +17,961 @@
 
 #pragma once
 
+#include <zj/MappedFile.h>
+#include <zj/Parallel.h>
+#include <zj/SimdScan.h>
+#include <array>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <functional>
+#include <fstream>
+#include <memory>
+#include <iterator>
+#include <cctype>
 #include <climits>
+#include <cstring>
+#include <stdexcept>
 
 namespace zj
 {
 
-/// \brief Read csv rows.
-/// Throw runtime_error if number of column varies on rows.
-/// param RecordFilter: bool rowFilter(std::vector<std::string>& rec). return false to skip current row, true to add it to result.
-inline std::vector<std::vector<std::string>> read_csv_strings( std::istream &is,
-                                                               char sep = ',',
-                                                               size_t skipLines = 0,
-                                                               size_t readMaxRecords = ULLONG_MAX,
-                                                               std::function<bool( std::vector<std::string> & )> rowFilter = nullptr,
-                                                               char commentChar = 0,
-                                                               const char *quotes = "\"\"" )
+///////////////////////////////////////////////////////////////
+/// CSV tokenizer over a buffer, i.e. a file mapping or blocks read from stream.
+///////////////////////////////////////////////////////////////
+
+struct CsvOptions
 {
-    std::vector<std::vector<std::string>> rows;
-    int iLine = 0;
+    char sep = ',';
+    size_t skipLines = 0; // number of lines skipped before the first record.
+    char commentChar = 0; // a field starting with commentChar skips the rest of line. 0 for no comment.
+    const char *quotes = "\"\""; // open and close quote chars. nullptr for no quoting.
+    bool newlineInQuotes = false; // quoted fields may span lines. Otherwise, newline in quotes is an error.
+    std::vector<size_t> columns; // indices of projected columns in the order of fields. Empty for all columns. See select_csv_columns.
+    // RFC 4180 style: a separator always starts a field, e.g. "a,b,\n" has 3 fields and "x\t\ty" of sep '\t' has 3 fields.
+    // Otherwise, as read_csv_strings always did, a trailing separator doesn't start a field, and runs of a whitespace sep are one separator.
+    bool sepStartsField = false;
+};
 
-    auto skipLine = [&] { // return false if EOF
-        for ( int c; is.good() && ( c = is.get() ) != EOF; )
-            if ( c == '\n' )
-            {
-                ++iLine;
-                return true;
-            }
-        return false;
+/// \return the chars that end unquoted and quoted fields: sep, newline, quotes and backslash.
+inline ByteSet csv_structural_chars( const CsvOptions &opts )
+{
+    ByteSet set{opts.sep, '\n', '\\'};
+    if ( opts.quotes )
+    {
+        set.add( opts.quotes[0] );
+        set.add( opts.quotes[1] );
+    }
+    return set;
+}
+
+/// \brief Advance p to the first structural char at or after p for which stop( char ) is true, or to end.
+/// Only the structural chars found by scanner are tested.
+template<class Stop>
+const char *find_structural( StructuralScanner &scanner, const char *p, const char *end, Stop &&stop )
+{
+    for ( p = scanner.next( p ); p < end && !stop( *p ); p = scanner.next( p + 1 ) )
+        continue;
+    return p;
+}
+
+/**
+ * @brief Split records of CSV into fields of std::string_view, which point into the input buffer unless a quoted field has escaped chars.
+ * Leading and trailing spaces of fields are trimmed. A separator between fields starts a new field, which may be empty, e.g. "a,,b" has
+ * 3 fields. Unless CsvOptions::sepStartsField, a separator at the end of line doesn't start a field, and runs of a whitespace separator,
+ * e.g. spaces or tabs aligning columns, are one separator.
+ * A quoted field can't span lines unless CsvOptions::newlineInQuotes. In a quoted field, "\n" is unescaped as newline, "\"" as quote,
+ * and other backslashes are kept.
+ * Lines of no field, i.e. blank or comment lines, are skipped.
+ * Fields are delimited by the structural chars found by SIMD scans (see StructuralScanner), rather than by testing every char.
+ * If CsvOptions::columns is set, fields() holds only the projected fields in its order. The other fields are delimited without being
+ * trimmed or unescaped. A record missing projected columns has only the present ones.
+ */
+class CsvTokenizer
+{
+public:
+    enum class Status
+    {
+        Record, // fields() holds the record.
+        NeedMore, // the record is incomplete. Call again with more input from the same position.
+        End, // no more record.
     };
-    auto trimRight = []( const std::string &s ) {
-        int i = int( s.length() ) - 1;
-        for ( ; i >= 0 && isspace( s[i] ); --i )
-            continue;
-        return s.substr( 0, i + 1 );
+
+protected:
+    struct Span
+    {
+        const char *data; // nullptr if it's in m_unescaped.
+        size_t offset, len; // offset into m_unescaped.
+        size_t ifield;
     };
-    for ( auto i = 0u; i < skipLines; ++i )
+    CsvOptions m_opts;
+    ByteSet m_structural;
+    MatchMaskFunc m_matchMask = match_mask_func();
+    size_t m_linesToSkip = 0;
+    size_t m_lineNo = 0; // number of lines consumed.
+    std::vector<int> m_slots; // position in fields() of each projected field index, or -1. Empty for no projection.
+    size_t m_numFields = 0; // number of fields of the last record, including the ones not projected.
+    std::vector<Span> m_spans;
+    std::string m_unescaped;
+    std::vector<std::string_view> m_fields;
+
+public:
+    explicit CsvTokenizer( const CsvOptions &opts = {} )
+            : m_opts( opts ), m_structural( csv_structural_chars( opts ) ), m_linesToSkip( opts.skipLines )
+    {
+        for ( size_t i = 0; i < opts.columns.size(); ++i )
+        {
+            if ( opts.columns[i] >= m_slots.size() )
+                m_slots.resize( opts.columns[i] + 1, -1 );
+            m_slots[opts.columns[i]] = int( i );
+        }
+    }
+
+    /// \brief Fields of the last record. Valid until next() is called or the input buffer is changed.
+    const std::vector<std::string_view> &fields() const
     {
-        if ( !skipLine() )
-            return {};
+        return m_fields;
     }
-    while ( is.good() )
+    /// \return number of lines consumed.
+    size_t lineNumber() const
     {
-        std::vector<std::string> row;
-        bool endOfLine = false, endOfFile = false;
-        while ( !endOfLine && !endOfFile ) // loop until endOfLine or endOfFile
+        return m_lineNo;
+    }
+
+    /// \brief Tokenize the next record in [p, end), and advance p past it.
+    /// \param eof true if end is the end of input. Otherwise, NeedMore is returned for an incomplete record, and p points to its beginning.
+    /// \throw std::runtime_error if a quoted field is not closed, or is followed by non-space chars.
+    Status next( const char *&p, const char *end, bool eof )
+    {
+        for ( ; m_linesToSkip; --m_linesToSkip, ++m_lineNo )
         {
-            int c;
-            //- skip the spaces
-            while ( is.good() ) // skip spaces.
+            const char *nl = find_newline( p, end );
+            if ( !nl )
             {
-                c = is.get();
-                if ( c == EOF )
-                {
-                    endOfFile = true;
-                    endOfLine = true;
-                }
-                if ( c == '\n' )
-                {
-                    endOfLine = true;
-                    ++iLine;
-                    break;
-                }
-                if ( isspace( c ) )
-                    continue;
-                if ( commentChar && c == commentChar )
-                {
-                    if ( !skipLine() )
-                        endOfFile = true;
-                    endOfLine = true;
-                }
-                break;
+                if ( !eof )
+                    return Status::NeedMore;
+                p = end;
+                return Status::End;
             }
-            if ( endOfLine )
-                break;
-            if ( quotes && c == quotes[0] ) // start quotes, is able to handle  escaped char "\n", "\"".
+            p = nl + 1;
+        }
+        while ( true )
+        {
+            if ( p == end )
+                return eof ? Status::End : Status::NeedMore;
+            Status status = parseRecord( p, end, eof );
+            if ( status != Status::Record || m_numFields )
+                return status;
+        }
+    }
+
+protected:
+    static bool is_space( char c )
+    {
+        return std::isspace( static_cast<unsigned char>( c ) );
+    }
+    std::runtime_error error( const std::string &msg, size_t lines ) const
+    {
+        return std::runtime_error( msg + " at line: " + std::to_string( m_lineNo + lines ) );
+    }
+    static const char *find_newline( const char *p, const char *end )
+    {
+        return p == end ? nullptr : static_cast<const char *>( std::memchr( p, '\n', size_t( end - p ) ) );
+    }
+    bool projected( size_t ifield ) const
+    {
+        return m_slots.empty() || ( ifield < m_slots.size() && m_slots[ifield] >= 0 );
+    }
+    void pushField( const char *begin, const char *end )
+    {
+        if ( projected( m_numFields ) )
+            m_spans.push_back( Span{begin, 0, size_t( end - begin ), m_numFields} );
+        ++m_numFields;
+    }
+    Status finishRecord( const char *&p, const char *next, size_t lines )
+    {
+        p = next;
+        m_lineNo += lines;
+        m_fields.clear();
+        if ( m_slots.empty() )
+        {
+            for ( const auto &span : m_spans )
+                m_fields.emplace_back( span.data ? span.data : m_unescaped.data() + span.offset, span.len );
+            return Status::Record;
+        }
+        m_fields.resize( m_opts.columns.size() ); // missing fields are default string_view of nullptr data.
+        for ( const auto &span : m_spans )
+            m_fields[size_t( m_slots[span.ifield] )] = std::string_view( span.data ? span.data : m_unescaped.data() + span.offset, span.len );
+        m_fields.erase( std::remove_if( m_fields.begin(), m_fields.end(), []( std::string_view f ) { return f.data() == nullptr; } ),
+                        m_fields.end() );
+        return Status::Record;
+    }
+
+    // p != end.
+    Status parseRecord( const char *&p, const char *end, bool eof )
+    {
+        const char sep = m_opts.sep, *quotes = m_opts.quotes;
+        const bool collapseSep = !m_opts.sepStartsField && is_space( sep ); // leading spaces of a field include separators.
+        const char *q = p;
+        size_t lines = 0;
+        bool afterSep = false;
+        StructuralScanner scanner( end, m_structural, m_matchMask );
+        m_spans.clear();
+        m_unescaped.clear();
+        m_numFields = 0;
+        while ( true )
+        {
+            while ( q < end && *q != '\n' && ( *q != sep || collapseSep ) && is_space( *q ) ) // skip leading spaces.
+                ++q;
+            if ( q == end || *q == '\n' )
             {
-                std::string s;
-                while ( true )
-                {
-                    if ( !is.good() )
-                        throw std::runtime_error( "EOF while Reading quoted string:" + s + " at line: " + std::to_string( iLine ) );
-                    c = is.get();
-                    if ( c == '\\' && is.good() ) // escaped char
-                    {
-                        auto x = is.get();
-                        if ( x == 'n' )
-                            s += '\n';
-                        else if ( x == '\"' )
-                            s += '\"';
-                        else
-                        {
-                            s += char( c );
-                            s += char( x );
-                        }
-                    }
-                    else if ( c == quotes[1] ) // end of quote
-                        break;
-                    else if ( c == '\n' )
-                        throw std::runtime_error( "EndOfLine while Reading quoted string:" + s + " at line: " + std::to_string( iLine ) );
-                    else
-                        s += char( c );
-                }
-                // continue read spaces till EOF or EOL, or SEP
-                while ( !endOfLine )
-                {
-                    if ( !is.good() )
-                    {
-                        endOfFile = true;
-                        endOfLine = true;
-                    }
-                    c = is.get();
-                    if ( c == EOF )
-                    {
-                        endOfFile = true;
-                        endOfLine = true;
-                    }
-                    else if ( c == '\n' )
-                    {
-                        endOfLine = true;
-                        ++iLine;
-                        break;
-                    }
-                    else if ( c == sep )
-                        break;
-                    else if ( !isspace( c ) )
-                        throw std::runtime_error( "ERROR! Non-space char after quoted string: " + s + " at line: " + std::to_string( iLine ) );
-                }
-                row.push_back( std::move( s ) );
+                if ( q == end && !eof )
+                    return Status::NeedMore;
+                if ( afterSep && m_opts.sepStartsField )
+                    pushField( q, q );
+                if ( q == end )
+                    return finishRecord( p, end, lines );
+                return finishRecord( p, q + 1, lines + 1 );
+            }
+            if ( m_opts.commentChar && *q == m_opts.commentChar )
+            {
+                if ( afterSep && m_opts.sepStartsField )
+                    pushField( q, q );
+                const char *nl = find_newline( q, end );
+                if ( nl )
+                    return finishRecord( p, nl + 1, lines + 1 );
+                if ( !eof )
+                    return Status::NeedMore;
+                return finishRecord( p, end, lines );
             }
-            else // read non-quoted string.
+            if ( quotes && *q == quotes[0] ) // quoted string, in which escaped "\n" and "\"" are unescaped.
             {
-                std::string s;
-                s += char( c );
+                const char *begin = ++q, *segment = q;
+                const bool keep = projected( m_numFields );
+                bool escaped = false;
+                size_t unescapedBegin = m_unescaped.size();
                 while ( true )
                 {
-                    if ( !is.good() )
+                    q = find_structural( scanner, q, end, [quotes]( char c ) { return c == quotes[1] || c == '\\' || c == '\n'; } );
+                    if ( q == end || ( *q == '\\' && q + 1 == end ) )
                     {
-                        endOfFile = true;
-                        endOfLine = true;
-                        break;
+                        if ( !eof )
+                            return Status::NeedMore;
+                        throw error( "EOF while Reading quoted string:" + std::string( begin, q ), lines );
                     }
-                    c = is.get();
-                    if ( c == sep ) // end of quote
-                        break;
-                    else if ( c == '\n' )
+                    if ( *q == '\n' )
                     {
-                        endOfLine = true;
-                        ++iLine;
-                        break;
+                        if ( !m_opts.newlineInQuotes )
+                            throw error( "EndOfLine while Reading quoted string:" + std::string( begin, q ), lines );
+                        ++q;
+                        ++lines;
+                        continue;
                     }
-                    else if ( c == EOF )
+                    if ( *q != '\\' ) // end of quote
+                        break;
+                    escaped = true;
+                    if ( keep ) // skipped fields are not unescaped.
                     {
-                        endOfFile = true;
-                        endOfLine = true;
+                        m_unescaped.append( segment, q );
+                        if ( q[1] == 'n' )
+                            m_unescaped += '\n';
+                        else if ( q[1] == '\"' )
+                            m_unescaped += '\"';
+                        else
+                            m_unescaped.append( q, 2 );
                     }
-                    else
-                        s += char( c );
+                    if ( q[1] == '\n' )
+                        ++lines;
+                    q += 2;
+                    segment = q;
                 }
-                if ( s.empty() && ( endOfFile || endOfLine ) ) // empty string
+                if ( escaped && keep )
                 {
+                    m_unescaped.append( segment, q );
+                    m_spans.push_back( Span{nullptr, unescapedBegin, m_unescaped.size() - unescapedBegin, m_numFields++} );
                 }
                 else
+                    pushField( begin, q );
+                ++q;
+                while ( q < end && *q != sep && *q != '\n' && is_space( *q ) ) // spaces till sep or end of line.
+                    ++q;
+                if ( q == end )
                 {
-                    s = trimRight( s ); // note: maybe empty, but ends with sep.
-                    row.push_back( std::move( s ) );
+                    if ( !eof )
+                        return Status::NeedMore;
+                    return finishRecord( p, end, lines );
                 }
+                if ( *q == '\n' )
+                    return finishRecord( p, q + 1, lines + 1 );
+                if ( *q != sep )
+                    throw error( "ERROR! Non-space char after quoted string: " + std::string( begin, q ), lines );
+            }
+            else // non-quoted string, trimmed right.
+            {
+                const char *begin = q;
+                q = find_structural( scanner, q, end, [sep]( char c ) { return c == sep || c == '\n'; } );
+                if ( q == end && !eof )
+                    return Status::NeedMore;
+                const char *last = q;
+                while ( last > begin && is_space( last[-1] ) && projected( m_numFields ) )
+                    --last;
+                pushField( begin, last );
+                if ( q == end )
+                    return finishRecord( p, end, lines );
+                if ( *q == '\n' )
+                    return finishRecord( p, q + 1, lines + 1 );
             }
-        } // while ( !endOfLine && !endOfFile )
-        if ( !row.empty() && ( !rowFilter || rowFilter( row ) ) )
+            ++q; // sep
+            afterSep = true;
+        }
+    }
+};
+
+/// \brief Call onRecord( const std::vector<std::string_view> &fields ) for each record in text. onRecord returns false to stop.
+/// \return number of records passed to onRecord.
+template<class OnRecord>
+size_t scan_csv( std::string_view text, const CsvOptions &opts, OnRecord &&onRecord )
+{
+    CsvTokenizer tokenizer( opts );
+    const char *p = text.data(), *end = text.data() + text.size();
+    size_t nrecords = 0;
+    while ( tokenizer.next( p, end, true ) == CsvTokenizer::Status::Record )
+    {
+        ++nrecords;
+        if ( !onRecord( tokenizer.fields() ) )
+            break;
+    }
+    return nrecords;
+}
+
+/// \brief Set columns to the indices of names in header fields.
+/// \return false if a name is not in header.
+template<class Header>
+bool select_csv_columns( const Header &header, const std::vector<std::string> &names, std::vector<size_t> &columns, std::ostream *err = nullptr )
+{
+    columns.clear();
+    for ( const auto &name : names )
+    {
+        auto it = std::find( header.begin(), header.end(), name );
+        if ( it == header.end() )
         {
-            rows.push_back( std::move( row ) );
-            if ( rows.size() >= readMaxRecords )
-                break;
+            if ( err )
+                *err << "select_csv_columns: Failed to find column:" << name << " in header.\n";
+            return false;
+        }
+        columns.push_back( size_t( it - header.begin() ) );
+    }
+    return true;
+}
+/// \brief Project opts to columns of names in the header, which is the first record of text after opts.skipLines. The header lines
+/// are added to opts.skipLines, so that records are read after the header.
+/// \return false if there is no header or a name is not in it.
+inline bool select_csv_columns( std::string_view text, const std::vector<std::string> &names, CsvOptions &opts, std::ostream *err = nullptr )
+{
+    CsvOptions headerOpts = opts;
+    headerOpts.columns.clear();
+    CsvTokenizer tokenizer( headerOpts );
+    const char *p = text.data();
+    if ( tokenizer.next( p, text.data() + text.size(), true ) != CsvTokenizer::Status::Record )
+    {
+        if ( err )
+            *err << "select_csv_columns: No header.\n";
+        return false;
+    }
+    if ( !select_csv_columns( tokenizer.fields(), names, opts.columns, err ) )
+        return false;
+    opts.skipLines = tokenizer.lineNumber();
+    return true;
+}
+
+/// \brief Cursor over records of a stream, which is read in blocks of blockSize bytes. A block grows if a record doesn't fit in it,
+/// so memory is bounded by blockSize and the longest record.
+class CsvRecordCursor
+{
+protected:
+    CsvTokenizer m_tokenizer;
+    std::istream *m_is;
+    std::string m_buf;
+    size_t m_begin = 0, m_discarded = 0; // unparsed input is m_buf[m_begin, m_buf.size()), after m_discarded bytes of stream.
+    size_t m_blockSize;
+    bool m_eof = false, m_end = false;
+
+public:
+    /// \param blockSize 0 to read line by line, so that the stream is never read past the returned record. It keeps a stream that
+    /// can't seek, e.g. a pipe, positioned after the last record if the caller stops early.
+    explicit CsvRecordCursor( std::istream &is, const CsvOptions &opts = {}, size_t blockSize = 1 << 20 )
+            : m_tokenizer( opts ), m_is( &is ), m_blockSize( blockSize ), m_eof( !is.good() )
+    {
+    }
+
+    /// \brief Tokenize the next record.
+    /// \return fields of the record, which are valid until the next call; nullptr if there is no more record.
+    /// \throw std::runtime_error if a quoted field is malformed.
+    const std::vector<std::string_view> *next()
+    {
+        while ( !m_end )
+        {
+            const char *p = m_buf.data() + m_begin;
+            auto status = m_tokenizer.next( p, m_buf.data() + m_buf.size(), m_eof );
+            m_begin = size_t( p - m_buf.data() );
+            if ( status == CsvTokenizer::Status::Record )
+                return &m_tokenizer.fields();
+            if ( status == CsvTokenizer::Status::End )
+                m_end = true;
+            else
+                readBlock();
         }
+        return nullptr;
+    }
+    bool atEnd() const
+    {
+        return m_end;
+    }
+    /// \return number of bytes of stream consumed by the returned records.
+    size_t consumed() const
+    {
+        return m_discarded + m_begin;
+    }
+    /// \return number of lines consumed.
+    size_t lineNumber() const
+    {
+        return m_tokenizer.lineNumber();
     }
+
+protected:
+    void readBlock()
+    {
+        m_buf.erase( 0, m_begin );
+        m_discarded += m_begin;
+        m_begin = 0;
+        if ( !m_blockSize )
+        {
+            std::string line;
+            std::getline( *m_is, line );
+            m_buf += line;
+            if ( !m_is->eof() )
+                m_buf += '\n';
+            m_eof = !m_is->good();
+            return;
+        }
+        const size_t n = m_buf.size();
+        m_buf.resize( n + m_blockSize );
+        m_is->read( m_buf.data() + n, std::streamsize( m_blockSize ) );
+        m_buf.resize( n + size_t( m_is->gcount() ) );
+        m_eof = !m_is->good();
+    }
+};
+
+/// \brief Scan records read from is in blocks of blockSize bytes (see CsvRecordCursor), as scan_csv of text does.
+/// If onRecord stops scanning, a seekable stream is positioned after the last record, so that following reads continue from there.
+/// A stream that can't seek is positioned there only if it's read line by line, i.e. blockSize is 0.
+template<class OnRecord>
+size_t scan_csv( std::istream &is, const CsvOptions &opts, OnRecord &&onRecord, size_t blockSize = 1 << 20 )
+{
+    const auto startPos = is.tellg();
+    CsvRecordCursor cursor( is, opts, blockSize );
+    size_t nrecords = 0;
+    while ( auto fields = cursor.next() )
+    {
+        ++nrecords;
+        if ( onRecord( *fields ) )
+            continue;
+        if ( startPos != std::istream::pos_type( -1 ) )
+        {
+            is.clear();
+            is.seekg( startPos + std::istream::off_type( cursor.consumed() ) );
+        }
+        break;
+    }
+    return nrecords;
+}
+
+/// \brief Scan records in the memory mapping of filename, as scan_csv of text does.
+/// \return false if the file can't be opened.
+template<class OnRecord>
+bool scan_csv_file( const std::string &filename, const CsvOptions &opts, OnRecord &&onRecord, std::ostream *err = nullptr )
+{
+    if ( MappedFile::isEmptyFile( filename ) )
+        return true;
+    MappedFile file;
+    if ( !file.open( filename, err ) )
+        return false;
+    file.adviseSequential();
+    scan_csv( std::string_view( file.data(), file.size() ), opts, std::forward<OnRecord>( onRecord ) );
+    return true;
+}
+
+///////////////////////////////////////////////////////////////
+/// Parallel parsing: text is split into chunks, record boundaries are resolved by the quoting state at the beginning of each chunk,
+/// and the ranges of whole records are tokenized in parallel.
+///////////////////////////////////////////////////////////////
+
+/// \brief States of CsvTokenizer reduced to what decides record boundaries.
+enum class CsvScanState : uint8_t
+{
+    RecordStart,
+    FieldStart,
+    Unquoted,
+    InQuote,
+    Escaped,
+    AfterQuote,
+    Comment,
+    Error,
+    Count
+};
+
+/// \return the state after char c, as CsvTokenizer parses it.
+inline CsvScanState csv_scan_step( CsvScanState state, char c, const CsvOptions &opts )
+{
+    using S = CsvScanState;
+    switch ( state )
+    {
+    case S::RecordStart:
+    case S::FieldStart:
+        if ( c == '\n' )
+            return S::RecordStart;
+        if ( c == opts.sep )
+            return S::FieldStart;
+        if ( std::isspace( static_cast<unsigned char>( c ) ) )
+            return state;
+        if ( opts.commentChar && c == opts.commentChar )
+            return S::Comment;
+        if ( opts.quotes && c == opts.quotes[0] )
+            return S::InQuote;
+        return S::Unquoted;
+    case S::Unquoted:
+        return c == '\n' ? S::RecordStart : c == opts.sep ? S::FieldStart : S::Unquoted;
+    case S::InQuote:
+        if ( c == '\n' )
+            return opts.newlineInQuotes ? S::InQuote : S::Error;
+        if ( c == '\\' )
+            return S::Escaped;
+        return c == opts.quotes[1] ? S::AfterQuote : S::InQuote;
+    case S::Escaped:
+        return S::InQuote;
+    case S::AfterQuote:
+        if ( c == '\n' )
+            return S::RecordStart;
+        if ( c == opts.sep )
+            return S::FieldStart;
+        return std::isspace( static_cast<unsigned char>( c ) ) ? S::AfterQuote : S::Error;
+    case S::Comment:
+        return c == '\n' ? S::RecordStart : S::Comment;
+    default:
+        return S::Error;
+    }
+}
+
+/// \brief For each possible state at the beginning of a chunk: the state at its end, and the offset of its first record.
+struct CsvChunkScan
+{
+    static constexpr size_t NumStates = size_t( CsvScanState::Count );
+    static constexpr size_t npos = size_t( -1 );
+
+    std::array<CsvScanState, NumStates> endState;
+    std::array<size_t, NumStates> firstRecord; // npos if no record begins in chunk.
+};
+
+/// \brief Run the states from state at text[pos] till end, and call onBoundary( size_t pos ) at the beginning of each record.
+/// onBoundary returns false to stop. Runs of chars that can't change state are skipped by StructuralScanner.
+/// \return the state at end, or at the stopped boundary.
+template<class OnBoundary>
+CsvScanState run_csv_scan( std::string_view text, size_t pos, size_t end, CsvScanState state, const CsvOptions &opts, OnBoundary &&onBoundary )
+{
+    using S = CsvScanState;
+    const char *p = text.data();
+    const char sep = opts.sep, closeQuote = opts.quotes ? opts.quotes[1] : 0;
+    const ByteSet structural = csv_structural_chars( opts );
+    StructuralScanner scanner( p + end, structural );
+    while ( pos < end )
+    {
+        switch ( state )
+        {
+        case S::Unquoted:
+            pos = size_t( find_structural( scanner, p + pos, p + end, [sep]( char c ) { return c == sep || c == '\n'; } ) - p );
+            break;
+        case S::InQuote:
+            pos = size_t( find_structural( scanner, p + pos, p + end, [closeQuote]( char c ) {
+                              return c == closeQuote || c == '\\' || c == '\n';
+                          } ) -
+                          p );
+            break;
+        case S::Comment:
+            while ( pos < end && p[pos] != '\n' )
+                ++pos;
+            break;
+        case S::Error:
+            return state;
+        default:
+            break;
+        }
+        if ( pos == end )
+            break;
+        const char c = p[pos++];
+        state = csv_scan_step( state, c, opts );
+        if ( c == '\n' && state == S::RecordStart && !onBoundary( pos ) )
+            break;
+    }
+    return state;
+}
+
+/// \brief Scan chunk text[begin, end) from every state. Each state runs to its first record boundary, usually the first newline.
+/// From there the trajectories meet, so the rest of chunk is usually scanned once.
+inline CsvChunkScan scan_csv_chunk( std::string_view text, size_t begin, size_t end, const CsvOptions &opts )
+{
+    constexpr size_t N = CsvChunkScan::NumStates;
+    CsvChunkScan res;
+    res.firstRecord.fill( CsvChunkScan::npos );
+    res.endState.fill( CsvScanState::Error );
+    for ( size_t s = 0; s < N; ++s )
+    {
+        if ( CsvScanState( s ) == CsvScanState::RecordStart )
+        {
+            res.firstRecord[s] = begin;
+            continue;
+        }
+        CsvScanState state = run_csv_scan( text, begin, end, CsvScanState( s ), opts, [&]( size_t pos ) {
+            res.firstRecord[s] = pos;
+            return false;
+        } );
+        if ( res.firstRecord[s] == CsvChunkScan::npos ) // no record begins in chunk.
+            res.endState[s] = state;
+    }
+    // run from the distinct first records in ascending order. A later one is synchronized if it's a record boundary of an earlier run.
+    std::vector<size_t> firsts;
+    for ( size_t s = 0; s < N; ++s )
+        if ( res.firstRecord[s] != CsvChunkScan::npos )
+            firsts.push_back( res.firstRecord[s] );
+    std::sort( firsts.begin(), firsts.end() );
+    firsts.erase( std::unique( firsts.begin(), firsts.end() ), firsts.end() );
+    std::vector<CsvScanState> endOfFirst( firsts.size(), CsvScanState::Count );
+    for ( size_t i = 0; i < firsts.size(); ++i )
+    {
+        if ( endOfFirst[i] != CsvScanState::Count )
+            continue;
+        std::vector<size_t> synced{i};
+        size_t k = i + 1;
+        const CsvScanState state = run_csv_scan( text, firsts[i], end, CsvScanState::RecordStart, opts, [&]( size_t pos ) {
+            for ( ; k < firsts.size() && firsts[k] <= pos; ++k )
+                if ( firsts[k] == pos && endOfFirst[k] == CsvScanState::Count )
+                    synced.push_back( k );
+            return true;
+        } );
+        for ( size_t j : synced )
+            endOfFirst[j] = state;
+    }
+    for ( size_t s = 0; s < N; ++s )
+        if ( res.firstRecord[s] != CsvChunkScan::npos )
+            res.endState[s] = endOfFirst[size_t( std::lower_bound( firsts.begin(), firsts.end(), res.firstRecord[s] ) - firsts.begin() )];
+    return res;
+}
+
+/// \brief Split text into ranges of whole records, one for each chunk of about chunkSize bytes in which a record begins.
+/// Lines of opts.skipLines are excluded. Chunks are scanned on nthreads threads (see parallel_for).
+inline std::vector<std::string_view> split_csv_records( std::string_view text, const CsvOptions &opts, size_t chunkSize, size_t nthreads = 0 )
+{
+    size_t base = 0;
+    for ( size_t i = 0; i < opts.skipLines && base < text.size(); ++i )
+    {
+        const size_t nl = text.find( '\n', base );
+        base = nl == std::string_view::npos ? text.size() : nl + 1;
+    }
+    std::vector<std::string_view> ranges;
+    if ( base == text.size() )
+        return ranges;
+    chunkSize = std::max<size_t>( chunkSize, 1 );
+    const size_t nchunks = ( text.size() - base + chunkSize - 1 ) / chunkSize;
+    if ( nchunks == 1 )
+        return {text.substr( base )};
+    std::vector<CsvChunkScan> scans( nchunks );
+    parallel_for( nchunks, nthreads, [&]( size_t i ) {
+        scans[i] = scan_csv_chunk( text, base + i * chunkSize, std::min( text.size(), base + ( i + 1 ) * chunkSize ), opts );
+    } );
+    std::vector<size_t> starts;
+    CsvScanState state = CsvScanState::RecordStart;
+    for ( const auto &scan : scans )
+    {
+        if ( size_t first = scan.firstRecord[size_t( state )]; first != CsvChunkScan::npos && first < text.size() )
+            starts.push_back( first );
+        state = scan.endState[size_t( state )];
+    }
+    for ( size_t i = 0; i < starts.size(); ++i )
+        ranges.push_back( text.substr( starts[i], ( i + 1 < starts.size() ? starts[i + 1] : text.size() ) - starts[i] ) );
+    return ranges;
+}
+
+/// \brief Tokenize text in parallel. Text is split into ranges of whole records (see split_csv_records), and
+/// parseRange( std::string_view range, const CsvOptions &rangeOpts, size_t irange ) is called for each range on nthreads threads.
+/// rangeOpts is opts without skipLines. Line numbers in errors are relative to range.
+/// \param chunkSize 0 to split text into 4 chunks per thread.
+/// \return number of ranges.
+template<class ParseRange>
+size_t parse_csv_parallel( std::string_view text, const CsvOptions &opts, ParseRange &&parseRange, size_t nthreads = 0, size_t chunkSize = 0 )
+{
+    nthreads = resolve_threads( nthreads );
+    if ( !chunkSize )
+        chunkSize = nthreads == 1 ? text.size() : std::max<size_t>( text.size() / ( nthreads * 4 ) + 1, 1 << 16 );
+    const auto ranges = split_csv_records( text, opts, chunkSize, nthreads );
+    CsvOptions rangeOpts = opts;
+    rangeOpts.skipLines = 0;
+    parallel_for( ranges.size(), nthreads, [&]( size_t i ) { parseRange( ranges[i], rangeOpts, i ); } );
+    return ranges.size();
+}
+
+/// \brief Read csv rows of text on nthreads threads. Rows are in the order of text.
+/// \throw runtime_error if a quoted string is malformed.
+inline std::vector<std::vector<std::string>> read_csv_strings_parallel( std::string_view text,
+                                                                        const CsvOptions &opts = {},
+                                                                        size_t nthreads = 0,
+                                                                        size_t chunkSize = 0 )
+{
+    using Rows = std::vector<std::vector<std::string>>;
+    std::vector<Rows> parts;
+    std::mutex partsMutex;
+    parse_csv_parallel(
+            text,
+            opts,
+            [&]( std::string_view range, const CsvOptions &rangeOpts, size_t irange ) {
+                Rows rows;
+                scan_csv( range, rangeOpts, [&]( const std::vector<std::string_view> &fields ) {
+                    rows.emplace_back( fields.begin(), fields.end() );
+                    return true;
+                } );
+                std::lock_guard<std::mutex> lock( partsMutex );
+                if ( parts.size() <= irange )
+                    parts.resize( irange + 1 );
+                parts[irange] = std::move( rows );
+            },
+            nthreads,
+            chunkSize );
+    Rows rows;
+    size_t nrows = 0;
+    for ( const auto &part : parts )
+        nrows += part.size();
+    rows.reserve( nrows );
+    for ( auto &part : parts )
+        std::move( part.begin(), part.end(), std::back_inserter( rows ) );
+    return rows;
+}
+
+/// \brief Read csv rows of the memory mapping of filename on nthreads threads.
+/// \return false if the file can't be opened.
+/// \throw runtime_error if a quoted string is malformed.
+inline bool read_csv_file_strings( const std::string &filename,
+                                   std::vector<std::vector<std::string>> &rows,
+                                   const CsvOptions &opts = {},
+                                   std::ostream *err = nullptr,
+                                   size_t nthreads = 0 )
+{
+    rows.clear();
+    if ( MappedFile::isEmptyFile( filename ) )
+        return true;
+    MappedFile file;
+    if ( !file.open( filename, err ) )
+        return false;
+    file.adviseSequential();
+    rows = read_csv_strings_parallel( std::string_view( file.data(), file.size() ), opts, nthreads );
+    return true;
+}
+
+/// \brief Read csv rows (see CsvTokenizer).
+/// Throw runtime_error if a quoted string is malformed.
+/// param RecordFilter: bool rowFilter(std::vector<std::string>& rec). return false to skip current row, true to add it to result.
+/// \note The stream is read in blocks. If readMaxRecords stops reading, the stream is positioned after the last read record:
+/// a seekable stream by seeking back, and the other streams by being read line by line.
+inline std::vector<std::vector<std::string>> read_csv_strings( std::istream &is,
+                                                               char sep = ',',
+                                                               size_t skipLines = 0,
+                                                               size_t readMaxRecords = ULLONG_MAX,
+                                                               std::function<bool( std::vector<std::string> & )> rowFilter = nullptr,
+                                                               char commentChar = 0,
+                                                               const char *quotes = "\"\"" )
+{
+    std::vector<std::vector<std::string>> rows;
+    const bool byLine = readMaxRecords != ULLONG_MAX && is.tellg() == std::istream::pos_type( -1 );
+    CsvOptions opts;
+    opts.sep = sep;
+    opts.skipLines = skipLines;
+    opts.commentChar = commentChar;
+    opts.quotes = quotes;
+    scan_csv( is, opts, [&]( const std::vector<std::string_view> &fields ) {
+        std::vector<std::string> row( fields.begin(), fields.end() );
+        if ( rowFilter && !rowFilter( row ) )
+            return true;
+        rows.push_back( std::move( row ) );
+        return rows.size() < readMaxRecords;
+    }, byLine ? 0 : size_t( 1 ) << 20 );
     return rows;
 }
 
+///////////////////////////////////////////////////////////////
+/// Batch reading: records of a stream are read in batches of bounded size, so that files larger than memory can be filtered,
+/// aggregated or appended to a DataFrame incrementally.
+///////////////////////////////////////////////////////////////
+
+/// \brief Records of fields copied into one buffer.
+class CsvRecordBatch
+{
+protected:
+    std::string m_chars;
+    std::vector<size_t> m_fieldEnds; // end offset of each field in m_chars.
+    std::vector<size_t> m_recordEnds; // end index of each record in m_fieldEnds.
+    mutable std::vector<std::string_view> m_record;
+
+public:
+    size_t size() const
+    {
+        return m_recordEnds.size();
+    }
+    bool empty() const
+    {
+        return m_recordEnds.empty();
+    }
+    size_t countFields( size_t irow ) const
+    {
+        return m_recordEnds[irow] - fieldBegin( irow );
+    }
+    std::string_view field( size_t irow, size_t icol ) const
+    {
+        const size_t ifield = fieldBegin( irow ) + icol;
+        const size_t begin = ifield ? m_fieldEnds[ifield - 1] : 0;
+        return std::string_view( m_chars.data() + begin, m_fieldEnds[ifield] - begin );
+    }
+    /// \return fields of record irow, which are valid until the next call or the batch is changed.
+    const std::vector<std::string_view> &record( size_t irow ) const
+    {
+        m_record.clear();
+        for ( size_t icol = 0, N = countFields( irow ); icol < N; ++icol )
+            m_record.push_back( field( irow, icol ) );
+        return m_record;
+    }
+
+    void push_back( const std::vector<std::string_view> &fields )
+    {
+        for ( auto field : fields )
+        {
+            m_chars.append( field.data(), field.size() );
+            m_fieldEnds.push_back( m_chars.size() );
+        }
+        m_recordEnds.push_back( m_fieldEnds.size() );
+    }
+    /// \brief Remove records. Memory is kept for the next batch.
+    void clear()
+    {
+        m_chars.clear();
+        m_fieldEnds.clear();
+        m_recordEnds.clear();
+    }
+
+protected:
+    size_t fieldBegin( size_t irow ) const
+    {
+        return irow ? m_recordEnds[irow - 1] : 0;
+    }
+};
+
+/**
+ * @brief Read records of a stream or file in batches of at most batchSize records. Memory is bounded by the batch and the read block
+ * (see CsvRecordCursor). Batches are either CsvRecordBatch of strings, or rows appended to a DataFrame, i.e. a ColumnDataFrame cleared
+ * for each batch, or a RowDataFrame growing incrementally. Reading continues from where the last batch stopped.
+ */
+class CsvBatchReader
+{
+protected:
+    std::unique_ptr<std::ifstream> m_file; // if opened by filename.
+    std::unique_ptr<CsvRecordCursor> m_cursor;
+    size_t m_batchSize = 1 << 16;
+
+public:
+    CsvBatchReader() = default;
+    explicit CsvBatchReader( std::istream &is, const CsvOptions &opts = {}, size_t batchSize = 1 << 16, size_t blockSize = 1 << 20 )
+            : m_cursor( new CsvRecordCursor( is, opts, blockSize ) ), m_batchSize( std::max<size_t>( batchSize, 1 ) )
+    {
+    }
+
+    /// \return false if the file can't be opened.
+    bool open( const std::string &filename,
+               const CsvOptions &opts = {},
+               size_t batchSize = 1 << 16,
+               std::ostream *err = nullptr,
+               size_t blockSize = 1 << 20 )
+    {
+        m_cursor.reset();
+        m_file.reset( new std::ifstream( filename, std::ios::binary ) );
+        if ( !m_file->is_open() )
+        {
+            if ( err )
+                *err << "Failed to open csv file:" << filename << ".\n";
+            m_file.reset();
+            return false;
+        }
+        m_cursor.reset( new CsvRecordCursor( *m_file, opts, blockSize ) );
+        m_batchSize = std::max<size_t>( batchSize, 1 );
+        return true;
+    }
+    bool isOpen() const
+    {
+        return bool( m_cursor );
+    }
+    /// \return true if all records are read.
+    bool atEnd() const
+    {
+        return !m_cursor || m_cursor->atEnd();
+    }
+    size_t batchSize() const
+    {
+        return m_batchSize;
+    }
+    /// \return number of lines consumed.
+    size_t lineNumber() const
+    {
+        return m_cursor ? m_cursor->lineNumber() : 0;
+    }
+
+    /// \brief Read the next batch of records into batch, which is cleared first.
+    /// \return number of records read; 0 at end.
+    /// \throw std::runtime_error if a quoted field is malformed.
+    size_t next( CsvRecordBatch &batch )
+    {
+        batch.clear();
+        return read( [&]( const std::vector<std::string_view> &fields ) {
+            batch.push_back( fields );
+            return true;
+        } );
+    }
+
+    /// \brief Append the next batch of records to df by df.appendRowStr( const std::vector<std::string_view>& , err ).
+    /// \param nrows number of records read, including the failed one.
+    /// \return false if a record fails to append; reading continues after it.
+    /// \throw std::runtime_error if a quoted field is malformed.
+    template<class DataFrame>
+    bool appendTo( DataFrame &df, size_t &nrows, std::ostream *err = nullptr )
+    {
+        bool ok = true;
+        nrows = read( [&]( const std::vector<std::string_view> &fields ) { return ok = df.appendRowStr( fields, err ); } );
+        return ok;
+    }
+
+protected:
+    // read up to m_batchSize records, or until onRecord returns false.
+    template<class OnRecord>
+    size_t read( OnRecord &&onRecord )
+    {
+        size_t n = 0;
+        if ( !m_cursor )
+            return n;
+        while ( n < m_batchSize )
+        {
+            auto fields = m_cursor->next();
+            if ( !fields )
+                break;
+            ++n;
+            if ( !onRecord( *fields ) )
+                break;
+        }
+        return n;
+    }
+};
+
 } // namespace zj
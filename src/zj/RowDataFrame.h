@@ -18,11 +18,22 @@
 #pragma once
 
 #include <zj/IDataFrame.h>
+#include <zj/Arena.h>
+#include <zj/BinaryIO.h>
+#include <zj/ReadCSV.h>
 #include <sstream>
 
 namespace zj
 {
 
+/// Cell storage of RowDataFrame.
+enum class RowStorage : char
+{
+    Variant = 'V', // Record of VarField.
+    Compact = 'C', // CompactRecord of 16-byte CompactField. at() materializes the cell into a thread-local field slot (see nextFieldSlot).
+    Arena = 'A', // Like Compact, but rows of CompactField and string bytes are bump-allocated in Arena chunks, which are freed at once.
+};
+
 /**
  * @brief The DataFrame class with Hash/Ordered Index
  */
@@ -31,7 +42,12 @@ class RowDataFrame : public IDataFrame
 {
 protected:
     std::vector<ColumnDef> m_columnDefs;
-    std::vector<Record> m_records;
+    std::vector<Record> m_records; // RowStorage::Variant
+    std::vector<CompactRecord> m_compactRecords; // RowStorage::Compact
+    std::vector<CompactField *> m_arenaRows; // RowStorage::Arena: countCols() fields per row in m_arena.
+    Arena m_arena;
+    CompactRecord m_scratch; // parsed row before it's copied into arena.
+    RowStorage m_storage = RowStorage::Variant;
 
     std::unordered_map<std::string, size_t> m_columnNames; // <name: index>
 
@@ -39,6 +55,9 @@ protected:
 
 public:
     RowDataFrame() = default;
+    explicit RowDataFrame( RowStorage storage ) : m_storage( storage )
+    {
+    }
 
     RowDataFrame( const std::vector<std::vector<std::string>> &rows, const ColumnDefs &columnDefs )
     {
@@ -53,10 +72,58 @@ public:
         if ( !from_tuples( tups, colNames, err ) )
             throw std::runtime_error( "Failed to create RowDataFrame from tuple vector: " + err.str() );
     }
+    /// \brief Copy rows in the same storage. Arena rows are appended into the arena of the copy.
+    RowDataFrame( const RowDataFrame &a )
+            : m_columnDefs( a.m_columnDefs ), m_records( a.m_records ), m_compactRecords( a.m_compactRecords ), m_storage( a.m_storage ),
+              m_columnNames( a.m_columnNames ), m_allowNullField( a.m_allowNullField )
+    {
+        m_arenaRows.reserve( a.m_arenaRows.size() );
+        for ( auto row : a.m_arenaRows )
+            appendArenaRow( row );
+    }
+    /// \brief Take over rows, including the arena and arena rows of a.
+    RowDataFrame( RowDataFrame &&a ) noexcept
+            : m_columnDefs( std::move( a.m_columnDefs ) ), m_records( std::move( a.m_records ) ), m_compactRecords( std::move( a.m_compactRecords ) ),
+              m_arenaRows( std::exchange( a.m_arenaRows, {} ) ), m_arena( std::move( a.m_arena ) ), m_storage( a.m_storage ),
+              m_columnNames( std::move( a.m_columnNames ) ), m_allowNullField( a.m_allowNullField )
+    {
+    }
+    RowDataFrame &operator=( const RowDataFrame &a )
+    {
+        if ( this != &a )
+        {
+            RowDataFrame tmp( a );
+            *this = std::move( tmp );
+        }
+        return *this;
+    }
+    RowDataFrame &operator=( RowDataFrame &&a ) noexcept
+    {
+        if ( this != &a )
+        {
+            clear();
+            m_columnDefs = std::move( a.m_columnDefs );
+            m_records = std::move( a.m_records );
+            m_compactRecords = std::move( a.m_compactRecords );
+            m_arenaRows = std::exchange( a.m_arenaRows, {} );
+            m_arena = std::move( a.m_arena );
+            m_storage = a.m_storage;
+            m_columnNames = std::move( a.m_columnNames );
+            m_allowNullField = a.m_allowNullField;
+        }
+        return *this;
+    }
     ~RowDataFrame() override
     {
         clear();
     }
+    /// \brief Create columns without any row. Rows can be appended by appendRowStr or appendTupple.
+    void create( const ColumnDefs &columnDefs )
+    {
+        clear();
+        m_columnDefs = columnDefs;
+        createColumnIndex();
+    }
     bool from_rows( const std::vector<std::vector<std::string>> &rows, const ColumnDefs &columnDefs = {}, std::ostream *err = nullptr )
     {
         clear();
@@ -71,8 +138,72 @@ public:
         return true;
     }
 
+    /// \brief Read csv records of text into rows of columnDefs in the current storage. Fields are parsed from text without intermediate
+    /// strings. If opts.columns projects the csv, columnDefs are of the projected columns and the other fields are skipped unparsed.
+    /// \return false if a record doesn't match columns. RowDataFrame keeps the records before it.
+    /// \throw runtime_error if a quoted string is malformed.
+    bool read_csv( std::string_view text, const ColumnDefs &columnDefs, const CsvOptions &opts = {}, std::ostream *err = nullptr )
+    {
+        create( columnDefs );
+        return appendCsv( [&]( auto &&onRecord ) { scan_csv( text, opts, onRecord ); }, err );
+    }
+    /// \brief Read csv records of is, which is read in blocks (see scan_csv).
+    bool read_csv( std::istream &is, const ColumnDefs &columnDefs, const CsvOptions &opts = {}, std::ostream *err = nullptr )
+    {
+        create( columnDefs );
+        return appendCsv( [&]( auto &&onRecord ) { scan_csv( is, opts, onRecord ); }, err );
+    }
+    /// \brief Read csv records of the memory mapping of filename.
+    bool read_csv_file( const std::string &filename, const ColumnDefs &columnDefs, const CsvOptions &opts = {}, std::ostream *err = nullptr )
+    {
+        if ( MappedFile::isEmptyFile( filename ) )
+        {
+            create( columnDefs );
+            return true;
+        }
+        MappedFile file;
+        if ( !file.open( filename, err ) )
+            return false;
+        file.adviseSequential();
+        return read_csv( std::string_view( file.data(), file.size() ), columnDefs, opts, err );
+    }
+
+    /// \brief Load DFBC written by save_binary into the current storage.
+    bool load_binary( std::istream &is, std::ostream *err = nullptr )
+    {
+        DFBCReader reader;
+        return reader.open( is, err ) && load_binary( reader, err );
+    }
+    bool load_binary( const std::string &filename, std::ostream *err = nullptr )
+    {
+        DFBCReader reader;
+        return reader.open( filename, err ) && load_binary( reader, err );
+    }
+    bool load_binary( DFBCReader &reader, std::ostream *err = nullptr )
+    {
+        clear();
+        m_columnDefs = reader.columnDefs();
+        createColumnIndex();
+        if ( m_storage == RowStorage::Variant )
+            m_records.reserve( reader.numRows() );
+        else if ( m_storage == RowStorage::Compact )
+            m_compactRecords.reserve( reader.numRows() );
+        else
+            m_arenaRows.reserve( reader.numRows() );
+        Record rec;
+        for ( size_t i = 0, N = reader.numRows(); i < N; ++i )
+        {
+            if ( !reader.next( rec, err ) )
+                return false;
+            pushRecord( std::move( rec ) );
+        }
+        return true;
+    }
+
+    /// \brief Parse fields of row into a record. Row is a vector of std::string or std::string_view.
     /// TODO: N/A value policy for each column: remove the record, save as null, or report error.
-    bool appendRowStr( const std::vector<std::string> &row, std::ostream *err = nullptr )
+    template<class Row = std::vector<std::string>>
+    bool appendRowStr( const Row &row, std::ostream *err = nullptr )
     {
         if ( m_columnDefs.empty() )
         {
@@ -88,6 +219,8 @@ public:
                      << " is not equal to columns=" << m_columnDefs.size() << ".\n";
             return false;
         }
+        if ( m_storage != RowStorage::Variant )
+            return appendCompactRowStr( row, err );
         Record rec;
         for ( size_t i = 0; i < m_columnDefs.size(); ++i )
         {
@@ -109,6 +242,29 @@ public:
         return true;
     }
 
+    /// \brief Convert the stored records to another storage.
+    void setStorage( RowStorage storage )
+    {
+        if ( storage == m_storage )
+            return;
+        std::vector<Record> records;
+        if ( m_storage == RowStorage::Variant )
+            records = std::move( m_records );
+        else
+        {
+            for ( size_t i = 0, N = countRows(); i < N; ++i )
+                records.push_back( to_record( compactRow( i ), countCols() ) );
+        }
+        clearRecords();
+        m_storage = storage;
+        for ( auto &rec : records )
+            pushRecord( std::move( rec ) );
+    }
+    RowStorage storage() const
+    {
+        return m_storage;
+    }
+
     template<class... T>
     bool from_tuples( const std::vector<std::tuple<T...>> &tups, const std::vector<std::string> &colNames = {}, std::ostream *err = nullptr )
     {
@@ -139,7 +295,7 @@ public:
             Record rec;
             if ( !create_record( rec, tup, err, m_allowNullField ) )
                 return false;
-            m_records.push_back( std::move( rec ) );
+            pushRecord( std::move( rec ) );
         }
         createColumnIndex();
         return true;
@@ -166,7 +322,7 @@ public:
         Record rec;
         if ( !create_record( rec, tup, err, m_allowNullField ) )
             return false;
-        m_records.push_back( std::move( rec ) );
+        pushRecord( std::move( rec ) );
         return true;
     }
 
@@ -194,15 +350,15 @@ public:
             return false;
         if ( m_columnDefs.empty() )
         {
-            assert( m_records.empty() );
+            assert( countRows() == 0 );
             // copy columns
-            for ( size_t i = 0, ncols = countCols(); i < ncols; ++i )
+            for ( size_t i = 0, ncols = rhs.countCols(); i < ncols; ++i )
             {
                 m_columnDefs.push_back( rhs.columnDef( i ) );
             }
             createColumnIndex();
         }
-        for ( size_t i = 0, nrows = countRows(); i < nrows; ++i )
+        for ( size_t i = 0, nrows = rhs.countRows(); i < nrows; ++i )
         {
             Record rec;
             for ( const auto &col : m_columnDefs )
@@ -211,23 +367,27 @@ public:
                 VarField var = val;
                 rec.push_back( std::move( var ) );
             }
-            m_records.push_back( std::move( rec ) );
+            pushRecord( std::move( rec ) );
         }
 
         return true;
     }
     IDataFrame *deepCopy() const override
     {
-        RowDataFrame *a = new RowDataFrame();
-        a->m_columnDefs = m_columnDefs;
-        a->m_columnNames = m_columnNames;
-        a->m_records = m_records;
-        return a;
+        return new RowDataFrame( *this );
     }
 
     size_t countRows() const override
     {
-        return m_records.size();
+        switch ( m_storage )
+        {
+        case RowStorage::Compact:
+            return m_compactRecords.size();
+        case RowStorage::Arena:
+            return m_arenaRows.size();
+        default:
+            return m_records.size();
+        }
     }
     size_t countCols() const override
     {
@@ -235,16 +395,45 @@ public:
     }
     const VarField &at( size_t irow, size_t icol ) const override
     {
-        if ( icol > countCols() )
+        if ( icol >= countCols() )
             throw std::out_of_range( "icol our of range: " + to_string( icol ) + " >= " + to_string( m_columnDefs.size() ) );
-        if ( irow > countRows() )
+        if ( irow >= countRows() )
             throw std::out_of_range( "irow our of range: " + to_string( irow ) + " >= " + to_string( countRows() ) );
+        if ( m_storage != RowStorage::Variant )
+        {
+            VarField &slot = nextFieldSlot();
+            compactRow( irow )[icol].get( slot );
+            return slot;
+        }
         return m_records[irow][icol];
     }
     const VarField &at( size_t irow, const std::string &col ) const override
     {
+        if ( m_storage != RowStorage::Variant )
+        {
+            if ( irow >= countRows() )
+                throw std::out_of_range( "irow our of range: " + to_string( irow ) + " >= " + to_string( countRows() ) );
+            VarField &slot = nextFieldSlot();
+            compactRow( irow )[colIndex( col )].get( slot );
+            return slot;
+        }
         return m_records.at( irow ).at( colIndex( col ) );
     }
+    const CompactField *compactAt( size_t irow, size_t icol ) const override
+    {
+        return m_storage != RowStorage::Variant ? &compactRow( irow )[icol] : nullptr;
+    }
+    /// \pre storage() is Compact or Arena.
+    /// \return countCols() fields of row irow.
+    const CompactField *compactRow( size_t irow ) const
+    {
+        assert( m_storage != RowStorage::Variant );
+        return m_storage == RowStorage::Arena ? m_arenaRows[irow] : m_compactRecords[irow].data();
+    }
+    const Arena &arena() const
+    {
+        return m_arena;
+    }
     const VarField &operator()( size_t irow, size_t icol ) const
     {
         return at( irow, icol );
@@ -284,24 +473,104 @@ public:
         throw std::out_of_range( "Failed to find DataFrame column name:" + colName );
     }
 
+    /// \note Arena chunks are freed at once. Fields are destructed only if there are vector columns, the values of which
+    /// are allocated out of arena.
     void clearRecords()
     {
         m_records.clear();
+        m_compactRecords.clear();
+        if ( std::any_of( m_columnDefs.begin(), m_columnDefs.end(), []( const ColumnDef &c ) {
+                 return CompactField::isOutOfLineType( c.colTypeTag );
+             } ) )
+        {
+            for ( auto row : m_arenaRows )
+                for ( size_t i = 0, N = m_columnDefs.size(); i < N; ++i )
+                    row[i].~CompactField();
+        }
+        m_arenaRows.clear();
+        m_arena.clear();
     }
     /// \brief clear records and columns.
     void clear()
     {
-        m_columnDefs.clear();
         clearRecords();
+        m_columnDefs.clear();
     }
 
 protected:
+    void pushRecord( Record &&rec )
+    {
+        if ( m_storage == RowStorage::Compact )
+            m_compactRecords.push_back( to_compact( rec ) );
+        else if ( m_storage == RowStorage::Arena )
+        {
+            m_scratch.resize( rec.size() );
+            for ( size_t i = 0, N = rec.size(); i < N; ++i )
+                m_scratch[i] = CompactField::borrow( rec[i] );
+            appendArenaRow( m_scratch.data() );
+        }
+        else
+            m_records.push_back( std::move( rec ) );
+    }
+    // copy countCols() fields into arena. Strings are copied into arena; vectors are owned by the fields.
+    void appendArenaRow( const CompactField *fields )
+    {
+        size_t ncols = m_columnDefs.size();
+        CompactField *row = m_arena.allocate_n<CompactField>( ncols );
+        for ( size_t i = 0; i < ncols; ++i )
+        {
+            if ( fields[i].typeTag() == FieldTypeTag::Str )
+                new ( row + i ) CompactField( CompactField::borrowStr( m_arena.copyStr( fields[i].strView() ) ) );
+            else
+                new ( row + i ) CompactField( fields[i].clone() );
+        }
+        m_arenaRows.push_back( row );
+    }
+    // parse fields into CompactField directly.
+    template<class Row>
+    bool appendCompactRowStr( const Row &row, std::ostream *err )
+    {
+        bool bArena = m_storage == RowStorage::Arena;
+        CompactRecord compactRec;
+        CompactRecord &rec = bArena ? m_scratch : compactRec;
+        rec.resize( m_columnDefs.size() );
+        for ( size_t i = 0; i < m_columnDefs.size(); ++i )
+        {
+            if ( bArena && m_columnDefs[i].colTypeTag == FieldTypeTag::Str && !( global().bParseNull && is_null( row[i] ) ) )
+                rec[i] = CompactField::borrowStr( row[i] ); // copied into arena by appendArenaRow.
+            else if ( !from_string( rec[i], m_columnDefs[i].colTypeTag, row[i] ) )
+            {
+                if ( err )
+                    *err << "appendRowStr: Failed to parse (row element=" << to_string( row[i] ) << ", col=" << i << ").\n";
+                return false;
+            }
+            if ( !m_allowNullField && rec[i].isNull() )
+            {
+                if ( err )
+                    *err << "appendRowStr: Null field is not allowed at col=" << i << ".\n";
+                return false;
+            }
+        }
+        if ( bArena )
+            appendArenaRow( rec.data() );
+        else
+            m_compactRecords.push_back( std::move( rec ) );
+        return true;
+    }
     void createColumnIndex()
     {
         m_columnNames.clear();
         for ( size_t i = 0, N = m_columnDefs.size(); i < N; ++i )
             m_columnNames[m_columnDefs[i].colName] = i;
     }
+    // scan( onRecord ) calls onRecord( const std::vector<std::string_view> &fields ) for each csv record.
+    template<class Scan>
+    bool appendCsv( Scan &&scan, std::ostream *err )
+    {
+        bool ok = true;
+        scan( [&]( const std::vector<std::string_view> &fields ) { return ok = appendRowStr( fields, err ); } );
+        return ok;
+    }
 };
 
 } // namespace zj
@@ -0,0 +1,149 @@
+/*
+ * This file is part of the ftl (Fast Template Library) distribution (https://github.com/zjgoggle/ftl).
+ * Copyright (c) 2020 Jack Zhang.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <zj/IDataFrame.h>
+#include <zj/BinaryIO.h>
+
+namespace zj
+{
+
+///////////////////////////////////////////////////////////////
+/// Statistics of row groups, by which conditions skip the row groups that can't match (see ICondition::mayMatchChunk).
+///////////////////////////////////////////////////////////////
+
+/// \brief Statistics of the rows of a column in a row group.
+struct ColumnChunkStats
+{
+    size_t numRows = 0;
+    size_t nullCount = 0;
+    // NullField if there is no value, or the column type has no order statistics, i.e. vector, or a float value is NaN, which is
+    // unordered with any value.
+    VarField minValue, maxValue;
+
+    bool allNull() const
+    {
+        return nullCount == numRows;
+    }
+    /// \return true if the range of values is known.
+    bool hasMinMax() const
+    {
+        return minValue.index() != 0;
+    }
+};
+
+/// \brief Statistics of a column for each row group of rowGroupSize rows. The last row group may have fewer rows.
+struct RowGroupStats
+{
+    static constexpr size_t DefaultRowGroupSize = 1 << 16;
+
+    size_t rowGroupSize = 0;
+    std::vector<ColumnChunkStats> chunks; // one per row group.
+
+    size_t countGroups() const
+    {
+        return chunks.size();
+    }
+    /// \return [beginRow, endRow) of row group igroup.
+    std::pair<size_t, size_t> groupRange( size_t igroup ) const
+    {
+        const size_t ibegin = igroup * rowGroupSize;
+        return {ibegin, ibegin + chunks.at( igroup ).numRows};
+    }
+};
+
+/// \return true if var is a Float32 or Float64 NaN.
+inline bool is_nan_field( const VarField &var )
+{
+    if ( auto p = std::get_if<Float64Field>( &var ) )
+        return p->value != p->value;
+    if ( auto p = std::get_if<Float32Field>( &var ) )
+        return p->value != p->value;
+    return false;
+}
+
+/// \brief Compute statistics of column icol for each row group of rowGroupSize rows.
+inline RowGroupStats compute_row_group_stats( const IDataFrame &df, size_t icol, size_t rowGroupSize )
+{
+    RowGroupStats stats;
+    stats.rowGroupSize = rowGroupSize;
+    const size_t nrows = df.countRows();
+    if ( !rowGroupSize )
+        return stats;
+    const bool hasOrder = !is_vec_field( df.columnDef( icol ).colTypeTag );
+    stats.chunks.reserve( ( nrows + rowGroupSize - 1 ) / rowGroupSize );
+    for ( size_t ibegin = 0; ibegin < nrows; ibegin += rowGroupSize )
+    {
+        ColumnChunkStats &chunk = stats.chunks.emplace_back();
+        chunk.numRows = std::min( rowGroupSize, nrows - ibegin );
+        bool hasNaN = false;
+        for ( size_t irow = ibegin, iend = ibegin + chunk.numRows; irow < iend; ++irow )
+        {
+            const VarField &var = df.at( irow, icol );
+            if ( var.index() == 0 )
+                ++chunk.nullCount;
+            else if ( hasOrder && !hasNaN )
+            {
+                if ( is_nan_field( var ) ) // the range would be wrong for comparisons that NaN matches, e.g. NE.
+                {
+                    hasNaN = true;
+                    chunk.minValue = chunk.maxValue = NullField{};
+                }
+                else if ( !chunk.hasMinMax() )
+                    chunk.minValue = chunk.maxValue = var;
+                else if ( var < chunk.minValue )
+                    chunk.minValue = var;
+                else if ( chunk.maxValue < var )
+                    chunk.maxValue = var;
+            }
+        }
+    }
+    return stats;
+}
+
+/// \brief Write 8-byte NullCount, min and max field of each row group (see "Mapped DataFrame Layout" in IDataFrame.h).
+inline void write_binary_row_group_stats( BinaryWriter &w, const RowGroupStats &stats )
+{
+    for ( const auto &chunk : stats.chunks )
+    {
+        w.put( uint64_t( chunk.nullCount ) );
+        write_binary_field( w, chunk.minValue );
+        write_binary_field( w, chunk.maxValue );
+    }
+}
+/// \brief Read statistics written by write_binary_row_group_stats for nrows rows.
+inline bool read_binary_row_group_stats( BinaryReader &r, size_t nrows, size_t rowGroupSize, RowGroupStats &stats )
+{
+    stats.rowGroupSize = rowGroupSize;
+    stats.chunks.clear();
+    if ( !rowGroupSize )
+        return true;
+    for ( size_t ibegin = 0; ibegin < nrows; ibegin += rowGroupSize )
+    {
+        ColumnChunkStats &chunk = stats.chunks.emplace_back();
+        chunk.numRows = std::min( rowGroupSize, nrows - ibegin );
+        uint64_t nullCount = 0;
+        if ( !r.get( nullCount ) || nullCount > chunk.numRows || !read_binary_field( r, chunk.minValue ) ||
+             !read_binary_field( r, chunk.maxValue ) || chunk.minValue.index() != chunk.maxValue.index() )
+            return false;
+        chunk.nullCount = nullCount;
+    }
+    return true;
+}
+
+} // namespace zj
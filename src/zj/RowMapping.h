@@ -0,0 +1,180 @@
+/*
+ * This file is part of the ftl (Fast Template Library) distribution (https://github.com/zjgoggle/ftl).
+ * Copyright (c) 2020 Jack Zhang.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+#include <zj/SparseVector.h>
+
+namespace zj
+{
+
+/// \brief Mapping from view rows to underlying rows. Range-shaped rows (all rows, or a few contiguous ranges) are stored as
+/// Incremental segments of SparseVector; other rows are stored as dense indices.
+/// Rows can be pushed as they are found, e.g. by condition scans: they are kept as segments until segments turn out to take
+/// more memory than dense indices, so that range-shaped selections never materialize dense indices.
+class RowMapping
+{
+    std::vector<size_t> m_dense;
+    SparseVector<size_t> m_runs;
+    bool m_compressed = true; // an empty mapping is compressed, so that pushed rows start as segments.
+
+    static constexpr size_t MinRowsToDecide = 256; // pushed rows stay segments until there are this many.
+
+    /// Rows are compressed if the segments take less than half of the dense indices.
+    static bool worth_compressing( size_t nsegs, size_t nrows )
+    {
+        return nsegs * sizeof( Segment<size_t> ) * 2 <= nrows * sizeof( size_t );
+    }
+    void decompress()
+    {
+        m_dense.reserve( m_runs.size() );
+        for ( const auto &seg : m_runs.segments() )
+            for ( size_t i = 0, N = seg.size(); i < N; ++i )
+                m_dense.push_back( seg.atLocal( i ) );
+        m_runs.clear();
+        m_compressed = false;
+    }
+
+public:
+    /// \brief Map rows [0, n).
+    void assignAll( size_t n )
+    {
+        clear();
+        if ( n )
+            m_runs.push_back_incremental( 0, n );
+    }
+    void assign( std::vector<size_t> &&irows )
+    {
+        clear();
+        m_compressed = false;
+        m_dense = std::move( irows );
+        compact();
+    }
+    void assign( SparseVector<size_t> runs )
+    {
+        clear();
+        m_runs = std::move( runs );
+    }
+    void clear()
+    {
+        m_dense.clear();
+        m_runs.clear();
+        m_compressed = true;
+    }
+
+    /// \brief Append a row. Segments are switched to dense indices once they don't save memory.
+    void push_back( size_t irow )
+    {
+        if ( !m_compressed )
+            return m_dense.push_back( irow );
+        m_runs.push_back( irow );
+        if ( m_runs.size() >= MinRowsToDecide && !worth_compressing( m_runs.countSegments(), m_runs.size() ) )
+            decompress();
+    }
+    /// \brief Append rows [ibegin, iend) in O(1) if they are stored as segments.
+    void push_back_range( size_t ibegin, size_t iend )
+    {
+        if ( ibegin >= iend )
+            return;
+        if ( !m_compressed )
+        {
+            for ( size_t i = ibegin; i < iend; ++i )
+                m_dense.push_back( i );
+            return;
+        }
+        m_runs.append_incremental( ibegin, iend - ibegin );
+        if ( m_runs.size() >= MinRowsToDecide && !worth_compressing( m_runs.countSegments(), m_runs.size() ) )
+            decompress();
+    }
+    /// \brief Choose the storage by the final rows after they are pushed: segments if they take less than half of the dense
+    /// indices, otherwise dense indices.
+    void compact()
+    {
+        if ( m_compressed )
+        {
+            if ( !worth_compressing( m_runs.countSegments(), m_runs.size() ) )
+                decompress();
+            return;
+        }
+        size_t nruns = 0;
+        for ( size_t i = 0, N = m_dense.size(); i < N; ++i )
+            if ( i == 0 || m_dense[i] != m_dense[i - 1] + 1 )
+                ++nruns;
+        if ( !worth_compressing( nruns, m_dense.size() ) )
+            return;
+        for ( auto r : m_dense )
+            m_runs.push_back( r );
+        m_dense = std::vector<size_t>();
+        m_compressed = true;
+    }
+
+    /// \note O(log(segments)) if it's compressed.
+    size_t operator[]( size_t irow ) const
+    {
+        return m_compressed ? m_runs[irow] : m_dense[irow];
+    }
+    size_t size() const
+    {
+        return m_compressed ? m_runs.size() : m_dense.size();
+    }
+    bool empty() const
+    {
+        return size() == 0;
+    }
+    bool isCompressed() const
+    {
+        return m_compressed;
+    }
+    const SparseVector<size_t> &runs() const
+    {
+        return m_runs;
+    }
+    /// Call func(size_t underlyingRow) for each row in order.
+    template<class Func>
+    void foreach( Func &&func ) const
+    {
+        if ( !m_compressed )
+        {
+            for ( auto r : m_dense )
+                func( r );
+            return;
+        }
+        for ( const auto &seg : m_runs.segments() )
+            for ( size_t i = 0, N = seg.size(); i < N; ++i )
+                func( seg.atLocal( i ) );
+    }
+    /// \return the largest row, or 0 if it's empty.
+    size_t maxRow() const
+    {
+        size_t res = 0;
+        if ( !m_compressed )
+        {
+            for ( auto r : m_dense )
+                res = std::max( res, r );
+            return res;
+        }
+        for ( const auto &seg : m_runs.segments() )
+            res = std::max( res, seg.atLocal( seg.size() - 1 ) ); // the last element of Incremental segment is its max.
+        return res;
+    }
+};
+
+} // namespace zj
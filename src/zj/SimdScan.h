@@ -0,0 +1,214 @@
+/*
+ * This file is part of the ftl (Fast Template Library) distribution (https://github.com/zjgoggle/ftl).
+ * Copyright (c) 2020 Jack Zhang.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <immintrin.h>
+#define ZJ_SIMD_X86 1
+#endif
+
+namespace zj
+{
+
+///////////////////////////////////////////////////////////////
+/// SIMD scan of structural chars, i.e. separators, newlines and quotes, producing bitmasks of 64 bytes at a time.
+/// The kernel is chosen at runtime by the instruction sets of CPU (see simd_level).
+///////////////////////////////////////////////////////////////
+
+/// \brief Set of up to MaxChars distinct bytes.
+class ByteSet
+{
+public:
+    static constexpr size_t MaxChars = 8;
+
+protected:
+    std::array<char, MaxChars> m_chars{};
+    size_t m_size = 0;
+    std::array<bool, 256> m_table{};
+
+public:
+    ByteSet() = default;
+    ByteSet( std::initializer_list<char> chars )
+    {
+        for ( char c : chars )
+            add( c );
+    }
+    /// \return false if there are already MaxChars chars.
+    bool add( char c )
+    {
+        if ( contains( c ) )
+            return true;
+        if ( m_size == MaxChars )
+            return false;
+        m_chars[m_size++] = c;
+        m_table[static_cast<unsigned char>( c )] = true;
+        return true;
+    }
+    bool contains( char c ) const
+    {
+        return m_table[static_cast<unsigned char>( c )];
+    }
+    size_t size() const
+    {
+        return m_size;
+    }
+    char operator[]( size_t i ) const
+    {
+        return m_chars[i];
+    }
+};
+
+/// \return bitmask of 64 bytes at p, in which bit i is set if p[i] is in set.
+using MatchMaskFunc = uint64_t ( * )( const char *p, const ByteSet &set );
+
+inline uint64_t match_mask64_scalar( const char *p, const ByteSet &set )
+{
+    uint64_t mask = 0;
+    for ( size_t i = 0; i < 64; ++i )
+        mask |= uint64_t( set.contains( p[i] ) ) << i;
+    return mask;
+}
+
+#ifdef ZJ_SIMD_X86
+__attribute__( ( target( "sse2" ) ) ) inline uint64_t match_mask64_sse2( const char *p, const ByteSet &set )
+{
+    uint64_t mask = 0;
+    for ( size_t k = 0; k < 4; ++k )
+    {
+        const __m128i bytes = _mm_loadu_si128( reinterpret_cast<const __m128i *>( p + k * 16 ) );
+        __m128i matched = _mm_setzero_si128();
+        for ( size_t i = 0; i < set.size(); ++i )
+            matched = _mm_or_si128( matched, _mm_cmpeq_epi8( bytes, _mm_set1_epi8( set[i] ) ) );
+        mask |= uint64_t( uint32_t( _mm_movemask_epi8( matched ) ) ) << ( k * 16 );
+    }
+    return mask;
+}
+__attribute__( ( target( "avx2" ) ) ) inline uint64_t match_mask64_avx2( const char *p, const ByteSet &set )
+{
+    const __m256i lo = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( p ) );
+    const __m256i hi = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( p + 32 ) );
+    __m256i matchedLo = _mm256_setzero_si256(), matchedHi = _mm256_setzero_si256();
+    for ( size_t i = 0; i < set.size(); ++i )
+    {
+        const __m256i c = _mm256_set1_epi8( set[i] );
+        matchedLo = _mm256_or_si256( matchedLo, _mm256_cmpeq_epi8( lo, c ) );
+        matchedHi = _mm256_or_si256( matchedHi, _mm256_cmpeq_epi8( hi, c ) );
+    }
+    return uint64_t( uint32_t( _mm256_movemask_epi8( matchedLo ) ) ) | uint64_t( uint32_t( _mm256_movemask_epi8( matchedHi ) ) ) << 32;
+}
+#endif
+
+enum class SimdLevel : uint8_t
+{
+    Scalar,
+    SSE2,
+    AVX2,
+};
+
+/// \return the best level supported by CPU.
+inline SimdLevel detect_simd_level()
+{
+#ifdef ZJ_SIMD_X86
+    if ( __builtin_cpu_supports( "avx2" ) )
+        return SimdLevel::AVX2;
+    if ( __builtin_cpu_supports( "sse2" ) )
+        return SimdLevel::SSE2;
+#endif
+    return SimdLevel::Scalar;
+}
+
+/// \brief The level used by scanners, detected once. Set it to a lower level, e.g. to compare kernels.
+inline SimdLevel &simd_level()
+{
+    static SimdLevel s = detect_simd_level();
+    return s;
+}
+
+/// \return the kernel of level, or of the best supported level below it.
+inline MatchMaskFunc match_mask_func( SimdLevel level = simd_level() )
+{
+#ifdef ZJ_SIMD_X86
+    static const SimdLevel supported = detect_simd_level();
+    if ( level > supported )
+        level = supported;
+    if ( level == SimdLevel::AVX2 )
+        return match_mask64_avx2;
+    if ( level == SimdLevel::SSE2 )
+        return match_mask64_sse2;
+#else
+    (void)level;
+#endif
+    return match_mask64_scalar;
+}
+
+/**
+ * @brief Visit the positions of bytes in set over [begin, end). Bitmasks of 64 bytes are computed by match_mask_func() and cached,
+ * so that only the matched positions are visited. The last partial block is copied into a padded buffer.
+ */
+class StructuralScanner
+{
+public:
+    static constexpr size_t BlockSize = 64;
+
+protected:
+    const char *m_end;
+    const ByteSet &m_set;
+    MatchMaskFunc m_func;
+    const char *m_block = nullptr; // [m_block, m_block + BlockSize) is cached in m_mask.
+    uint64_t m_mask = 0;
+
+public:
+    StructuralScanner( const char *end, const ByteSet &set, MatchMaskFunc func = match_mask_func() ) : m_end( end ), m_set( set ), m_func( func )
+    {
+    }
+
+    /// \return the first position at or after p of a byte in set, or end.
+    const char *next( const char *p )
+    {
+        while ( p < m_end )
+        {
+            if ( !m_block || p < m_block || p >= m_block + BlockSize )
+                loadBlock( p );
+            if ( uint64_t mask = m_mask & ( ~uint64_t( 0 ) << ( p - m_block ) ) )
+                return m_block + __builtin_ctzll( mask );
+            p = m_block + BlockSize;
+        }
+        return m_end;
+    }
+
+protected:
+    void loadBlock( const char *p )
+    {
+        m_block = p;
+        const size_t n = size_t( m_end - p );
+        if ( n >= BlockSize )
+            m_mask = m_func( p, m_set );
+        else
+        {
+            char buf[BlockSize] = {};
+            std::memcpy( buf, p, n );
+            m_mask = m_func( buf, m_set ) & ( ( uint64_t( 1 ) << n ) - 1 );
+        }
+    }
+};
+
+} // namespace zj
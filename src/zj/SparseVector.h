@@ -20,6 +20,11 @@
 #include <vector>
 #include <algorithm>
 #include <stdexcept>
+#include <string>
+#include <limits>
+#include <type_traits>
+#include <cassert>
+#include <sys/types.h>
 
 /// SparseVector
 
@@ -32,23 +37,32 @@ enum class SegType
     Duplicate, // all elements have the same value.
     Incremental // each element incremnets by 1
 };
+
+// Incremental segments are supported only by integral types other than bool.
+template<class T>
+constexpr bool is_incrementable_v = std::is_integral_v<T> && !std::is_same_v<T, bool>;
+
 template<class T>
 struct Segment
 {
     size_t m_size;
     size_t m_endIdx;
     SegType m_segType;
-    T m_value;
+    T m_value; // value of the first element.
 
-    const T &atGlobal( size_t idx ) const
+    // Returns by value, because elements of Incremental segment are computed.
+    T atGlobal( size_t idx ) const
     {
         assert( idx < m_endIdx && idx >= m_endIdx - m_size );
-        return m_segType == SegType::Duplicate ? m_value : ( m_value + idx - ( m_endIdx - m_size ) );
+        return atLocal( globalToLocal( idx ) );
     }
-    const T &atLocal( size_t idx ) const
+    T atLocal( size_t idx ) const
     {
         assert( idx < m_size );
-        return m_segType == SegType::Duplicate ? m_value : ( m_value + idx );
+        if constexpr ( is_incrementable_v<T> )
+            return m_segType == SegType::Duplicate ? m_value : T( m_value + idx );
+        else
+            return m_value;
     }
     size_t localToGlobal( size_t idx ) const
     {
@@ -58,6 +72,10 @@ struct Segment
     {
         return idx - ( m_endIdx - m_size );
     }
+    size_t beginIdx() const
+    {
+        return m_endIdx - m_size;
+    }
 
     size_t size() const
     {
@@ -65,12 +83,13 @@ struct Segment
     }
 };
 
+/// \brief Vector of runs. Duplicate runs of any T; Incremental runs if T is integral.
+/// at() is O(log(number of segments)).
 template<class T>
 struct SparseVector
 {
-    static_assert( std::is_integral_v<T>, "T must be integral!" );
-
     using this_type = SparseVector;
+    using value_type = T;
     static constexpr size_t MAXULONG = std::numeric_limits<size_t>::max();
     struct Iter
     {
@@ -81,7 +100,7 @@ struct SparseVector
 
         bool isEnd() const
         {
-            return iSeg = MAXULONG;
+            return iSeg == MAXULONG;
         }
         void setEnd()
         {
@@ -105,7 +124,7 @@ struct SparseVector
                 ++idxInSeg;
             return *this;
         }
-        Iter operator++( int ) const
+        Iter operator++( int )
         {
             Iter res = *this;
             this->operator++();
@@ -121,12 +140,16 @@ struct SparseVector
         {
             return ssize_t( a.index() ) - ssize_t( index() );
         }
-
-        const T *operator->() const
+        bool operator==( const Iter &a ) const
+        {
+            return iSeg == a.iSeg && ( isEnd() || idxInSeg == a.idxInSeg );
+        }
+        bool operator!=( const Iter &a ) const
         {
-            return &vec->m_segs[iSeg].atLocal( idxInSeg );
+            return !operator==( a );
         }
-        const T &operator*() const
+
+        T operator*() const
         {
             return vec->m_segs[iSeg].atLocal( idxInSeg );
         }
@@ -143,29 +166,101 @@ struct SparseVector
     }
     void push_back_incremental( const T &val, size_t n )
     {
+        static_assert( is_incrementable_v<T>, "Incremental segment requires integral type!" );
         size_t endIndex = m_segs.empty() ? n : ( m_segs.back().m_endIdx + n );
         m_segs.push_back( Seg{n, endIndex, SegType::Incremental, val} );
     }
+    /// \brief Append one element. It extends the last segment if val repeats its value, or if val is the next value of
+    /// an Incremental segment. A single-element Duplicate segment becomes Incremental if val is its value + 1.
+    void push_back( const T &val )
+    {
+        if ( !m_segs.empty() )
+        {
+            Seg &last = m_segs.back();
+            if ( last.m_segType == SegType::Duplicate && last.m_value == val )
+            {
+                ++last.m_size, ++last.m_endIdx;
+                return;
+            }
+            if constexpr ( is_incrementable_v<T> )
+            {
+                // val is the next value if val - m_value == m_size, computed in unsigned so that it neither overflows nor wraps around.
+                using U = std::make_unsigned_t<T>;
+                if ( ( last.m_segType == SegType::Incremental || last.m_size == 1 ) && last.m_value < val &&
+                     size_t( U( U( val ) - U( last.m_value ) ) ) == last.m_size )
+                {
+                    last.m_segType = SegType::Incremental;
+                    ++last.m_size, ++last.m_endIdx;
+                    return;
+                }
+            }
+        }
+        push_back_duplicates( val, 1 );
+    }
+    /// \brief Append n consecutive values val, val + 1, ... as push_back does for each, in O(1).
+    void append_incremental( const T &val, size_t n )
+    {
+        static_assert( is_incrementable_v<T>, "Incremental segment requires integral type!" );
+        if ( n == 0 )
+            return;
+        push_back( val );
+        if ( n == 1 )
+            return;
+        Seg &last = m_segs.back();
+        if ( last.m_segType == SegType::Duplicate && last.m_size > 1 ) // val repeats the last value.
+            return push_back_incremental( T( val + 1 ), n - 1 );
+        last.m_segType = SegType::Incremental;
+        last.m_size += n - 1, last.m_endIdx += n - 1;
+    }
     size_t size() const
     {
         return m_segs.empty() ? 0 : m_segs.back().m_endIdx;
     }
-    const T &at( size_t idx ) const
+    size_t countSegments() const
+    {
+        return m_segs.size();
+    }
+    const std::vector<Seg> &segments() const
+    {
+        return m_segs;
+    }
+    /// \return index of segment that contains element idx.
+    /// \pre idx < size()
+    size_t segmentIndex( size_t idx ) const
+    {
+        auto it = std::upper_bound( m_segs.begin(), m_segs.end(), idx, []( size_t i, const Seg &s ) { return i < s.m_endIdx; } );
+        assert( it != m_segs.end() );
+        return size_t( it - m_segs.begin() );
+    }
+    T at( size_t idx ) const
     {
         if ( m_segs.empty() || idx >= m_segs.back().m_endIdx )
             throw std::out_of_range( "SparseVector idx:" + std::to_string( idx ) );
-        auto it = std::upper_bound( m_segs.begin(), m_segs.end(), idx, [this]( int idx, const Seg &s ) { return idx < s.m_endIdx; } );
-        assert( it != m_segs.end() );
-        return m_segs.atGlobal( idx );
+        return m_segs[segmentIndex( idx )].atGlobal( idx );
     }
-    const T &operator[]( size_t idx ) const
+    T operator[]( size_t idx ) const
     {
-        return at( idx );
+        return m_segs[segmentIndex( idx )].atGlobal( idx );
     }
     bool empty() const
     {
         return m_segs.empty();
     }
+    void clear()
+    {
+        m_segs.clear();
+    }
+    /// Remove the trailing elements so that size() == n.
+    void truncate( size_t n )
+    {
+        while ( !m_segs.empty() && m_segs.back().beginIdx() >= n )
+            m_segs.pop_back();
+        if ( !m_segs.empty() && m_segs.back().m_endIdx > n )
+        {
+            m_segs.back().m_size -= m_segs.back().m_endIdx - n;
+            m_segs.back().m_endIdx = n;
+        }
+    }
     iterator end() const
     {
         return {this, MAXULONG, MAXULONG};
@@ -43,7 +43,6 @@ using StrVec = std::vector<std::string>;
 using IntVec = std::vector<int32_t>;
 using LongVec = std::vector<int64_t>;
 using ULongVec = std::vector<size_t>;
-using Timestamp = DateTime;
 
 
 using SCols = StrVec; // String Columns
@@ -140,10 +139,22 @@ auto Set( const std::vector<T> &v )
 
 static constexpr int32_t VAR_LENGTH = 0xFFFFFFFF;
 
+/// Storage encoding of a column in ColumnDataFrame. RowDataFrame ignores it.
+enum class ColumnEncoding : uint8_t
+{
+    Plain = 0,
+    Dictionary, // Str only: per-column dictionary of distinct values and integer codes.
+    RunLength, // scalar types: runs of duplicate values, or of incremental integers.
+    FrameOfReference, // Int32, Int64 and Timestamp: blocks of value - min, bit-packed (see IntBlockVector).
+    Delta, // Int32, Int64 and Timestamp: blocks of deltas, bit-packed.
+    DeltaOfDelta, // Int32, Int64 and Timestamp: blocks of deltas of deltas, bit-packed.
+};
+
 struct ColumnDef
 {
     FieldTypeTag colTypeTag;
     std::string colName;
+    ColumnEncoding encoding = ColumnEncoding::Plain;
 };
 
 using ColumnDefs = std::vector<ColumnDef>;
@@ -204,6 +215,17 @@ DEFINE_FIELDVALUE( Float32Vec, std::vector<float>, VAR_LENGTH );
 DEFINE_FIELDVALUE( Float64Vec, std::vector<double>, VAR_LENGTH );
 DEFINE_FIELDVALUE( TimestampVec, std::vector<Timestamp>, VAR_LENGTH );
 
+/// Str column stored as dictionary codes in ColumnDataFrame.
+inline ColumnDef DictStrCol( std::string name )
+{
+    return ColumnDef{FieldTypeTag::Str, std::move( name ), ColumnEncoding::Dictionary};
+}
+/// Scalar column stored as runs in ColumnDataFrame.
+inline ColumnDef RunCol( FieldTypeTag typeTag, std::string name )
+{
+    return ColumnDef{typeTag, std::move( name ), ColumnEncoding::RunLength};
+}
+
 
 
 /// \note the order of each field type must be consistent with the order of values in FieldTypeTag.
@@ -455,6 +477,11 @@ inline VarField field( std::string_view v )
 {
     return VarField{std::in_place_type_t<FieldValue<std::string>>(), FieldValue<std::string>{std::string( v )}};
 }
+template<>
+inline VarField field( DateTime v )
+{
+    return VarField{std::in_place_type_t<FieldValue<Timestamp>>(), FieldValue<Timestamp>{Timestamp( v )}};
+}
 
 // wrap function field.
 struct CreateField
@@ -532,6 +559,30 @@ inline bool is_field_compatible( const VarField &field, const ColumnDef &col, bo
         return true;
     return fieldType == colType;
 }
+/// \brief Get the value of a field of column type T. A numeric field of another type is converted to T as TypedColumn::append does.
+/// \param converted holds the converted value.
+/// \return nullptr if the field is null or incompatible with T.
+template<class T>
+const T *field_value_as( const VarField &field, T &converted )
+{
+    if constexpr ( !std::is_same_v<T, Null> )
+    {
+        if ( auto p = std::get_if<FieldValue<T>>( &field ) )
+            return &p->value;
+        if constexpr ( isNumericFieldType( FieldValue<T>::type ) )
+        {
+            if ( isNumericFieldType( FieldTypeTag( field.index() ) ) )
+            {
+                if ( auto intVal = getAsInt( field ) )
+                    converted = T( *intVal );
+                else
+                    converted = T( *getAsDouble( field ) );
+                return &converted;
+            }
+        }
+    }
+    return nullptr;
+}
 inline bool is_record_compatible( const Record &rec, const ColumnDefs &cols, std::ostream *err = nullptr, bool allowNullField = true )
 {
     if ( rec.size() != cols.size() )
@@ -584,6 +635,11 @@ inline std::string to_string( const std::string &s )
 {
     return "\"" + s + "\"";
 }
+template<>
+inline std::string to_string( const std::string_view &s )
+{
+    return "\"" + std::string( s ) + "\"";
+}
 
 template<>
 inline std::string to_string( const Timestamp &tsSinceEpoch )
@@ -786,20 +842,16 @@ bool from_string( FieldValue<T> &val, std::string_view s )
     {
         auto pEnd = s.data() + s.length();
         auto res = std::from_chars( s.data(), pEnd, val.value );
-        return res.ptr == pEnd;
+        return res.ec == std::errc() && res.ptr == pEnd; // out of range is an error.
     }
     else if constexpr ( std::is_floating_point_v<typename FieldValue<T>::value_type> )
     {
-        // todo: use std::from_chars
-        char *pLast;
+        // locale independent, and bounded by s, which is not null terminated.
+        if ( !s.empty() && s[0] == '+' && ( s.size() == 1 || s[1] != '-' ) )
+            s.remove_prefix( 1 );
         auto pEnd = s.data() + s.length();
-        auto x = strtold( s.data(), &pLast );
-        if ( pLast == pEnd )
-        {
-            val.value = x;
-            return true;
-        }
-        return false;
+        auto res = std::from_chars( s.data(), pEnd, val.value );
+        return res.ec == std::errc() && res.ptr == pEnd;
     }
     else if constexpr ( std::is_same_v<FieldValue<T>, TimestampField> ) // Timestamp
     {
@@ -903,7 +955,7 @@ struct hash_code<Timestamp>
 {
     size_t operator()( const Timestamp &v ) const
     {
-        return hashcode( v.count() );
+        return hashcode( v.nanos );
     }
 };
 template<>
@@ -2,15 +2,30 @@
 #include <zj/DataFrame.h>
 #include <zj/DataFrameIndex.h>
 #include <zj/RowDataFrame.h>
+#include <zj/ColumnDataFrame.h>
 #include <zj/DataFrameView.h>
 #include <zj/Condition.h>
 #include <zj/ReadCSV.h>
+#include <zj/CsvSchema.h>
+#include <zj/CsvFilter.h>
+#include <zj/MappedDataFrame.h>
+#include <zj/PartitionedDataFrame.h>
 #include <fstream>
+#include <filesystem>
 
 UNITTEST_MAIN
 
 using namespace zj;
 
+// underlying rows of a view, in the order of view rows.
+static std::vector<size_t> view_rows( const DataFrameView &v )
+{
+    std::vector<size_t> res;
+    for ( size_t i = 0; i < v.size(); ++i )
+        res.push_back( v.underlyingRow( i ) );
+    return res;
+}
+
 ADD_TEST_CASE( ReadCSV )
 {
 
@@ -118,6 +133,448 @@ Tom, "18", B, 22, "2020/12/13 10:00:10"
     }
 }
 
+ADD_TEST_CASE( ReadCSV_Tokenizer )
+{
+    using Rows = std::vector<std::vector<std::string>>;
+    const std::string text = "header line\n"
+                             "Name, Age, Note\n"
+                             "John, 23 , \"a, \\\"b\\\"\\nc\" \r\n"
+                             "\n"
+                             "   \n"
+                             "# comment line\n"
+                             "Tom,,\"\"\n"
+                             "Jeff, 12, x # rest\n"
+                             "Amy,\t7\t,\n"
+                             "Bob, 9, #comment";
+    const Rows expected = {{"Name", "Age", "Note"},
+                           {"John", "23", "a, \"b\"\nc"},
+                           {"Tom", "", ""},
+                           {"Jeff", "12", "x # rest"},
+                           {"Amy", "7"},
+                           {"Bob", "9"}};
+    CsvOptions opts;
+    opts.skipLines = 1;
+    opts.commentChar = '#';
+    Rows rows;
+    auto addRow = [&]( const std::vector<std::string_view> &fields ) {
+        rows.emplace_back( fields.begin(), fields.end() );
+        return true;
+    };
+    REQUIRE_EQ( scan_csv( std::string_view( text ), opts, addRow ), expected.size() );
+    REQUIRE( rows == expected );
+    for ( size_t blockSize : {1u, 3u, 7u, 64u} ) // records span blocks.
+    {
+        rows.clear();
+        std::stringstream ss( text );
+        scan_csv( ss, opts, addRow, blockSize );
+        REQUIRE( rows == expected );
+    }
+    std::stringstream ss( text );
+    REQUIRE( read_csv_strings( ss, ',', 1, ULLONG_MAX, nullptr, '#' ) == expected );
+
+    // reading stops after readMaxRecords, and the stream continues from the next record.
+    std::stringstream header( text );
+    REQUIRE( read_csv_strings( header, ',', 1, 1, nullptr, '#' ) == Rows( {expected[0]} ) );
+    REQUIRE_EQ( read_csv_strings( header, ',', 0, ULLONG_MAX, nullptr, '#' ).size(), expected.size() - 1 );
+
+    // a stream that can't seek is read line by line, so that it's not read past readMaxRecords.
+    struct NoSeekBuf : std::streambuf
+    {
+        std::string s;
+        explicit NoSeekBuf( std::string text ) : s( std::move( text ) )
+        {
+            setg( s.data(), s.data(), s.data() + s.size() );
+        }
+    } pipe( "a\n\"b\", 2\n\n\nc" );
+    std::istream pipeStream( &pipe );
+    REQUIRE( pipeStream.tellg() == std::istream::pos_type( -1 ) );
+    REQUIRE( read_csv_strings( pipeStream, ',', 0, 1 ) == Rows( {{"a"}} ) );
+    REQUIRE( read_csv_strings( pipeStream, ',', 0, 1 ) == Rows( {{"b", "2"}} ) );
+    REQUIRE( read_csv_strings( pipeStream, ',', 0, 1 ) == Rows( {{"c"}} ) );
+    REQUIRE( read_csv_strings( pipeStream, ',', 0, 1 ).empty() );
+
+    // filter, and no quoting.
+    std::stringstream filtered( "a|\"b\"\nc|d\n" );
+    auto filteredRows = read_csv_strings( filtered, '|', 0, ULLONG_MAX, []( std::vector<std::string> &row ) { return row[0] != "c"; }, 0, nullptr );
+    REQUIRE( filteredRows == Rows( {{"a", "\"b\""}} ) );
+
+    const std::string filename = ( std::filesystem::temp_directory_path() / "zj_ReadCSV_Tokenizer.csv" ).string();
+    {
+        std::ofstream ofs( filename, std::ios::binary | std::ios::trunc );
+        ofs << text;
+    }
+    rows.clear();
+    REQUIRE( scan_csv_file( filename, opts, addRow ) );
+    REQUIRE( rows == expected );
+    std::ofstream( filename, std::ios::trunc ).close();
+    REQUIRE( scan_csv_file( filename, opts, []( const std::vector<std::string_view> & ) { return true; } ) );
+    std::filesystem::remove( filename );
+    std::stringstream err;
+    REQUIRE( !scan_csv_file( filename, opts, []( const std::vector<std::string_view> & ) { return true; }, &err ) );
+
+    // separators: a trailing one doesn't start a field, and runs of a whitespace sep are one, unless sepStartsField.
+    std::stringstream aligned( "  a   b  c\n" ), tabs( "x\t\ty\n" ), trailingSep( "a,b,\na,,b\n" );
+    REQUIRE( read_csv_strings( aligned, ' ' ) == Rows( {{"a", "b", "c"}} ) );
+    REQUIRE( read_csv_strings( tabs, '\t' ) == Rows( {{"x", "y"}} ) );
+    REQUIRE( read_csv_strings( trailingSep ) == Rows( {{"a", "b"}, {"a", "", "b"}} ) );
+    CsvOptions rfc;
+    rfc.sepStartsField = true;
+    rows.clear();
+    scan_csv( std::string_view( "a,b,\na,,b\nc, #x\n" ), rfc, addRow );
+    REQUIRE( rows == Rows( {{"a", "b", ""}, {"a", "", "b"}, {"c", "#x"}} ) );
+    rfc.sep = '\t';
+    rfc.commentChar = '#';
+    rows.clear();
+    scan_csv( std::string_view( "x\t\ty\t\nz\t#x" ), rfc, addRow );
+    REQUIRE( rows == Rows( {{"x", "", "y", ""}, {"z", ""}} ) );
+    rfc.sep = ' ';
+    rows.clear();
+    scan_csv( std::string_view( "  a   b  c\n" ), rfc, addRow );
+    REQUIRE( rows == Rows( {{"", "", "a", "", "", "b", "", "c"}} ) );
+
+    std::stringstream unclosed( "a,\"b\n" ), trailing( "a,\"b\" c\n" );
+    REQUIRE_THROW( read_csv_strings( unclosed ), std::runtime_error );
+    REQUIRE_THROW( read_csv_strings( trailing ), std::runtime_error );
+}
+
+ADD_TEST_CASE( ReadCSV_Parallel )
+{
+    // records with quoted separators, escapes, newlines in quotes, comments and blank lines.
+    std::string text = "skipped\n";
+    for ( int i = 0; i < 3000; ++i )
+    {
+        text += std::to_string( i ) + ", \"q," + std::to_string( i % 7 ) + "\"";
+        if ( i % 5 == 0 )
+            text += ", \"multi\nline \\\"" + std::to_string( i ) + "\\\"\"";
+        else if ( i % 5 == 1 )
+            text += ", plain # comment";
+        else if ( i % 5 == 2 )
+            text += ",\n\n# comment line, \"\n";
+        text += "\n";
+    }
+    CsvOptions opts;
+    opts.skipLines = 1;
+    opts.commentChar = '#';
+    opts.newlineInQuotes = true;
+    std::stringstream ss( text );
+    std::vector<std::vector<std::string>> expected;
+    scan_csv( ss, opts, [&]( const std::vector<std::string_view> &fields ) {
+        expected.emplace_back( fields.begin(), fields.end() );
+        return true;
+    } );
+    REQUIRE_EQ( expected.size(), 3000u );
+    REQUIRE_EQ( expected[10][2], "multi\nline \"10\"" );
+    REQUIRE_EQ( expected[12].size(), 2u ); // the trailing separator doesn't start a field.
+
+    for ( size_t chunkSize : {1u, 5u, 97u, 4096u} ) // chunks split records, quoted newlines and escapes.
+        REQUIRE( read_csv_strings_parallel( text, opts, 4, chunkSize ) == expected );
+    REQUIRE( read_csv_strings_parallel( text, opts ) == expected );
+
+    auto ranges = split_csv_records( text, opts, 1000, 2 );
+    REQUIRE( ranges.size() > 1u );
+    REQUIRE_EQ( ranges.front().data(), text.data() + 8 );
+    size_t total = 0;
+    for ( auto range : ranges )
+        total += range.size();
+    REQUIRE_EQ( total, text.size() - 8 );
+
+    const std::string filename = ( std::filesystem::temp_directory_path() / "zj_ReadCSV_Parallel.csv" ).string();
+    {
+        std::ofstream ofs( filename, std::ios::binary | std::ios::trunc );
+        ofs << text;
+    }
+    std::vector<std::vector<std::string>> fileRows;
+    REQUIRE( read_csv_file_strings( filename, fileRows, opts, &std::cerr, 3 ) );
+    REQUIRE( fileRows == expected );
+    std::filesystem::remove( filename );
+
+    // errors in any chunk are thrown; newline in quotes is an error by default.
+    opts.newlineInQuotes = false;
+    REQUIRE_THROW( read_csv_strings_parallel( text, opts, 4, 97 ), std::runtime_error );
+}
+
+ADD_TEST_CASE( ReadCSV_BatchReader )
+{
+    std::string text = "Name, Qty, Price\n";
+    for ( int i = 0; i < 1000; ++i )
+        text += "\"sym, " + std::to_string( i ) + "\", " + std::to_string( i ) + ", " + std::to_string( i % 7 ) + ".5\n";
+    CsvOptions opts;
+    opts.skipLines = 1;
+    std::stringstream expectedSS( text );
+    const auto expected = read_csv_strings( expectedSS, ',', 1 );
+
+    // string batches with blocks smaller than a record.
+    std::stringstream ss( text );
+    CsvBatchReader reader( ss, opts, 300, 16 );
+    CsvRecordBatch batch;
+    size_t nbatches = 0, irow = 0;
+    while ( reader.next( batch ) )
+    {
+        ++nbatches;
+        REQUIRE( batch.size() <= 300u );
+        for ( size_t i = 0; i < batch.size(); ++i, ++irow )
+        {
+            REQUIRE_EQ( batch.countFields( i ), 3u );
+            REQUIRE( std::vector<std::string>( batch.record( i ).begin(), batch.record( i ).end() ) == expected.at( irow ) );
+        }
+    }
+    REQUIRE_EQ( nbatches, 4u );
+    REQUIRE_EQ( irow, 1000u );
+    REQUIRE( reader.atEnd() );
+    REQUIRE_EQ( reader.next( batch ), 0u );
+
+    // typed batches aggregated, and appended to RowDataFrame.
+    const std::string filename = ( std::filesystem::temp_directory_path() / "zj_ReadCSV_BatchReader.csv" ).string();
+    {
+        std::ofstream ofs( filename, std::ios::binary | std::ios::trunc );
+        ofs << text << "\"bad\", x, 1.0\n\"last\", 1000, 1.0\n";
+    }
+    const ColumnDefs colDefs = {StrCol( "Name" ), Int32Col( "Qty" ), {FieldTypeTag::Float64, "Price"}};
+    CsvBatchReader fileReader;
+    REQUIRE( !fileReader.open( "/nonexistent/zj.csv" ) );
+    REQUIRE( fileReader.open( filename, opts, 256, &std::cerr ) );
+    ColumnDataFrame typedBatch;
+    typedBatch.create( colDefs );
+    RowDataFrame all;
+    int64_t sumQty = 0;
+    size_t nrows = 0, nfailed = 0, nread = 0;
+    while ( !fileReader.atEnd() )
+    {
+        typedBatch.clearRecords();
+        if ( !fileReader.appendTo( typedBatch, nrows ) )
+            ++nfailed;
+        nread += nrows;
+        for ( int32_t qty : typedBatch.typedColumn<int32_t>( 1 )->values() )
+            sumQty += qty;
+        REQUIRE( all.append( typedBatch, &std::cerr ) );
+    }
+    std::filesystem::remove( filename );
+    REQUIRE_EQ( nread, 1002u );
+    REQUIRE_EQ( nfailed, 1u );
+    REQUIRE_EQ( sumQty, int64_t( 1000 * 1001 / 2 ) ); // the batch stopped at the bad record; the last record is in the next one.
+    REQUIRE_EQ( all.countRows(), 1001u );
+    REQUIRE_EQ( all( 999, "Name" ), field( "sym, 999" ) );
+    REQUIRE_EQ( all( 1000, "Qty" ), field( 1000 ) );
+}
+
+ADD_TEST_CASE( ReadCSV_Projection )
+{
+    const size_t ncols = 30;
+    std::string text = "# vendor file\n";
+    for ( size_t icol = 0; icol < ncols; ++icol )
+        text += ( icol ? ", C" : "C" ) + std::to_string( icol );
+    text += "\n";
+    for ( int irow = 0; irow < 500; ++irow )
+    {
+        for ( size_t icol = 0; icol < ncols; ++icol )
+        {
+            if ( icol )
+                text += ", ";
+            if ( icol % 5 == 1 )
+                text += "\"q \\\"" + std::to_string( irow ) + "\\\", " + std::to_string( icol ) + "\""; // quoted with escapes.
+            else
+                text += std::to_string( irow * 100 + int( icol ) );
+        }
+        text += "\n";
+    }
+    CsvOptions allOpts;
+    allOpts.skipLines = 2;
+    const auto all = read_csv_strings_parallel( text, allOpts, 1 );
+
+    CsvOptions opts;
+    opts.skipLines = 1;
+    REQUIRE( !select_csv_columns( text, {"C3", "Missing"}, opts ) );
+    REQUIRE( select_csv_columns( text, {"C21", "C3", "C15"}, opts, &std::cerr ) );
+    REQUIRE( opts.columns == std::vector<size_t>( {21, 3, 15} ) );
+    REQUIRE_EQ( opts.skipLines, 2u );
+
+    auto projected = read_csv_strings_parallel( text, opts, 3, 1000 );
+    REQUIRE_EQ( projected.size(), 500u );
+    for ( size_t irow = 0; irow < projected.size(); ++irow )
+        REQUIRE( projected[irow] == std::vector<std::string>( {all[irow][21], all[irow][3], all[irow][15]} ) );
+    REQUIRE_EQ( projected[7][0], "q \"7\", 21" );
+
+    RowDataFrame df( RowStorage::Compact );
+    REQUIRE( df.read_csv( text, {StrCol( "C21" ), Int32Col( "C3" ), Int64Col( "C15" )}, opts, &std::cerr ) );
+    REQUIRE_EQ( df.countCols(), 3u );
+    REQUIRE_EQ( df.countRows(), 500u );
+    REQUIRE_EQ( df( 499, "C3" ), field( 49903 ) );
+    REQUIRE_EQ( df( 2, "C21" ), field( "q \"2\", 21" ) );
+
+    // a record missing projected columns fails to append.
+    std::stringstream err;
+    REQUIRE( !df.read_csv( text + "1, 2, 3, 4\n", {StrCol( "C21" ), Int32Col( "C3" ), Int64Col( "C15" )}, opts, &err ) );
+    REQUIRE_EQ( df.countRows(), 500u );
+
+    std::stringstream ss( text );
+    CsvBatchReader reader( ss, opts, 100 );
+    CsvRecordBatch batch;
+    REQUIRE_EQ( reader.next( batch ), 100u );
+    REQUIRE_EQ( batch.countFields( 0 ), 3u );
+    REQUIRE_EQ( batch.field( 1, 1 ), "103" );
+}
+
+ADD_TEST_CASE( ReadCSV_PredicatePushdown )
+{
+    const char *syms[] = {"IBM", "MSFT", "AAPL", "GOOG", "ORCL"};
+    std::string text = "Time, Sym, Px, Qty, Note\n";
+    for ( int i = 0; i < 2000; ++i )
+        text += "2020/01/0" + std::to_string( 1 + i % 4 ) + " 10:00:" + std::to_string( 10 + i % 50 ) + ", " + syms[i % 5] + ", " +
+                std::to_string( 100 + i ) + ".5, " + std::to_string( i ) + ", \"note, " + std::to_string( i ) + "\"\n";
+    text += "2020/01/02 10:00:00, IBM, bad, 1, x\n"; // not matched, so the bad price isn't parsed.
+    const ColumnDefs colDefs = {TimestampCol( "Time" ), StrCol( "Sym" ), {FieldTypeTag::Float64, "Px"}, Int32Col( "Qty" ), StrCol( "Note" )};
+    CsvOptions opts;
+    opts.skipLines = 1;
+
+    const Timestamp day( mkDate( 2020, 1, 3 ) ), nextDay( mkDate( 2020, 1, 4 ) );
+    AndExpr where = Col( "Time" ) >= day && Col( "Time" ) < nextDay && Col( "Sym" ).isin( record( "IBM", "GOOG" ) );
+    RowDataFrame df;
+    REQUIRE( read_csv_where( df, text, colDefs, where, opts, &std::cerr ) );
+    size_t expected = 0;
+    for ( int i = 0; i < 2000; ++i )
+        expected += i % 4 == 2 && ( i % 5 == 0 || i % 5 == 3 );
+    REQUIRE_EQ( df.countRows(), expected );
+    for ( size_t irow = 0; irow < df.countRows(); ++irow )
+    {
+        const int i = std::get<Int32Field>( df( irow, "Qty" ) ).value;
+        REQUIRE( i % 4 == 2 && ( i % 5 == 0 || i % 5 == 3 ) );
+        REQUIRE_EQ( df( irow, "Note" ), field( "note, " + std::to_string( i ) ) );
+    }
+
+    // the same rows read from a stream into ColumnDataFrame.
+    ColumnDataFrame cdf;
+    std::stringstream ss( text );
+    REQUIRE( read_csv_where( cdf, ss, colDefs, where, opts, &std::cerr ) );
+    REQUIRE_EQ( cdf.size(), expected );
+
+    // a matched record that fails to parse stops reading.
+    std::stringstream err;
+    AndExpr ibm = Col( "Sym" ) == "IBM" && Col( "Qty" ) == 1;
+    REQUIRE( !read_csv_where( cdf, text, colDefs, ibm, opts, &err ) );
+    REQUIRE_EQ( cdf.size(), 0u );
+    AndExpr unknown = Col( "Venue" ) == "ARCA" && Col( "Qty" ) == 1;
+    REQUIRE( !read_csv_where( cdf, text, colDefs, unknown, opts, &err ) );
+}
+
+ADD_TEST_CASE( PartitionedDataFrame_ReadFiles )
+{
+    namespace fs = std::filesystem;
+    const fs::path dir = fs::temp_directory_path() / "zj_PartitionedDataFrame";
+    fs::remove_all( dir );
+    fs::create_directories( dir );
+    std::vector<std::string> filenames;
+    for ( int day = 1; day <= 6; ++day )
+    {
+        filenames.push_back( ( dir / ( "trades_2021010" + std::to_string( day ) + ".csv" ) ).string() );
+        std::ofstream ofs( filenames.back(), std::ios::binary | std::ios::trunc );
+        ofs << "Sym, Qty, Date\n";
+        for ( int i = 0; i < day * 100; ++i )
+            ofs << ( i % 2 ? "AAPL" : "\"IBM, Inc\"" ) << ", " << i << ", 2021-01-0" << day << "\n";
+        if ( day == 4 )
+            ofs << "Bad, x, 2021-01-04\n";
+    }
+    std::ofstream( dir / "other.txt" ) << "Sym, Qty, Date\n";
+    std::vector<std::string> matched;
+    REQUIRE( glob_files( ( dir / "trades_*.csv" ).string(), matched, &std::cerr ) );
+    REQUIRE( matched == filenames );
+    REQUIRE( match_wildcard( "a*b?c*", "aXXbYcZ" ) && !match_wildcard( "a*b?c", "abc" ) );
+
+    const ColumnDefs colDefs = {StrCol( "Sym" ), Int32Col( "Qty" ), TimestampCol( "Date" )};
+    CsvOptions opts;
+    opts.skipLines = 1;
+    PartitionedDataFrame df;
+    std::vector<CsvFileError> errors;
+    REQUIRE( !df.read_csv_glob( ( dir / "trades_*.csv" ).string(), colDefs, opts, 3, &errors ) );
+    REQUIRE_EQ( errors.size(), 1u ); // the bad file is skipped; the others are loaded.
+    REQUIRE_EQ( errors[0].filename, filenames[3] );
+    REQUIRE( errors[0].message.find( "\"x\"" ) != std::string::npos );
+    REQUIRE_EQ( df.countPartitions(), 5u );
+    REQUIRE_EQ( df.partitionName( 3 ), filenames[4] );
+    REQUIRE_EQ( df.countRows(), size_t( 100 + 200 + 300 + 500 + 600 ) );
+    REQUIRE_EQ( df.countCols(), 3u );
+    REQUIRE_EQ( df.partitionBegin( 3 ), 600u );
+    REQUIRE( ( df.partitionPos( 1099 ) == std::array<size_t, 2>{3, 499} ) );
+    REQUIRE_EQ( df( 600, "Qty" ), field( 0 ) );
+    REQUIRE_EQ( df( 601, 0 ), field( "AAPL" ) );
+    REQUIRE_EQ( df( 1699, "Date" ), field( Timestamp( *ParseDateTime( "2021-01-06" ) ) ) );
+    REQUIRE( !df.getColumn( 0 ) ); // columns of partitions are separate.
+    REQUIRE_THROW( df.at( df.countRows(), 0 ), std::out_of_range );
+
+    // partitions are shared, and copied only by deepCopy.
+    std::unique_ptr<IDataFrame> copy( df.deepCopy() );
+    REQUIRE_EQ( copy->countRows(), df.countRows() );
+    for ( size_t irow = 0; irow < df.countRows(); irow += 97 )
+        for ( size_t icol = 0; icol < df.countCols(); ++icol )
+            REQUIRE_EQ( copy->at( irow, icol ), df.at( irow, icol ) );
+
+    errors.clear();
+    REQUIRE( df.read_csv_files( {filenames[0], ( dir / "missing.csv" ).string()}, colDefs, opts, 0, &errors ) == false );
+    REQUIRE_EQ( df.countPartitions(), 1u );
+    REQUIRE_EQ( errors.size(), 1u );
+    REQUIRE( df.getColumn( 1 ) == df.partition( 0 ).getColumn( 1 ) );
+    REQUIRE( !df.read_csv_glob( ( dir / "none_*.csv" ).string(), colDefs, opts ) );
+    REQUIRE_EQ( df.countRows(), 0u );
+
+    auto other = std::make_shared<ColumnDataFrame>();
+    other->create( {StrCol( "Sym" ), Int64Col( "Qty" ), TimestampCol( "Date" )} );
+    REQUIRE( !df.addPartition( other, "other" ) );
+    fs::remove_all( dir );
+}
+
+ADD_TEST_CASE( SimdScan_StructuralChars )
+{
+    std::string text;
+    uint32_t seed = 7;
+    for ( int i = 0; i < 1000; ++i )
+    {
+        seed = seed * 1103515245 + 12345;
+        const char chars[] = "ab ,\n\"\\x\t";
+        text += chars[( seed >> 16 ) % ( sizeof( chars ) - 1 )];
+    }
+    const ByteSet set{',', '\n', '"', '\\'};
+    REQUIRE( set.contains( '"' ) && !set.contains( 'a' ) );
+    std::vector<size_t> expected;
+    for ( size_t i = 0; i < text.size(); ++i )
+        if ( set.contains( text[i] ) )
+            expected.push_back( i );
+
+    const SimdLevel detected = simd_level();
+    for ( SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2} )
+    {
+        MatchMaskFunc func = match_mask_func( level );
+        for ( size_t pos = 0; pos + 64 <= text.size(); pos += 13 )
+            REQUIRE_EQ( func( text.data() + pos, set ), match_mask64_scalar( text.data() + pos, set ) );
+
+        for ( size_t begin : {0u, 5u, 63u, 64u} ) // partial last blocks.
+        {
+            const char *end = text.data() + text.size() - begin / 2;
+            StructuralScanner scanner( end, set, func );
+            std::vector<size_t> found;
+            for ( const char *p = scanner.next( text.data() + begin ); p < end; p = scanner.next( p + 1 ) )
+                found.push_back( size_t( p - text.data() ) );
+            std::vector<size_t> want;
+            for ( size_t i : expected )
+                if ( i >= begin && text.data() + i < end )
+                    want.push_back( i );
+            REQUIRE( found == want );
+        }
+
+        // the tokenizer gives the same fields with every kernel.
+        simd_level() = level;
+        CsvOptions opts;
+        opts.newlineInQuotes = true;
+        std::string csv;
+        for ( int i = 0; i < 200; ++i )
+            csv += std::to_string( i ) + ", \"long quoted, field with \\\"escapes\\\" and\nnewline " + std::to_string( i ) +
+                   "\", unquoted field of some length, x\n";
+        auto rows = read_csv_strings_parallel( csv, opts, 2, 300 );
+        simd_level() = detected;
+        REQUIRE_EQ( rows.size(), 200u );
+        REQUIRE_EQ( rows[7][1], "long quoted, field with \"escapes\" and\nnewline 7" );
+        REQUIRE_EQ( rows[199][2], "unquoted field of some length" );
+    }
+}
+
 ADD_TEST_CASE( DataFrame_Basic )
 {
     using Tup = std::tuple<std::string, int, float, char, Timestamp>;
@@ -150,6 +607,13 @@ ADD_TEST_CASE( DataFrame_Basic )
         //-- append
         REQUIRE( df.append( df1, &std::cerr ) );
         REQUIRE_EQ( df.size(), 4u );
+
+        RowDataFrame empty; // takes columns and rows of rhs.
+        REQUIRE( empty.append( df1, &std::cerr ) );
+        REQUIRE_EQ( empty.countCols(), 5u );
+        REQUIRE_EQ( empty.size(), 2u );
+        REQUIRE_EQ( empty( 1, "Name" ), field( "Jeff" ) );
+        REQUIRE_EQ( empty( 0, "BirthDate" ), field( mkDate( 2010, 10, 22 ) ) );
     }
     SECTION( "VectorRef" )
     {
@@ -405,3 +869,1214 @@ ADD_TEST_CASE( DataFrame_Basic )
         std::cout << "------- view of  Level >= B || Score < 45.5 -----\n" << viewOr << std::endl;
     }
 }
+
+ADD_TEST_CASE( ColumnDataFrame_Basic )
+{
+    using Tup = std::tuple<std::string, int, float, char, Timestamp>;
+    using Tups = std::vector<Tup>;
+    ColumnDataFrame df, df1;
+
+    std::vector<ColumnDef> colDefs = {
+            StrCol( "Name" ), Int32Col( "Age" ), {FieldTypeTag::Char, "Level"}, {FieldTypeTag::Float32, "Score"}, TimestampCol( "BirthDate" )};
+    std::vector<StrVec> records{{"John", "23", "A", "29.3", "2000/10/22"}, {"Tom", "18", "B", "45.2", "N/A"}};
+    REQUIRE( df.from_rows( records, colDefs, &std::cerr ) );
+    REQUIRE( !df.appendRowStr( {"Bad", "x", "C", "1.0", "N/A"} ) ); // failed row is rolled back.
+    REQUIRE_EQ( df.size(), 2u );
+    REQUIRE_EQ( df( 0, 1 ), field( 23 ) );
+    REQUIRE_EQ( df( 1, "BirthDate" ).index(), 0u ); // null
+    REQUIRE( df.column( "BirthDate" ).isNull( 1 ) );
+    REQUIRE_EQ( df.typedColumn<int32_t>( 1 )->values(), IntVec( {23, 18} ) );
+
+    REQUIRE( df1.from_tuples( Tups{Tup{"Jonathon", 24, 23.3, 'A', mkDate( 2010, 10, 22 )}, Tup{"Jeff", 12, 43.5, 'C', mkDate( 2008, 10, 22 )}},
+                              {"Name", "Age", "Score", "Level", "BirthDate"},
+                              &std::cerr ) );
+    REQUIRE( df.append( df1, &std::cerr ) );
+    REQUIRE_EQ( df.size(), 4u );
+    REQUIRE_EQ( df( 3, "Name" ), field( "Jeff" ) );
+    {
+        struct BadAgeFrame : ColumnDataFrame // returns a Str field for Age of row 1.
+        {
+            VarField bad = field( "x" );
+            using ColumnDataFrame::at;
+            const VarField &at( size_t irow, size_t icol ) const override
+            {
+                return irow == 1 && icol == colIndex( "Age" ) ? bad : ColumnDataFrame::at( irow, icol );
+            }
+        } badAge;
+        REQUIRE( badAge.append( df1, &std::cerr ) );
+        std::ostringstream err;
+        REQUIRE( !df.append( badAge, &err ) );
+        REQUIRE( err.str().find( "append: Incompatible field" ) == 0 );
+        REQUIRE_EQ( df.size(), 4u ); // rows of rhs are all rolled back.
+        for ( size_t j = 0; j < df.countCols(); ++j )
+            REQUIRE_EQ( df.column( j ).size(), 4u );
+    }
+
+    SECTION( "Index & View" )
+    {
+        MultiColHashMultiIndex hidxLevel;
+        hidxLevel.create( df, StrVec{"Level"} );
+        REQUIRE_EQ( Set( hidxLevel[record( 'A' )] ), Set( ULongVec{0, 2} ) );
+
+        OrderedIndex orderedAge;
+        orderedAge.create( df, "Age" );
+        DataFrameView gv;
+        gv.create( df, orderedAge.getRowIndices(), SCols{"Name", "Level", "Age"} );
+        REQUIRE_EQ( gv.at( 0, "Name" ), field( "Jeff" ) );
+        std::cout << "---- ColumnDataFrame View: sorted by age ----\n" << gv << std::endl;
+    }
+    SECTION( "DataFrameWithIndex" )
+    {
+        DataFrameWithIndex dfidx( IDataFramePtr( df.deepCopy() ) );
+        dfidx.addHashIndex( {"Name"} );
+        dfidx.addOrderedIndex( {"Level"} );
+        REQUIRE_EQ( dfidx.select( Col( "Name" ).isin( record( "John", "Jeff" ) ) ).size(), 2u );
+        REQUIRE_EQ( dfidx.select( Col( "Level" ) >= 'B' && Col( "Age" ) > 12 ).size(), 1u );
+        REQUIRE_EQ( dfidx.select( Col( "Level" ) >= 'B' || Col( "Score" ) < 45.5 ).size(), 4u );
+    }
+}
+
+ADD_TEST_CASE( ColumnDataFrame_ReadCSV )
+{
+    const std::string text = "Name, Age, Score, BirthDate, Venue\n"
+                             "John, 23, 29.3, 2000/10/22, ARCA\n"
+                             "\"Smith, Tom\", \"18\", 45.2, N/A, NYSE\n"
+                             "\n"
+                             "Jeff, 12, 43.5, 2008/10/22 10:00:10, ARCA\n";
+    ColumnDefs colDefs = {StrCol( "Name" ), Int32Col( "Age" ), {FieldTypeTag::Float64, "Score"}, TimestampCol( "BirthDate" ), StrCol( "Venue" )};
+    colDefs[4].encoding = ColumnEncoding::Dictionary;
+    CsvOptions opts;
+    opts.skipLines = 1;
+
+    ColumnDataFrame df, expected;
+    REQUIRE( df.read_csv( text, colDefs, opts, &std::cerr ) );
+    std::stringstream ss( text );
+    REQUIRE( expected.from_rows( read_csv_strings( ss, ',', 1 ), colDefs, &std::cerr ) );
+    REQUIRE_EQ( df.size(), 3u );
+    REQUIRE_EQ( df( 1, "Name" ), field( "Smith, Tom" ) );
+    REQUIRE_EQ( df.typedColumn<int32_t>( 1 )->values(), IntVec( {23, 18, 12} ) );
+    REQUIRE( df.column( 1 ).plainValues() == df.typedColumn<int32_t>( 1 )->values().data() );
+    REQUIRE( !df.column( "Name" ).plainValues() );
+    REQUIRE( df.column( "BirthDate" ).isNull( 1 ) );
+    for ( size_t irow = 0; irow < df.size(); ++irow )
+        for ( size_t icol = 0; icol < df.countCols(); ++icol )
+            REQUIRE_EQ( df( irow, icol ), expected( irow, icol ) );
+
+    ColumnDataFrame dfStream;
+    std::stringstream is( text );
+    REQUIRE( dfStream.read_csv( is, colDefs, opts, &std::cerr ) );
+    REQUIRE_EQ( dfStream.size(), 3u );
+    REQUIRE_EQ( dfStream( 2, "Venue" ), field( "ARCA" ) );
+
+    const std::string filename = ( std::filesystem::temp_directory_path() / "zj_ColumnDataFrame_ReadCSV.csv" ).string();
+    {
+        std::ofstream ofs( filename, std::ios::binary | std::ios::trunc );
+        ofs << text << "Bad, x, 1.0, N/A, ARCA\nLast, 1, 1.0, N/A, ARCA\n";
+    }
+    ColumnDataFrame dfFile;
+    std::stringstream err;
+    REQUIRE( !dfFile.read_csv_file( filename, colDefs, opts, &err ) ); // stops at the bad record, keeping records before it.
+    REQUIRE_EQ( dfFile.size(), 3u );
+    REQUIRE( err.str().find( "\"x\"" ) != std::string::npos );
+    std::filesystem::remove( filename );
+    REQUIRE( !dfFile.read_csv_file( filename, colDefs, opts ) );
+
+    // RowDataFrame parses fields of string_view too.
+    RowDataFrame rdf( RowStorage::Arena );
+    REQUIRE( rdf.from_rows( {}, colDefs ) );
+    scan_csv( std::string_view( text ), opts, [&]( const std::vector<std::string_view> &fields ) {
+        return rdf.appendRowStr( fields, &std::cerr );
+    } );
+    REQUIRE_EQ( rdf.size(), 3u );
+    REQUIRE_EQ( rdf( 1, "Name" ), field( "Smith, Tom" ) );
+}
+
+ADD_TEST_CASE( FieldParser_Conversion )
+{
+    // TimestampParser gives the same values as ParseDateTime, whether or not the layout is locked.
+    auto check = [&]( const std::vector<std::string> &strs, bool bLocked ) {
+        TimestampParser parser;
+        for ( const auto &s : strs )
+        {
+            Timestamp ts, expected;
+            auto dt = ParseDateTime( s );
+            REQUIRE_EQ( parser( s, ts ), dt.has_value() );
+            if ( !dt )
+                continue;
+            expected = *dt;
+            REQUIRE_EQ( ts, expected );
+            REQUIRE_EQ( ts.to_string(), expected.to_string() );
+        }
+        REQUIRE_EQ( parser.locked(), bLocked );
+    };
+    check( {"2020-12-25T12:05:02.123", "2021-01-01T00:00:00.5", "1999-02-28T23:59:59.123456789", "2020-12-25 12:05:02", "2020/12/25"}, true );
+    check( {"2020-12-25", "2021-02-29", "2020-13-01", "2020-1-01", "20201225", "x"}, true );
+    check( {"20201225 12:05:02", "20201225T120502", "2020-12-25T12:05:02Z"}, true );
+    check( {"2020-12-25T12:05:02+08:00", "2020-12-25T12:05:02"}, false );
+    check( {"12/25/2020", "2020-12-25"}, false );
+
+    // floats are parsed by from_chars.
+    Float64Field f;
+    REQUIRE( from_string( f, std::string_view( "+1.5" ) ) && f.value == 1.5 );
+    REQUIRE( from_string( f, std::string_view( "1e3" ) ) && f.value == 1000 );
+    REQUIRE( from_string( f, std::string_view( "-0.25" ) ) && f.value == -0.25 );
+    REQUIRE( !from_string( f, std::string_view( "" ) ) );
+    REQUIRE( !from_string( f, std::string_view( "+-1" ) ) );
+    REQUIRE( !from_string( f, std::string_view( "1.5x" ) ) );
+    REQUIRE( !from_string( f, std::string_view( "1e999" ) ) );
+
+    // appendStrs converts a column of strings, stopping at the first bad one.
+    std::vector<std::string_view> strs = {"1", "2", "N/A", "4", "x", "6"};
+    auto col = create_column( FieldTypeTag::Int32 );
+    REQUIRE_EQ( col->appendStrs( strs.data(), strs.size() ), 4u );
+    REQUIRE_EQ( col->size(), 4u );
+    REQUIRE( col->isNull( 2 ) );
+    VarField var;
+    col->get( 3, var );
+    REQUIRE_EQ( var, field( 4 ) );
+    auto tsCol = create_column( FieldTypeTag::Timestamp );
+    std::vector<std::string_view> times = {"2020-12-25", "2020-12-26 01:02:03", "12/27/2020"};
+    REQUIRE_EQ( tsCol->appendStrs( times.data(), times.size() ), 3u );
+    tsCol->get( 2, var );
+    REQUIRE_EQ( var, field( Timestamp( *ParseDateTime( "12/27/2020" ) ) ) );
+}
+
+ADD_TEST_CASE( CsvSchema_Inference )
+{
+    REQUIRE( CsvColumnInference::is_bool_str( "True" ) && CsvColumnInference::is_bool_str( "N" ) );
+    REQUIRE( !CsvColumnInference::is_bool_str( "Tom" ) && !CsvColumnInference::is_bool_str( "10" ) );
+    {
+        CsvColumnInference col;
+        for ( auto s : {"1", "0", "N/A", "12"} )
+            col.add( s );
+        REQUIRE( col.type() == FieldTypeTag::Int32 );
+        col.add( "1.5" );
+        REQUIRE( col.type() == FieldTypeTag::Float64 );
+        col.add( "" );
+        REQUIRE( col.type() == FieldTypeTag::Str );
+    }
+    {
+        CsvColumnInference col;
+        col.add( "3000000000" ); // out of Int32 range.
+        REQUIRE( col.type() == FieldTypeTag::Int64 );
+    }
+
+    std::string text = "# generated\nFlag, Id, Big, Price, When, Name, Missing\n";
+    for ( int i = 0; i < 300; ++i )
+        text += std::string( i % 2 ? "y" : "N" ) + ", " + std::to_string( i ) + ", " + std::to_string( i < 250 ? i : ( 1ll << 40 ) + i ) +
+                ", " + std::to_string( i ) + ".25, 2020/01/02 10:00:" + std::to_string( 10 + i % 40 ) + ", \"name, " + std::to_string( i ) +
+                "\", N/A\n";
+    CsvOptions opts;
+    opts.skipLines = 1;
+    CsvSchemaOptions schemaOpts;
+    schemaOpts.sampleRows = 100;
+    CsvSchema schema = infer_csv_schema( text, opts, schemaOpts );
+    REQUIRE( schema.hasHeader );
+    REQUIRE_EQ( schema.sampledRows, 99u );
+    ColumnDefs expected = {{FieldTypeTag::Bool, "Flag"},
+                           {FieldTypeTag::Int32, "Id"},
+                           {FieldTypeTag::Int32, "Big"},
+                           {FieldTypeTag::Float64, "Price"},
+                           {FieldTypeTag::Timestamp, "When"},
+                           {FieldTypeTag::Str, "Name"},
+                           {FieldTypeTag::Str, "Missing"}};
+    for ( size_t i = 0; i < expected.size(); ++i )
+    {
+        REQUIRE_EQ( schema.columnDefs.at( i ).colName, expected[i].colName );
+        REQUIRE( schema.columnDefs.at( i ).colTypeTag == expected[i].colTypeTag );
+    }
+
+    // spread-out chunks find the large values near the end.
+    schemaOpts.sampleChunks = 8;
+    schemaOpts.chunkRows = 10;
+    schema = infer_csv_schema( text, opts, schemaOpts );
+    REQUIRE( schema.columnDefs.at( 2 ).colTypeTag == FieldTypeTag::Int64 );
+    REQUIRE_EQ( schema.sampledRows, 99u + 80u );
+    ColumnDataFrame df;
+    REQUIRE( df.read_csv( text, schema.columnDefs, schema.dataOptions( opts ), &std::cerr ) );
+    REQUIRE_EQ( df.size(), 300u );
+    REQUIRE_EQ( df( 299, "Big" ), field( int64_t( ( 1ll << 40 ) + 299 ) ) );
+    REQUIRE_EQ( df( 3, "Name" ), field( "name, 3" ) );
+
+    // without header, columns are named by position; the stream is positioned back.
+    std::stringstream is( "1, a, 2020/01/02\n2, b, 2020/01/03\n" );
+    schema = infer_csv_schema( is );
+    REQUIRE( !schema.hasHeader );
+    REQUIRE_EQ( schema.sampledRows, 2u );
+    REQUIRE_EQ( schema.columnDefs.at( 0 ).colName, "Col0" );
+    REQUIRE( schema.columnDefs.at( 0 ).colTypeTag == FieldTypeTag::Int32 );
+    REQUIRE( schema.columnDefs.at( 2 ).colTypeTag == FieldTypeTag::Timestamp );
+    REQUIRE( df.read_csv( is, schema.columnDefs, schema.dataOptions( {} ) ) );
+    REQUIRE_EQ( df.size(), 2u );
+
+    // all Str columns: distinct names are a header unless it's absent.
+    const std::string names = "Sym, Venue\nIBM, ARCA\nMSFT, NYSE\n";
+    REQUIRE( infer_csv_schema( names ).hasHeader );
+    schemaOpts = {};
+    schemaOpts.header = CsvHeader::Absent;
+    REQUIRE_EQ( infer_csv_schema( names, {}, schemaOpts ).sampledRows, 3u );
+
+    CsvSchema fileSchema;
+    REQUIRE( !infer_csv_file_schema( "/nonexistent/zj.csv", fileSchema ) );
+}
+
+ADD_TEST_CASE( ColumnDataFrame_Nulls )
+{
+    SECTION( "Bitmap" )
+    {
+        Bitmap bits( 70, true );
+        bits.set( 3, false );
+        bits.set( 65, false );
+        REQUIRE_EQ( bits.count(), 68u );
+        std::vector<size_t> unset;
+        bits.foreachUnset( [&]( size_t i ) { unset.push_back( i ); } );
+        REQUIRE_EQ( unset, ULongVec( {3, 65} ) );
+        bits.resize( 66 );
+        bits.flip();
+        REQUIRE_EQ( bits.count(), 2u );
+    }
+
+    std::vector<ColumnDef> colDefs = {StrCol( "Name" ), Int32Col( "Age" ), Float64Col( "Score" )};
+    std::vector<StrVec> records{{"John", "23", "29.3"}, {"Tom", "N/A", "45.2"}, {"Jeff", "12", "N/A"}, {"Ann", "N/A", "40"}};
+    ColumnDataFrame cdf( records, colDefs );
+    RowDataFrame rdf( records, colDefs );
+    REQUIRE_EQ( cdf.column( "Age" ).countNulls(), 2u );
+
+    DataFrameWithIndex cidx( IDataFramePtr( cdf.deepCopy() ) ), ridx( IDataFramePtr( rdf.deepCopy() ) );
+    REQUIRE_EQ( view_rows( cidx.select( Col( "Age" ).isnull() ) ), ULongVec( {1, 3} ) );
+    REQUIRE_EQ( view_rows( cidx.select( Col( "Age" ).notnull() ) ), ULongVec( {0, 2} ) );
+    REQUIRE_EQ( view_rows( cidx.select( !Col( "Score" ).notnull() ) ), ULongVec( {2} ) );
+    REQUIRE_EQ( view_rows( ridx.select( Col( "Age" ).isnull() ) ), ULongVec( {1, 3} ) ); // row frame by slow path
+
+    // typed scans on columnar storage match VarField compare semantic: null < any value.
+    REQUIRE_EQ( view_rows( cidx.select( Col( "Age" ) < 20 ) ), view_rows( ridx.select( Col( "Age" ) < 20 ) ) );
+    REQUIRE_EQ( view_rows( cidx.select( Col( "Age" ) >= 12.5 ) ), view_rows( ridx.select( Col( "Age" ) >= 12.5 ) ) );
+    REQUIRE_EQ( view_rows( cidx.select( Col( "Score" ) != 45.2 ) ), view_rows( ridx.select( Col( "Score" ) != 45.2 ) ) );
+    REQUIRE_EQ( view_rows( cidx.select( Col( "Name" ) <= "John" ) ), view_rows( ridx.select( Col( "Name" ) <= "John" ) ) );
+    REQUIRE_EQ( view_rows( cidx.select( Col( "Age" ).notnull() && Col( "Name" ) == "Jeff" ) ), ULongVec( {2} ) );
+}
+
+ADD_TEST_CASE( ColumnDataFrame_Dictionary )
+{
+    std::vector<ColumnDef> colDefs = {DictStrCol( "Venue" ), DictStrCol( "Symbol" ), Int32Col( "Qty" )};
+    std::vector<StrVec> records{{"NYSE", "MSFT", "100"},
+                                {"ARCA", "AAPL", "200"},
+                                {"NYSE", "IBM", "300"},
+                                {"N/A", "AAPL", "400"},
+                                {"BATS", "MSFT", "500"},
+                                {"ARCA", "MSFT", "600"}};
+    ColumnDataFrame cdf( records, colDefs );
+    RowDataFrame rdf( records, colDefs );
+    const DictStrColumn *venues = cdf.dictColumn( 0 );
+    REQUIRE( venues );
+    REQUIRE_EQ( venues->dictionary().size(), 3u );
+    REQUIRE( !venues->dictionary().isSorted() );
+    REQUIRE_EQ( cdf( 2, "Venue" ), field( "NYSE" ) );
+    REQUIRE_EQ( cdf( 3, "Venue" ).index(), 0u ); // null
+
+    // predicates on codes match predicates on strings.
+    auto checkSelects = [&]( DataFrameWithIndex &cidx, DataFrameWithIndex &ridx ) {
+        REQUIRE_EQ( view_rows( cidx.select( Col( "Venue" ) == "NYSE" ) ), ULongVec( {0, 2} ) );
+        REQUIRE_EQ( view_rows( cidx.select( Col( "Venue" ) != "NYSE" ) ), view_rows( ridx.select( Col( "Venue" ) != "NYSE" ) ) );
+        REQUIRE_EQ( view_rows( cidx.select( Col( "Venue" ) == "CBOE" ) ), ULongVec{} );
+        REQUIRE_EQ( view_rows( cidx.select( Col( "Venue" ) < "BATS" ) ), view_rows( ridx.select( Col( "Venue" ) < "BATS" ) ) );
+        REQUIRE_EQ( view_rows( cidx.select( Col( "Venue" ) >= "BATS" ) ), view_rows( ridx.select( Col( "Venue" ) >= "BATS" ) ) );
+        REQUIRE_EQ( view_rows( cidx.select( Col( "Venue" ) > "CBOE" ) ), view_rows( ridx.select( Col( "Venue" ) > "CBOE" ) ) );
+        REQUIRE_EQ( view_rows( cidx.select( Col( "Venue" ).isin( record( "ARCA", "BATS" ) ) ) ), ULongVec( {1, 4, 5} ) );
+        REQUIRE_EQ( view_rows( cidx.select( Col( "Venue" ).notin( record( "ARCA", "BATS" ) ) ) ),
+                    view_rows( ridx.select( Col( "Venue" ).notin( record( "ARCA", "BATS" ) ) ) ) );
+        REQUIRE_EQ( view_rows( cidx.select( Col( "Qty" ) > 100 && Col( "Symbol" ) == "MSFT" ) ), ULongVec( {4, 5} ) );
+    };
+    {
+        DataFrameWithIndex cidx( IDataFramePtr( cdf.deepCopy() ) ), ridx( IDataFramePtr( rdf.deepCopy() ) );
+        checkSelects( cidx, ridx );
+    }
+    cdf.sortDictionaries();
+    REQUIRE( cdf.dictColumn( 0 )->dictionary().isSorted() );
+    REQUIRE_EQ( cdf( 4, "Venue" ), field( "BATS" ) );
+    {
+        DataFrameWithIndex cidx( IDataFramePtr( cdf.deepCopy() ) ), ridx( IDataFramePtr( rdf.deepCopy() ) );
+        checkSelects( cidx, ridx );
+    }
+
+    SECTION( "Code index" )
+    {
+        MultiColHashMultiIndex hidx;
+        hidx.create( cdf, StrVec{"Symbol", "Venue"} );
+        REQUIRE( hidx.isCodeIndex() );
+        REQUIRE( hidx.isMultiValue() == false );
+        REQUIRE_EQ( hidx[record( "MSFT", "NYSE" )], ULongVec( {0} ) );
+        Record nullVenue{field( "AAPL" ), NullField{}};
+        REQUIRE_EQ( hidx[nullVenue], ULongVec( {3} ) );
+        REQUIRE( !hidx.at( record( "IBM", "ARCA" ) ) );
+        REQUIRE( !hidx.at( record( "GOOG", "ARCA" ) ) );
+
+        DataFrameWithIndex cidx( IDataFramePtr( cdf.deepCopy() ) );
+        cidx.addHashIndex( {"Symbol"} );
+        REQUIRE_EQ( Set( view_rows( cidx.select( Col( "Symbol" ).isin( record( "AAPL", "IBM" ) ) ) ) ), Set( ULongVec{1, 2, 3} ) );
+        REQUIRE_EQ( view_rows( cidx.select( Col( "Symbol" ) != "MSFT" ) ), ULongVec( {1, 2, 3} ) );
+    }
+    SECTION( "Shared dictionary" )
+    {
+        ColumnDataFrame other;
+        other.create( {DictStrCol( "Venue" )} );
+        REQUIRE( other.shareDictionary( 0, cdf, 0, &std::cerr ) );
+        REQUIRE( other.appendRowStr( {"ARCA"} ) );
+        REQUIRE( other.dictColumn( 0 )->sharesDictionary( *cdf.dictColumn( 0 ) ) );
+        REQUIRE_EQ( other.dictColumn( 0 )->codeAt( 0 ), cdf.dictColumn( 0 )->codeAt( 1 ) );
+        REQUIRE( !cdf.shareDictionary( 0, other, 0 ) ); // not empty
+
+        std::unique_ptr<ColumnDataFrame> copy( static_cast<ColumnDataFrame *>( cdf.deepCopy() ) );
+        const size_t dictSize = cdf.dictColumn( 0 )->dictionary().size();
+        REQUIRE( !copy->dictColumn( 0 )->sharesDictionary( *cdf.dictColumn( 0 ) ) );
+        REQUIRE( copy->appendRowStr( {"CBOE", "IBM", "700"} ) );
+        REQUIRE_EQ( cdf.dictColumn( 0 )->dictionary().size(), dictSize );
+        REQUIRE_EQ( copy->dictColumn( 0 )->dictionary().size(), dictSize + 1 );
+        REQUIRE_EQ( copy->at( 1, 0 ), cdf.at( 1, 0 ) );
+    }
+}
+
+ADD_TEST_CASE( CompactField_Basic )
+{
+    SECTION( "Conversion" )
+    {
+        Record rec{field( "John" ), field( 23 ), field( int64_t( 7 ) ), field( 2.5 ), field( 'A' ), field( true ),
+                   field( mkDate( 2010, 10, 22 ) ), field( IntVec{1, 2, 3} ), field( StrVec{"a", "b"} ), NullField{}};
+        CompactRecord crec = to_compact( rec );
+        REQUIRE_EQ( to_record( crec ), rec );
+        for ( size_t i = 0; i < rec.size(); ++i )
+        {
+            REQUIRE( crec[i] == rec[i] );
+            REQUIRE_EQ( hashcode( crec[i] ), hashcode( rec[i] ) );
+            REQUIRE_EQ( hashcode( CompactField::borrow( rec[i] ) ), hashcode( rec[i] ) );
+        }
+        REQUIRE( crec[0].isOwned() && !CompactField::borrow( rec[0] ).isOwned() );
+        CompactRecord copied = crec;
+        REQUIRE( copied[0].strView().data() != crec[0].strView().data() ); // deep copy
+        REQUIRE_EQ( copied[7].value<IntVec>(), IntVec( {1, 2, 3} ) );
+
+        // numeric fields are compared by value; null is less than any value.
+        REQUIRE( CompactField( field( 23 ) ) == CompactField( field( 23.0 ) ) );
+        REQUIRE( CompactField( field( 2 ) ) < CompactField( field( 2.5 ) ) );
+        REQUIRE( CompactField() < CompactField( field( "" ) ) );
+        REQUIRE( CompactField( field( "abc" ) ) < field( "abd" ) );
+    }
+    SECTION( "Compact RowDataFrame" )
+    {
+        std::vector<ColumnDef> colDefs = {StrCol( "Name" ), Int32Col( "Age" ), {FieldTypeTag::Char, "Level"}, TimestampCol( "BirthDate" )};
+        std::vector<StrVec> records{
+                {"John", "23", "A", "2000/10/22"}, {"Tom", "18", "B", "N/A"}, {"Jeff", "12", "A", "2008/10/22"}, {"Tom", "45", "C", "N/A"}};
+        RowDataFrame vdf( records, colDefs ), cdf( RowStorage::Compact );
+        REQUIRE( cdf.from_rows( records, colDefs, &std::cerr ) );
+        REQUIRE_EQ( cdf.size(), 4u );
+        REQUIRE( cdf.compactAt( 1, 0 ) && !vdf.compactAt( 1, 0 ) );
+        for ( size_t i = 0; i < vdf.countRows(); ++i )
+            for ( size_t j = 0; j < vdf.countCols(); ++j )
+                REQUIRE_EQ( cdf( i, j ), vdf( i, j ) );
+
+        MultiColHashMultiIndex hidx;
+        hidx.create( cdf, StrVec{"Name", "BirthDate"} );
+        Record key{field( "Tom" ), NullField{}};
+        REQUIRE_EQ( hidx[key], ULongVec( {1, 3} ) );
+
+        DataFrameWithIndex cidx( IDataFramePtr( cdf.deepCopy() ) ), vidx( IDataFramePtr( vdf.deepCopy() ) );
+        cidx.addHashIndex( {"Level"} );
+        REQUIRE_EQ( cidx.select( Col( "Level" ).isin( record( 'A', 'C' ) ) ).size(), 3u );
+        REQUIRE_EQ( cidx.select( Col( "Age" ) > 15 ).size(), vidx.select( Col( "Age" ) > 15 ).size() );
+
+        vdf.setStorage( RowStorage::Compact );
+        REQUIRE_EQ( vdf( 3, "Age" ), field( 45 ) );
+        vdf.setStorage( RowStorage::Variant );
+        REQUIRE_EQ( vdf( 2, "Name" ), field( "Jeff" ) );
+    }
+}
+
+ADD_TEST_CASE( RowDataFrame_Arena )
+{
+    std::vector<ColumnDef> colDefs = {StrCol( "Name" ), Int32Col( "Age" ), Float64Col( "Score" )};
+    std::vector<StrVec> records{{"John", "23", "29.3"}, {"Tom", "N/A", "45.2"}, {"Jeff", "12", "N/A"}, {"", "7", "40"}};
+    RowDataFrame vdf( records, colDefs ), adf( RowStorage::Arena );
+    REQUIRE( adf.from_rows( records, colDefs, &std::cerr ) );
+    std::ostringstream err;
+    REQUIRE( !adf.appendRowStr( {"Bad", "x", "1.0"}, &err ) );
+    REQUIRE( err.str().find( "appendRowStr: Failed to parse" ) == 0 );
+    REQUIRE_EQ( adf.size(), 4u );
+    REQUIRE_EQ( adf.arena().countChunks(), 1u );
+    REQUIRE_THROW( adf.at( 4, 0 ), std::out_of_range );
+    REQUIRE_THROW( adf.at( 0, 3 ), std::out_of_range );
+    for ( size_t i = 0; i < vdf.countRows(); ++i )
+        for ( size_t j = 0; j < vdf.countCols(); ++j )
+            REQUIRE_EQ( adf( i, j ), vdf( i, j ) );
+    REQUIRE( !adf.compactAt( 0, 0 )->isOwned() ); // string bytes are in arena.
+
+    std::unique_ptr<IDataFrame> copied( adf.deepCopy() );
+    adf.clearRecords();
+    REQUIRE_EQ( adf.size(), 0u );
+    REQUIRE_EQ( adf.arena().countChunks(), 0u );
+    REQUIRE_EQ( copied->at( 2, "Name" ), field( "Jeff" ) );
+
+    static_assert( std::is_copy_constructible_v<RowDataFrame> && std::is_move_constructible_v<RowDataFrame> );
+    RowDataFrame copy( *dynamic_cast<RowDataFrame *>( copied.get() ) ), moved( std::move( copy ) );
+    REQUIRE_EQ( copy.size(), 0u );
+    REQUIRE_EQ( copy.arena().countChunks(), 0u );
+    REQUIRE( copy.from_rows( {{"Reused", "1", "1.0"}}, colDefs ) ); // the moved-from frame allocates new chunks.
+    REQUIRE_EQ( moved.size(), 4u );
+    REQUIRE( moved.storage() == RowStorage::Arena );
+    REQUIRE( moved.compactAt( 2, 0 )->strView().data() != copied->compactAt( 2, 0 )->strView().data() );
+    copied.reset();
+    REQUIRE_EQ( moved( 2, "Name" ), field( "Jeff" ) );
+    adf = moved;
+    moved = std::move( copy );
+    REQUIRE_EQ( adf.size(), 4u );
+    REQUIRE_EQ( adf( 3, "Age" ), field( 7 ) );
+    REQUIRE_EQ( moved.size(), 1u );
+    REQUIRE_EQ( moved( 0, "Name" ), field( "Reused" ) );
+
+    RowDataFrame tdf( RowStorage::Arena ); // inline Timestamp values
+    using Tup = std::tuple<std::string, Timestamp>;
+    const std::vector<Tup> tups{Tup{"Jonathon", mkDate( 2010, 10, 22 )}, Tup{"Jeff", mkDate( 2008, 10, 22 )}};
+    REQUIRE( tdf.from_tuples( tups, {"Name", "BirthDate"} ) );
+    REQUIRE_EQ( tdf( 1, "BirthDate" ), field( mkDate( 2008, 10, 22 ) ) );
+    tdf.setStorage( RowStorage::Variant );
+    REQUIRE_EQ( tdf( 0, "Name" ), field( "Jonathon" ) );
+}
+
+ADD_TEST_CASE( ColumnDataFrame_ListColumn )
+{
+    using Tup = std::tuple<std::string, IntVec, std::vector<double>>;
+    using Tups = std::vector<Tup>;
+    Tups tups{Tup{"a", {1, 2, 3}, {1.5}}, Tup{"b", {}, {2.5, 3.5}}, Tup{"c", {1, 2, 3}, {}}, Tup{"d", {1, 2}, {0.5}}};
+    ColumnDataFrame cdf( tups, {"Name", "Ticks", "Prices"} );
+    RowDataFrame rdf( RowStorage::Compact );
+    REQUIRE( rdf.from_tuples( tups, {"Name", "Ticks", "Prices"} ) );
+
+    const ListColumn<int32_t> *ticks = cdf.listColumn<int32_t>( 1 );
+    REQUIRE( ticks );
+    REQUIRE_EQ( ticks->values(), IntVec( {1, 2, 3, 1, 2, 3, 1, 2} ) ); // flat values
+    REQUIRE_EQ( ticks->offsets(), ULongVec( {0, 3, 3, 6, 8} ) );
+    REQUIRE( ticks->cell( 0 ) == IntVec( {1, 2, 3} ) );
+    REQUIRE( ticks->cell( 3 ) < ticks->cell( 0 ) );
+    REQUIRE_EQ( hashcode( ticks->cell( 2 ) ), hashcode( IntVec{1, 2, 3} ) );
+    REQUIRE_EQ( cdf( 1, "Prices" ), field( std::vector<double>{2.5, 3.5} ) );
+
+    REQUIRE( cdf.appendRecord( Record{field( "e" ), NullField{}, field( std::vector<double>{} )} ) );
+    REQUIRE( !cdf.appendRecord( Record{field( "f" ), field( 1 ), field( std::vector<double>{} )} ) );
+    REQUIRE_EQ( cdf.size(), 5u );
+    REQUIRE( cdf.column( 1 ).isNull( 4 ) );
+
+    MultiColHashMultiIndex hidx;
+    hidx.create( cdf, StrVec{"Ticks"} );
+    REQUIRE_EQ( hidx[record( IntVec{1, 2, 3} )], ULongVec( {0, 2} ) );
+    REQUIRE_EQ( hidx.size(), 4u );
+
+    OrderedIndex ordered;
+    ordered.create( cdf, "Ticks" );
+    REQUIRE_EQ( ordered.getRowIndices(), ULongVec( {4, 1, 3, 0, 2} ) ); // null < [] < [1,2] < [1,2,3]
+
+    DataFrameWithIndex cidx( IDataFramePtr( cdf.deepCopy() ) ), ridx( IDataFramePtr( rdf.deepCopy() ) );
+    auto expr = []() { return Col( "Ticks" ).isin( record( IntVec{1, 2, 3}, IntVec{} ) ); };
+    REQUIRE_EQ( cidx.select( expr() ).size(), 3u );
+    REQUIRE_EQ( ridx.select( expr() ).size(), 3u );
+}
+
+ADD_TEST_CASE( Timestamp_Nanos )
+{
+    Timestamp utc = *ParseDateTime( "2020-12-25T12:05:02.5Z", &std::cerr ); // no time zone: normalized as UTC.
+    REQUIRE_EQ( utc.count(), ( days_from_civil( 2020, 12, 25 ) * 86400 + 12 * 3600 + 5 * 60 + 2 ) * Timestamp::NanosPerSec + 500000000 );
+    Timestamp est = *ParseDateTime( "20201225 07:05:02.5-5", &std::cerr );
+    REQUIRE( est == utc ); // same instant.
+    REQUIRE_EQ( hashcode( est ), hashcode( utc ) );
+    REQUIRE_EQ( est.to_string( nullptr, 1 ), "2020-12-25T07:05:02.5-0500" );
+    REQUIRE_EQ( utc.to_string( nullptr, 1 ), "2020-12-25T12:05:02.5" );
+    REQUIRE_EQ( Timestamp( mkDate( 1999, 2, 28 ) ).to_string(), "1999-02-28" );
+    REQUIRE_EQ( Timestamp( mkTime( 1, 2, 3, 0, 120 ) ).to_string(), "01:02:03+0200" ); // time only
+    REQUIRE( Timestamp( mkDate( 2008, 10, 22 ) ) < Timestamp( mkDate( 2010, 1, 1 ) ) );
+
+    DateTime dt = est.to_datetime();
+    REQUIRE_EQ( dt.hour, 7u );
+    REQUIRE_EQ( dt.nanosec, 500000000u );
+    REQUIRE( dt == *ParseDateTime( "20201225 07:05:02.5-5", &std::cerr ) );
+    int64_t y = 0;
+    unsigned m = 0, d = 0;
+    civil_from_days( days_from_civil( 2000, 2, 29 ), y, m, d );
+    REQUIRE_EQ( y * 10000 + m * 100 + d, 20000229 );
+
+    CompactField cf( TimestampField{est} ); // stored inline.
+    REQUIRE( !cf.isOwned() );
+    REQUIRE_EQ( cf.value<Timestamp>().to_string( nullptr, 1 ), "2020-12-25T07:05:02.5-0500" );
+    REQUIRE( cf == field( utc ) );
+    REQUIRE_EQ( hashcode( cf ), hashcode( field( utc ) ) );
+}
+
+ADD_TEST_CASE( ColumnDataFrame_BoolColumn )
+{
+    std::vector<ColumnDef> colDefs = {Int32Col( "Id" ), BoolCol( "Flag" )};
+    std::vector<StrVec> records;
+    for ( int i = 0; i < 70; ++i ) // spans two bitmap words.
+        records.push_back( {std::to_string( i ), i % 7 == 0 ? "N/A" : i % 3 == 0 ? "1" : "0"} );
+    ColumnDataFrame cdf( records, colDefs );
+    RowDataFrame rdf( records, colDefs );
+    const BoolColumn *flags = cdf.boolColumn( 1 );
+    REQUIRE( flags );
+    REQUIRE_EQ( flags->countNulls(), 10u );
+    REQUIRE_EQ( flags->bits().count(), 20u ); // multiples of 3 but not 7.
+    REQUIRE_EQ( cdf( 3, "Flag" ), field( true ) );
+    REQUIRE_EQ( cdf( 7, "Flag" ).index(), 0u );
+    REQUIRE( flags->select( true, false, false ) == flags->bits() );
+
+    DataFrameWithIndex cidx( IDataFramePtr( cdf.deepCopy() ) ), ridx( IDataFramePtr( rdf.deepCopy() ) );
+    REQUIRE_EQ( cidx.select( Col( "Flag" ) == true ).size(), 20u );
+    REQUIRE_EQ( view_rows( cidx.select( Col( "Flag" ) == true ) ), view_rows( ridx.select( Col( "Flag" ) == true ) ) );
+    REQUIRE_EQ( view_rows( cidx.select( Col( "Flag" ) != true ) ), view_rows( ridx.select( Col( "Flag" ) != true ) ) );
+    REQUIRE_EQ( view_rows( cidx.select( Col( "Flag" ) < true ) ), view_rows( ridx.select( Col( "Flag" ) < true ) ) );
+    REQUIRE_EQ( view_rows( cidx.select( Col( "Flag" ) >= false ) ), view_rows( ridx.select( Col( "Flag" ) >= false ) ) );
+    auto notin = []() { return Col( "Flag" ).notin( record( true ) ); };
+    REQUIRE_EQ( cidx.select( notin() ).size(), 50u ); // false and null
+    REQUIRE_EQ( view_rows( cidx.select( notin() ) ), view_rows( ridx.select( notin() ) ) );
+    auto isFalse = []() { return Col( "Flag" ).isin( record( false ) ); };
+    REQUIRE_EQ( view_rows( cidx.select( isFalse() ) ), view_rows( ridx.select( isFalse() ) ) );
+}
+
+ADD_TEST_CASE( ColumnDataFrame_RunColumn )
+{
+    SparseVector<int32_t> seq;
+    for ( int32_t x : {5, 5, 5, 6, 7, 8, 8, 1, 2} )
+        seq.push_back( x );
+    REQUIRE_EQ( seq.countSegments(), 4u ); // [5,5,5] [6,7,8] [8] [1,2]
+    REQUIRE_EQ( seq.at( 4 ), 7 );
+    REQUIRE_EQ( seq[8], 2 );
+    std::vector<int32_t> iterated;
+    for ( auto it = seq.begin(); it != seq.end(); ++it )
+        iterated.push_back( *it );
+    REQUIRE_EQ( iterated, IntVec( {5, 5, 5, 6, 7, 8, 8, 1, 2} ) );
+    seq.truncate( 5 );
+    REQUIRE_EQ( seq.size(), 5u );
+    REQUIRE_EQ( seq.countSegments(), 2u );
+    SparseVector<int32_t> wrapped; // an incremental run doesn't wrap around from max to min.
+    for ( int32_t x : {INT_MAX - 1, INT_MAX, INT_MIN, INT_MIN + 1} )
+        wrapped.push_back( x );
+    REQUIRE_EQ( wrapped.countSegments(), 2u );
+    REQUIRE_EQ( wrapped[2], INT_MIN );
+
+    std::vector<ColumnDef> colDefs = {RunCol( FieldTypeTag::Str, "Date" ), RunCol( FieldTypeTag::Int64, "Seq" ), Float64Col( "Price" )};
+    std::vector<StrVec> records;
+    for ( int i = 0; i < 40; ++i )
+        records.push_back( {i < 25 ? "20201224" : "20201225", i == 30 ? "N/A" : std::to_string( 100 + i ), std::to_string( i * 0.5 )} );
+    ColumnDataFrame cdf( records, colDefs );
+    RowDataFrame rdf( records, colDefs );
+    REQUIRE_EQ( cdf.runColumn<Str>( 0 )->countSegments(), 2u );
+    REQUIRE_EQ( cdf.runColumn<int64_t>( 1 )->countSegments(), 3u ); // the null breaks the incremental run
+    REQUIRE_EQ( cdf( 27, "Date" ), field( "20201225" ) );
+    REQUIRE_EQ( cdf( 31, "Seq" ), field( int64_t( 131 ) ) );
+    REQUIRE_EQ( cdf( 30, "Seq" ).index(), 0u );
+    std::vector<ColumnDef> vecRunDefs = {RunCol( FieldTypeTag::Int32Vec, "Date" ), Int64Col( "Seq" ), Float64Col( "Price" )};
+    REQUIRE_THROW( ColumnDataFrame( records, vecRunDefs ), std::invalid_argument );
+
+    DataFrameWithIndex cidx( IDataFramePtr( cdf.deepCopy() ) ), ridx( IDataFramePtr( rdf.deepCopy() ) );
+    REQUIRE_EQ( cidx.select( Col( "Date" ) == "20201225" ).size(), 15u );
+    for ( int64_t x : {90, 100, 117, 130, 131, 139, 150} )
+    {
+        REQUIRE_EQ( view_rows( cidx.select( Col( "Seq" ) == x ) ), view_rows( ridx.select( Col( "Seq" ) == x ) ) );
+        REQUIRE_EQ( view_rows( cidx.select( Col( "Seq" ) != x ) ), view_rows( ridx.select( Col( "Seq" ) != x ) ) );
+        REQUIRE_EQ( view_rows( cidx.select( Col( "Seq" ) < x ) ), view_rows( ridx.select( Col( "Seq" ) < x ) ) );
+        REQUIRE_EQ( view_rows( cidx.select( Col( "Seq" ) <= x ) ), view_rows( ridx.select( Col( "Seq" ) <= x ) ) );
+        REQUIRE_EQ( view_rows( cidx.select( Col( "Seq" ) > x ) ), view_rows( ridx.select( Col( "Seq" ) > x ) ) );
+        REQUIRE_EQ( view_rows( cidx.select( Col( "Seq" ) >= x ) ), view_rows( ridx.select( Col( "Seq" ) >= x ) ) );
+    }
+    REQUIRE_EQ( view_rows( cidx.select( Col( "Seq" ) > 117.5 ) ), view_rows( ridx.select( Col( "Seq" ) > 117.5 ) ) );
+    REQUIRE_EQ( view_rows( cidx.select( Col( "Date" ) <= "20201224" && Col( "Seq" ) >= 120 ) ), ULongVec( {20, 21, 22, 23, 24} ) );
+
+    OrderedIndex ordered;
+    ordered.create( cdf, "Seq" );
+    REQUIRE_EQ( ordered.getRowIndices().front(), 30u ); // null first
+
+    ColumnDataFrame wrappedDf( std::vector<StrVec>{{std::to_string( INT_MAX - 1 )}, {std::to_string( INT_MAX )}, {std::to_string( INT_MIN )},
+                                                   {std::to_string( INT_MIN + 1 )}},
+                               {RunCol( FieldTypeTag::Int32, "i" )} );
+    DataFrameWithIndex widx( IDataFramePtr( wrappedDf.deepCopy() ) );
+    REQUIRE_EQ( view_rows( widx.select( Col( "i" ) < 0 ) ), ULongVec( {2, 3} ) );
+    REQUIRE_EQ( view_rows( widx.select( Col( "i" ) > 0 ) ), ULongVec( {0, 1} ) );
+}
+
+ADD_TEST_CASE( DataFrameView_RowMapping )
+{
+    std::vector<ColumnDef> colDefs = {Int32Col( "Id" ), StrCol( "Name" )};
+    std::vector<StrVec> records;
+    for ( int i = 0; i < 100; ++i )
+        records.push_back( {std::to_string( i ), "n" + std::to_string( i % 10 )} );
+    ColumnDataFrame cdf( records, colDefs );
+
+    DataFrameView all;
+    REQUIRE( all.create_column_view( cdf, StrVec{"Name"}, &std::cerr ) );
+    REQUIRE( all.rowMapping().isCompressed() );
+    REQUIRE_EQ( all.rowMapping().runs().countSegments(), 1u );
+    REQUIRE_EQ( all.size(), 100u );
+    REQUIRE_EQ( all.at( 42, "Name" ), field( "n2" ) );
+
+    DataFrameWithIndex cidx( IDataFramePtr( cdf.deepCopy() ) );
+    auto ranges = cidx.select( Col( "Id" ) < 20 || Col( "Id" ) >= 70 ); // two ranges
+    REQUIRE( ranges.rowMapping().isCompressed() );
+    REQUIRE_EQ( ranges.size(), 50u );
+    REQUIRE_EQ( ranges.underlyingRow( 19 ), 19u );
+    REQUIRE_EQ( ranges.underlyingRow( 20 ), 70u );
+    REQUIRE_EQ( ranges.at( 49, "Id" ), field( 99 ) );
+
+    auto scattered = cidx.select( Col( "Name" ) == "n3" ); // every 10th row
+    REQUIRE( !scattered.rowMapping().isCompressed() );
+    REQUIRE_EQ( scattered.underlyingRow( 2 ), 23u );
+
+    DataFrameView slice, sliceOfRanges;
+    REQUIRE( slice.create_range_view( cdf, 10, 60, &std::cerr ) );
+    REQUIRE( slice.rowMapping().isCompressed() );
+    REQUIRE_EQ( slice.at( 0, "Id" ), field( 10 ) );
+    REQUIRE( !slice.create_range_view( cdf, 10, 101 ) );
+    REQUIRE( sliceOfRanges.create_range_view( ranges, 10, 40, &std::cerr ) ); // view of view maps to underlying rows.
+    REQUIRE( sliceOfRanges.rowMapping().isCompressed() );
+    REQUIRE_EQ( sliceOfRanges.underlyingRow( 10 ), 70u );
+    std::vector<size_t> mapped;
+    sliceOfRanges.rowMapping().foreach( [&]( size_t r ) { mapped.push_back( r ); } );
+    REQUIRE_EQ( mapped.size(), 30u );
+    REQUIRE_EQ( mapped.back(), 89u );
+
+    sliceOfRanges.sort_by( {"Id"}, true );
+    REQUIRE_EQ( sliceOfRanges.at( 0, "Id" ), field( 89 ) );
+
+    // rows are compressed as they are pushed, and switch to dense indices once they turn out scattered.
+    RowMapping pushed;
+    pushed.push_back_range( 0, 1000 );
+    pushed.push_back( 1000 );
+    pushed.push_back_range( 2000, 3000 );
+    REQUIRE( pushed.isCompressed() );
+    REQUIRE_EQ( pushed.runs().countSegments(), 2u );
+    REQUIRE_EQ( pushed.size(), 2001u );
+    REQUIRE_EQ( pushed[1001], 2000u );
+    REQUIRE_EQ( pushed.maxRow(), 2999u );
+    for ( size_t i = 0; i < 1000; ++i )
+        pushed.push_back( 4000 + 2 * i );
+    REQUIRE( !pushed.isCompressed() );
+    REQUIRE_EQ( pushed.size(), 3001u );
+    REQUIRE_EQ( pushed[1001], 2000u );
+    REQUIRE_EQ( pushed[3000], 5998u );
+
+    auto scanned = cidx.select( Col( "Id" ) >= 30 ); // typed scan
+    REQUIRE( scanned.rowMapping().isCompressed() );
+    REQUIRE_EQ( scanned.rowMapping().runs().countSegments(), 1u );
+    REQUIRE_EQ( scanned.at( 0, "Id" ), field( 30 ) );
+    REQUIRE( cidx.addIndex( IndexType::OrderedIndex, StrVec{"Id"}, "", &std::cerr ) );
+    auto allBut = cidx.select( Col( "Id" ) != 50 ); // rows between the rows of index lookup
+    REQUIRE( allBut.rowMapping().isCompressed() );
+    REQUIRE_EQ( allBut.size(), 99u );
+    REQUIRE_EQ( allBut.underlyingRow( 50 ), 51u );
+}
+
+ADD_TEST_CASE( DataFrame_Binary )
+{
+    std::vector<ColumnDef> colDefs = {
+            DictStrCol( "Name" ), Int32Col( "Age" ), BoolCol( "Flag" ),
+            Float64Col( "Score" ), TimestampCol( "BirthDate" ), {FieldTypeTag::Int32Vec, "Ticks"}};
+    ColumnDataFrame cdf;
+    cdf.create( colDefs );
+    REQUIRE( cdf.appendRecord(
+            Record{field( "John" ), field( 23 ), field( true ), field( 29.3 ), field( mkDate( 2010, 10, 22 ) ), field( IntVec{1, 2} )} ) );
+    REQUIRE( cdf.appendRecord(
+            Record{field( "Tom" ), NullField{}, field( false ), field( 45.2 ), field( *ParseDateTime( "20201225 12:05:02-4" ) ),
+                   field( IntVec{} )} ) );
+    REQUIRE( cdf.appendRecord( Record{field( "Jeff" ), field( 12 ), NullField{}, NullField{}, NullField{}, field( IntVec{3} )} ) );
+    auto sameCells = []( const IDataFrame &a, const IDataFrame &b ) {
+        if ( a.countRows() != b.countRows() || a.countCols() != b.countCols() )
+            return false;
+        for ( size_t i = 0; i < a.countRows(); ++i )
+            for ( size_t j = 0; j < a.countCols(); ++j )
+                if ( !( a.at( i, j ) == b.at( i, j ) ) || a.columnDef( j ).colName != b.columnDef( j ).colName )
+                    return false;
+        return true;
+    };
+
+    std::stringstream ss;
+    REQUIRE( save_binary( cdf, ss, &std::cerr ) );
+    std::string bytes = ss.str();
+    REQUIRE_EQ( bytes.substr( 0, 4 ), "DFBC" );
+
+    for ( RowStorage storage : {RowStorage::Variant, RowStorage::Compact, RowStorage::Arena} )
+    {
+        RowDataFrame rdf( storage );
+        std::stringstream is( bytes );
+        REQUIRE( rdf.load_binary( is, &std::cerr ) );
+        REQUIRE( sameCells( rdf, cdf ) );
+        std::stringstream resaved; // bytes don't depend on the storage.
+        REQUIRE( save_binary( rdf, resaved, &std::cerr ) );
+        REQUIRE( resaved.str() == bytes );
+    }
+    ColumnDataFrame loaded;
+    std::stringstream is( bytes );
+    REQUIRE( loaded.load_binary( is, &std::cerr ) );
+    REQUIRE( sameCells( loaded, cdf ) );
+    REQUIRE( loaded.dictColumn( 0 ) ); // encoding is kept.
+    REQUIRE_EQ( loaded.at( 1, 4 ), cdf.at( 1, 4 ) );
+    REQUIRE_EQ( std::get<TimestampField>( loaded.at( 1, 4 ) ).value.to_string(), "2020-12-25T12:05:02-0400" );
+
+    DataFrameView view; // any IDataFrame is saved by traversal.
+    REQUIRE( view.create( cdf, ULongVec{2, 0}, StrVec{"Ticks", "Name"}, &std::cerr ) );
+    std::stringstream viewss;
+    REQUIRE( save_binary( view, viewss, &std::cerr ) );
+    RowDataFrame viewLoaded;
+    REQUIRE( viewLoaded.load_binary( viewss, &std::cerr ) );
+    REQUIRE( sameCells( viewLoaded, view ) );
+
+    std::stringstream truncated( bytes.substr( 0, bytes.size() - 3 ) );
+    std::stringstream err;
+    REQUIRE( !loaded.load_binary( truncated, &err ) );
+    REQUIRE( !err.str().empty() );
+
+    // a corrupt length or column block is an error, without allocating the length.
+    std::string corrupt = bytes;
+    const uint64_t hugeLength = uint64_t( 1 ) << 60;
+    std::memcpy( &corrupt[4], &hugeLength, sizeof( hugeLength ) );
+    std::stringstream corruptLength( corrupt );
+    err.str( "" );
+    REQUIRE( !loaded.load_binary( corruptLength, &err ) );
+    REQUIRE( err.str().find( "exceeds" ) != std::string::npos );
+    corrupt = bytes;
+    size_t numRowsPos = 16; // after TypeCode, length and NumCols.
+    for ( const auto &colDef : colDefs )
+        numRowsPos += 3 + colDef.colName.size();
+    const uint64_t moreRows = 1000; // column blocks don't fit in the body.
+    std::memcpy( &corrupt[numRowsPos], &moreRows, sizeof( moreRows ) );
+    std::stringstream corruptBlock( corrupt );
+    err.str( "" );
+    REQUIRE( !loaded.load_binary( corruptBlock, &err ) );
+    REQUIRE( err.str().find( "invalid block" ) != std::string::npos );
+
+    // numeric fields of other types than their columns are saved as the column types.
+    RowDataFrame mixed;
+    mixed.create( {Int64Col( "a" ), Float64Col( "b" )} );
+    REQUIRE( mixed.appendTupple( std::make_tuple( int32_t( 7 ), int32_t( 3 ) ), &std::cerr ) );
+    std::stringstream mixedss;
+    REQUIRE( save_binary( mixed, mixedss, &std::cerr ) );
+    ColumnDataFrame mixedLoaded;
+    REQUIRE( mixedLoaded.load_binary( mixedss, &std::cerr ) );
+    REQUIRE_EQ( std::get<Int64Field>( mixedLoaded.at( 0, 0 ) ).value, 7 );
+    REQUIRE_EQ( std::get<Float64Field>( mixedLoaded.at( 0, 1 ) ).value, 3.0 );
+
+    // a file is read from its memory mapping, and column blocks straight into columns.
+    const std::string filename = ( std::filesystem::temp_directory_path() / "zj_DataFrame_Binary.dfbc" ).string();
+    REQUIRE( save_binary( cdf, filename, &std::cerr ) );
+    ColumnDataFrame fromFile;
+    REQUIRE( fromFile.load_binary( filename, &std::cerr ) );
+    REQUIRE( sameCells( fromFile, cdf ) );
+    REQUIRE( fromFile.column( 1 ).isNull( 1 ) );
+    REQUIRE_EQ( fromFile.listColumn<int32_t>( 5 )->values(), IntVec( {1, 2, 3} ) );
+    RowDataFrame rowsFromFile;
+    REQUIRE( rowsFromFile.load_binary( filename, &std::cerr ) );
+    REQUIRE( sameCells( rowsFromFile, cdf ) );
+    std::ofstream( filename, std::ios::binary | std::ios::trunc ) << corrupt;
+    REQUIRE( !fromFile.load_binary( filename, &err ) );
+    std::ofstream( filename, std::ios::binary | std::ios::trunc ) << bytes.substr( 0, 12 );
+    REQUIRE( !fromFile.load_binary( filename, &err ) );
+    std::filesystem::remove( filename );
+    REQUIRE( !fromFile.load_binary( filename, &err ) );
+}
+
+ADD_TEST_CASE( DataFrameWithIndex_IndexFile )
+{
+    ColumnDataFrame cdf;
+    cdf.create( {DictStrCol( "Name" ), Int32Col( "Age" ), Float64Col( "Score" )} );
+    REQUIRE( cdf.appendRecord( Record{field( "John" ), field( 23 ), field( 29.3 )} ) );
+    REQUIRE( cdf.appendRecord( Record{field( "Tom" ), field( 12 ), field( 45.2 )} ) );
+    REQUIRE( cdf.appendRecord( Record{field( "Jeff" ), field( 23 ), NullField{}} ) );
+    REQUIRE( cdf.appendRecord( Record{field( "Bill" ), field( 30 ), field( 12.0 )} ) );
+
+    DataFrameWithIndex dfidx( IDataFramePtr( cdf.deepCopy() ) );
+    REQUIRE( dfidx.addHashIndex( {"Name"}, "NameHash", &std::cerr ) ); // indexed by codes.
+    REQUIRE( dfidx.addIndex( IndexType::HashMultiIndex, StrVec{"Age"}, "", &std::cerr ) );
+    REQUIRE( dfidx.addIndex( IndexType::ReverseOrderedIndex, StrVec{"Score", "Age"}, "ScoreDesc", &std::cerr ) );
+
+    std::stringstream ss;
+    REQUIRE( dfidx.saveIndexes( ss, &std::cerr ) );
+    std::string bytes = ss.str();
+    REQUIRE_EQ( bytes.substr( 0, 4 ), "DFBI" );
+
+    DataFrameWithIndex loaded( IDataFramePtr( cdf.deepCopy() ) );
+    {
+        std::stringstream is( bytes );
+        REQUIRE( loaded.loadIndexes( is, &std::cerr ) );
+    }
+    auto pOrdered = loaded.findIndex( IndexCategory::OrderedCat, ULongVec{2, 1} );
+    REQUIRE( pOrdered );
+    const auto &orderedIndex = std::get<MultiColOrderedIndex>( ( *pOrdered )->second.value );
+    REQUIRE( orderedIndex.isReverseOrder() );
+    const auto &savedIndex = std::get<MultiColOrderedIndex>( ( *dfidx.findIndex( IndexCategory::OrderedCat, ULongVec{2, 1} ) )->second.value );
+    REQUIRE( orderedIndex.getRowIndices() == savedIndex.getRowIndices() );
+    auto pNameHash = loaded.findIndex( IndexCategory::HashCat, ULongVec{0} );
+    REQUIRE( pNameHash );
+    REQUIRE_EQ( ( *pNameHash )->second.name, "NameHash" );
+    REQUIRE( std::get<MultiColHashMultiIndex>( ( *pNameHash )->second.value ).isCodeIndex() );
+    auto pAgeHash = loaded.findIndex( IndexCategory::HashCat, ULongVec{1} );
+    REQUIRE( pAgeHash );
+    const auto &ageIndex = std::get<MultiColHashMultiIndex>( ( *pAgeHash )->second.value );
+    REQUIRE( ageIndex.isMultiValue() );
+    REQUIRE_EQ( ageIndex.size(), 3u );
+    REQUIRE( ageIndex[record( 23 )] == ULongVec( {0, 2} ) );
+
+    REQUIRE_EQ( loaded.select( Col( "Name" ).isin( record( "John", "Bill" ) ) ).size(), 2u );
+    REQUIRE_EQ( loaded.select( Col( "Age" ) == 23 ).size(), 2u );
+    REQUIRE_EQ( loaded.select( Col( "Score" ) != 45.2 ).size(), 3u );
+    {
+        std::stringstream resaved; // a loaded index is saved the same.
+        REQUIRE( loaded.saveIndexes( resaved, &std::cerr ) );
+        REQUIRE_EQ( resaved.str().size(), bytes.size() );
+    }
+
+    // indexes are rejected if the frame doesn't match.
+    ColumnDataFrame fewer;
+    fewer.create( {DictStrCol( "Name" ), Int32Col( "Age" ), Float64Col( "Score" )} );
+    REQUIRE( fewer.appendRecord( Record{field( "John" ), field( 23 ), field( 29.3 )} ) );
+    DataFrameWithIndex mismatched( IDataFramePtr( fewer.deepCopy() ) );
+    std::stringstream err;
+    {
+        std::stringstream is( bytes );
+        REQUIRE( !mismatched.loadIndexes( is, &err ) );
+        REQUIRE( err.str().find( "number of rows" ) != std::string::npos );
+    }
+    ColumnDataFrame renamed;
+    renamed.create( {DictStrCol( "Name" ), Int32Col( "Years" ), Float64Col( "Score" )} );
+    for ( size_t i = 0; i < cdf.countRows(); ++i )
+        REQUIRE( renamed.appendRecord( Record{cdf.at( i, 0 ), cdf.at( i, 1 ), cdf.at( i, 2 )} ) );
+    DataFrameWithIndex renamedIdx( IDataFramePtr( renamed.deepCopy() ) );
+    {
+        std::stringstream is( bytes );
+        REQUIRE( !renamedIdx.loadIndexes( is, &err ) );
+        REQUIRE( !renamedIdx.findIndex( IndexCategory::HashCat, ULongVec{0} ) );
+    }
+    {
+        std::stringstream is( bytes.substr( 0, bytes.size() - 2 ) );
+        REQUIRE( !loaded.loadIndexes( is, &err ) );
+        REQUIRE( !loaded.findIndex( IndexCategory::HashCat, ULongVec{0} ) );
+    }
+
+    // groups of a corrupt file: rows are missing, or a key is in two groups.
+    MultiColHashMultiIndex fromGroups;
+    REQUIRE( fromGroups.createFromGroups( cdf, {1}, {{0, 2}, {1}, {3}}, &std::cerr ) );
+    REQUIRE_EQ( fromGroups.size(), 3u );
+    REQUIRE( !fromGroups.createFromGroups( cdf, {1}, {{0, 2}, {1}}, &err ) );
+    REQUIRE( err.str().find( "groups have 3 rows" ) != std::string::npos );
+    REQUIRE( !fromGroups.createFromGroups( cdf, {1}, {{0}, {2}, {1}, {3}}, &err ) );
+    REQUIRE( err.str().find( "key of row 2 is in more than one group" ) != std::string::npos );
+    REQUIRE_EQ( fromGroups.size(), 0u );
+    REQUIRE( !fromGroups.createFromGroups( cdf, {0}, {{0}, {0}, {1}, {3}}, &err ) ); // indexed by codes.
+    REQUIRE_EQ( fromGroups.size(), 0u );
+    REQUIRE( !fromGroups.createFromGroups( cdf, {1}, {{0, 1}, {2}, {3}}, &err ) );
+    REQUIRE( err.str().find( "key of row 1 differs from row 0" ) != std::string::npos );
+    REQUIRE( !fromGroups.createFromGroups( cdf, {0}, {{0, 1}, {2}, {3}}, &err ) ); // indexed by codes.
+    REQUIRE_EQ( fromGroups.size(), 0u );
+
+    // sorted rows of a corrupt file are out of order.
+    MultiColOrderedIndex fromSorted;
+    REQUIRE( fromSorted.createFromSorted( cdf, {1}, false, {1, 2, 0, 3}, &std::cerr ) );
+    REQUIRE( fromSorted.createFromSorted( cdf, {1}, true, {3, 0, 2, 1}, &std::cerr ) );
+    REQUIRE( !fromSorted.createFromSorted( cdf, {1}, false, {1, 3, 0, 2}, &err ) );
+    REQUIRE( err.str().find( "row 0 is out of order after row 3" ) != std::string::npos );
+    REQUIRE( !fromSorted.createFromSorted( cdf, {1}, true, {1, 2, 0, 3}, &err ) );
+
+    // indexes saved from other rows of the same shape are rejected.
+    ColumnDataFrame reversed;
+    reversed.create( {DictStrCol( "Name" ), Int32Col( "Age" ), Float64Col( "Score" )} );
+    for ( size_t i = cdf.countRows(); i-- > 0; )
+        REQUIRE( reversed.appendRecord( Record{cdf.at( i, 0 ), cdf.at( i, 1 ), cdf.at( i, 2 )} ) );
+    DataFrameWithIndex reversedIdx( IDataFramePtr( reversed.deepCopy() ) );
+    {
+        std::stringstream is( bytes );
+        REQUIRE( !reversedIdx.loadIndexes( is, &err ) );
+        REQUIRE( !reversedIdx.findIndex( IndexCategory::OrderedCat, ULongVec{2, 1} ) );
+        REQUIRE( !reversedIdx.findIndex( IndexCategory::HashCat, ULongVec{1} ) );
+    }
+}
+
+ADD_TEST_CASE( MappedDataFrame_Basic )
+{
+    std::vector<ColumnDef> colDefs = {StrCol( "Name" ),
+                                      Int32Col( "Age" ),
+                                      BoolCol( "Flag" ),
+                                      Float64Col( "Score" ),
+                                      TimestampCol( "BirthDate" ),
+                                      {FieldTypeTag::Int32Vec, "Ticks"},
+                                      {FieldTypeTag::StrVec, "Tags"}};
+    ColumnDataFrame cdf;
+    cdf.create( colDefs );
+    REQUIRE( cdf.appendRecord( Record{field( "John" ),
+                                      field( 23 ),
+                                      field( true ),
+                                      field( 29.3 ),
+                                      field( mkDate( 2010, 10, 22 ) ),
+                                      field( IntVec{1, 2} ),
+                                      field( StrVec{"a", "b"} )} ) );
+    REQUIRE( cdf.appendRecord( Record{field( "Tom" ),
+                                      NullField{},
+                                      field( false ),
+                                      field( 45.2 ),
+                                      field( *ParseDateTime( "20201225 12:05:02-4" ) ),
+                                      field( IntVec{} ),
+                                      NullField{}} ) );
+    REQUIRE( cdf.appendRecord( Record{NullField{}, field( 12 ), NullField{}, NullField{}, NullField{}, field( IntVec{3} ), field( StrVec{""} )} ) );
+    for ( int i = 0; i < 100; ++i ) // spans multiple validity words.
+        REQUIRE( cdf.appendRecord( Record{field( "Row" + std::to_string( i ) ),
+                                          field( 30 + i ),
+                                          field( i % 3 == 0 ),
+                                          field( i * 0.5 ),
+                                          field( mkDate( 2000, 1, 1 + i % 28 ) ),
+                                          field( IntVec{i} ),
+                                          field( StrVec{} )} ) );
+
+    const std::string filename = ( std::filesystem::temp_directory_path() / "zj_MappedDataFrame_Basic.dfbm" ).string();
+    REQUIRE( save_mapped( cdf, filename, &std::cerr ) );
+
+    MappedDataFrame mdf;
+    REQUIRE( mdf.open( filename, &std::cerr ) );
+    REQUIRE_EQ( mdf.countRows(), cdf.countRows() );
+    REQUIRE_EQ( mdf.countCols(), cdf.countCols() );
+    for ( size_t i = 0; i < cdf.countRows(); ++i )
+        for ( size_t j = 0; j < cdf.countCols(); ++j )
+        {
+            REQUIRE( mdf.at( i, j ) == cdf.at( i, j ) );
+            REQUIRE_EQ( mdf.getColumn( j )->hashAt( i ), hashcode( cdf.at( i, j ) ) );
+        }
+    REQUIRE_EQ( std::get<TimestampField>( mdf.at( 1, "BirthDate" ) ).value.to_string(), "2020-12-25T12:05:02-0400" );
+
+    // typed accessors read the mapping.
+    auto pAge = mdf.mappedColumn<int32_t>( 1 );
+    REQUIRE( pAge );
+    REQUIRE_EQ( pAge->values().size(), cdf.countRows() );
+    REQUIRE_EQ( pAge->values()[0], 23 );
+    REQUIRE( pAge->isNull( 1 ) );
+    REQUIRE_EQ( pAge->countNulls(), 1u );
+    REQUIRE( pAge->validity() && !pAge->validity()->test( 1 ) && pAge->validity()->test( 2 ) );
+    REQUIRE( pAge->plainValues() == pAge->values().begin() );
+    auto pName = mdf.mappedColumn<Str>( 0 );
+    REQUIRE( pName );
+    REQUIRE( !pName->plainValues() );
+    REQUIRE_EQ( pName->valueAt( 1 ), std::string_view( "Tom" ) );
+    REQUIRE( !mdf.mappedColumn<Str>( 1 ) );
+    std::unique_ptr<IColumn> readOnly( mdf.column( 1 ).clone() );
+    REQUIRE( !readOnly->append( field( 1 ) ) );
+    REQUIRE_THROW( readOnly->truncate( 0 ), std::logic_error );
+
+    // conditions scan mapped columns, and indexes work on it.
+    DataFrameWithIndex dfidx( IDataFramePtr( mdf.deepCopy() ) );
+    REQUIRE_EQ( dfidx.select( Col( "Age" ) >= 30 ).size(), 100u );
+    REQUIRE_EQ( dfidx.select( Col( "Flag" ) == true ).size(), 35u );
+    REQUIRE( dfidx.addHashIndex( {"Name"}, "", &std::cerr ) );
+    REQUIRE_EQ( dfidx.select( Col( "Name" ).isin( record( "John", "Row7" ) ) ).size(), 2u );
+    REQUIRE( dfidx.addOrderedIndex( {"Score"}, "", &std::cerr ) );
+    REQUIRE_EQ( dfidx.select( Col( "Score" ) > 45.0 ).size(), 10u );
+
+    MappedDataFrame copied( mdf ); // shares the mapping.
+    mdf.clear();
+    REQUIRE( copied.at( 0, "Ticks" ) == field( IntVec{1, 2} ) );
+
+    std::string bytes;
+    {
+        std::ifstream ifs( filename, std::ios::binary );
+        bytes.assign( std::istreambuf_iterator<char>( ifs ), std::istreambuf_iterator<char>() );
+    }
+    REQUIRE_EQ( bytes.substr( 0, 4 ), "DFBM" );
+    {
+        std::ofstream ofs( filename, std::ios::binary | std::ios::trunc );
+        ofs.write( bytes.data(), bytes.size() - 8 );
+    }
+    std::stringstream err;
+    MappedDataFrame truncated;
+    REQUIRE( !truncated.open( filename, &err ) );
+    REQUIRE( !err.str().empty() );
+    REQUIRE_EQ( truncated.countCols(), 0u );
+    std::filesystem::remove( filename );
+}
+
+ADD_TEST_CASE( MappedDataFrame_RowGroupStats )
+{
+    ColumnDataFrame cdf;
+    cdf.create( {Int64Col( "Seq" ), StrCol( "Symbol" ), Float64Col( "Price" ), {FieldTypeTag::Int32Vec, "Ticks"}} );
+    for ( int i = 0; i < 1000; ++i )
+    {
+        VarField price = i / 100 == 5 ? VarField( NullField{} ) : field( 100.0 - i * 0.1 );
+        REQUIRE( cdf.appendRecord( Record{field( int64_t( i ) ), field( "S" + std::to_string( i / 100 ) ), price, field( IntVec{i} )} ) );
+    }
+    const std::string filename = ( std::filesystem::temp_directory_path() / "zj_MappedDataFrame_RowGroupStats.dfbm" ).string();
+    REQUIRE( save_mapped( cdf, filename, 100, &std::cerr ) );
+    IDataFramePtr pMapped( new MappedDataFrame( filename ) );
+
+    const RowGroupStats *pStats = pMapped->rowGroupStats( 0 );
+    REQUIRE( pStats );
+    REQUIRE_EQ( pStats->countGroups(), 10u );
+    REQUIRE_EQ( pStats->chunks[3].minValue, field( int64_t( 300 ) ) );
+    REQUIRE_EQ( pStats->chunks[3].maxValue, field( int64_t( 399 ) ) );
+    REQUIRE( pMapped->rowGroupStats( 2 )->chunks[5].allNull() );
+    REQUIRE( !pMapped->rowGroupStats( 3 )->chunks[0].hasMinMax() ); // no order statistics for vector.
+    REQUIRE( !cdf.rowGroupStats( 0 ) );
+
+    using Ranges = std::vector<std::pair<Rowindex, Rowindex>>;
+    auto groupsOf = [&]( Expr expr ) {
+        auto pCond = expr.toCondition( *pMapped, &std::cerr );
+        return findRowGroups( pMapped.get(), {pCond.get()} );
+    };
+    REQUIRE( groupsOf( Col( "Seq" ) >= 950 ) == Ranges( {{900, 1000}} ) );
+    REQUIRE( groupsOf( Col( "Symbol" ).isin( record( "S2", "S7" ) ) ) == Ranges( {{200, 300}, {700, 800}} ) );
+    REQUIRE( groupsOf( Col( "Price" ).isnull() ) == Ranges( {{500, 600}} ) );
+    REQUIRE( groupsOf( Col( "Price" ) < 50.0 ) == Ranges( {{500, 1000}} ) ); // nulls are less than values.
+    REQUIRE( !groupsOf( Col( "Seq" ) != 5 ) ); // no group is skipped.
+    REQUIRE( !groupsOf( Col( "Ticks" ) == IntVec{3} ) );
+
+    // results are the same as scanning all the rows.
+    DataFrameWithIndex mapped( pMapped ), inMemory( IDataFramePtr( cdf.deepCopy() ) );
+    auto sameRows = [&]( auto expr ) {
+        auto a = mapped.select( expr ), b = inMemory.select( expr );
+        if ( a.size() != b.size() )
+            return false;
+        for ( size_t i = 0; i < a.size(); ++i )
+            if ( !( a.at( i, "Seq" ) == b.at( i, "Seq" ) ) )
+                return false;
+        return true;
+    };
+    REQUIRE_EQ( mapped.select( Col( "Seq" ) >= 950 ).size(), 50u );
+    REQUIRE( sameRows( Col( "Seq" ) >= 950 ) );
+    REQUIRE( sameRows( Col( "Symbol" ) == "S3" ) );
+    REQUIRE( sameRows( Col( "Symbol" ) > "S8" ) );
+    REQUIRE( sameRows( Col( "Price" ) <= 50.0 ) );
+    REQUIRE( sameRows( Col( "Price" ).notnull() ) );
+    REQUIRE_EQ( mapped.select( Col( "Seq" ) < 250 && Col( "Symbol" ).isin( record( "S2", "S7" ) ) ).size(), 50u );
+    REQUIRE( sameRows( Col( "Seq" ) < 250 && Col( "Symbol" ).isin( record( "S2", "S7" ) ) ) );
+    REQUIRE( sameRows( Col( "Seq" ) > 2000 && Col( "Symbol" ) == "S1" ) );
+
+    // a row group of NaN has no range, so that it's not skipped.
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    ColumnDataFrame nanDf;
+    REQUIRE( nanDf.from_tuples( std::vector<std::tuple<double>>{{nan}, {10.0}, {20.0}, {1.0}, {1.0}, {nan}, {3.0}, {2.0}}, {"x"} ) );
+    REQUIRE( save_mapped( nanDf, filename, 4, &std::cerr ) );
+    IDataFramePtr pNan( new MappedDataFrame( filename ) );
+    REQUIRE( !pNan->rowGroupStats( 0 )->chunks[0].hasMinMax() );
+    REQUIRE( !pNan->rowGroupStats( 0 )->chunks[1].hasMinMax() );
+    DataFrameWithIndex mappedNan( pNan ), inMemoryNan( IDataFramePtr( nanDf.deepCopy() ) );
+    REQUIRE_EQ( mappedNan.select( Col( "x" ) > 5.0 ).size(), 2u );
+    REQUIRE_EQ( mappedNan.select( Col( "x" ) != 1.0 ).size(), inMemoryNan.select( Col( "x" ) != 1.0 ).size() );
+    REQUIRE_EQ( mappedNan.select( Col( "x" ) < 2.5 ).size(), inMemoryNan.select( Col( "x" ) < 2.5 ).size() );
+
+    // numeric fields of other types than their columns are saved as the column types, as the statistics are computed.
+    RowDataFrame mixed;
+    mixed.create( {Int64Col( "a" ), Float64Col( "b" )} );
+    REQUIRE( mixed.appendTupple( std::make_tuple( int32_t( 7 ), int32_t( 3 ) ), &std::cerr ) );
+    REQUIRE( save_mapped( mixed, filename, &std::cerr ) );
+    IDataFramePtr pMixed( new MappedDataFrame( filename ) );
+    REQUIRE_EQ( std::get<Int64Field>( pMixed->at( 0, 0 ) ).value, 7 );
+    REQUIRE_EQ( std::get<Float64Field>( pMixed->at( 0, 1 ) ).value, 3.0 );
+    DataFrameWithIndex mappedMixed( pMixed );
+    REQUIRE_EQ( mappedMixed.select( Col( "a" ) == 7 ).size(), 1u );
+    REQUIRE_EQ( mappedMixed.select( Col( "b" ).isnull() ).size(), 0u );
+
+    // statistics are optional.
+    REQUIRE( save_mapped( cdf, filename, 0, &std::cerr ) );
+    MappedDataFrame noStats( filename );
+    REQUIRE( !noStats.rowGroupStats( 0 ) );
+    std::filesystem::remove( filename );
+}
+
+ADD_TEST_CASE( EncodedIntColumn_Codecs )
+{
+    // every codec round-trips any int64, including wrapped deltas.
+    std::vector<int64_t> vals;
+    for ( int64_t i = 0; i < 1000; ++i )
+        vals.push_back( i % 97 == 3 ? std::numeric_limits<int64_t>::min() : i % 89 == 5 ? std::numeric_limits<int64_t>::max() : i * i - 50 * i );
+    for ( IntCodec codec : {IntCodec::FrameOfReference, IntCodec::Delta, IntCodec::DeltaOfDelta} )
+    {
+        IntBlockVector v( codec );
+        for ( auto x : vals )
+            v.push_back( x );
+        REQUIRE_EQ( v.size(), vals.size() );
+        REQUIRE_EQ( v.countBlocks(), 8u );
+        for ( size_t i = 0; i < vals.size(); ++i )
+            REQUIRE_EQ( v[i], vals[i] );
+        std::vector<int64_t> decoded;
+        v.foreachBlock( [&]( const int64_t *p, size_t n, size_t ibegin ) {
+            REQUIRE_EQ( ibegin, decoded.size() );
+            decoded.insert( decoded.end(), p, p + n );
+        } );
+        REQUIRE( decoded == vals );
+
+        std::vector<uint64_t> words;
+        v.serialize( words );
+        IntBlockVector borrowed;
+        size_t nread = 0;
+        REQUIRE( borrowed.borrow( words.data(), words.size(), nullptr, nread ) );
+        REQUIRE_EQ( nread, words.size() );
+        REQUIRE( borrowed.isBorrowed() );
+        for ( size_t i = 0; i < vals.size(); ++i )
+            REQUIRE_EQ( borrowed[i], vals[i] );
+        REQUIRE( !borrowed.borrow( words.data(), words.size() - 1, nullptr, nread ) );
+
+        v.truncate( 300 );
+        v.push_back( 7 );
+        REQUIRE_EQ( v.size(), 301u );
+        REQUIRE_EQ( v[299], vals[299] );
+        REQUIRE_EQ( v[300], 7 );
+    }
+
+    // regular timestamps and bounded ints are packed in a few bits.
+    const int64_t t0 = 1600000000 * Timestamp::NanosPerSec;
+    ColumnDataFrame cdf;
+    cdf.create( {ColumnDef{FieldTypeTag::Timestamp, "Time", ColumnEncoding::DeltaOfDelta},
+                 ColumnDef{FieldTypeTag::Int64, "Seq", ColumnEncoding::Delta},
+                 ColumnDef{FieldTypeTag::Int32, "Qty", ColumnEncoding::FrameOfReference},
+                 Int32Col( "PlainQty" )} );
+    for ( int i = 0; i < 1000; ++i )
+    {
+        VarField qty = i % 10 == 9 ? VarField( NullField{} ) : field( 100 + i % 7 );
+        REQUIRE( cdf.appendRecord( Record{field( Timestamp( t0 + i * Timestamp::NanosPerSec ) ), field( int64_t( 5000 + i * 2 ) ), qty, qty} ) );
+    }
+    const auto *pTime = cdf.encodedColumn<Timestamp>( 0 );
+    const auto *pSeq = cdf.encodedColumn<int64_t>( 1 );
+    REQUIRE( pTime && pSeq && cdf.encodedColumn<int32_t>( 2 ) && !cdf.encodedColumn<int32_t>( 3 ) );
+    REQUIRE( pTime->encodedBytes() < 1000 * 12 / 4 );
+    REQUIRE( pSeq->encodedBytes() < 1000 * 8 / 4 );
+    REQUIRE_EQ( cdf.at( 3, "Time" ), field( Timestamp( t0 + 3 * Timestamp::NanosPerSec ) ) );
+    REQUIRE_EQ( cdf.at( 999, "Seq" ), field( int64_t( 6998 ) ) );
+    REQUIRE_EQ( cdf.at( 19, "Qty" ), VarField( NullField{} ) );
+    REQUIRE_EQ( cdf.at( 20, "Qty" ), field( 106 ) );
+    REQUIRE_THROW( create_column( ColumnDef{FieldTypeTag::Float64, "F", ColumnEncoding::Delta} ), std::invalid_argument );
+
+    // block scans match plain scans.
+    DataFrameWithIndex indexed( IDataFramePtr( cdf.deepCopy() ) );
+    REQUIRE_EQ( indexed.select( Col( "Seq" ) >= 6000 ).size(), 500u );
+    REQUIRE_EQ( indexed.select( Col( "Time" ) < Timestamp( t0 + 10 * Timestamp::NanosPerSec ) ).size(), 10u );
+    REQUIRE_EQ( indexed.select( Col( "Qty" ) == 103 ).size(), indexed.select( Col( "PlainQty" ) == 103 ).size() );
+    REQUIRE_EQ( indexed.select( Col( "Qty" ) < 103 ).size(), indexed.select( Col( "PlainQty" ) < 103 ).size() );
+
+    // codecs are kept in DFBC and DFBM, and DFBM columns are decoded from mapping.
+    std::stringstream ss;
+    REQUIRE( save_binary( cdf, ss, &std::cerr ) );
+    ColumnDataFrame loaded;
+    REQUIRE( loaded.load_binary( ss, &std::cerr ) );
+    REQUIRE( loaded.encodedColumn<Timestamp>( 0 ) );
+
+    const std::string filename = ( std::filesystem::temp_directory_path() / "zj_EncodedIntColumn_Codecs.dfbm" ).string();
+    REQUIRE( save_mapped( cdf, filename, 100, &std::cerr ) );
+    {
+        MappedDataFrame mapped( filename );
+        const IColumn *pMappedTime = mapped.getColumn( 0 );
+        REQUIRE( dynamic_cast<const EncodedIntColumn<Timestamp> *>( pMappedTime ) );
+        REQUIRE( !dynamic_cast<const EncodedIntColumn<Timestamp> *>( pMappedTime )->encodedValues().empty() );
+        for ( size_t i = 0; i < cdf.countRows(); ++i )
+            for ( size_t j = 0; j < cdf.countCols(); ++j )
+                REQUIRE_EQ( mapped.at( i, j ), cdf.at( i, j ) );
+        std::unique_ptr<IColumn> pCopy( pMappedTime->clone() );
+        REQUIRE( !pCopy->append( field( Timestamp( t0 ) ) ) ); // read-only.
+        DataFrameWithIndex mappedIndexed( IDataFramePtr( mapped.deepCopy() ) );
+        REQUIRE_EQ( mappedIndexed.select( Col( "Seq" ) >= 6000 ).size(), 500u );
+        REQUIRE_EQ( mappedIndexed.select( Col( "Qty" ).isnull() ).size(), 100u );
+    }
+    // RowDataFrame doesn't encode columns, but an integer codec of other column types is still an error in DFBM.
+    RowDataFrame rdf;
+    rdf.create( {ColumnDef{FieldTypeTag::Float64, "a", ColumnEncoding::Delta}} );
+    REQUIRE( rdf.appendTupple( std::make_tuple( 1.5 ) ) );
+    std::stringstream err;
+    REQUIRE( !save_mapped( rdf, filename, &err ) );
+    REQUIRE( err.str().find( "Integer codec expects" ) != std::string::npos );
+    std::filesystem::remove( filename );
+}